@@ -20,307 +20,1815 @@
 #include "driverlib/ssi.h"
 #include "driverlib/sysctl.h"
 #include "driverlib/uart.h"
+#include "inc/hw_gpio.h"
 #include "inc/hw_memmap.h"
 #include "inc/hw_ints.h"
+#include "inc/hw_types.h"
 #include "utils/uartstdio.h"
 #include "utils/cmdline.h"
 #include "utils/ustdlib.h"
 
 #include "utilities/nRF24L01.h"
+#include "utilities/secure.h"
+#include "utilities/netkey.h"
+#include "utilities/cyclecount.h"
+#include "utilities/timesync.h"
+#include "utilities/push.h"
+#include "utilities/broadcast.h"
+#include "utilities/tdma.h"
+#include "utilities/relay.h"
+#include "utilities/spitrace.h"
+#include "utilities/deliver.h"
+#include "utilities/channel.h"
+#include "utilities/board.h"
+#include "utilities/ramfunc.h"
+
+#include "bench.h"
+#include "capture.h"
+#include "console.h"
+#include "events.h"
+#include "health.h"
+#include "latency.h"
+#include "led.h"
+#include "poll.h"
+#include "profile.h"
+#include "route.h"
+#include "schedule.h"
+#include "sensor.h"
+#include "trace.h"
 
 void setup(void);
 void ConfigureUART(void);
+void BenchRadioReturn(void);
 int CMD_help(int argc, char **argv);
 int CMD_status(int argc, char **argv);
 int CMD_verbose(int argc, char **argv);
 int CMD_LED(int argc, char **argv);
 int CMD_RGB(int argc, char **argv);
+int CMD_crypto(int argc, char **argv);
+int CMD_load(int argc, char **argv);
+int CMD_health(int argc, char **argv);
+int CMD_sensor(int argc, char **argv);
+int CMD_at(int argc, char **argv);
+int CMD_sync(int argc, char **argv);
+int CMD_urgent(int argc, char **argv);
+int CMD_bcast(int argc, char **argv);
+int CMD_latency(int argc, char **argv);
+int CMD_sched(int argc, char **argv);
+int CMD_pace(int argc, char **argv);
+int CMD_route(int argc, char **argv);
+int CMD_spitrace(int argc, char **argv);
+int CMD_profile(int argc, char **argv);
+int CMD_bench(int argc, char **argv);
+int CMD_capture(int argc, char **argv);
+int CMD_delivery(int argc, char **argv);
+int CMD_echo(int argc, char **argv);
 
-bool g_bCMDReturn = false;
 bool g_bVerbose = false;
 
 uint32_t gui32SysClock;
 
+//
+// Radio configuration, less the PRIM_RX bit.  Data sent and max retransmit
+// interrupts are left enabled; they end a push or a broadcast.
+//
+#define RADIO_CFG               (nRF_CFG_EN_CRC | nRF_CFG_PWR_UP)
+
+//
+// The network runs at the radio's reset data rate, 2 Mbps at 0 dBm, and
+// retransmit setting, 3 retransmissions 250 us apart, with every pipe
+// auto-acknowledged.  They are set at bring-up all the same, since the
+// benchmark changes them.  The 250 us delay is enough here, as nodes
+// acknowledge pushes without a payload; the nodes themselves, whose polls
+// are answered with sealed ACK payloads, wait 500 us.
+//
+#define RADIO_RF_SETUP          0x0F
+#define RADIO_SETUP_RETR        0x03
+#define RADIO_EN_AA             0x3F
+
+//
+// Registers set at bring-up, less CONFIG, as a tnRFRegister initialiser.
+// The watchdog checks them against the same table.  Broadcasts need the
+// no-ACK write.
+//
+#define RADIO_REGISTERS(iRadio)                                               \
+    {                                                                         \
+        {nRF_O_RF_CH, 1, {CHANNEL_RADIO_RF(iRadio)}},                         \
+        {nRF_O_RF_SETUP, 1, {RADIO_RF_SETUP}},                                \
+        {nRF_O_SETUP_RETR, 1, {RADIO_SETUP_RETR}},                            \
+        {nRF_O_EN_AA, 1, {RADIO_EN_AA}},                                      \
+        {nRF_O_FEATURE, 1, {nRF_EN_DPL | nRF_EN_ACK_PAY | nRF_EN_DYN_ACK}},   \
+        {nRF_O_DYNPD, 1, {nRF_DATA_PIPE_0}},                                  \
+        {nRF_O_EN_RXADDR, 1, {nRF_DATA_PIPE_0}},                              \
+        {nRF_O_RX_ADDR_P0, PUSH_ADDR_LEN, PUSH_POLL_ADDR},                    \
+    }
+
+//
+// Attempts to push an urgent command before it falls back to an ACK
+// payload, and the SysTick periods between attempts.  A node only misses a
+// push while it is sending its own poll.
+//
+#define PUSH_TRIES              5
+#define PUSH_RETRY_TICKS        1
+
+//
+// SysTick periods between copies of a broadcast.  A node misses one only
+// while it is sending its own poll, which takes a few milliseconds.
+//
+#define BROADCAST_GAP_TICKS     1
+
+//
+// Longest a receiver takes to send the ACK for a poll after raising RX_DR:
+// the RX to TX turnaround plus the ACK with a full payload, with margin.  A
+// poll waits this long for TX_DS before it is taken to have gone without
+// the staged payload.
+//
+#define ACK_SENT_WAIT_US        400
+
+//*****************************************************************************
+//
+// Input buffer for the command line interpreter.
+//
+//*****************************************************************************
+static char g_cInput[128];
+
+//
+// Urgent commands waiting to be pushed.
+//
+tAutoCmd g_psUrgent[NUM_SLAVES];
+
+//
+// Pushes that gave up and fell back to the ACK payload queue, and queued
+// commands dropped to make room for them.
+//
+uint32_t g_ui32PushFallbacks;
+uint32_t g_ui32PushDrops;
+
+#if NUM_SLAVES > BROADCAST_ID
+#error "Node IDs must be below BROADCAST_ID"
+#endif
+
+//
+// Link broadcasts are sealed on, the broadcast going out, and the time it
+// was entered.  g_ui32Broadcasts counts those entered, and
+// g_ui32BroadcastCopies the copies sent of them on all radios.
+// g_ui32BroadcastUs is how long the last took from being entered to its
+// last copy.
+//
+tSecureLink g_sBroadcastLink;
+uint8_t g_pui8Broadcast[SECURE_MAX_FRAME];
+int g_iBroadcastLen;
+uint32_t g_ui32BroadcastIssued;
+uint32_t g_ui32Broadcasts;
+uint32_t g_ui32BroadcastCopies;
+uint32_t g_ui32BroadcastUs;
+
+//*****************************************************************************
+//
+// The master's radios, wired as board.h describes.  Each serves the nodes
+// CHANNEL_RADIO() gives it on its own RF channel, so polls and pushes run on
+// all of them at once.
+//
+//*****************************************************************************
+#if CHANNEL_RADIOS > BOARD_RADIOS
+#error "The board has fewer radios than CHANNEL_RADIOS"
+#endif
+
 typedef struct
 {
+    tnRFRadio sSPI;
+
+    uint32_t ui32CEPort;
+
+    uint8_t ui8CEPin;
+
+    uint8_t ui8IRQPin;
+
+    //
+    // Network time the IRQ was last asserted, and whether it has yet to be
+    // matched to the poll that raised it.  bIRQ is set from the IRQ until
+    // RadioService() runs.
+    //
+    uint32_t ui32Arrival;
+
+    bool bArrivalValid;
+
+    volatile bool bIRQ;
+
+    //
+    // Slave a push is in flight to, or -1; attempts made on the current
+    // urgent command; tick before which it is not retried; network time
+    // the attempt in flight started.
+    //
+    int iPushSlave;
+
+    uint32_t ui32PushTries;
+
+    uint32_t ui32PushRetryTick;
+
+    uint32_t ui32PushStart;
+
+    //
+    // Whether a copy of the broadcast is in flight, copies still to send
+    // and the tick before which the next is not.  The copy in flight times
+    // from ui32PushStart.
+    //
+    bool bBroadcasting;
+
+    uint32_t ui32BroadcastLeft;
+
+    uint32_t ui32BroadcastTick;
+
     //
-    //! A pointer to a string containing the name of the command.
+    // False if the radio failed its bring-up, in which case it is left
+    // disabled.  bRetry is set if the watchdog reset it and it did not come
+    // back, and it is tried again at ui32RetryTick.
     //
-    uint8_t ui8Len;
+    bool bUp;
+
+    bool bRetry;
+
+    uint32_t ui32RetryTick;
+
+    //
+    // The poll at the head of the RX FIFO is left there until TX_DS shows
+    // whether the staged payload went with its ACK, or until
+    // ACK_SENT_WAIT_US after ui32AckWaitStart.  The arrival time it
+    // claimed is kept meanwhile.
+    //
+    bool bAckWait;
+
+    bool bAckWaitTimed;
+
+    uint32_t ui32AckWaitStart;
+
+    uint32_t ui32AckWaitArrival;
+}
+tMasterRadio;
+
+tMasterRadio g_psRadios[CHANNEL_RADIOS] =
+{
+    {{BOARD_RADIO0_SSI_BASE, BOARD_RADIO0_CS_PORT, BOARD_RADIO0_CS_PIN},
+     BOARD_RADIO0_CE_PORT, BOARD_RADIO0_CE_PIN, BOARD_RADIO0_IRQ_PIN, 0,
+     false, false, -1},
+#if CHANNEL_RADIOS > 1
+    {{BOARD_RADIO1_SSI_BASE, BOARD_RADIO1_CS_PORT, BOARD_RADIO1_CS_PIN},
+     BOARD_RADIO1_CE_PORT, BOARD_RADIO1_CE_PIN, BOARD_RADIO1_IRQ_PIN, 0,
+     false, false, -1},
+#endif
+};
+
+//
+// Calls to GPIOPortHIntHandler() and the cycles spent in them, from its
+// first instruction to its last, for the "load" command.
+//
+uint32_t g_ui32IRQCalls;
+uint64_t g_ui64IRQCycles;
+uint32_t g_ui32IRQMaxCycles;
+
+//
+// Cycles spent in RadioService() for each radio event, and in PollHandle()
+// for each poll, which run from flash and call the SRAM path.  Build with
+// and without NO_RAMFUNC and compare "load" over the same traffic.
+//
+tCycleStat g_sServiceCycles;
+tCycleStat g_sPollCycles;
+
+//
+// Radio lent to the benchmark by the "bench" command, or -1.
+//
+int g_iBenchRadio = -1;
+
+//
+// Set by the "at" command while it runs another command, so that commands
+// queued meanwhile are wrapped to execute at g_ui32ExecuteAt.
+//
+bool g_bExecuteAt;
+uint32_t g_ui32ExecuteAt;
+
+//
+// Set by the "urgent" command while it runs another command, so that
+// commands queued meanwhile are pushed rather than waiting for a poll.
+//
+bool g_bUrgent;
+
+//
+// Set by the "bcast" command while it runs another command, so that
+// commands queued meanwhile for nodes in range go into one broadcast
+// instead, with the nodes in g_ui32BroadcastMask.
+//
+bool g_bBroadcast;
+uint32_t g_ui32BroadcastMask;
+uint8_t g_pui8BroadcastCmd[SECURE_MAX_PAYLOAD - BROADCAST_HDR_LEN];
+int g_iBroadcastCmdLen;
+
+//*****************************************************************************
+//
+// A table of terminal commands, callback functions, and descriptions, as
+// needed by the TivaWare command line processor.
+//
+//*****************************************************************************
+tCmdLineEntry g_psCmdTable[] =
+{
+    {"help",     CMD_help,      "    : Display list of commands" },
+    {"status",   CMD_status,    "  : Read the radio's status register"},
+    {"verbose",  CMD_verbose,   " : Toggle verbosity" },
+    {"LED",      CMD_LED,       "     : \"LED state id\", where state = [on|off] and id = [0-4] or a list such as 0,2,3"},
+    {"RGB",      CMD_RGB,       "     : \"RGB id R G B\", where id is as for LED and R,G,B = [0-(2^16-1)]"},
+    {"at",       CMD_at,        "      : \"at ms command\", run an LED or RGB command on every node ms from now"},
+    {"sync",     CMD_sync,      "    : Show each node's clock error after its last time sync"},
+    {"urgent",   CMD_urgent,    "  : \"urgent command\", push an LED or RGB command without waiting for a poll"},
+    {"bcast",    CMD_bcast,     "   : \"bcast [copies] command\", send an LED or RGB command to nodes in range in one frame"},
+    {"latency",  CMD_latency,   " : Show command delivery latency by class"},
+    {"delivery", CMD_delivery,  ": Show confirmed, retried and failed commands for each node"},
+    {"sched",    CMD_sched,     "   : Show the polling schedule and each node's retransmissions"},
+    {"pace",     CMD_pace,      "    : \"pace id fast|slow\", tell nodes to expect more commands or to poll seldom"},
+    {"route",    CMD_route,     "   : Show how each node is reached and what relays forwarded"},
+    {"capture",  CMD_capture,   " : \"capture [on|off]\", stream radio traffic for host/replay"},
+    {"echo",     CMD_echo,      "    : \"echo [on|off]\", echo typed input back; host/gateway turns it off"},
+    {"spitrace", CMD_spitrace,  ": \"spitrace [clear]\", dump the radio SPI trace for host/spitrace.py"},
+    {"profile",  CMD_profile,   " : \"profile [start [hz]|stop|dump]\", sample the CPU for host/profile.py"},
+    {"bench",    CMD_bench,     "   : \"bench [quick|full [radio]|stop]\", benchmark a radio against Node_Bench"},
+    {"crypto",   CMD_crypto,    "  : Show radio link security overhead and rejects"},
+    {"load",     CMD_load,      "    : \"load [clear]\", show idle CPU load, event dispatch latency and radio path cycles"},
+    {"health",   CMD_health,    "  : Show radio faults found by the watchdog and time to recover"},
+    {"sensor",   CMD_sensor,    "  : \"sensor id [raw|10s|5m]\", show a sensor node's readings"},
+    { 0, 0, 0 }
+};
+
+//*****************************************************************************
+//
+// Queue a command for a slave, to be sent in the ACK to its next poll, or
+// pushed if the "urgent" command is running and the slave is in range.
+// While the "at" command is running, the command is wrapped with the time
+// at which the slave should execute it.  A command still waiting for the
+// slave is replaced.  While the "bcast" command is running, a slave in
+// range is added to the broadcast instead.
+//
+//*****************************************************************************
+void
+CommandQueue(uint32_t ui32SlaveIndex, const uint8_t *pui8Cmd, int iLen)
+{
+    tAutoCmd *psCmd = &g_psAckData[ui32SlaveIndex];
+
+    if (g_bBroadcast && RouteIsDirect(ui32SlaveIndex) &&
+        (ui32SlaveIndex < 32) && (iLen <= sizeof(g_pui8BroadcastCmd)))
+    {
+        g_ui32BroadcastMask |= 1 << ui32SlaveIndex;
+        memcpy(g_pui8BroadcastCmd, pui8Cmd, iLen);
+        g_iBroadcastCmdLen = iLen;
+        return;
+    }
+
+    if (g_bUrgent && RouteIsDirect(ui32SlaveIndex))
+    {
+        psCmd = &g_psUrgent[ui32SlaveIndex];
+    } else if (g_psAckBehind[ui32SlaveIndex].ui8Len != 0) {
+        psCmd = &g_psAckBehind[ui32SlaveIndex];
+    }
+    if (psCmd->ui8Len != 0)
+    {
+        ConsolePrintf("DELIVERY %d %u replaced\n", ui32SlaveIndex,
+                      psCmd->ui8Seq);
+    }
+
+    if (g_bUrgent)
+    {
+        psCmd->ui8Class = LATENCY_URGENT;
+    } else if (g_bExecuteAt) {
+        psCmd->ui8Class = LATENCY_AT;
+    } else {
+        psCmd->ui8Class = LATENCY_BULK;
+    }
+    psCmd->ui32Issued = EventMicros();
 
-    char pcCmd[32];
+    if (g_bExecuteAt)
+    {
+        psCmd->pcCmd[0] = TIMESYNC_MSG_AT;
+        memcpy(psCmd->pcCmd + 1, &g_ui32ExecuteAt, 4);
+        memcpy(psCmd->pcCmd + TIMESYNC_AT_HDR_LEN, pui8Cmd, iLen);
+        psCmd->ui8Len = iLen + TIMESYNC_AT_HDR_LEN;
+    } else {
+        memcpy(psCmd->pcCmd, pui8Cmd, iLen);
+        psCmd->ui8Len = iLen;
+    }
+    psCmd->ui8Seq = DeliverySeqNext(ui32SlaveIndex);
+    ConsolePrintf("DELIVERY %d %u queued\n", ui32SlaveIndex, psCmd->ui8Seq);
+    CaptureCommand(ui32SlaveIndex, psCmd,
+                   psCmd == &g_psUrgent[ui32SlaveIndex]);
+}
+
+//*****************************************************************************
+//
+// Parse a slave index, or a comma separated list of them, into a bit mask.
+// Returns 0 if any index is out of range.
+//
+//*****************************************************************************
+uint32_t
+SlaveListParse(char *pcList)
+{
+    uint32_t ui32Mask = 0, ui32SlaveIndex;
+    char* pcEnd;
+
+    while (1)
+    {
+        ui32SlaveIndex = ustrtoul(pcList, &pcEnd, 10);
+        if ((pcEnd == pcList) || (ui32SlaveIndex >= NUM_SLAVES))
+        {
+            return 0;
+        }
+        ui32Mask |= 1 << ui32SlaveIndex;
+        if (*pcEnd != ',')
+        {
+            return ui32Mask;
+        }
+        pcList = pcEnd + 1;
+    }
+}
+
+int
+CMD_RGB(int argc, char **argv)
+{
+    uint32_t ui32SlaveIndex, ui32Mask;
+    uint16_t ui16Red, ui16Green, ui16Blue;
+    uint8_t pui8Cmd[8];
+    char* throwaway;
+    if (argc > 4)
+    {
+        ui32Mask = SlaveListParse(*(argv + 1));
+        if (ui32Mask == 0)
+        {
+            return CMDLINE_INVALID_ARG;
+        }
+        ui16Red = ustrtoul(*(argv + 2), &throwaway, 10);
+        ui16Green = ustrtoul(*(argv + 3), &throwaway, 10);
+        ui16Blue = ustrtoul(*(argv + 4), &throwaway, 10);
+        pui8Cmd[0] = 0xA3;
+        pui8Cmd[1] = 0;
+        memcpy(pui8Cmd + 2, &ui16Red, 2);
+        memcpy(pui8Cmd + 4, &ui16Green, 2);
+        memcpy(pui8Cmd + 6, &ui16Blue, 2);
+        for (ui32SlaveIndex = 0; ui32SlaveIndex < NUM_SLAVES; ui32SlaveIndex++)
+        {
+            if (ui32Mask & (1 << ui32SlaveIndex))
+            {
+                CommandQueue(ui32SlaveIndex, pui8Cmd, sizeof(pui8Cmd));
+            }
+        }
+        return 0;
+    }
+    return CMDLINE_TOO_FEW_ARGS;
+}
+        
+
+//*****************************************************************************
+//
+// Takes two arguments, the first is either "on" or "off", the second is a
+// slave index or list of them. Sends a command to the indicated slaves to
+// turn their LEDs either on or off.
+//
+//*****************************************************************************
+int
+CMD_LED(int argc, char **argv)
+{
+    uint32_t ui32SlaveIndex, ui32Mask;
+    uint8_t ui8Cmd;
+    if (argc > 2)
+    {
+        ui32Mask = SlaveListParse(*(argv + 2));
+        if (!strcmp(*(argv + 1),"on"))
+        {
+            ui8Cmd = 0xA1;
+        } else if (!strcmp(*(argv + 1),"off"))
+        {
+            ui8Cmd = 0xA2;
+        } else {
+            return CMDLINE_INVALID_ARG;
+        }
+        if (ui32Mask == 0)
+        {
+            return CMDLINE_INVALID_ARG;
+        }
+        for (ui32SlaveIndex = 0; ui32SlaveIndex < NUM_SLAVES; ui32SlaveIndex++)
+        {
+            if (ui32Mask & (1 << ui32SlaveIndex))
+            {
+                CommandQueue(ui32SlaveIndex, &ui8Cmd, 1);
+            }
+        }
+        return 0;
+    }
+    return CMDLINE_TOO_FEW_ARGS;
+}
+
+//*****************************************************************************
+//
+// Look up a command that queues commands for nodes, so it can be run by
+// "at" or "urgent".  Returns 0 for any other command.
+//
+//*****************************************************************************
+tCmdLineEntry*
+NodeCommandFind(char *pcName)
+{
+    tCmdLineEntry* psCommand = g_psCmdTable;
+
+    while (psCommand->pcCmd && strcmp(psCommand->pcCmd, pcName))
+    {
+        psCommand++;
+    }
+    if ((psCommand->pfnCmd != CMD_LED) && (psCommand->pfnCmd != CMD_RGB))
+    {
+        return 0;
+    }
+    return psCommand;
+}
+
+//*****************************************************************************
+//
+// Takes a delay in milliseconds followed by an LED or RGB command.  Every
+// slave it addresses executes it at the same network time, however far
+// apart their polls fall, so the delay must cover a full polling period.
+//
+//*****************************************************************************
+int
+CMD_at(int argc, char **argv)
+{
+    tCmdLineEntry* psCommand;
+    char* throwaway;
+    int iStatus;
+
+    if (argc < 3)
+    {
+        return CMDLINE_TOO_FEW_ARGS;
+    }
+    psCommand = NodeCommandFind(*(argv + 2));
+    if (psCommand == 0)
+    {
+        return CMDLINE_INVALID_ARG;
+    }
+
+    g_ui32ExecuteAt = EventMicros() +
+                      (ustrtoul(*(argv + 1), &throwaway, 10) * 1000);
+    g_bExecuteAt = true;
+    iStatus = psCommand->pfnCmd(argc - 2, argv + 2);
+    g_bExecuteAt = false;
+
+    return iStatus;
+}
+
+//*****************************************************************************
+//
+// Print the contents of each radio's status register to the serial terminal.
+//
+//*****************************************************************************
+int
+CMD_status(int argc, char **argv)
+{
+    int i;
+
+    for (i = 0; i < CHANNEL_RADIOS; i++)
+    {
+        if (i == g_iBenchRadio)
+        {
+            ConsolePrintf("Radio %d: benchmarking\n", i);
+            continue;
+        }
+        if (!g_psRadios[i].bUp)
+        {
+            ConsolePrintf("Radio %d: down\n", i);
+            continue;
+        }
+        nRFRadioSelect(&g_psRadios[i].sSPI);
+        ConsolePrintf("Radio %d: %02x\n", i, nRFStatusGet());
+    }
+    return(0);
+}
+
+
+void
+CycleStatPrint(char *pcName, char *pcUnit, tCycleStat *psStat)
+{
+    uint32_t ui32Avg, ui32PerUs = gui32SysClock / 1000000;
+
+    ui32Avg = (psStat->ui32Count ?
+               (uint32_t)(psStat->ui64Total / psStat->ui32Count) : 0);
+    ConsolePrintf("%s: %u %s, avg %u cycles (%u us), "
+                  "max %u cycles (%u us)\n", pcName, psStat->ui32Count,
+                  pcUnit, ui32Avg, ui32Avg / ui32PerUs, psStat->ui32Max,
+                  psStat->ui32Max / ui32PerUs);
+}
+
+//*****************************************************************************
+//
+// Print the per-message cost of the secure radio link and the frames each
+// node's link has rejected.
+//
+//*****************************************************************************
+int
+CMD_crypto(int argc, char **argv)
+{
+    int i;
+
+    ConsolePrintf("Overhead: %d bytes per frame\n", SECURE_OVERHEAD);
+    CycleStatPrint("Open", "frames", &g_sOpenCycles);
+    CycleStatPrint("Seal", "frames", &g_sSealCycles);
+    ConsolePrintf("Node  AuthFail  Replay\n");
+    for (i = 0; i < NUM_SLAVES; i++)
+    {
+        ConsolePrintf("%4d  %8u  %6u\n", i, g_psLinks[i].ui32AuthFail,
+                      g_psLinks[i].ui32Replay);
+    }
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Takes an LED or RGB command and pushes it to the nodes it addresses as
+// soon as the radio is free, rather than waiting for their next polls.
+//
+//*****************************************************************************
+int
+CMD_urgent(int argc, char **argv)
+{
+    tCmdLineEntry* psCommand;
+    int iStatus;
+
+    if (argc < 2)
+    {
+        return CMDLINE_TOO_FEW_ARGS;
+    }
+    psCommand = NodeCommandFind(*(argv + 1));
+    if (psCommand == 0)
+    {
+        return CMDLINE_INVALID_ARG;
+    }
+
+    g_bUrgent = true;
+    iStatus = psCommand->pfnCmd(argc - 1, argv + 1);
+    g_bUrgent = false;
+
+    return iStatus;
+}
+
+//*****************************************************************************
+//
+// Takes an optional count of copies and an LED or RGB command, and sends the
+// command to the nodes it addresses in one broadcast frame, on every radio.
+// Nodes reached through a relay are sent it in the usual way.  With no
+// argument, show what has been broadcast.
+//
+//*****************************************************************************
+int
+CMD_bcast(int argc, char **argv)
+{
+    tCmdLineEntry* psCommand;
+    uint8_t pui8Plain[SECURE_MAX_PAYLOAD];
+    uint32_t ui32Copies;
+    char* pcEnd;
+    int iStatus, i;
+
+    if (argc == 1)
+    {
+        ConsolePrintf("Broadcasts: %u, %u copies sent, last took %u us\n",
+                      g_ui32Broadcasts, g_ui32BroadcastCopies,
+                      g_ui32BroadcastUs);
+        return(0);
+    }
+    ui32Copies = ustrtoul(argv[1], &pcEnd, 10);
+    if (pcEnd != argv[1])
+    {
+        if ((ui32Copies == 0) || (ui32Copies > BROADCAST_MAX_COPIES))
+        {
+            return CMDLINE_INVALID_ARG;
+        }
+        argc--;
+        argv++;
+    } else {
+        ui32Copies = BROADCAST_COPIES;
+    }
+    if (argc < 2)
+    {
+        return CMDLINE_TOO_FEW_ARGS;
+    }
+    psCommand = NodeCommandFind(*(argv + 1));
+    if (psCommand == 0)
+    {
+        return CMDLINE_INVALID_ARG;
+    }
+    for (i = 0; i < CHANNEL_RADIOS; i++)
+    {
+        if (g_psRadios[i].ui32BroadcastLeft || g_psRadios[i].bBroadcasting)
+        {
+            ConsolePrintf("Broadcast still going out, try again\n");
+            return(0);
+        }
+    }
+
+    g_ui32BroadcastMask = 0;
+    g_bBroadcast = true;
+    iStatus = psCommand->pfnCmd(argc - 1, argv + 1);
+    g_bBroadcast = false;
+    if ((iStatus != 0) || (g_ui32BroadcastMask == 0))
+    {
+        return iStatus;
+    }
+
+    //
+    // Seal it once; every copy on every radio is the same frame.  A node
+    // that has reset since the last one refuses that one's epoch.
+    //
+    if (g_bBroadcastEpochDue)
+    {
+        g_bBroadcastEpochDue = false;
+        SecureLinkEpochNext(&g_sBroadcastLink);
+    }
+    pui8Plain[0] = BROADCAST_MSG_CMD;
+    memcpy(pui8Plain + 1, &g_ui32BroadcastMask, 4);
+    memcpy(pui8Plain + BROADCAST_HDR_LEN, g_pui8BroadcastCmd,
+           g_iBroadcastCmdLen);
+    g_iBroadcastLen = SecureSeal(&g_sBroadcastLink, SECURE_DIR_DOWN,
+                                 pui8Plain,
+                                 g_iBroadcastCmdLen + BROADCAST_HDR_LEN,
+                                 g_pui8Broadcast);
+    g_ui32BroadcastIssued = EventMicros();
+    g_ui32Broadcasts++;
+    for (i = 0; i < CHANNEL_RADIOS; i++)
+    {
+        g_psRadios[i].ui32BroadcastLeft = ui32Copies;
+        g_psRadios[i].ui32BroadcastTick = g_ui32Ticks;
+    }
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Print how long commands of each class took to reach their nodes.
+//
+//*****************************************************************************
+int
+CMD_latency(int argc, char **argv)
+{
+    LatencyPrint();
+    ConsolePrintf("Pushes that fell back to polling: %u, commands dropped "
+                  "for them: %u\n", g_ui32PushFallbacks, g_ui32PushDrops);
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Print each node's polling slot and how often its polls were retransmitted.
+//
+//*****************************************************************************
+int
+CMD_sched(int argc, char **argv)
+{
+    SchedPrint();
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Takes a slave index or list of them and "fast" or "slow", and has the
+// slaves told with their next ACK payloads to poll every period, ready for
+// more commands, or at the longest interval.  Nodes slow down again by
+// themselves when idle.
+//
+//*****************************************************************************
+int
+CMD_pace(int argc, char **argv)
+{
+    uint32_t ui32SlaveIndex, ui32Mask;
+    uint8_t ui8Pace;
+
+    if (argc < 3)
+    {
+        return CMDLINE_TOO_FEW_ARGS;
+    }
+    ui32Mask = SlaveListParse(argv[1]);
+    if (!strcmp(argv[2], "fast"))
+    {
+        ui8Pace = TDMA_PACE_ACTIVE;
+    } else if (!strcmp(argv[2], "slow")) {
+        ui8Pace = TDMA_PACE_MAX;
+    } else {
+        return CMDLINE_INVALID_ARG;
+    }
+    if (ui32Mask == 0)
+    {
+        return CMDLINE_INVALID_ARG;
+    }
+    for (ui32SlaveIndex = 0; ui32SlaveIndex < NUM_SLAVES; ui32SlaveIndex++)
+    {
+        if (ui32Mask & (1 << ui32SlaveIndex))
+        {
+            PaceHintSet(ui32SlaveIndex, ui8Pace);
+        }
+    }
+    return 0;
+}
+
+//*****************************************************************************
+//
+// Print each node's route and the forwarding done by relays.
+//
+//*****************************************************************************
+int
+CMD_route(int argc, char **argv)
+{
+    RoutePrint();
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Print confirmed, retried and failed commands for each node.
+//
+//*****************************************************************************
+int
+CMD_delivery(int argc, char **argv)
+{
+    DeliveryPrint();
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Turn the echo of typed input on or off.  Programs driving the console,
+// such as host/gateway, turn it off so that input they send ahead does not
+// land in the middle of output.
+//
+//*****************************************************************************
+int
+CMD_echo(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return CMDLINE_TOO_FEW_ARGS;
+    }
+    if (!strcmp(argv[1], "on"))
+    {
+        UARTEchoSet(true);
+    } else if (!strcmp(argv[1], "off")) {
+        UARTEchoSet(false);
+    } else {
+        return CMDLINE_INVALID_ARG;
+    }
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Start or stop streaming a capture of radio traffic.
+//
+//*****************************************************************************
+int
+CMD_capture(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        return CMDLINE_TOO_FEW_ARGS;
+    }
+    if (!strcmp(argv[1], "on"))
+    {
+        CaptureStart();
+    } else if (!strcmp(argv[1], "off")) {
+        CaptureStop();
+    } else {
+        return CMDLINE_INVALID_ARG;
+    }
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Dump the SPI transaction trace, or clear it.  The dump is written out
+// over the next few main loop passes.
+//
+//*****************************************************************************
+int
+CMD_spitrace(int argc, char **argv)
+{
+#ifdef SPI_TRACE
+    if ((argc > 1) && !strcmp(argv[1], "clear"))
+    {
+        SPITraceClear();
+        return(0);
+    }
+    TraceDumpStart(gui32SysClock);
+#else
+    ConsolePrintf("SPI tracing is not built in; define SPI_TRACE\n");
+#endif
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Start, stop or dump the statistical profiler, or with no argument show
+// how far it has got.  Starting clears it.  The dump stops it and is
+// written out over the next few main loop passes.
+//
+//*****************************************************************************
+int
+CMD_profile(int argc, char **argv)
+{
+    uint32_t ui32Hz = PROFILE_HZ;
+
+    if (argc == 1)
+    {
+        ProfilePrint();
+    } else if (!strcmp(argv[1], "start")) {
+        if (argc > 2)
+        {
+            ui32Hz = ustrtoul(argv[2], 0, 10);
+            if ((ui32Hz == 0) || (ui32Hz > 100000))
+            {
+                return(CMDLINE_INVALID_ARG);
+            }
+        }
+        ProfileStart(ui32Hz);
+    } else if (!strcmp(argv[1], "stop")) {
+        ProfileStop();
+    } else if (!strcmp(argv[1], "dump")) {
+        ProfileDumpStart();
+    } else {
+        return(CMDLINE_INVALID_ARG);
+    }
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Run the radio benchmark against a Node_Bench board, or with no argument
+// show how far it has got.  The radio, 0 unless given, is taken off the
+// network until the suite ends or is stopped, so its nodes go unpolled.
+// The results are written out a case at a time for host/bench.py.
+//
+//*****************************************************************************
+int
+CMD_bench(int argc, char **argv)
+{
+    tMasterRadio *psRadio;
+    int iRadio = 0;
+
+    if (argc == 1)
+    {
+        BenchPrint();
+        return(0);
+    } else if (!strcmp(argv[1], "stop")) {
+        if (BenchRunning())
+        {
+            BenchStop();
+            BenchRadioReturn();
+        }
+        return(0);
+    } else if (strcmp(argv[1], "quick") && strcmp(argv[1], "full")) {
+        return(CMDLINE_INVALID_ARG);
+    }
+
+    if (argc > 2)
+    {
+        iRadio = ustrtoul(argv[2], 0, 10);
+        if (iRadio >= CHANNEL_RADIOS)
+        {
+            return(CMDLINE_INVALID_ARG);
+        }
+    }
+    psRadio = &g_psRadios[iRadio];
+    if (BenchRunning())
+    {
+        ConsolePrintf("Bench already running on radio %d\n", g_iBenchRadio);
+        return(0);
+    } else if (!psRadio->bUp || (psRadio->iPushSlave >= 0) ||
+               psRadio->bBroadcasting) {
+        ConsolePrintf("Radio %d is %s\n", iRadio,
+                      psRadio->bUp ? "pushing, try again" : "down");
+        return(0);
+    }
+
+    //
+    // Take the radio off the network: nothing else touches a radio that is
+    // not up, and its IRQ is the benchmark's to poll.
+    //
+    GPIOIntDisable(BOARD_RADIO0_IRQ_PORT, psRadio->ui8IRQPin);
+    GPIOIntClear(BOARD_RADIO0_IRQ_PORT, psRadio->ui8IRQPin);
+    BoardPinWrite(psRadio->ui32CEPort, psRadio->ui8CEPin, 0x00);
+    psRadio->bUp = false;
+    psRadio->bIRQ = false;
+    psRadio->bArrivalValid = false;
+    psRadio->bAckWait = false;
+    g_iBenchRadio = iRadio;
+
+    BenchStart(&psRadio->sSPI, psRadio->ui32CEPort, psRadio->ui8CEPin,
+               BOARD_RADIO0_IRQ_PORT, psRadio->ui8IRQPin, gui32SysClock,
+               !strcmp(argv[1], "quick"));
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Print the clock error each node measured at its last time sync, and the
+// spread between them, which bounds how far apart a scheduled command runs.
+//
+//*****************************************************************************
+int
+CMD_sync(int argc, char **argv)
+{
+    int32_t i32Min = 0, i32Max = 0;
+    bool bAny = false;
+    int i;
+
+    ConsolePrintf("Node  Reports  Skew us  Max us  RTT us\n");
+    for (i = 0; i < NUM_SLAVES; i++)
+    {
+        if (g_psSkew[i].ui32Reports == 0)
+        {
+            continue;
+        }
+        ConsolePrintf("%4d  %7u  %7d  %6u  %6u\n", i, g_psSkew[i].ui32Reports,
+                      g_psSkew[i].i32Last, g_psSkew[i].ui32MaxAbs,
+                      g_psSkew[i].ui32RTT);
+        if (!bAny || (g_psSkew[i].i32Last < i32Min))
+        {
+            i32Min = g_psSkew[i].i32Last;
+        }
+        if (!bAny || (g_psSkew[i].i32Last > i32Max))
+        {
+            i32Max = g_psSkew[i].i32Last;
+        }
+        bAny = true;
+    }
+    ConsolePrintf("Spread: %d us\n", i32Max - i32Min);
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Print the measured CPU load and how long events wait to be dispatched.
+//
+//*****************************************************************************
+int
+CMD_load(int argc, char **argv)
+{
+    static const tCycleStat sZero;
+
+    if ((argc > 1) && !strcmp(argv[1], "clear"))
+    {
+        g_ui32IRQCalls = 0;
+        g_ui64IRQCycles = 0;
+        g_ui32IRQMaxCycles = 0;
+        g_sServiceCycles = sZero;
+        g_sPollCycles = sZero;
+        return(0);
+    }
+    EventStatsPrint();
+    ConsolePrintf("Radio IRQ handler in %s: %u calls, %u cycles avg, %u max\n",
+                  RAMFUNC_WHERE, g_ui32IRQCalls,
+                  g_ui32IRQCalls ? (uint32_t)(g_ui64IRQCycles / g_ui32IRQCalls) : 0,
+                  g_ui32IRQMaxCycles);
+    ConsolePrintf("Radio path in %s:\n", RAMFUNC_WHERE);
+    CycleStatPrint("  RadioService", "events", &g_sServiceCycles);
+    CycleStatPrint("  PollHandle", "polls", &g_sPollCycles);
+    ConsoleStatsPrint();
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Show what the radio watchdog has found and how long recovery took.
+//
+//*****************************************************************************
+int
+CMD_health(int argc, char **argv)
+{
+    uint32_t ui32Now = EventMicros();
+    int i;
+
+    for (i = 0; i < CHANNEL_RADIOS; i++)
+    {
+        ConsolePrintf("Radio %d: %s\n", i, (i == g_iBenchRadio) ?
+                      "benchmarking" : (g_psRadios[i].bUp ? "up" : "down"));
+        HealthPrint(i, ui32Now);
+    }
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Takes a slave index and optionally a resolution: the latest raw samples,
+// or min/max/mean over 10 second or 5 minute intervals.  Defaults to raw.
+//
+//*****************************************************************************
+int
+CMD_sensor(int argc, char **argv)
+{
+    int iTier = 0;
+    char* throwaway;
+
+    if (argc < 2)
+    {
+        return CMDLINE_TOO_FEW_ARGS;
+    }
+    if (argc > 2)
+    {
+        iTier = SensorTierLookup(*(argv + 2));
+        if (iTier < 0)
+        {
+            return CMDLINE_INVALID_ARG;
+        }
+    }
+    SensorPrint(ustrtoul(*(argv + 1), &throwaway, 10), iTier);
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Write a help message to the serial terminal.
+//
+//*****************************************************************************
+int
+CMD_help(int argc, char **argv)
+{
+    tCmdLineEntry* psCommand = g_psCmdTable;
+    while (psCommand->pcCmd)
+    {
+        ConsolePrintf(" %s%s\n", psCommand->pcCmd, psCommand->pcHelp);
+        psCommand++;
+    }
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Toggle verbose output mode.
+//
+//*****************************************************************************
+int
+CMD_verbose(int argc, char **argv)
+{
+    if (g_bVerbose)
+    {
+        ConsolePrintf("Verbose mode off\n");
+        g_bVerbose = false;
+    } else {
+        ConsolePrintf("Verbose mode on\n");
+        g_bVerbose = true;
+    }
+    return(0);
+}
+
+//*****************************************************************************
+//
+// Flash the LED to signal an error and print an error message, MSG, to the
+// serial terminal, without waiting on either.
+//
+//*****************************************************************************
+void
+ErrorNotify(char* msg)
+{
+    ConsolePrintf("ERROR: %s\n", msg);
+    
+    //
+    // The blinks are played from the SysTick event, so this returns at once.
+    //
+    GPIOPinWrite(GPIO_PORTQ_BASE, GPIO_PIN_4, 0x00);
+    LEDPatternPlay(LED_PATTERN_ERROR, LED_PATTERN_ERROR_STEPS,
+                   LED_PATTERN_ERROR_TICKS);
+}
+
+//*****************************************************************************
+//
+// Handle interrupts from the radios.  All SPI traffic happens in the main
+// loop, so an interrupt can never land in the middle of a console command's
+// radio transaction.  The handler and everything it calls run from SRAM,
+// and the port's registers are accessed directly rather than through
+// driverlib in flash.
+//
+//*****************************************************************************
+RAMFUNC void GPIOPortHIntHandler()
+{
+    uint32_t ui32Start = CycleCountGet();
+    uint32_t ui32Pins = HWREG(BOARD_RADIO0_IRQ_PORT + GPIO_O_MIS);
+    uint32_t ui32Now = EventMicros();
+    uint32_t ui32Cycles;
+    int i;
+
+    HWREG(BOARD_RADIO0_IRQ_PORT + GPIO_O_ICR) = ui32Pins;
+    for (i = 0; i < CHANNEL_RADIOS; i++)
+    {
+        if (ui32Pins & g_psRadios[i].ui8IRQPin)
+        {
+            g_psRadios[i].ui32Arrival = ui32Now;
+            g_psRadios[i].bArrivalValid = true;
+            g_psRadios[i].bIRQ = true;
+        }
+    }
+    EventPost(EVENT_RADIO);
+
+    ui32Cycles = CycleCountGet() - ui32Start;
+    g_ui32IRQCalls++;
+    g_ui64IRQCycles += ui32Cycles;
+    if (ui32Cycles > g_ui32IRQMaxCycles)
+    {
+        g_ui32IRQMaxCycles = ui32Cycles;
+    }
+}
+
+//*****************************************************************************
+//
+// Handle interrupts from the console UART, and wake the main loop once a
+// whole line has been received.
+//
+//*****************************************************************************
+void
+UART0IntHandler(void)
+{
+    UARTStdioIntHandler();
+    if (UARTPeek('\r') != -1)
+    {
+        EventPost(EVENT_CONSOLE);
+    }
+}
+
+//*****************************************************************************
+//
+// Push the urgent command for a slave.  The slave's radio becomes a
+// transmitter aimed at its listening address until RadioService() sees the
+// data sent or max retransmit interrupt.
+//
+//*****************************************************************************
+void
+PushStart(int iSlave)
+{
+    uint8_t pui8Addr[PUSH_ADDR_LEN] = PUSH_NODE_ADDR;
+    uint8_t pui8Frame[SECURE_MAX_FRAME];
+    uint8_t pui8Plain[SECURE_MAX_PAYLOAD];
+    int iRadio = CHANNEL_RADIO(iSlave);
+    tMasterRadio *psRadio = &g_psRadios[iRadio];
+    uint32_t ui32Start;
+    int iLen;
+
+    nRFRadioSelect(&psRadio->sSPI);
+    BoardPinWrite(psRadio->ui32CEPort, psRadio->ui8CEPin, 0x00);
+
+    //
+    // Anything in the TX FIFO would be sent ahead of the push.
+    //
+    AckFlush(iRadio);
+
+    pui8Addr[0] = iSlave;
+    nRFSetTXAddress(pui8Addr, PUSH_ADDR_LEN);
+    nRFSetAddress(0, pui8Addr, PUSH_ADDR_LEN);
+    nRFConfig(RADIO_CFG);
+
+    //
+    // Pushes carry the sequence number too, so that a node whose ACK was
+    // lost carries out the retry only once.
+    //
+    pui8Plain[0] = DELIVER_MSG_CMD;
+    pui8Plain[1] = g_psUrgent[iSlave].ui8Seq;
+    memcpy(pui8Plain + DELIVER_HDR_LEN, g_psUrgent[iSlave].pcCmd,
+           g_psUrgent[iSlave].ui8Len);
+
+    ui32Start = CycleCountGet();
+    iLen = SecureSeal(&g_psLinks[iSlave], SECURE_DIR_DOWN, pui8Plain,
+                      g_psUrgent[iSlave].ui8Len + DELIVER_HDR_LEN, pui8Frame);
+    CycleStatAdd(&g_sSealCycles, ui32Start);
+    nRFDataPut(pui8Frame, iLen);
+
+    //
+    // A chip enable pulse of at least 10 us starts the transmission.
+    //
+    BoardPinWrite(psRadio->ui32CEPort, psRadio->ui8CEPin, psRadio->ui8CEPin);
+    SysCtlDelay(gui32SysClock / 3 / 50000);
+    BoardPinWrite(psRadio->ui32CEPort, psRadio->ui8CEPin, 0x00);
+
+    psRadio->iPushSlave = iSlave;
+    psRadio->ui32PushTries++;
+    psRadio->ui32PushStart = EventMicros();
+}
+
+//*****************************************************************************
+//
+// Finish a push and return the selected radio to receiving polls.  A push
+// that keeps failing is handed to the ACK payload queue instead, alongside
+// any command already queued there.
+//
+//*****************************************************************************
+void
+PushDone(int iRadio, bool bAcked)
+{
+    uint8_t pui8PollAddr[PUSH_ADDR_LEN] = PUSH_POLL_ADDR;
+    tMasterRadio *psRadio = &g_psRadios[iRadio];
+    int iSlave = psRadio->iPushSlave;
+    tAutoCmd *psCmd = &g_psUrgent[iSlave];
+
+    nRFFlushTX();
+    nRFSetAddress(0, pui8PollAddr, PUSH_ADDR_LEN);
+    nRFConfig(RADIO_CFG | nRF_CFG_PRIM_RX);
+    BoardPinWrite(psRadio->ui32CEPort, psRadio->ui8CEPin, psRadio->ui8CEPin);
+
+    if (bAcked)
+    {
+        DeliveryDone(iSlave, psCmd, true,
+                     EventMicros() - psCmd->ui32Issued, psRadio->ui32PushTries);
+        SchedPaceSet(iSlave, TDMA_PACE_ACTIVE);
+        if (g_bVerbose)
+        {
+            ConsolePrintf("Pushed %02x to Node %d\n", psCmd->pcCmd[0],
+                          iSlave);
+        }
+        psCmd->ui8Len = 0;
+        psRadio->ui32PushTries = 0;
+    } else if (psRadio->ui32PushTries >= PUSH_TRIES) {
+        if (!AckRequeue(iSlave, psCmd))
+        {
+            g_ui32PushDrops++;
+        }
+        psCmd->ui8Len = 0;
+        psRadio->ui32PushTries = 0;
+        g_ui32PushFallbacks++;
+    } else {
+        psRadio->ui32PushRetryTick = g_ui32Ticks + PUSH_RETRY_TICKS;
+    }
+
+    //
+    // The IRQ that ended the push carries no poll arrival time.
+    //
+    psRadio->bArrivalValid = false;
+    psRadio->iPushSlave = -1;
+}
+
+//*****************************************************************************
+//
+// Start a push on each free radio that has one waiting.  A command that
+// failed is retried before any other slave's on its radio.
+//
+//*****************************************************************************
+void
+PushService(void)
+{
+    static int piNext[CHANNEL_RADIOS];
+    tMasterRadio *psRadio;
+    int iRadio, iSlave, i;
+
+    for (iRadio = 0; iRadio < CHANNEL_RADIOS; iRadio++)
+    {
+        psRadio = &g_psRadios[iRadio];
+        if (!psRadio->bUp || (psRadio->iPushSlave >= 0) ||
+            psRadio->bBroadcasting || psRadio->bAckWait ||
+            ((int32_t)(g_ui32Ticks - psRadio->ui32PushRetryTick) < 0))
+        {
+            continue;
+        }
+        for (i = 0; i < NUM_SLAVES; i++)
+        {
+            iSlave = piNext[iRadio];
+            if ((CHANNEL_RADIO(iSlave) == iRadio) &&
+                (g_psUrgent[iSlave].ui8Len != 0))
+            {
+                PushStart(iSlave);
+                break;
+            }
+            if (psRadio->ui32PushTries == 0)
+            {
+                piNext[iRadio] = (iSlave + 1) % NUM_SLAVES;
+            }
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Send a copy of the broadcast on a radio.  Like a push, the radio becomes
+// a transmitter until RadioService() sees the data sent interrupt, which
+// comes as soon as the frame is on air, since nothing acknowledges it.
+//
+//*****************************************************************************
+void
+BroadcastSend(int iRadio)
+{
+    uint8_t pui8Addr[PUSH_ADDR_LEN] = PUSH_NODE_ADDR;
+    tMasterRadio *psRadio = &g_psRadios[iRadio];
+
+    nRFRadioSelect(&psRadio->sSPI);
+    BoardPinWrite(psRadio->ui32CEPort, psRadio->ui8CEPin, 0x00);
+    AckFlush(iRadio);
+
+    pui8Addr[0] = BROADCAST_ID;
+    nRFSetTXAddress(pui8Addr, PUSH_ADDR_LEN);
+    nRFConfig(RADIO_CFG);
+    nRFDataPutNoAck(g_pui8Broadcast, g_iBroadcastLen);
+
+    BoardPinWrite(psRadio->ui32CEPort, psRadio->ui8CEPin, psRadio->ui8CEPin);
+    SysCtlDelay(gui32SysClock / 3 / 50000);
+    BoardPinWrite(psRadio->ui32CEPort, psRadio->ui8CEPin, 0x00);
+
+    psRadio->bBroadcasting = true;
+    psRadio->ui32BroadcastLeft--;
+    psRadio->ui32PushStart = EventMicros();
+}
+
+//*****************************************************************************
+//
+// A copy of the broadcast is out: return the selected radio to receiving
+// polls, and note the time once the last copy on every radio is out.
+//
+//*****************************************************************************
+void
+BroadcastDone(int iRadio)
+{
+    tMasterRadio *psRadio = &g_psRadios[iRadio];
+    int i;
+
+    nRFFlushTX();
+    nRFConfig(RADIO_CFG | nRF_CFG_PRIM_RX);
+    BoardPinWrite(psRadio->ui32CEPort, psRadio->ui8CEPin, psRadio->ui8CEPin);
+
+    psRadio->bArrivalValid = false;
+    psRadio->bBroadcasting = false;
+    psRadio->ui32BroadcastTick = g_ui32Ticks + BROADCAST_GAP_TICKS;
+    g_ui32BroadcastCopies++;
+
+    for (i = 0; i < CHANNEL_RADIOS; i++)
+    {
+        if (g_psRadios[i].ui32BroadcastLeft || g_psRadios[i].bBroadcasting)
+        {
+            return;
+        }
+    }
+    g_ui32BroadcastUs = EventMicros() - g_ui32BroadcastIssued;
+    if (g_bVerbose)
+    {
+        ConsolePrintf("Broadcast %02x sent in %u us\n",
+                      g_pui8BroadcastCmd[0], g_ui32BroadcastUs);
+    }
 }
-tAutoCmd;
-
-#define EMPTY_COMMAND {0, {0x00}}
 
 //*****************************************************************************
 //
-// Input buffer for the command line interpreter.
+// Send the next copy of the broadcast on each free radio that has one due.
+// A radio that is down sends none.
 //
 //*****************************************************************************
-static char g_cInput[128];
+void
+BroadcastService(void)
+{
+    tMasterRadio *psRadio;
+    int iRadio;
 
-tAutoCmd g_psAckData[5] = { EMPTY_COMMAND };
+    for (iRadio = 0; iRadio < CHANNEL_RADIOS; iRadio++)
+    {
+        psRadio = &g_psRadios[iRadio];
+        if (!psRadio->bUp)
+        {
+            psRadio->ui32BroadcastLeft = 0;
+        }
+        if ((psRadio->ui32BroadcastLeft == 0) || psRadio->bBroadcasting ||
+            (psRadio->iPushSlave >= 0) || psRadio->bAckWait ||
+            ((int32_t)(g_ui32Ticks - psRadio->ui32BroadcastTick) < 0))
+        {
+            continue;
+        }
+        BroadcastSend(iRadio);
+    }
+}
 
 //*****************************************************************************
 //
-// A table of terminal commands, callback functions, and descriptions, as
-// needed by the TivaWare command line processor.
+// Deferred interrupt work for one radio.  The flags are cleared before the
+// FIFO is drained, so a poll that arrives meanwhile raises a fresh IRQ edge
+// instead of sitting unread until the next one.
 //
 //*****************************************************************************
-tCmdLineEntry g_psCmdTable[] =
-{
-    {"help",     CMD_help,      "    : Display list of commands" },
-    {"status",   CMD_status,    "  : Read the radio's status register"},
-    {"verbose",  CMD_verbose,   " : Toggle verbosity" },
-    {"LED",      CMD_LED,       "     : \"LED state id\", where state = [on|off] and id = [0-4]"},
-    {"RGB",      CMD_RGB,       "     : \"RGB id R G B\", where id = [0-4] and R,G,B = [0-(2^16-1)]"},
-    { 0, 0, 0 }
-};
-#ifdef TARGET_IS_BLIZZARD_RA3
-    #define CS_PORT GPIO_PORTE_BASE
-    #define CS_PIN  GPIO_PIN_0
-#else
-    #define CS_PORT GPIO_PORTQ_BASE
-    #define CS_PIN  GPIO_PIN_7
-#endif
-void SPISend(int iLen, uint8_t *data)
+void
+RadioService(int iRadio)
 {
-    GPIOPinWrite(CS_PORT, CS_PIN, 0x00);
-    while(iLen-- > 0)
-    {
-        SSIDataPut(SSI2_BASE, *data++);
-    }
-    while(SSIBusy(SSI2_BASE))
-    {
-        // Wait for SSI to finish transmitting
-    }
-    GPIOPinWrite(CS_PORT, CS_PIN, CS_PIN);
-}
+    tMasterRadio *psRadio = &g_psRadios[iRadio];
+    uint8_t ui8Status;
+    uint32_t ui32Arrival, ui32Start;
+    bool bTimed;
 
-void SPIReceive(int iLen, uint8_t *p_ui8TXData, uint8_t *p_ui8RXData)
-{
-    uint32_t ui32RXData;
-    while(SSIBusy(SSI2_BASE))
-    {
-        // Wait for SSI to finish transmitting
-    }
-    while (SSIDataGetNonBlocking(SSI2_BASE, &ui32RXData))
-    {
-    }
-    GPIOPinWrite(CS_PORT, CS_PIN, 0x00);
-    while (iLen-- > 0)
+    nRFRadioSelect(&psRadio->sSPI);
+    ui8Status = nRFClearInterrupt();
+
+    //
+    // While a push or broadcast is in flight the radio is a transmitter;
+    // polls wait in the RX FIFO until it is a receiver again and can stage
+    // ACK payloads.
+    //
+    if (psRadio->iPushSlave >= 0)
     {
-        SSIDataPut(SSI2_BASE, *(p_ui8TXData++));
-        SSIDataGet(SSI2_BASE, &ui32RXData);
-        *(p_ui8RXData++) = ui32RXData & 0x000000FF;
+        if (ui8Status & (nRF_INT_TX_DS | nRF_INT_MAX_RT))
+        {
+            PushDone(iRadio, ui8Status & nRF_INT_TX_DS);
+        } else {
+            return;
+        }
+    } else if (psRadio->bBroadcasting) {
+        if (ui8Status & nRF_INT_TX_DS)
+        {
+            BroadcastDone(iRadio);
+        } else {
+            return;
+        }
     }
-    while(SSIBusy(SSI2_BASE))
+
+    //
+    // RX_P_NO reads all ones while the RX FIFO is empty.
+    //
+    while ((nRFStatusGet() & nRF_STAT_RX_P_NO) != nRF_STAT_RX_P_NO)
     {
-        // Wait for SSI to finish transmitting
-    }
-    GPIOPinWrite(CS_PORT, CS_PIN, CS_PIN);
-}
+        if (psRadio->bAckWait)
+        {
+            //
+            // A poll left waiting for TX_DS.  Until it comes or the wait
+            // runs out, the poll stays in the FIFO and the CPU is free.
+            //
+            if (!(ui8Status & nRF_INT_TX_DS) &&
+                (EventMicros() - psRadio->ui32AckWaitStart <
+                 ACK_SENT_WAIT_US))
+            {
+                return;
+            }
+            psRadio->bAckWait = false;
+            ui32Arrival = psRadio->ui32AckWaitArrival;
+            bTimed = psRadio->bAckWaitTimed;
 
+            //
+            // The IRQ TX_DS raised stamped no poll's arrival.
+            //
+            if (ui8Status & nRF_INT_TX_DS)
+            {
+                MAP_IntMasterDisable();
+                psRadio->bArrivalValid = false;
+                MAP_IntMasterEnable();
+            }
+        }
+        else
+        {
+            //
+            // Claim the IRQ timestamp.  Only the first poll read after an
+            // IRQ is the one that raised it.
+            //
+            MAP_IntMasterDisable();
+            ui32Arrival = psRadio->ui32Arrival;
+            bTimed = psRadio->bArrivalValid;
+            psRadio->bArrivalValid = false;
+            MAP_IntMasterEnable();
 
-int
-CMD_RGB(int argc, char **argv)
-{
-    uint32_t ui32SlaveIndex;
-    uint16_t ui16Red, ui16Green, ui16Blue;
-    char* throwaway;
-    if (argc > 4)
-    {
-        ui32SlaveIndex = ustrtoul(*(argv + 1), &throwaway, 10);
-        g_psAckData[ui32SlaveIndex].ui8Len = 8;
-        g_psAckData[ui32SlaveIndex].pcCmd[0] = 0xA3;
-        ui16Red = ustrtoul(*(argv + 2), &throwaway, 10);
-        ui16Green = ustrtoul(*(argv + 3), &throwaway, 10);
-        ui16Blue = ustrtoul(*(argv + 4), &throwaway, 10);
-        *((uint16_t*) (g_psAckData[ui32SlaveIndex].pcCmd + 2)) = ui16Red;
-        *((uint16_t*) (g_psAckData[ui32SlaveIndex].pcCmd + 4)) = ui16Green;
-        *((uint16_t*) (g_psAckData[ui32SlaveIndex].pcCmd + 6)) = ui16Blue;
-        g_bCMDReturn = true;
-        return 0;
+            //
+            // TX_DS on a receiver means a staged ACK payload went out.  It
+            // is raised an ACK's length after the poll, so may be yet to
+            // come; rather than spin for it, leave the poll until the next
+            // IRQ, or tick, brings TX_DS or ends the wait.
+            //
+            if (AckPending(iRadio) && !(ui8Status & nRF_INT_TX_DS))
+            {
+                psRadio->bAckWait = true;
+                psRadio->bAckWaitTimed = bTimed;
+                psRadio->ui32AckWaitStart = EventMicros();
+                psRadio->ui32AckWaitArrival = ui32Arrival;
+                return;
+            }
+        }
+        ui32Start = CycleCountGet();
+        PollHandle(iRadio, bTimed ? ui32Arrival : EventMicros(), bTimed,
+                   (ui8Status & nRF_INT_TX_DS) != 0);
+        CycleStatAdd(&g_sPollCycles, ui32Start);
+        HealthPoll(iRadio, EventMicros());
+
+        //
+        // Polls already waiting behind this one came in before anything
+        // else was staged.
+        //
+        ui8Status = 0;
     }
-    g_bCMDReturn = true;
-    return CMDLINE_TOO_FEW_ARGS;
 }
-        
 
 //*****************************************************************************
 //
-// Takes two arguments, the first is either "on" or "off", the second is a
-// number between 0 and 5 indicating to which slave to send the command. Sends
-// a command to the indicated to slave to turn it's LED either on or off.
+// Run every complete command line waiting in the UART RX buffer.
 //
 //*****************************************************************************
-int
-CMD_LED(int argc, char **argv)
+void
+ConsoleService(void)
 {
-    uint32_t ui32SlaveIndex;
-    char* throwaway;
-    if (argc > 2)
+    int32_t i32CommandStatus;
+
+    while (UARTPeek('\r') != -1)
     {
-        ui32SlaveIndex = ustrtoul(*(argv + 2), &throwaway, 10);
-        if (!strcmp(*(argv + 1),"on"))
+        UARTgets(g_cInput,sizeof(g_cInput));
+
+        //
+        // Pass the line from the user to the command processor.
+        // It will be parsed and valid commands executed.
+        //
+        i32CommandStatus = CmdLineProcess(g_cInput);
+
+        //
+        // Handle the case of bad command.
+        //
+        if(i32CommandStatus == CMDLINE_BAD_CMD)
         {
-            g_psAckData[ui32SlaveIndex].ui8Len = 1;
-            g_psAckData[ui32SlaveIndex].pcCmd[0] = 0xA1;
-        } else if (!strcmp(*(argv + 1),"off"))
+            ErrorNotify("Bad Command");
+        }
+        
+        else if (i32CommandStatus == CMDLINE_TOO_FEW_ARGS)
         {
-            g_psAckData[ui32SlaveIndex].ui8Len = 1;
-            g_psAckData[ui32SlaveIndex].pcCmd[0] = 0xA2;
-        } else {
-            g_bCMDReturn = true;
-            return CMDLINE_INVALID_ARG;
+            ErrorNotify("Too few arguments!");
         }
-        g_bCMDReturn = true;
-        return 0;
+        
+        else if (i32CommandStatus == CMDLINE_INVALID_ARG)
+        {
+            ErrorNotify("Invalid argument!");
+        }
+
+        //
+        // Handle the case of too many arguments.
+        //
+        else if(i32CommandStatus == CMDLINE_TOO_MANY_ARGS)
+        {
+            ConsolePrintf("Too many arguments for command processor!\n");
+        }
+        
+        ConsolePrintf("> ");
     }
-    g_bCMDReturn = true;
-    return CMDLINE_TOO_FEW_ARGS;
 }
 
 //*****************************************************************************
 //
-// Print the contents of the radio's status register to the serial terminal.
+// Bring up a radio for RX on its channel, with dynamic payloads and ACK
+// payloads, and pipe 0 alone open at the poll address, and report how it
+// went.  A radio that does not read its configuration back is left
+// disabled.
 //
 //*****************************************************************************
-int
-CMD_status(int argc, char **argv)
+void
+RadioBringUp(int iRadio)
 {
-    UARTprintf("%02x\n", nRFStatusGet());
-    g_bCMDReturn = true;
-    return(0);
-}
+    tnRFRegister psRegs[] = RADIO_REGISTERS(iRadio);
+    tMasterRadio *psRadio = &g_psRadios[iRadio];
 
+    nRFRadioSelect(&psRadio->sSPI);
+    psRadio->bUp = nRFBringUp(gui32SysClock, RADIO_CFG | nRF_CFG_PRIM_RX,
+                              psRegs, sizeof(psRegs) / sizeof(psRegs[0]));
+    if (psRadio->bUp)
+    {
+        ConsolePrintf("Radio %d up at %u us\n", iRadio, EventMicros());
+    }
+    else
+    {
+        ConsolePrintf("Radio %d not answering, left disabled\n", iRadio);
+    }
+}
 
 //*****************************************************************************
 //
-// Write a help message to the serial terminal.
+// Bring a radio up afresh from whatever state it is in and, if it comes
+// up, enable it and service it in case its IRQ line is already asserted.
 //
 //*****************************************************************************
-int
-CMD_help(int argc, char **argv)
+void
+RadioRestart(int iRadio)
 {
-    tCmdLineEntry* psCommand = g_psCmdTable;
-    while (psCommand->pcCmd)
+    tMasterRadio *psRadio = &g_psRadios[iRadio];
+
+    BoardPinWrite(psRadio->ui32CEPort, psRadio->ui8CEPin, 0x00);
+    RadioBringUp(iRadio);
+    if (psRadio->bUp)
     {
-        UARTprintf(" ");
-        UARTprintf(psCommand->pcCmd);
-        UARTprintf(psCommand->pcHelp);
-        UARTprintf("\n");
-        psCommand++;
+        GPIOIntEnable(BOARD_RADIO0_IRQ_PORT, psRadio->ui8IRQPin);
+        BoardPinWrite(psRadio->ui32CEPort, psRadio->ui8CEPin,
+                      psRadio->ui8CEPin);
+        psRadio->bIRQ = true;
+        EventPost(EVENT_RADIO);
     }
-    g_bCMDReturn = true;
-    return(0);
 }
 
 //*****************************************************************************
 //
-// Toggle verbose output mode.
+// Give the benchmark's radio back to the network, restarted since the
+// benchmark changed its settings.
 //
 //*****************************************************************************
-int
-CMD_verbose(int argc, char **argv)
+void
+BenchRadioReturn(void)
 {
-    if (g_bVerbose)
-    {
-        UARTprintf("Verbose mode off\n");
-        g_bVerbose = false;
-    } else {
-        UARTprintf("Verbose mode on\n");
-        g_bVerbose = true;
-    }
-    g_bCMDReturn = true;
-    return(0);
+    RadioRestart(g_iBenchRadio);
+    g_iBenchRadio = -1;
 }
 
 //*****************************************************************************
 //
-// Flash the LED to signal an error and print an error message, MSG, to the
-// serial terminal.
+// Reset a radio the watchdog found at fault.  Queued commands are kept:
+// those in the flushed ACK payloads are staged again at the next poll, and
+// an urgent command whose push was cut short is pushed again.  A radio
+// that does not come back is tried again every HEALTH_RETRY_TICKS.
 //
 //*****************************************************************************
 void
-ErrorNotify(char* msg)
+RadioRecover(int iRadio)
 {
-    int i;
-    
-    UARTprintf("ERROR: ");
-    UARTprintf(msg);
-    UARTprintf("\n");
-    
-    while (UARTBusy(UART0_BASE))
-    {
-        // spin
-    }
-    
-    GPIOPinWrite(GPIO_PORTQ_BASE, GPIO_PIN_4, 0x00);
-    for (i = 0; i < 4; i++)
-    {
-        GPIOPinWrite(GPIO_PORTN_BASE, GPIO_PIN_5, GPIO_PIN_5);
-        SysCtlDelay(2000000);
-        GPIOPinWrite(GPIO_PORTN_BASE, GPIO_PIN_5, 0x00);
-        SysCtlDelay(2000000);
-    }
+    tMasterRadio *psRadio = &g_psRadios[iRadio];
+    uint32_t ui32Start = EventMicros();
+
+    nRFRadioSelect(&psRadio->sSPI);
+    AckFlush(iRadio);
+    psRadio->iPushSlave = -1;
+    psRadio->bBroadcasting = false;
+    psRadio->bArrivalValid = false;
+    psRadio->bAckWait = false;
+    RadioRestart(iRadio);
+    HealthRestored(iRadio, psRadio->bUp, EventMicros() - ui32Start);
+
+    psRadio->bRetry = !psRadio->bUp;
+    psRadio->ui32RetryTick = g_ui32Ticks + HEALTH_RETRY_TICKS;
 }
 
 //*****************************************************************************
 //
-// Handle interrupts from the radio.
+// Check that a radio is still on the bus, holds its configuration, has no
+// interrupt waiting unseen, is not stuck in a push and is still hearing the
+// polls it was, and deal with what is wrong.  Radios lent to the benchmark
+// or that failed their bring-up at start-up are left alone.
 //
 //*****************************************************************************
-void GPIOPortHIntHandler()
+void
+RadioCheck(int iRadio)
 {
-    uint8_t ui8RXData;
-    int iSlaveIndex;
-    
-    //
-    // Clear the interrupt.
-    //
-    GPIOIntClear(GPIO_PORTH_BASE, GPIO_INT_PIN_6);
-    
-    //
-    // Finish SPI transmission, if any.
-    //
-    while(SSIBusy(SSI2_BASE))
+    tnRFRegister psRegs[] = RADIO_REGISTERS(iRadio);
+    tMasterRadio *psRadio = &g_psRadios[iRadio];
+    uint32_t ui32Now = EventMicros();
+    uint8_t ui8Fifo;
+    bool bAsserted;
+    int iFault;
+
+    if (iRadio == g_iBenchRadio)
     {
+        return;
     }
-    GPIOPinWrite(GPIO_PORTQ_BASE, GPIO_PIN_7, GPIO_PIN_7);
-    
-    //
-    // Clear the RX interrupt flag on the radio.
-    //
-    nRFClearInterrupt();
-   
+    if (!psRadio->bUp)
+    {
+        if (psRadio->bRetry &&
+            ((int32_t)(g_ui32Ticks - psRadio->ui32RetryTick) >= 0))
+        {
+            RadioRecover(iRadio);
+        }
+        return;
+    }
+
+    nRFRadioSelect(&psRadio->sSPI);
+
     //
-    // Flush the RX FIFO.
+    // STATUS always reads with its top bit clear, and a radio that browned
+    // out comes back with CONFIG at its reset value.  While a push or
+    // broadcast is in flight CONFIG is a transmitter's, so only its running
+    // time is checked.  The IRQ line and FIFO are read before bIRQ, so an
+    // interrupt that comes in between is seen as taken.
     //
-    //nRFFlushRX();
-    nRFDataGet(&ui8RXData, 1);
-    iSlaveIndex = ui8RXData & 0x0F;
-    
-    //ui8AckData = 0xA5;
-
-    if (g_bVerbose)
+    if (nRFStatusGet() & 0x80)
     {
-        UARTprintf("Request received from Node %d\n", iSlaveIndex);
+        iFault = HEALTH_SPI;
+    } else if ((psRadio->iPushSlave >= 0) || psRadio->bBroadcasting) {
+        if (ui32Now - psRadio->ui32PushStart <= HEALTH_PUSH_US)
+        {
+            return;
+        }
+        iFault = HEALTH_PUSH;
+    } else if ((nRFRegisterRead(nRF_O_CONFIG) !=
+                (RADIO_CFG | nRF_CFG_PRIM_RX)) ||
+               !nRFRegistersCheck(psRegs, sizeof(psRegs) / sizeof(psRegs[0]))) {
+        iFault = HEALTH_CONFIG;
+    } else {
+        ui8Fifo = nRFRegisterRead(nRF_O_FIFO_STATUS);
+        bAsserted = !BoardPinRead(BOARD_RADIO0_IRQ_PORT, psRadio->ui8IRQPin) ||
+                    !(ui8Fifo & nRF_FIFO_RX_EMPTY);
+        if (bAsserted && !psRadio->bIRQ)
+        {
+            iFault = HEALTH_IRQ;
+        } else if (HealthSilent(iRadio, ui32Now)) {
+            iFault = HEALTH_SILENT;
+        } else {
+            HealthGood(iRadio, ui32Now);
+            return;
+        }
     }
-    
-    if (g_psAckData[iSlaveIndex].ui8Len != 0) {
-        nRFDataPutAck(0, g_psAckData[iSlaveIndex].pcCmd, g_psAckData[iSlaveIndex].ui8Len);
-        UARTprintf("Responding with %02x\n", g_psAckData[iSlaveIndex].pcCmd[0]);
-        g_psAckData[iSlaveIndex].ui8Len = 0;
+
+    HealthFault(iRadio, iFault, ui32Now);
+    if (iFault == HEALTH_IRQ)
+    {
+        psRadio->bIRQ = true;
+        EventPost(EVENT_RADIO);
+    } else {
+        RadioRecover(iRadio);
     }
 }
 
 int
 main(void)
 {
-    int32_t i32CommandStatus;
+    uint32_t ui32Events, ui32Reset, ui32HealthTick = 0, ui32Start;
+    int i;
     
     //
     // Set the system clock to run from the PLL at 120 MHz
@@ -328,99 +1836,155 @@ main(void)
     gui32SysClock = SysCtlClockFreqSet(SYSCTL_USE_PLL | SYSCTL_OSC_MAIN | SYSCTL_XTAL_25MHZ
                    | SYSCTL_CFG_VCO_480, 120000000);
     
+    //
+    // Start the cycle counter and network time straight away, since they
+    // time the radios' power on reset and the start-up, and note what reset
+    // the master.
+    //
+    CycleCountEnable();
+    EventInit(gui32SysClock);
+    ui32Reset = MAP_SysCtlResetCauseGet();
+    MAP_SysCtlResetCauseClear(ui32Reset);
+    
     setup();
     
     //
-    // Enable data receive interrupt and enable radio for RX mode
-    // (Mask data sent and max re-transmit interrupts)
+    // Set up UART and initialize command line
     //
-    nRFConfig(/*nRF_CFG_MASK_TX_DS | nRF_CFG_MASK_MAX_RT | */nRF_CFG_EN_CRC
-                | nRF_CFG_PWR_UP | nRF_CFG_PRIM_RX);
-    nRFFeatureSet(nRF_EN_DPL | nRF_EN_ACK_PAY);
-    nRFDynPayloadEnable(nRF_DATA_PIPE_0);
+    ConfigureUART();
     
     //
-    // Enable the GPIO interrupt for the radio IRQ.
+    // Bring up each radio, once any power on reset it shares with the
+    // master is over, with the GPIO interrupt for its IRQ.
     //
-    GPIOIntEnable(GPIO_PORTH_BASE, GPIO_INT_PIN_6);
-    MAP_IntEnable(INT_GPIOH_SNOWFLAKE);
+    if (ui32Reset & (SYSCTL_CAUSE_POR | SYSCTL_CAUSE_BOR))
+    {
+        nRFPowerOnWait(gui32SysClock);
+    }
+    for (i = 0; i < CHANNEL_RADIOS; i++)
+    {
+        RadioBringUp(i);
+        if (g_psRadios[i].bUp)
+        {
+            GPIOIntEnable(BOARD_RADIO0_IRQ_PORT, g_psRadios[i].ui8IRQPin);
+        }
+    }
+    MAP_IntEnable(BOARD_RADIO_IRQ_INT);
     MAP_IntMasterEnable();
     
     //
-    // Set up UART and initialize command line
+    // Leave the highest interrupt priority to the profiler's timer, so that
+    // it can sample the other handlers.
     //
-    ConfigureUART();
+    MAP_IntPrioritySet(FAULT_SYSTICK, PROFILE_HANDLER_PRIORITY);
+    MAP_IntPrioritySet(INT_UART0, PROFILE_HANDLER_PRIORITY);
+    MAP_IntPrioritySet(BOARD_RADIO_IRQ_INT, PROFILE_HANDLER_PRIORITY);
+    ProfileInit(gui32SysClock);
     
-    UARTprintf("\nHome Automation Console\n");
-    UARTprintf("Type \"help\" for a list of commands\n");
-    UARTprintf("> ");
+    ConsolePrintf("\nHome Automation Console\n");
+    ConsolePrintf("Type \"help\" for a list of commands\n");
+    ConsolePrintf("> ");
     
     //
-    // Enable the Radio
+    // Enable the radios that came up, and service each once up front in
+    // case its IRQ line was already asserted before the edge interrupt was
+    // enabled.
     //
-    GPIOPinWrite(GPIO_PORTH_BASE, GPIO_PIN_7, GPIO_PIN_7);
-    uint8_t ui8AckData = 0xA5;
-    
-    nRFDataPutAck(0, &ui8AckData, 1);
+    for (i = 0; i < CHANNEL_RADIOS; i++)
+    {
+        if (g_psRadios[i].bUp)
+        {
+            BoardPinWrite(g_psRadios[i].ui32CEPort, g_psRadios[i].ui8CEPin,
+                          g_psRadios[i].ui8CEPin);
+            g_psRadios[i].bIRQ = true;
+        }
+    }
+    EventPost(EVENT_RADIO);
     
+    //
+    // Sleep until an interrupt posts an event, then dispatch it.
+    //
     while(1)
     {
-        
-        
-        //
-        // Process commands from the UART.
-        //
-        if (UARTPeek('\r') != -1)
+        ui32Events = EventWait();
+
+        if (ui32Events & EVENT_FLAG(EVENT_RADIO))
+        {
+            for (i = 0; i < CHANNEL_RADIOS; i++)
+            {
+                if (g_psRadios[i].bIRQ)
+                {
+                    g_psRadios[i].bIRQ = false;
+                    ui32Start = CycleCountGet();
+                    RadioService(i);
+                    CycleStatAdd(&g_sServiceCycles, ui32Start);
+                }
+            }
+        }
+
+        if (ui32Events & EVENT_FLAG(EVENT_CONSOLE))
         {
-            g_bCMDReturn = false;
-            
-            UARTgets(g_cInput,sizeof(g_cInput));
+            ConsoleService();
+        }
 
-            //
-            // Pass the line from the user to the command processor.
-            // It will be parsed and valid commands executed.
-            //
-            i32CommandStatus = CmdLineProcess(g_cInput);
+        if (ui32Events & EVENT_FLAG(EVENT_TICK))
+        {
+            LEDPatternTick();
+            SchedTick(EventMicros());
 
             //
-            // Handle the case of bad command.
+            // Finish polls whose ACK raised no TX_DS, if no IRQ has since.
             //
-            if(i32CommandStatus == CMDLINE_BAD_CMD)
-            {
-                ErrorNotify("Bad Command");
-            }
-            
-            else if (i32CommandStatus == CMDLINE_TOO_FEW_ARGS)
+            for (i = 0; i < CHANNEL_RADIOS; i++)
             {
-                ErrorNotify("Too few arguments!");
-            }
-            
-            else if (i32CommandStatus == CMDLINE_INVALID_ARG)
-            {
-                ErrorNotify("Invalid argument!");
+                if (g_psRadios[i].bAckWait)
+                {
+                    RadioService(i);
+                }
             }
 
             //
-            // Handle the case of too many arguments.
+            // Check the radios' health.
             //
-            else if(i32CommandStatus == CMDLINE_TOO_MANY_ARGS)
-            {
-                UARTprintf("Too many arguments for command processor!\n");
-            }
-            
-            else if(!g_bCMDReturn)
+            if ((int32_t)(g_ui32Ticks - ui32HealthTick) >= 0)
             {
-                while(!g_bCMDReturn);
+                ui32HealthTick = g_ui32Ticks + HEALTH_CHECK_TICKS;
+                for (i = 0; i < CHANNEL_RADIOS; i++)
+                {
+                    RadioCheck(i);
+                }
             }
-            
-            UARTprintf("> ");
+        }
+
+        //
+        // Push urgent commands queued by the console, or due for a retry,
+        // and send broadcasts.
+        //
+        PushService();
+        BroadcastService();
+
+        //
+        // Write out as much of an SPI trace dump, traffic capture or profile
+        // as the console can take.
+        //
+        TraceDumpService();
+        CaptureService();
+        ProfileDumpService();
+
+        //
+        // Run the next benchmark case, and give the radio back to the
+        // network once the suite is over.
+        //
+        if (BenchService())
+        {
+            BenchRadioReturn();
         }
     }
 }
 
 //*****************************************************************************
 //
-// Configure the UART and its pins.  This must be called before UARTprintf().
+// Configure the UART and its pins.  This must be called before ConsolePrintf().
 //
 //*****************************************************************************
 void
@@ -462,6 +2026,11 @@ ConfigureUART(void)
 void
 setup()
 { 
+    static const uint8_t pui8NetKey[16] = NETWORK_KEY;
+    uint8_t pui8Key[16];
+    uint32_t ui32Epoch;
+    int i;
+    
     //
     // Enable peripherals
     //
@@ -469,25 +2038,46 @@ setup()
     MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOH);
     MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPION);
     MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOQ);
-    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_SSI2);
+    MAP_SysCtlPeripheralEnable(BOARD_RADIO0_SSI_PERIPH);
+#if CHANNEL_RADIOS > 1
+    MAP_SysCtlPeripheralEnable(BOARD_RADIO1_SSI_PERIPH);
+#endif
     
     //
-    // Setup interrupt on radio IRQ assertion.
+    // Setup interrupts on radio IRQ assertion, and the chip select and chip
+    // enable outputs.
     //
-    MAP_GPIOPinTypeGPIOInput(GPIO_PORTH_BASE, GPIO_PIN_6);
-    MAP_GPIOIntTypeSet(GPIO_PORTH_BASE, GPIO_PIN_6, GPIO_FALLING_EDGE);
-    
-    MAP_GPIOPinTypeGPIOOutput(GPIO_PORTQ_BASE, GPIO_PIN_7);
-    MAP_GPIOPinTypeGPIOOutput(GPIO_PORTH_BASE, GPIO_PIN_7);
+    for (i = 0; i < CHANNEL_RADIOS; i++)
+    {
+        MAP_GPIOPinTypeGPIOInput(BOARD_RADIO0_IRQ_PORT,
+                                 g_psRadios[i].ui8IRQPin);
+        MAP_GPIOIntTypeSet(BOARD_RADIO0_IRQ_PORT, g_psRadios[i].ui8IRQPin,
+                           GPIO_FALLING_EDGE);
+        MAP_GPIOPinTypeGPIOOutput(g_psRadios[i].sSPI.ui32CSPort,
+                                  g_psRadios[i].sSPI.ui8CSPin);
+        MAP_GPIOPinTypeGPIOOutput(g_psRadios[i].ui32CEPort,
+                                  g_psRadios[i].ui8CEPin);
+    }
     
     //
-    // Configure pins for SSI2
+    // Configure pins for each radio's SSI
     //
-    MAP_GPIOPinConfigure(GPIO_PG5_SSI2XDAT0);
-    MAP_GPIOPinConfigure(GPIO_PG4_SSI2XDAT1);
-    MAP_GPIOPinConfigure(GPIO_PG7_SSI2CLK);
-    MAP_GPIOPinTypeSSI(GPIO_PORTG_BASE, GPIO_PIN_4 | GPIO_PIN_5 | GPIO_PIN_7);
-    GPIOPinWrite(GPIO_PORTQ_BASE, GPIO_PIN_7, GPIO_PIN_7);
+    MAP_GPIOPinConfigure(BOARD_RADIO0_SSI_TX);
+    MAP_GPIOPinConfigure(BOARD_RADIO0_SSI_RX);
+    MAP_GPIOPinConfigure(BOARD_RADIO0_SSI_CLK);
+    MAP_GPIOPinTypeSSI(BOARD_RADIO0_SSI_PORT, BOARD_RADIO0_SSI_PINS);
+#if CHANNEL_RADIOS > 1
+    MAP_GPIOPinConfigure(BOARD_RADIO1_SSI_TX);
+    MAP_GPIOPinConfigure(BOARD_RADIO1_SSI_RX);
+    MAP_GPIOPinConfigure(BOARD_RADIO1_SSI_CLK);
+    MAP_GPIOPinTypeSSI(BOARD_RADIO1_SSI_PORT, BOARD_RADIO1_SSI_PINS);
+#endif
+    
+    for (i = 0; i < CHANNEL_RADIOS; i++)
+    {
+        GPIOPinWrite(g_psRadios[i].sSPI.ui32CSPort, g_psRadios[i].sSPI.ui8CSPin,
+                     g_psRadios[i].sSPI.ui8CSPin);
+    }
     
     //
     // Configure pins for LED output
@@ -497,12 +2087,37 @@ setup()
     GPIOPinWrite(GPIO_PORTN_BASE, GPIO_PIN_5, 0x00);
     GPIOPinWrite(GPIO_PORTQ_BASE, GPIO_PIN_4, 0x00);
     
-    GPIOPinWrite(GPIO_PORTH_BASE, GPIO_PIN_7, 0x00);
+    //
+    // Confiure each radio's SSI for SPI Mode 0 at 8Mbps, 8 bit transfers,
+    // with the radio disabled.
+    //
+    for (i = 0; i < CHANNEL_RADIOS; i++)
+    {
+        BoardPinWrite(g_psRadios[i].ui32CEPort, g_psRadios[i].ui8CEPin, 0x00);
+        MAP_SSIConfigSetExpClk(g_psRadios[i].sSPI.ui32SSIBase, gui32SysClock,
+                               SSI_FRF_MOTO_MODE_0, SSI_MODE_MASTER, 8000000,
+                               8);
+        MAP_SSIEnable(g_psRadios[i].sSPI.ui32SSIBase);
+    }
     
     //
-    // Confiure SSI2 for SPI Mode 0 at 8Mbps, 8 bit transfers.
+    // Bring up the AES engine and derive each node's link key.  Downlink
+    // counters start in a fresh epoch so no nonce from before this boot is
+    // reused.  Polls from the last node epoch accepted on each link, and
+    // older ones, are refused; a node moves on to a fresh epoch once it
+    // takes an ACK payload in this one.
     //
-    MAP_SSIConfigSetExpClk(SSI2_BASE, gui32SysClock, SSI_FRF_MOTO_MODE_0,
-                           SSI_MODE_MASTER, 8000000, 8);
-    MAP_SSIEnable(SSI2_BASE);
+    SecureInit();
+    ui32Epoch = SecureEpochAdvance();
+    for (i = 0; i < NUM_SLAVES; i++)
+    {
+        SecureKeyDerive(pui8NetKey, i, pui8Key);
+        SecureLinkInit(&g_psLinks[i], i, pui8Key, ui32Epoch,
+                       SecureRXEpochGet(SECURE_EE_LINK_RX_EPOCH(i)));
+        SecureLinkPersistRX(&g_psLinks[i], SECURE_EE_LINK_RX_EPOCH(i));
+    }
+    SecureKeyDerive(pui8NetKey, BROADCAST_ID, pui8Key);
+    SecureLinkInit(&g_sBroadcastLink, BROADCAST_ID, pui8Key, ui32Epoch, 0);
+
+    SensorInit();
 }
@@ -0,0 +1,563 @@
+//*****************************************************************************
+//
+// bench.c - Radio benchmark driven by the master.
+//
+// The "bench" command hands one of the master's radios to this module,
+// which runs the suite in utilities/bench.h against a Node_Bench board and
+// prints a result line per case for host/bench.py.  A case blocks the main
+// loop while it runs, a fraction of a second at most, and one is run per
+// pass once the console has room for its line, so the console stays live
+// and "bench stop" is taken between cases.  The radio's IRQ line is polled
+// and timed on the cycle counter, as the node does, so that interrupt and
+// event latency stay out of the numbers.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "inc/hw_gpio.h"
+#include "inc/hw_types.h"
+
+#include "utilities/nRF24L01.h"
+#include "utilities/cyclecount.h"
+#include "utilities/board.h"
+#include "utilities/bench.h"
+
+#include "console.h"
+#include "bench.h"
+
+//
+// Cases in each suite.
+//
+#define BENCH_QUICK_COUNT       (sizeof(g_pui8QuickSizes) /                   \
+                                 sizeof(g_pui8QuickSizes[0]))
+#define BENCH_CASES_QUICK       (BENCH_TESTS * BENCH_QUICK_COUNT)
+#define BENCH_CASES_FULL        (BENCH_RATES * BENCH_RETRIES * BENCH_TESTS *   \
+                                 BENCH_SIZE_MAX)
+
+//
+// Longest result line, with the "\r\n" uartstdio writes for '\n'.
+//
+#define BENCH_LINE_MAX          128
+
+typedef struct
+{
+    uint8_t ui8Test;
+
+    uint8_t ui8Size;
+
+    uint8_t ui8Rate;
+
+    uint8_t ui8Retry;
+}
+tBenchCase;
+
+typedef struct
+{
+    uint32_t ui32Sent;
+
+    uint32_t ui32OK;
+
+    uint32_t ui32Retries;
+
+    uint32_t ui32ElapsedUs;
+}
+tBenchResult;
+
+static const char *g_ppcTestNames[BENCH_TESTS] = BENCH_TEST_NAMES;
+static const uint16_t g_pui16Kbps[BENCH_RATES] = BENCH_RATE_KBPS;
+static const uint8_t g_pui8RateSetup[BENCH_RATES] = BENCH_RATE_SETUP;
+static const uint16_t g_pui16ArdUs[BENCH_RETRIES] = BENCH_RETRY_ARD_US;
+static const uint8_t g_pui8Arc[BENCH_RETRIES] = BENCH_RETRY_ARC;
+static const uint8_t g_pui8QuickSizes[] = BENCH_QUICK_SIZES;
+
+//
+// The radio lent to the benchmark.
+//
+static tnRFRadio *g_psSPI;
+
+static uint32_t g_ui32CEPort;
+
+static uint8_t g_ui8CEPin;
+
+static uint32_t g_ui32IRQPort;
+
+static uint8_t g_ui8IRQPin;
+
+static uint32_t g_ui32SysClock;
+
+static uint32_t g_ui32CyclesPerUs;
+
+//
+// Progress through the suite.
+//
+static bool g_bRunning;
+
+static bool g_bQuick;
+
+static bool g_bHeaderSent;
+
+static bool g_bAborted;
+
+static uint32_t g_ui32Case;
+
+static uint32_t g_ui32Cases;
+
+//
+// Latencies of the case running, in microseconds, and the cycle count at
+// which BenchIRQWait() last saw the IRQ line low.
+//
+static uint32_t g_pui32Latency[BENCH_PACKETS];
+
+static uint32_t g_ui32IRQTime;
+
+//
+// The ui32Case'th case of the suite: for each data rate and retransmit
+// setting, each test at each size.
+//
+static void
+BenchCaseGet(uint32_t ui32Case, tBenchCase *psCase)
+{
+    if(g_bQuick)
+    {
+        psCase->ui8Size = g_pui8QuickSizes[ui32Case % BENCH_QUICK_COUNT];
+        psCase->ui8Test = ui32Case / BENCH_QUICK_COUNT;
+        psCase->ui8Rate = BENCH_QUICK_RATE;
+        psCase->ui8Retry = BENCH_QUICK_RETRY;
+        return;
+    }
+    psCase->ui8Size = (ui32Case % BENCH_SIZE_MAX) + 1;
+    ui32Case /= BENCH_SIZE_MAX;
+    psCase->ui8Test = ui32Case % BENCH_TESTS;
+    ui32Case /= BENCH_TESTS;
+    psCase->ui8Retry = ui32Case % BENCH_RETRIES;
+    psCase->ui8Rate = ui32Case / BENCH_RETRIES;
+}
+
+static void
+BenchWait(uint32_t ui32Us)
+{
+    uint32_t ui32Start = CycleCountGet();
+
+    while(CycleCountGet() - ui32Start < ui32Us * g_ui32CyclesPerUs)
+    {
+    }
+}
+
+//
+// Send what is in the TX FIFO with a pulse on CE.
+//
+static void
+BenchPulse(void)
+{
+    BoardPinWrite(g_ui32CEPort, g_ui8CEPin, g_ui8CEPin);
+    BenchWait(BENCH_CE_US);
+    BoardPinWrite(g_ui32CEPort, g_ui8CEPin, 0x00);
+}
+
+//
+// Wait up to BENCH_TIMEOUT_US for the radio to raise its IRQ, noting when
+// it did in g_ui32IRQTime, and return the interrupt flags it had set after
+// clearing them, or zero if it never did.
+//
+static uint8_t
+BenchIRQWait(void)
+{
+    uint32_t ui32Start = CycleCountGet();
+
+    while(BoardPinRead(g_ui32IRQPort, g_ui8IRQPin))
+    {
+        if(CycleCountGet() - ui32Start > BENCH_TIMEOUT_US * g_ui32CyclesPerUs)
+        {
+            return(0);
+        }
+    }
+    g_ui32IRQTime = CycleCountGet();
+    return(nRFClearInterrupt() &
+           (nRF_INT_RX_DR | nRF_INT_TX_DS | nRF_INT_MAX_RT));
+}
+
+//
+// Retransmissions the radio made for the packet it last finished with.
+//
+#define BenchRetriesGet()                                                     \
+    (nRFRegisterRead(nRF_O_OBSERVE_TX) & nRF_OBS_ARC_CNT)
+
+//
+// Change to a data rate and retransmit setting as a transmitter.
+//
+static bool
+BenchApply(int iRate, int iRetry)
+{
+    tnRFRegister psRegs[] =
+        BENCH_REGISTERS(g_pui8RateSetup[iRate],
+                        BENCH_SETUP_RETR(g_pui16ArdUs[iRetry],
+                                         g_pui8Arc[iRetry]));
+
+    BoardPinWrite(g_ui32CEPort, g_ui8CEPin, 0x00);
+    return(nRFBringUp(g_ui32SysClock, BENCH_CFG, psRegs,
+                      sizeof(psRegs) / sizeof(psRegs[0])));
+}
+
+//
+// Send a control frame at the control settings.  Returns true once the
+// node has acknowledged it.
+//
+static bool
+BenchControlSend(uint8_t *pui8Frame, int iLen)
+{
+    int i;
+
+    for(i = 0; i < BENCH_SETUP_TRIES; i++)
+    {
+        if(!BenchApply(BENCH_CONTROL_RATE, BENCH_CONTROL_RETRY))
+        {
+            return(false);
+        }
+        nRFDataPut(pui8Frame, iLen);
+        BenchPulse();
+        if(BenchIRQWait() & nRF_INT_TX_DS)
+        {
+            return(true);
+        }
+
+        //
+        // The node may still be at the last case's settings; give it time
+        // to go back to the control settings.
+        //
+        nRFFlushTX();
+        BenchWait(BENCH_IDLE_US);
+    }
+    return(false);
+}
+
+//
+// Test payload ui32Seq: bytes counting up from the sequence number, with
+// the top bit clear so that it is never taken for a control frame.
+//
+static void
+BenchFill(uint8_t *pui8Data, int iSize, uint32_t ui32Seq)
+{
+    int i;
+
+    for(i = 0; i < iSize; i++)
+    {
+        pui8Data[i] = (ui32Seq + i) & 0x7F;
+    }
+}
+
+//
+// One packet out and, for ping, its echo back; for ackpl, the ACK payload
+// that answers it.
+//
+static void
+BenchRoundTrips(const tBenchCase *psCase, tBenchResult *psResult)
+{
+    uint8_t pui8Data[BENCH_SIZE_MAX];
+    uint32_t ui32Start;
+    uint8_t ui8Flags;
+    int i;
+
+    for(i = 0; i < BENCH_PACKETS; i++)
+    {
+        BenchFill(pui8Data, psCase->ui8Size, i);
+        nRFDataPut(pui8Data, psCase->ui8Size);
+        ui32Start = CycleCountGet();
+        BenchPulse();
+        psResult->ui32Sent++;
+
+        ui8Flags = BenchIRQWait();
+        psResult->ui32Retries += BenchRetriesGet();
+        if(!(ui8Flags & nRF_INT_TX_DS))
+        {
+            nRFFlushTX();
+            nRFFlushRX();
+            continue;
+        }
+
+        if(psCase->ui8Test == BENCH_TEST_PING)
+        {
+            //
+            // Listen for the echo, and stay listening until the radio has
+            // acknowledged it, or the node would send it again.
+            //
+            nRFConfig(BENCH_CFG | nRF_CFG_PRIM_RX);
+            BoardPinWrite(g_ui32CEPort, g_ui8CEPin, g_ui8CEPin);
+            ui8Flags = BenchIRQWait();
+            BenchWait(BENCH_ECHO_WAIT_US);
+            BoardPinWrite(g_ui32CEPort, g_ui8CEPin, 0x00);
+            nRFConfig(BENCH_CFG);
+        }
+
+        if(ui8Flags & nRF_INT_RX_DR)
+        {
+            g_pui32Latency[psResult->ui32OK++] =
+                (g_ui32IRQTime - ui32Start) / g_ui32CyclesPerUs;
+        }
+        nRFFlushRX();
+    }
+}
+
+//
+// Packets sent back to back with CE held high and the TX FIFO kept full.
+// The latency of each is the time since the ACK before it.
+//
+static void
+BenchStream(const tBenchCase *psCase, tBenchResult *psResult)
+{
+    uint8_t pui8Data[BENCH_SIZE_MAX];
+    uint32_t ui32Last, ui32Queued = 0, ui32InFIFO = 0;
+    uint8_t ui8Flags;
+
+    ui32Last = CycleCountGet();
+    while(psResult->ui32Sent < BENCH_PACKETS)
+    {
+        while((ui32InFIFO < 3) && (ui32Queued < BENCH_PACKETS))
+        {
+            BenchFill(pui8Data, psCase->ui8Size, ui32Queued);
+            nRFDataPut(pui8Data, psCase->ui8Size);
+            ui32Queued++;
+            ui32InFIFO++;
+        }
+        BoardPinWrite(g_ui32CEPort, g_ui8CEPin, g_ui8CEPin);
+
+        ui8Flags = BenchIRQWait();
+        if(ui8Flags == 0)
+        {
+            break;
+        }
+        if(ui8Flags & (nRF_INT_TX_DS | nRF_INT_MAX_RT))
+        {
+            psResult->ui32Sent++;
+            psResult->ui32Retries += BenchRetriesGet();
+        }
+        if(ui8Flags & nRF_INT_TX_DS)
+        {
+            g_pui32Latency[psResult->ui32OK++] =
+                (g_ui32IRQTime - ui32Last) / g_ui32CyclesPerUs;
+            ui32Last = g_ui32IRQTime;
+            ui32InFIFO--;
+        }
+        else if(ui8Flags & nRF_INT_MAX_RT)
+        {
+            //
+            // A packet that runs out of retransmissions stays at the head
+            // of the FIFO.  Drop it alone and send the rest again.
+            //
+            BoardPinWrite(g_ui32CEPort, g_ui8CEPin, 0x00);
+            nRFFlushTX();
+            ui32Queued -= ui32InFIFO - 1;
+            ui32InFIFO = 0;
+            ui32Last = g_ui32IRQTime;
+        }
+        nRFFlushRX();
+    }
+    BoardPinWrite(g_ui32CEPort, g_ui8CEPin, 0x00);
+    nRFFlushTX();
+}
+
+//
+// Sort the case's latencies for the percentiles.  There are few enough for
+// an insertion sort.
+//
+static void
+BenchSort(uint32_t ui32Count)
+{
+    uint32_t i, j, ui32Value;
+
+    for(i = 1; i < ui32Count; i++)
+    {
+        ui32Value = g_pui32Latency[i];
+        for(j = i; (j > 0) && (g_pui32Latency[j - 1] > ui32Value); j--)
+        {
+            g_pui32Latency[j] = g_pui32Latency[j - 1];
+        }
+        g_pui32Latency[j] = ui32Value;
+    }
+}
+
+static void
+BenchResultPrint(const tBenchCase *psCase, const tBenchResult *psResult)
+{
+    uint32_t ui32Rate = 0, ui32Goodput = 0, ui32N;
+
+    if(psResult->ui32ElapsedUs)
+    {
+        ui32Rate = ((uint64_t)psResult->ui32OK * 1000000) /
+                   psResult->ui32ElapsedUs;
+        ui32Goodput = ((uint64_t)psResult->ui32OK * psCase->ui8Size *
+                       1000000) / psResult->ui32ElapsedUs;
+    }
+
+    ConsolePrintf("B %s %u %u %u %u %u %u %u %u %u %u",
+                  g_ppcTestNames[psCase->ui8Test], psCase->ui8Size,
+                  g_pui16Kbps[psCase->ui8Rate], g_pui16ArdUs[psCase->ui8Retry],
+                  g_pui8Arc[psCase->ui8Retry], psResult->ui32Sent,
+                  psResult->ui32OK, psResult->ui32Retries,
+                  psResult->ui32ElapsedUs, ui32Rate, ui32Goodput);
+
+    ui32N = psResult->ui32OK;
+    if(ui32N == 0)
+    {
+        ConsolePrintf(" - - - -\n");
+        return;
+    }
+    BenchSort(ui32N);
+    ConsolePrintf(" %u %u %u %u\n", g_pui32Latency[((ui32N - 1) * 50) / 100],
+                  g_pui32Latency[((ui32N - 1) * 90) / 100],
+                  g_pui32Latency[((ui32N - 1) * 99) / 100],
+                  g_pui32Latency[ui32N - 1]);
+}
+
+//
+// Run one case: set the node up for it, run the test and end it.  Returns
+// false if the node did not answer the setup.
+//
+static bool
+BenchCaseRun(const tBenchCase *psCase)
+{
+    uint8_t pui8Frame[BENCH_SETUP_LEN];
+    tBenchResult sResult = {0, 0, 0, 0};
+    uint32_t ui32Start;
+
+    nRFRadioSelect(g_psSPI);
+
+    pui8Frame[0] = BENCH_MSG_SETUP;
+    pui8Frame[1] = psCase->ui8Test;
+    pui8Frame[2] = psCase->ui8Size;
+    pui8Frame[3] = psCase->ui8Rate;
+    pui8Frame[4] = psCase->ui8Retry;
+    if(!BenchControlSend(pui8Frame, BENCH_SETUP_LEN))
+    {
+        return(false);
+    }
+
+    //
+    // Change after the node, which changes BENCH_SWITCH_US after it took
+    // the setup frame.
+    //
+    BenchWait(BENCH_SWITCH_US);
+    if(!BenchApply(psCase->ui8Rate, psCase->ui8Retry))
+    {
+        return(false);
+    }
+
+    ui32Start = CycleCountGet();
+    if(psCase->ui8Test == BENCH_TEST_STREAM)
+    {
+        BenchStream(psCase, &sResult);
+        sResult.ui32ElapsedUs = (g_ui32IRQTime - ui32Start) / g_ui32CyclesPerUs;
+    }
+    else
+    {
+        BenchRoundTrips(psCase, &sResult);
+        sResult.ui32ElapsedUs = (CycleCountGet() - ui32Start) /
+                                g_ui32CyclesPerUs;
+    }
+
+    //
+    // The end frame goes at the case's settings, and a node that misses it
+    // goes back to the control settings on its own.
+    //
+    pui8Frame[0] = BENCH_MSG_END;
+    nRFDataPut(pui8Frame, 1);
+    BenchPulse();
+    BenchIRQWait();
+    nRFFlushTX();
+    nRFFlushRX();
+    BenchWait(BENCH_SWITCH_US);
+
+    BenchResultPrint(psCase, &sResult);
+    return(true);
+}
+
+//
+// Start the suite on a radio the caller has taken off the network, with
+// its CE low and its IRQ interrupt disabled.  The quick suite runs only
+// BENCH_QUICK_SIZES at one setting.
+//
+void
+BenchStart(tnRFRadio *psSPI, uint32_t ui32CEPort, uint8_t ui8CEPin,
+           uint32_t ui32IRQPort, uint8_t ui8IRQPin, uint32_t ui32SysClock,
+           bool bQuick)
+{
+    g_psSPI = psSPI;
+    g_ui32CEPort = ui32CEPort;
+    g_ui8CEPin = ui8CEPin;
+    g_ui32IRQPort = ui32IRQPort;
+    g_ui8IRQPin = ui8IRQPin;
+    g_ui32SysClock = ui32SysClock;
+    g_ui32CyclesPerUs = ui32SysClock / 1000000;
+
+    g_bQuick = bQuick;
+    g_ui32Cases = bQuick ? BENCH_CASES_QUICK : BENCH_CASES_FULL;
+    g_ui32Case = 0;
+    g_bHeaderSent = false;
+    g_bAborted = false;
+    g_bRunning = true;
+}
+
+//
+// Stop between cases.  The caller gives the radio back to the network.
+//
+void
+BenchStop(void)
+{
+    g_bRunning = false;
+}
+
+bool
+BenchRunning(void)
+{
+    return(g_bRunning);
+}
+
+void
+BenchPrint(void)
+{
+    ConsolePrintf("Bench %s: %u of %u %s cases run%s\n",
+                  g_bRunning ? "running" : "stopped", g_ui32Case, g_ui32Cases,
+                  g_bQuick ? "quick" : "full",
+                  g_bAborted ? ", node stopped answering" : "");
+}
+
+//
+// Run the next case if the console has room for its line.  Call from the
+// main loop.  Returns true when the suite has just finished or given up,
+// for the caller to give the radio back to the network.
+//
+bool
+BenchService(void)
+{
+    tBenchCase sCase;
+
+    if(!g_bRunning || (ConsoleTxFree() < BENCH_LINE_MAX))
+    {
+        return(false);
+    }
+
+    if(!g_bHeaderSent)
+    {
+        ConsolePrintf("BENCH %u %u hw\n", BENCH_DUMP_VERSION, BENCH_PACKETS);
+        g_bHeaderSent = true;
+        return(false);
+    }
+
+    if(g_ui32Case < g_ui32Cases)
+    {
+        BenchCaseGet(g_ui32Case, &sCase);
+        if(BenchCaseRun(&sCase))
+        {
+            g_ui32Case++;
+            return(false);
+        }
+        g_bAborted = true;
+    }
+
+    ConsolePrintf("BENCH END\n");
+    g_bRunning = false;
+    return(true);
+}
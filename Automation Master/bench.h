@@ -0,0 +1,20 @@
+//*****************************************************************************
+//
+// bench.h - Radio benchmark driven by the master.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __BENCH_MASTER_H__
+#define __BENCH_MASTER_H__
+
+void BenchStart(tnRFRadio *psSPI, uint32_t ui32CEPort, uint8_t ui8CEPin,
+                uint32_t ui32IRQPort, uint8_t ui8IRQPin, uint32_t ui32SysClock,
+                bool bQuick);
+void BenchStop(void);
+bool BenchRunning(void);
+void BenchPrint(void);
+bool BenchService(void);
+
+#endif
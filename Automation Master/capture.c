@@ -0,0 +1,236 @@
+//*****************************************************************************
+//
+// capture.c - Recording of radio traffic for offline replay.
+//
+// While a capture runs, every poll received, ACK payload staged and command
+// queued is recorded and streamed out of the console for host/replay:
+//
+//     CAPTURE <version>
+//     CAP <record as hex>
+//     ...
+//     CAPTURE END <records> <records lost>
+//
+// Record times are network time in microseconds.  Records wait in a small
+// queue for room on the console, so streaming never holds up the radio.
+// Records that find the queue full are counted and reported in a
+// CAPTURE_LOST record once there is space.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "utilities/secure.h"
+
+#include "console.h"
+#include "events.h"
+#include "poll.h"
+#include "capture.h"
+
+//
+// Longest line, with the "\r\n" uartstdio writes for '\n'.
+//
+#define CAPTURE_LINE_MAX        (4 + (CAPTURE_RECORD_MAX * 2) + 2)
+
+typedef struct
+{
+    uint8_t ui8Len;
+
+    uint8_t pui8Data[CAPTURE_RECORD_MAX];
+}
+tCaptureRecord;
+
+static tCaptureRecord g_psCapture[CAPTURE_SLOTS];
+
+static uint32_t g_ui32CaptureHead;
+
+static uint32_t g_ui32CaptureCount;
+
+static bool g_bCapturing;
+
+//
+// Header and end lines still to be written.
+//
+static bool g_bHeaderDue;
+
+static bool g_bEndDue;
+
+static uint32_t g_ui32Records;
+
+static uint32_t g_ui32Lost;
+
+//
+// Records lost since the last CAPTURE_LOST record.
+//
+static uint32_t g_ui32LostPending;
+
+//
+// Start a record of iLen body bytes, returning where the body goes, or 0
+// if the queue is full.
+//
+static uint8_t *
+CaptureAlloc(uint8_t ui8Type, uint32_t ui32Time, int iLen)
+{
+    tCaptureRecord *psRecord;
+
+    if(g_ui32CaptureCount == CAPTURE_SLOTS)
+    {
+        g_ui32Lost++;
+        g_ui32LostPending++;
+        return(0);
+    }
+
+    psRecord = &g_psCapture[(g_ui32CaptureHead + g_ui32CaptureCount) %
+                            CAPTURE_SLOTS];
+    g_ui32CaptureCount++;
+    g_ui32Records++;
+
+    psRecord->ui8Len = CAPTURE_HDR_LEN + iLen;
+    psRecord->pui8Data[0] = ui8Type;
+    psRecord->pui8Data[1] = iLen;
+    memcpy(psRecord->pui8Data + 2, &ui32Time, 4);
+    return(psRecord->pui8Data + CAPTURE_HDR_LEN);
+}
+
+void
+CaptureStart(void)
+{
+    g_ui32CaptureHead = 0;
+    g_ui32CaptureCount = 0;
+    g_ui32Records = 0;
+    g_ui32Lost = 0;
+    g_ui32LostPending = 0;
+    g_bHeaderDue = true;
+    g_bEndDue = false;
+    g_bCapturing = true;
+}
+
+void
+CaptureStop(void)
+{
+    if(g_bCapturing)
+    {
+        g_bCapturing = false;
+        g_bEndDue = true;
+    }
+}
+
+void
+CapturePoll(uint32_t ui32Arrival, bool bTimed, const uint8_t *pui8Frame,
+            int iLen)
+{
+    uint8_t *pui8Body;
+
+    if(!g_bCapturing || (iLen > CAPTURE_RECORD_MAX - CAPTURE_HDR_LEN - 1))
+    {
+        return;
+    }
+    pui8Body = CaptureAlloc(CAPTURE_POLL, ui32Arrival, iLen + 1);
+    if(pui8Body)
+    {
+        pui8Body[0] = bTimed ? CAPTURE_POLL_TIMED : 0;
+        memcpy(pui8Body + 1, pui8Frame, iLen);
+    }
+}
+
+void
+CaptureAck(int iSlave, const uint8_t *pui8Frame, int iLen)
+{
+    uint8_t *pui8Body;
+
+    if(!g_bCapturing)
+    {
+        return;
+    }
+    pui8Body = CaptureAlloc(CAPTURE_ACK, EventMicros(), iLen + 1);
+    if(pui8Body)
+    {
+        pui8Body[0] = iSlave;
+        memcpy(pui8Body + 1, pui8Frame, iLen);
+    }
+}
+
+void
+CaptureCommand(int iSlave, const tAutoCmd *psCmd, bool bPushed)
+{
+    uint8_t *pui8Body;
+
+    if(!g_bCapturing)
+    {
+        return;
+    }
+    pui8Body = CaptureAlloc(CAPTURE_CMD, psCmd->ui32Issued,
+                            psCmd->ui8Len + 4);
+    if(pui8Body)
+    {
+        pui8Body[0] = iSlave;
+        pui8Body[1] = psCmd->ui8Class;
+        pui8Body[2] = bPushed ? CAPTURE_CMD_PUSHED : 0;
+        pui8Body[3] = psCmd->ui8Seq;
+        memcpy(pui8Body + 4, psCmd->pcCmd, psCmd->ui8Len);
+    }
+}
+
+//
+// Write out as many queued records as the console has room for.  Call from
+// the main loop.
+//
+void
+CaptureService(void)
+{
+    static const char pcHex[] = "0123456789abcdef";
+    char pcLine[CAPTURE_LINE_MAX];
+    tCaptureRecord *psRecord;
+    uint8_t *pui8Body;
+    int i, iPos;
+
+    if(g_bHeaderDue)
+    {
+        if(ConsoleTxFree() < 32)
+        {
+            return;
+        }
+        ConsolePrintf("CAPTURE %u\n", CAPTURE_VERSION);
+        g_bHeaderDue = false;
+    }
+
+    while(g_ui32CaptureCount && (ConsoleTxFree() >= CAPTURE_LINE_MAX))
+    {
+        psRecord = &g_psCapture[g_ui32CaptureHead];
+        memcpy(pcLine, "CAP ", 4);
+        iPos = 4;
+        for(i = 0; i < psRecord->ui8Len; i++)
+        {
+            pcLine[iPos++] = pcHex[psRecord->pui8Data[i] >> 4];
+            pcLine[iPos++] = pcHex[psRecord->pui8Data[i] & 0x0F];
+        }
+        pcLine[iPos] = 0;
+        ConsolePrintf("%s\n", pcLine);
+        g_ui32CaptureHead = (g_ui32CaptureHead + 1) % CAPTURE_SLOTS;
+        g_ui32CaptureCount--;
+
+        //
+        // Note losses in the stream where they happened.
+        //
+        if(g_ui32LostPending && g_bCapturing)
+        {
+            if(g_ui32LostPending > 0xFFFF)
+            {
+                g_ui32LostPending = 0xFFFF;
+            }
+            pui8Body = CaptureAlloc(CAPTURE_LOST, EventMicros(), 2);
+            pui8Body[0] = g_ui32LostPending & 0xFF;
+            pui8Body[1] = g_ui32LostPending >> 8;
+            g_ui32LostPending = 0;
+        }
+    }
+
+    if(g_bEndDue && !g_ui32CaptureCount && (ConsoleTxFree() >= 48))
+    {
+        ConsolePrintf("CAPTURE END %u %u\n", g_ui32Records, g_ui32Lost);
+        g_bEndDue = false;
+    }
+}
@@ -0,0 +1,54 @@
+//*****************************************************************************
+//
+// capture.h - Recording of radio traffic for offline replay.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include "poll.h"
+
+//
+// Capture format version, printed in the header line.
+//
+#define CAPTURE_VERSION         2
+
+//
+// Record types.  Every record is [type][body length][network time 4][body],
+// little-endian.
+//
+#define CAPTURE_POLL            0x01 // [flags][frame as received]
+#define CAPTURE_ACK             0x02 // [slave][sealed frame]
+#define CAPTURE_CMD             0x03 // [slave][class][flags][seq][command]
+#define CAPTURE_LOST            0x04 // [records lost 2]
+
+#define CAPTURE_HDR_LEN         6
+
+//
+// Flags.
+//
+#define CAPTURE_POLL_TIMED      0x01 // Arrival time taken by the radio IRQ
+#define CAPTURE_CMD_PUSHED      0x01 // Queued to be pushed, not polled for
+
+//
+// Longest record, a poll of 32 bytes plus a route header.
+//
+#define CAPTURE_RECORD_MAX      (CAPTURE_HDR_LEN + 1 + 33)
+
+//
+// Records held while waiting for room on the console.
+//
+#define CAPTURE_SLOTS           32
+
+void CaptureStart(void);
+void CaptureStop(void);
+void CapturePoll(uint32_t ui32Arrival, bool bTimed, const uint8_t *pui8Frame,
+                 int iLen);
+void CaptureAck(int iSlave, const uint8_t *pui8Frame, int iLen);
+void CaptureCommand(int iSlave, const tAutoCmd *psCmd, bool bPushed);
+void CaptureService(void);
+
+#endif
@@ -0,0 +1,80 @@
+//*****************************************************************************
+//
+// console.c - Non-blocking console output for the master.
+//
+// The UART runs from uartstdio's interrupt-driven TX ring (UART_BUFFERED),
+// so writing never waits for the wire.  When the ring is too full for a
+// message, uartstdio would silently cut it short; ConsolePrintf() instead
+// drops the whole message and counts it, so output stays readable and the
+// loss shows up in the "load" command.
+//
+// Only call these from the main loop.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+
+#include "utils/uartstdio.h"
+#include "utils/ustdlib.h"
+
+#include "console.h"
+
+static uint32_t g_ui32DroppedMsgs;
+static uint32_t g_ui32DroppedBytes;
+
+void
+ConsolePrintf(const char *pcString, ...)
+{
+    char pcLine[CONSOLE_LINE_LEN];
+    va_list vaArgP;
+    int iLen, iNeeded, i;
+
+    va_start(vaArgP, pcString);
+    iLen = uvsnprintf(pcLine, sizeof(pcLine), pcString, vaArgP);
+    va_end(vaArgP);
+    if (iLen >= (int)sizeof(pcLine))
+    {
+        iLen = sizeof(pcLine) - 1;
+    }
+
+    //
+    // uartstdio expands each '\n' to "\r\n".
+    //
+    iNeeded = iLen;
+    for (i = 0; i < iLen; i++)
+    {
+        if (pcLine[i] == '\n')
+        {
+            iNeeded++;
+        }
+    }
+
+    if (UARTTxBytesFree() < iNeeded)
+    {
+        g_ui32DroppedMsgs++;
+        g_ui32DroppedBytes += iNeeded;
+        return;
+    }
+    UARTwrite(pcLine, iLen);
+}
+
+//
+// Return the space left in the TX ring, for output that must not be
+// dropped and can wait.  Each '\n' takes two bytes.
+//
+int
+ConsoleTxFree(void)
+{
+    return(UARTTxBytesFree());
+}
+
+void
+ConsoleStatsPrint(void)
+{
+    ConsolePrintf("Console: %u messages (%u bytes) dropped on TX overflow\n",
+                  g_ui32DroppedMsgs, g_ui32DroppedBytes);
+}
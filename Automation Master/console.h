@@ -0,0 +1,21 @@
+//*****************************************************************************
+//
+// console.h - Non-blocking console output for the master.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __CONSOLE_H__
+#define __CONSOLE_H__
+
+//
+// Longest single message ConsolePrintf() will format.
+//
+#define CONSOLE_LINE_LEN        160
+
+void ConsolePrintf(const char *pcString, ...);
+int ConsoleTxFree(void);
+void ConsoleStatsPrint(void);
+
+#endif
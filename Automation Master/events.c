@@ -0,0 +1,226 @@
+//*****************************************************************************
+//
+// events.c - Event flags and idle handling for the master's main loop.
+//
+// Interrupt handlers do the minimum and post an event; the main loop sleeps
+// in WFI until one is pending.  Time spent asleep and the delay from post to
+// dispatch are measured against a free-running timer, which unlike the DWT
+// cycle counter keeps counting while the core is stopped.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "driverlib/cpu.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/systick.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_timer.h"
+#include "inc/hw_types.h"
+
+#include "utilities/ramfunc.h"
+#include "utilities/timesync.h"
+
+#include "console.h"
+#include "events.h"
+
+//
+// 32-bit free-running timer used for timestamps.
+//
+#define TIMESTAMP_PERIPH        SYSCTL_PERIPH_TIMER5
+#define TIMESTAMP_BASE          TIMER5_BASE
+
+//
+// Pending events.  Only ever set through the bit-band alias, so a post from
+// an interrupt cannot be lost to a read-modify-write in another context.
+//
+static volatile uint32_t g_ui32Events;
+
+//
+// Timestamp of the first post of each event since it was last dispatched.
+//
+static uint32_t g_pui32PostTime[NUM_EVENTS];
+
+//
+// Dispatch count and post-to-dispatch latency, in timer ticks, per event.
+//
+static uint32_t g_pui32Dispatched[NUM_EVENTS];
+static uint32_t g_pui32LatencyTotal[NUM_EVENTS];
+static uint32_t g_pui32LatencyMax[NUM_EVENTS];
+
+//
+// Idle time in the current one second window, and the load measured over
+// the last complete window, in tenths of a percent.
+//
+static uint32_t g_ui32WindowStart;
+static uint32_t g_ui32IdleTime;
+static uint32_t g_ui32LoadPermille;
+
+static uint32_t g_ui32TicksPerSecond;
+
+volatile uint32_t g_ui32Ticks;
+
+//
+// Microsecond clock built on the timestamp timer.  This is the network time
+// distributed to the nodes.
+//
+static tTimeClock g_sClock;
+
+static const char *g_ppcEventNames[NUM_EVENTS] =
+{
+    "radio", "console", "tick"
+};
+
+//
+// The timestamp timer's count, read directly as TimerValueGet() would,
+// since this is on the radio interrupt's path.
+//
+RAMFUNC uint32_t
+EventTimestamp(void)
+{
+    return(HWREG(TIMESTAMP_BASE + TIMER_O_TAV));
+}
+
+//
+// Return the time in microseconds.  The SysTick keeps the underlying clock
+// current across timer wraps.
+//
+RAMFUNC uint32_t
+EventMicros(void)
+{
+    uint32_t ui32Micros;
+    bool bMasked;
+
+    bMasked = MAP_IntMasterDisable();
+    ui32Micros = TimeClockUpdate(&g_sClock, EventTimestamp());
+    if(!bMasked)
+    {
+        MAP_IntMasterEnable();
+    }
+    return(ui32Micros);
+}
+
+//
+// Mark an event pending.  Safe to call from any interrupt handler.
+//
+RAMFUNC void
+EventPost(uint32_t ui32Event)
+{
+    if(!HWREGBITW(&g_ui32Events, ui32Event))
+    {
+        g_pui32PostTime[ui32Event] = EventTimestamp();
+        HWREGBITW(&g_ui32Events, ui32Event) = 1;
+    }
+}
+
+void
+SysTickIntHandler(void)
+{
+    g_ui32Ticks++;
+    EventMicros();
+    EventPost(EVENT_TICK);
+}
+
+//
+// Sleep until at least one event is pending, then return and clear the
+// pending set.  WFI is entered with interrupts masked so an event posted
+// between the check and the sleep still wakes the core.
+//
+uint32_t
+EventWait(void)
+{
+    uint32_t ui32Events, ui32Now, ui32Latency, ui32Sleep;
+    int i;
+
+    MAP_IntMasterDisable();
+    while(g_ui32Events == 0)
+    {
+        ui32Sleep = EventTimestamp();
+        CPUwfi();
+        g_ui32IdleTime += EventTimestamp() - ui32Sleep;
+
+        //
+        // Let the interrupt that woke us run.
+        //
+        MAP_IntMasterEnable();
+        MAP_IntMasterDisable();
+    }
+    ui32Events = g_ui32Events;
+    g_ui32Events = 0;
+    MAP_IntMasterEnable();
+
+    ui32Now = EventTimestamp();
+    for(i = 0; i < NUM_EVENTS; i++)
+    {
+        if(ui32Events & EVENT_FLAG(i))
+        {
+            ui32Latency = ui32Now - g_pui32PostTime[i];
+            g_pui32Dispatched[i]++;
+            g_pui32LatencyTotal[i] += ui32Latency;
+            if(ui32Latency > g_pui32LatencyMax[i])
+            {
+                g_pui32LatencyMax[i] = ui32Latency;
+            }
+        }
+    }
+
+    if(ui32Now - g_ui32WindowStart >= g_ui32TicksPerSecond)
+    {
+        g_ui32LoadPermille = 1000 - (g_ui32IdleTime /
+                                     ((ui32Now - g_ui32WindowStart) / 1000));
+        g_ui32WindowStart = ui32Now;
+        g_ui32IdleTime = 0;
+    }
+
+    return(ui32Events);
+}
+
+//
+// Print CPU load and per-event dispatch latency to the console.
+//
+void
+EventStatsPrint(void)
+{
+    uint32_t ui32PerUs = g_ui32TicksPerSecond / 1000000;
+    uint32_t ui32Avg;
+    int i;
+
+    ConsolePrintf("CPU load: %u.%u%%\n", g_ui32LoadPermille / 10,
+                  g_ui32LoadPermille % 10);
+    ConsolePrintf("Event     Count     Avg us  Max us\n");
+    for(i = 0; i < NUM_EVENTS; i++)
+    {
+        ui32Avg = g_pui32Dispatched[i] ?
+                  g_pui32LatencyTotal[i] / g_pui32Dispatched[i] : 0;
+        ConsolePrintf("%8s  %8u  %6u  %6u\n", g_ppcEventNames[i],
+                      g_pui32Dispatched[i], ui32Avg / ui32PerUs,
+                      g_pui32LatencyMax[i] / ui32PerUs);
+    }
+}
+
+//
+// Start the timestamp timer and the SysTick.
+//
+void
+EventInit(uint32_t ui32SysClock)
+{
+    g_ui32TicksPerSecond = ui32SysClock;
+
+    MAP_SysCtlPeripheralEnable(TIMESTAMP_PERIPH);
+    MAP_TimerConfigure(TIMESTAMP_BASE, TIMER_CFG_PERIODIC_UP);
+    MAP_TimerLoadSet(TIMESTAMP_BASE, TIMER_A, 0xFFFFFFFF);
+    MAP_TimerEnable(TIMESTAMP_BASE, TIMER_A);
+    g_ui32WindowStart = EventTimestamp();
+    TimeClockInit(&g_sClock, ui32SysClock, g_ui32WindowStart);
+
+    MAP_SysTickPeriodSet(ui32SysClock / SYSTICK_HZ);
+    MAP_SysTickIntEnable();
+    MAP_SysTickEnable();
+}
@@ -0,0 +1,37 @@
+//*****************************************************************************
+//
+// events.h - Event flags and idle handling for the master's main loop.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __EVENTS_H__
+#define __EVENTS_H__
+
+//
+// Events, as bit numbers in the pending set.  Interrupt handlers post them
+// and the main loop dispatches them.
+//
+#define EVENT_RADIO             0 // Radio IRQ asserted
+#define EVENT_CONSOLE           1 // Complete line in the UART RX buffer
+#define EVENT_TICK              2 // SysTick period elapsed
+#define NUM_EVENTS              3
+
+#define EVENT_FLAG(e)           (1 << (e))
+
+//
+// SysTick rate, which is also the resolution of software timeouts.
+//
+#define SYSTICK_HZ              100
+
+extern volatile uint32_t g_ui32Ticks;
+
+void EventInit(uint32_t ui32SysClock);
+void EventPost(uint32_t ui32Event);
+uint32_t EventWait(void);
+uint32_t EventTimestamp(void);
+uint32_t EventMicros(void);
+void EventStatsPrint(void);
+
+#endif
@@ -0,0 +1,244 @@
+//*****************************************************************************
+//
+// health.c - Radio health watchdog for the master.
+//
+// The main loop checks each radio every HEALTH_CHECK_TICKS and reports what
+// it finds here.  A radio that fails is reset on the spot, or just serviced
+// if all it missed was an interrupt.  An episode runs from the last sign
+// the radio was well, a poll or a passed check, to the first poll after
+// the fault was dealt with, or to the first passed check for a radio that
+// was hearing no polls.  Detection time is the part up to the fault being
+// found, and recovery time the rest.  A radio reset for silence that stays
+// silent is taken to have lost its nodes rather than failed, and the
+// episode is closed unconfirmed.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "utilities/tdma.h"
+#include "utilities/channel.h"
+
+#include "console.h"
+#include "events.h"
+#include "health.h"
+
+#define HEALTH_SILENT_US        (HEALTH_SILENT_PERIODS << \
+                                 (TDMA_PERIOD_LOG2 + TDMA_PACE_MAX))
+
+typedef struct
+{
+    //
+    // Whether polls have been heard since the radio last went silent, when
+    // the last came, and the last sign of any kind that the radio was well.
+    //
+    bool bHeard;
+
+    uint32_t ui32LastPoll;
+
+    uint32_t ui32LastGood;
+
+    //
+    // The episode under way: when the radio was last well before it, when
+    // the fault was found, and whether it ends on a poll.
+    //
+    bool bRecovering;
+
+    bool bAwaitPoll;
+
+    uint32_t ui32Since;
+
+    uint32_t ui32Detected;
+
+    uint32_t pui32Faults[HEALTH_FAULTS];
+
+    uint32_t ui32Resets;
+
+    uint32_t ui32ResetFails;
+
+    uint32_t ui32ResetMaxUs;
+
+    //
+    // Episodes closed, in total and longest milliseconds.
+    //
+    uint32_t ui32Recovered;
+
+    uint32_t ui32Unconfirmed;
+
+    uint32_t ui32DetectTotal;
+
+    uint32_t ui32DetectMax;
+
+    uint32_t ui32RecoverTotal;
+
+    uint32_t ui32RecoverMax;
+}
+tHealth;
+
+static tHealth g_psHealth[CHANNEL_RADIOS];
+
+static const char *g_ppcFaultNames[HEALTH_FAULTS] =
+{
+    "SPI", "config", "IRQ", "push", "silent"
+};
+
+//
+// Close the episode under way.
+//
+static void
+HealthRecovered(tHealth *psHealth, uint32_t ui32Now)
+{
+    uint32_t ui32Detect = (psHealth->ui32Detected - psHealth->ui32Since) / 1000;
+    uint32_t ui32Recover = (ui32Now - psHealth->ui32Detected) / 1000;
+
+    psHealth->bRecovering = false;
+    psHealth->ui32Recovered++;
+    psHealth->ui32DetectTotal += ui32Detect;
+    psHealth->ui32RecoverTotal += ui32Recover;
+    if(ui32Detect > psHealth->ui32DetectMax)
+    {
+        psHealth->ui32DetectMax = ui32Detect;
+    }
+    if(ui32Recover > psHealth->ui32RecoverMax)
+    {
+        psHealth->ui32RecoverMax = ui32Recover;
+    }
+}
+
+//
+// A poll came in on the radio.
+//
+void
+HealthPoll(int iRadio, uint32_t ui32Now)
+{
+    tHealth *psHealth = &g_psHealth[iRadio];
+
+    psHealth->bHeard = true;
+    psHealth->ui32LastPoll = ui32Now;
+    psHealth->ui32LastGood = ui32Now;
+    if(psHealth->bRecovering)
+    {
+        HealthRecovered(psHealth, ui32Now);
+    }
+}
+
+//
+// Return true if polls the radio was hearing have stopped.  Silence after
+// a reset for it closes the episode unconfirmed instead, and is not
+// reported again until polls are heard once more.
+//
+bool
+HealthSilent(int iRadio, uint32_t ui32Now)
+{
+    tHealth *psHealth = &g_psHealth[iRadio];
+
+    if(!psHealth->bHeard ||
+       ((ui32Now - psHealth->ui32LastPoll) <= HEALTH_SILENT_US))
+    {
+        return(false);
+    }
+    if(psHealth->bRecovering)
+    {
+        psHealth->bRecovering = false;
+        psHealth->bHeard = false;
+        psHealth->ui32Unconfirmed++;
+        return(false);
+    }
+    return(true);
+}
+
+//
+// The radio passed a check.
+//
+void
+HealthGood(int iRadio, uint32_t ui32Now)
+{
+    tHealth *psHealth = &g_psHealth[iRadio];
+
+    psHealth->ui32LastGood = ui32Now;
+    if(psHealth->bRecovering && !psHealth->bAwaitPoll)
+    {
+        HealthRecovered(psHealth, ui32Now);
+    }
+}
+
+//
+// A check found a fault.  One found while an episode is under way belongs
+// to it.  The silence window starts again from the reset that follows.
+//
+void
+HealthFault(int iRadio, int iFault, uint32_t ui32Now)
+{
+    tHealth *psHealth = &g_psHealth[iRadio];
+
+    psHealth->pui32Faults[iFault]++;
+    psHealth->ui32LastPoll = ui32Now;
+    if(!psHealth->bRecovering)
+    {
+        psHealth->bRecovering = true;
+        psHealth->bAwaitPoll = psHealth->bHeard;
+        psHealth->ui32Since = psHealth->ui32LastGood;
+        psHealth->ui32Detected = ui32Now;
+    }
+    ConsolePrintf("Radio %d %s fault\n", iRadio, g_ppcFaultNames[iFault]);
+}
+
+//
+// The radio was reset, taking ui32Micros, and came up or not.
+//
+void
+HealthRestored(int iRadio, bool bUp, uint32_t ui32Micros)
+{
+    tHealth *psHealth = &g_psHealth[iRadio];
+
+    psHealth->ui32Resets++;
+    if(!bUp)
+    {
+        psHealth->ui32ResetFails++;
+    }
+    if(ui32Micros > psHealth->ui32ResetMaxUs)
+    {
+        psHealth->ui32ResetMaxUs = ui32Micros;
+    }
+}
+
+void
+HealthPrint(int iRadio, uint32_t ui32Now)
+{
+    tHealth *psHealth = &g_psHealth[iRadio];
+    uint32_t ui32N = psHealth->ui32Recovered;
+    int i;
+
+    ConsolePrintf("  Last well %u ms ago", (ui32Now - psHealth->ui32LastGood) /
+                                           1000);
+    if(psHealth->bHeard)
+    {
+        ConsolePrintf(", last poll %u ms ago",
+                      (ui32Now - psHealth->ui32LastPoll) / 1000);
+    }
+    ConsolePrintf("%s\n", psHealth->bRecovering ? ", recovering" : "");
+    ConsolePrintf("  Faults:");
+    for(i = 0; i < HEALTH_FAULTS; i++)
+    {
+        ConsolePrintf(" %u %s%s", psHealth->pui32Faults[i],
+                      g_ppcFaultNames[i], (i < HEALTH_FAULTS - 1) ? "," : "\n");
+    }
+    ConsolePrintf("  Resets: %u, %u failed, longest %u us\n",
+                  psHealth->ui32Resets, psHealth->ui32ResetFails,
+                  psHealth->ui32ResetMaxUs);
+    ConsolePrintf("  Recovered %u, %u unconfirmed\n", ui32N,
+                  psHealth->ui32Unconfirmed);
+    if(ui32N)
+    {
+        ConsolePrintf("  Detection ms avg %u max %u, recovery ms avg %u max "
+                      "%u, MTTR %u ms\n", psHealth->ui32DetectTotal / ui32N,
+                      psHealth->ui32DetectMax,
+                      psHealth->ui32RecoverTotal / ui32N,
+                      psHealth->ui32RecoverMax,
+                      (psHealth->ui32DetectTotal +
+                       psHealth->ui32RecoverTotal) / ui32N);
+    }
+}
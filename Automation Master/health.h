@@ -0,0 +1,48 @@
+//*****************************************************************************
+//
+// health.h - Radio health watchdog for the master.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __HEALTH_H__
+#define __HEALTH_H__
+
+//
+// SysTick periods between checks of each radio, and between attempts to
+// bring back one that did not come up again.
+//
+#define HEALTH_CHECK_TICKS      SYSTICK_HZ
+#define HEALTH_RETRY_TICKS      (10 * SYSTICK_HZ)
+
+//
+// A radio that has been hearing polls is reset once they have stopped for
+// this many times the interval of an idle node at TDMA_PACE_MAX.
+//
+#define HEALTH_SILENT_PERIODS   2
+
+//
+// Longest a push may stay in flight.  One takes a few milliseconds at
+// most, even with every retransmission.
+//
+#define HEALTH_PUSH_US          100000
+
+//
+// Faults a check can find.
+//
+#define HEALTH_SPI              0 // STATUS reads 0xFF: no radio on the bus
+#define HEALTH_CONFIG           1 // Configuration lost, as to a brown-out
+#define HEALTH_IRQ              2 // IRQ asserted or RX FIFO not empty, no interrupt taken
+#define HEALTH_PUSH             3 // Push or broadcast never finished
+#define HEALTH_SILENT           4 // No polls for HEALTH_SILENT_PERIODS
+#define HEALTH_FAULTS           5
+
+void HealthPoll(int iRadio, uint32_t ui32Now);
+bool HealthSilent(int iRadio, uint32_t ui32Now);
+void HealthGood(int iRadio, uint32_t ui32Now);
+void HealthFault(int iRadio, int iFault, uint32_t ui32Now);
+void HealthRestored(int iRadio, bool bUp, uint32_t ui32Micros);
+void HealthPrint(int iRadio, uint32_t ui32Now);
+
+#endif
@@ -0,0 +1,94 @@
+//*****************************************************************************
+//
+// latency.c - Command delivery latency histograms for the master.
+//
+// Latency runs from the console command being entered to the command
+// reaching the node: for ACK payloads, the poll that carried it out; for
+// pushed commands, the node's acknowledgement.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "console.h"
+#include "latency.h"
+
+typedef struct
+{
+    uint32_t ui32Count;
+
+    uint32_t ui32Max;
+
+    uint64_t ui64Total;
+
+    uint32_t pui32Buckets[LATENCY_BUCKETS];
+}
+tLatencyHist;
+
+static tLatencyHist g_psLatency[LATENCY_CLASSES];
+
+static const char *g_ppcClassNames[LATENCY_CLASSES] =
+{
+    "bulk", "at", "urgent"
+};
+
+void
+LatencyRecord(uint32_t ui32Class, uint32_t ui32Micros)
+{
+    tLatencyHist *psHist = &g_psLatency[ui32Class];
+    uint32_t ui32Bucket = 0, ui32Millis = ui32Micros / 1000;
+
+    while((ui32Bucket < LATENCY_BUCKETS - 1) &&
+          (ui32Millis >= (1 << ui32Bucket)))
+    {
+        ui32Bucket++;
+    }
+
+    psHist->ui32Count++;
+    psHist->ui64Total += ui32Micros;
+    psHist->pui32Buckets[ui32Bucket]++;
+    if(ui32Micros > psHist->ui32Max)
+    {
+        psHist->ui32Max = ui32Micros;
+    }
+}
+
+//
+// Print each class's average and maximum, then its non-empty buckets.
+//
+void
+LatencyPrint(void)
+{
+    tLatencyHist *psHist;
+    int iClass, i;
+
+    for(iClass = 0; iClass < LATENCY_CLASSES; iClass++)
+    {
+        psHist = &g_psLatency[iClass];
+        ConsolePrintf("%6s: %u commands, avg %u ms, max %u ms\n",
+                      g_ppcClassNames[iClass], psHist->ui32Count,
+                      psHist->ui32Count ?
+                      (uint32_t)(psHist->ui64Total / psHist->ui32Count / 1000) :
+                      0, psHist->ui32Max / 1000);
+        for(i = 0; i < LATENCY_BUCKETS; i++)
+        {
+            if(psHist->pui32Buckets[i] == 0)
+            {
+                continue;
+            }
+            if(i == LATENCY_BUCKETS - 1)
+            {
+                ConsolePrintf("   >= %5u ms  %u\n", 1 << (i - 1),
+                              psHist->pui32Buckets[i]);
+            }
+            else
+            {
+                ConsolePrintf("    < %5u ms  %u\n", 1 << i,
+                              psHist->pui32Buckets[i]);
+            }
+        }
+    }
+}
@@ -0,0 +1,29 @@
+//*****************************************************************************
+//
+// latency.h - Command delivery latency histograms for the master.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __LATENCY_H__
+#define __LATENCY_H__
+
+//
+// Command classes.  Bulk and scheduled commands ride in ACK payloads and
+// wait for the node's next poll; urgent commands are pushed to the node.
+//
+#define LATENCY_BULK            0
+#define LATENCY_AT              1
+#define LATENCY_URGENT          2
+#define LATENCY_CLASSES         3
+
+//
+// Bucket i counts latencies under 2^i ms; the last bucket takes the rest.
+//
+#define LATENCY_BUCKETS         16
+
+void LatencyRecord(uint32_t ui32Class, uint32_t ui32Micros);
+void LatencyPrint(void);
+
+#endif
@@ -0,0 +1,67 @@
+//*****************************************************************************
+//
+// led.c - Timer-driven status LED patterns for the master.
+//
+// LEDPatternPlay() only records the pattern; LEDPatternTick(), run from the
+// main loop on every SysTick event, steps it.  Nothing here waits.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "driverlib/gpio.h"
+#include "inc/hw_memmap.h"
+
+#include "led.h"
+
+#define LED_PORT                GPIO_PORTN_BASE
+#define LED_PIN                 GPIO_PIN_5
+
+static uint32_t g_ui32Pattern;
+static uint32_t g_ui32StepsLeft;
+static uint32_t g_ui32StepTicks;
+static uint32_t g_ui32TicksLeft;
+
+//
+// Start a pattern, replacing any that is still playing.
+//
+void
+LEDPatternPlay(uint32_t ui32Pattern, uint32_t ui32Steps,
+               uint32_t ui32StepTicks)
+{
+    g_ui32Pattern = ui32Pattern;
+    g_ui32StepsLeft = ui32Steps;
+    g_ui32StepTicks = ui32StepTicks;
+    g_ui32TicksLeft = 0;
+}
+
+void
+LEDPatternTick(void)
+{
+    if (g_ui32TicksLeft > 0)
+    {
+        g_ui32TicksLeft--;
+        return;
+    }
+
+    if (g_ui32StepsLeft == 0)
+    {
+        if (g_ui32StepTicks != 0)
+        {
+            //
+            // Pattern finished; leave the LED off.
+            //
+            GPIOPinWrite(LED_PORT, LED_PIN, 0x00);
+            g_ui32StepTicks = 0;
+        }
+        return;
+    }
+
+    GPIOPinWrite(LED_PORT, LED_PIN, (g_ui32Pattern & 1) ? LED_PIN : 0x00);
+    g_ui32Pattern >>= 1;
+    g_ui32StepsLeft--;
+    g_ui32TicksLeft = g_ui32StepTicks - 1;
+}
@@ -0,0 +1,26 @@
+//*****************************************************************************
+//
+// led.h - Timer-driven status LED patterns for the master.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __LED_H__
+#define __LED_H__
+
+//
+// A pattern is a bit string, played LSB first, one bit per step with the
+// LED on for each set bit.  Step lengths are in SysTick periods.
+//
+// Error: four 50 ms blinks.
+//
+#define LED_PATTERN_ERROR       0x55
+#define LED_PATTERN_ERROR_STEPS 8
+#define LED_PATTERN_ERROR_TICKS 5
+
+void LEDPatternPlay(uint32_t ui32Pattern, uint32_t ui32Steps,
+                    uint32_t ui32StepTicks);
+void LEDPatternTick(void);
+
+#endif
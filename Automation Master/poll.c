@@ -0,0 +1,808 @@
+//*****************************************************************************
+//
+// poll.c - Poll handling and ACK payload staging for the master.
+//
+// All nodes on a radio poll the master at the same address, so the radio
+// hands each staged ACK payload to whichever node polls next.  The code
+// here keeps a copy of each radio's ACK payload FIFO to know which command
+// went where.  Calls for a radio expect the driver to have it selected.
+// Commands go out wrapped with a sequence number and are sent again until
+// the node echoes it (see utilities/deliver.h).  A pace hint (see
+// utilities/tdma.h) goes in front of any payload but a command, which sets
+// the node's pace itself.  The code here touches the radio only through the
+// nRF24L01 driver, so that host/replay can run it against recorded traffic.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "inc/hw_types.h"
+
+#include "utilities/nRF24L01.h"
+#include "utilities/secure.h"
+#include "utilities/cyclecount.h"
+#include "utilities/timesync.h"
+#include "utilities/tdma.h"
+#include "utilities/relay.h"
+#include "utilities/deliver.h"
+#include "utilities/channel.h"
+#include "utilities/boot.h"
+
+#include "capture.h"
+#include "console.h"
+#include "latency.h"
+#include "poll.h"
+#include "route.h"
+#include "schedule.h"
+#include "sensor.h"
+
+tAutoCmd g_psAckData[NUM_SLAVES] = { EMPTY_COMMAND };
+
+//
+// A command waiting behind the one in g_psAckData, entered after it.  Only
+// a push falling back to polling queues a second command; the console
+// replaces the newest one queued.
+//
+tAutoCmd g_psAckBehind[NUM_SLAVES];
+
+//
+// Copy of what is in the radio's ACK payload FIFO, oldest first.  Each new
+// poll takes the oldest entry.
+//
+tStagedAck g_psStaged[CHANNEL_RADIOS][ACK_FIFO_DEPTH];
+uint32_t g_pui32StagedHead[CHANNEL_RADIOS];
+uint32_t g_pui32StagedCount[CHANNEL_RADIOS];
+
+//
+// Per-node keys and replay counters for the secure radio link.
+//
+tSecureLink g_psLinks[NUM_SLAVES];
+
+//
+// Whether a poll from each node has authenticated since the master started.
+//
+static bool g_pbHeard[NUM_SLAVES];
+
+//
+// A node has reset since the last broadcast was sealed, and refuses the
+// broadcast epoch it last took until the master moves on to a new one.
+//
+bool g_bBroadcastEpochDue;
+
+tCycleStat g_sOpenCycles;
+tCycleStat g_sSealCycles;
+
+tSkewStat g_psSkew[NUM_SLAVES];
+
+//
+// Sequence number and arrival time of each node's last timed poll, held
+// until they can be staged for the node.
+//
+typedef struct
+{
+    bool bValid;
+
+    uint16_t ui16Seq;
+
+    uint32_t ui32Arrival;
+}
+tTimeReply;
+
+tTimeReply g_psTimeReply[NUM_SLAVES];
+
+//
+// Pace each node is to be told to keep, until it takes the hint.
+//
+typedef struct
+{
+    bool bValid;
+
+    uint8_t ui8Pace;
+}
+tPaceHint;
+
+tPaceHint g_psPaceHint[NUM_SLAVES];
+
+//
+// The command each node is being sent, until it echoes the sequence number
+// or the master gives up.  Commands entered meanwhile wait in g_psAckData.
+//
+typedef struct
+{
+    //
+    // ui8Len is zero if there is none.
+    //
+    tAutoCmd sCmd;
+
+    //
+    // Times it has gone out, and whether the last of those awaits its echo.
+    //
+    uint8_t ui8Tries;
+
+    bool bSent;
+
+    //
+    // Polls from the node since the command last went out, and the time it
+    // did.
+    //
+    uint8_t ui8Polls;
+
+    uint32_t ui32Sent;
+}
+tDelivery;
+
+tDelivery g_psDelivery[NUM_SLAVES];
+
+//
+// Sequence number given to each node's next command.
+//
+uint8_t g_pui8DeliverySeq[NUM_SLAVES];
+
+typedef struct
+{
+    uint32_t ui32Delivered;
+
+    uint32_t ui32Retries;
+
+    uint32_t ui32Failed;
+
+    uint32_t ui32LastLatency;
+}
+tDeliveryStat;
+
+tDeliveryStat g_psDeliveryStat[NUM_SLAVES];
+
+//*****************************************************************************
+//
+// Record the cycles taken by one crypto operation started at ui32Start.
+//
+//*****************************************************************************
+void
+CycleStatAdd(tCycleStat *psStat, uint32_t ui32Start)
+{
+    uint32_t ui32Cycles = CycleCountGet() - ui32Start;
+
+    psStat->ui32Count++;
+    psStat->ui64Total += ui32Cycles;
+    if (ui32Cycles > psStat->ui32Max)
+    {
+        psStat->ui32Max = ui32Cycles;
+    }
+}
+
+//*****************************************************************************
+//
+// Seal a payload for a slave and stage it in its radio's ACK payload FIFO,
+// noting whether it carries the slave's command or leads with a pace hint.
+// Returns false if the FIFO is full, since the radio would drop the
+// payload.
+//
+//*****************************************************************************
+bool
+AckStage(int iSlave, bool bCommand, uint8_t *pui8Plain, int iLen)
+{
+    int iRadio = CHANNEL_RADIO(iSlave);
+    tStagedAck *psStaged;
+    uint8_t pui8Frame[SECURE_MAX_FRAME];
+    uint32_t ui32Start;
+
+    if (g_pui32StagedCount[iRadio] == ACK_FIFO_DEPTH)
+    {
+        return false;
+    }
+
+    ui32Start = CycleCountGet();
+    iLen = SecureSeal(&g_psLinks[iSlave], SECURE_DIR_DOWN, pui8Plain, iLen,
+                      pui8Frame);
+    CycleStatAdd(&g_sSealCycles, ui32Start);
+    nRFDataPutAck(0, pui8Frame, iLen);
+    CaptureAck(iSlave, pui8Frame, iLen);
+
+    psStaged = &g_psStaged[iRadio][(g_pui32StagedHead[iRadio] +
+                                    g_pui32StagedCount[iRadio]) %
+                                   ACK_FIFO_DEPTH];
+    psStaged->iSlave = iSlave;
+    psStaged->bCommand = bCommand;
+    psStaged->bHint = (pui8Plain[0] == TDMA_MSG_PACE);
+    psStaged->ui8Pace = psStaged->bHint ? pui8Plain[1] : ACK_PACE_KEEP;
+    g_pui32StagedCount[iRadio]++;
+
+    return true;
+}
+
+//*****************************************************************************
+//
+// Return true if a payload is staged for the next poll to a radio.
+//
+//*****************************************************************************
+bool
+AckPending(int iRadio)
+{
+    return (g_pui32StagedCount[iRadio] != 0);
+}
+
+//*****************************************************************************
+//
+// An authenticated poll from iPoller took the staged payload psTaken with
+// its ACK.  A command in it now awaits the node's echo.  If another node
+// took it, and will fail to authenticate it, the command is still unsent
+// and is staged again, as is a pace hint.  iPoller is -1 if the poll did
+// not authenticate, so its sender is unknown.  Returns the pace the payload
+// set the node to, or ACK_PACE_KEEP if it set none.
+//
+//*****************************************************************************
+uint8_t
+AckTaken(const tStagedAck *psTaken, int iPoller, uint32_t ui32Now)
+{
+    tDelivery *psDelivery;
+    uint8_t ui8Pace = ACK_PACE_KEEP;
+
+    if ((iPoller < 0) || (psTaken->iSlave != iPoller))
+    {
+        SchedMisdirected();
+    }
+    else if (psTaken->bCommand)
+    {
+        psDelivery = &g_psDelivery[iPoller];
+        psDelivery->ui8Tries++;
+        psDelivery->bSent = true;
+        psDelivery->ui8Polls = 0;
+        psDelivery->ui32Sent = ui32Now;
+        ui8Pace = TDMA_PACE_ACTIVE;
+    }
+    else if (psTaken->bHint)
+    {
+        //
+        // The hint may have changed since this one was staged; the node
+        // still has to be told the new pace.
+        //
+        if (g_psPaceHint[iPoller].ui8Pace == psTaken->ui8Pace)
+        {
+            g_psPaceHint[iPoller].bValid = false;
+        }
+        ui8Pace = psTaken->ui8Pace;
+    }
+    return ui8Pace;
+}
+
+//*****************************************************************************
+//
+// Empty a radio's ACK payload FIFO.  Commands it held stay unsent in their
+// delivery and are staged again; time messages are simply dropped, as the
+// next poll brings a fresh one.
+//
+//*****************************************************************************
+void
+AckFlush(int iRadio)
+{
+    nRFFlushTX();
+    g_pui32StagedHead[iRadio] = 0;
+    g_pui32StagedCount[iRadio] = 0;
+}
+
+//*****************************************************************************
+//
+// Queue a command for a slave's ACK payloads that could not be pushed to
+// it, in the order the commands were entered.  There is room for two; with
+// a third, the oldest of them is replaced, as the console replaces an older
+// queued command.  Returns false if a command was dropped.
+//
+//*****************************************************************************
+bool
+AckRequeue(int iSlave, const tAutoCmd *psCmd)
+{
+    tAutoCmd *psHead = &g_psAckData[iSlave];
+    tAutoCmd *psBehind = &g_psAckBehind[iSlave];
+    bool bKept = true;
+
+    if (psHead->ui8Len == 0)
+    {
+        *psHead = *psCmd;
+        return true;
+    }
+    if (psBehind->ui8Len != 0)
+    {
+        if ((int32_t)(psCmd->ui32Issued - psHead->ui32Issued) < 0)
+        {
+            ConsolePrintf("DELIVERY %d %u replaced\n", iSlave, psCmd->ui8Seq);
+            return false;
+        }
+        ConsolePrintf("DELIVERY %d %u replaced\n", iSlave, psHead->ui8Seq);
+        *psHead = *psBehind;
+        psBehind->ui8Len = 0;
+        bKept = false;
+    }
+    if ((int32_t)(psCmd->ui32Issued - psHead->ui32Issued) < 0)
+    {
+        *psBehind = *psHead;
+        *psHead = *psCmd;
+    } else {
+        *psBehind = *psCmd;
+    }
+    return bKept;
+}
+
+//*****************************************************************************
+//
+// Have a slave told to keep a pace, with the next ACK payload it takes
+// that carries no command.
+//
+//*****************************************************************************
+void
+PaceHintSet(int iSlave, uint8_t ui8Pace)
+{
+    g_psPaceHint[iSlave].ui8Pace = ui8Pace;
+    g_psPaceHint[iSlave].bValid = true;
+}
+
+//*****************************************************************************
+//
+// Return the sequence number for a slave's next command, skipping 0.
+//
+//*****************************************************************************
+uint8_t
+DeliverySeqNext(int iSlave)
+{
+    if (++g_pui8DeliverySeq[iSlave] == 0)
+    {
+        g_pui8DeliverySeq[iSlave] = 1;
+    }
+    return g_pui8DeliverySeq[iSlave];
+}
+
+//*****************************************************************************
+//
+// Record the outcome of a command for a slave and report it on the console.
+// ui32Latency runs from the command being entered to the ACK or push that
+// delivered it.
+//
+//*****************************************************************************
+void
+DeliveryDone(int iSlave, const tAutoCmd *psCmd, bool bOk,
+             uint32_t ui32Latency, uint32_t ui32Tries)
+{
+    tDeliveryStat *psStat = &g_psDeliveryStat[iSlave];
+
+    if (ui32Tries > 1)
+    {
+        psStat->ui32Retries += ui32Tries - 1;
+    }
+    if (bOk)
+    {
+        LatencyRecord(psCmd->ui8Class, ui32Latency);
+        psStat->ui32Delivered++;
+        psStat->ui32LastLatency = ui32Latency;
+        ConsolePrintf("DELIVERY %d %u ok %u %u\n", iSlave, psCmd->ui8Seq,
+                      ui32Latency, ui32Tries);
+    } else {
+        psStat->ui32Failed++;
+        ConsolePrintf("DELIVERY %d %u failed %u\n", iSlave, psCmd->ui8Seq,
+                      ui32Tries);
+    }
+}
+
+//*****************************************************************************
+//
+// Handle the echo of a command's sequence number in a poll.  Echoes of
+// commands already confirmed, which come when a command was sent again
+// after a lost poll, are ignored.
+//
+//*****************************************************************************
+static void
+DeliveryConfirm(int iSlave, uint8_t ui8Seq)
+{
+    tDelivery *psDelivery = &g_psDelivery[iSlave];
+
+    if ((psDelivery->sCmd.ui8Len == 0) || !psDelivery->bSent ||
+        (psDelivery->sCmd.ui8Seq != ui8Seq))
+    {
+        return;
+    }
+    DeliveryDone(iSlave, &psDelivery->sCmd, true,
+                 psDelivery->ui32Sent - psDelivery->sCmd.ui32Issued,
+                 psDelivery->ui8Tries);
+    psDelivery->sCmd.ui8Len = 0;
+}
+
+//*****************************************************************************
+//
+// Count a poll that came without the echo of a command sent to the node.
+// A direct node echoes in the poll after the one the command went out
+// with; a relayed node only gets the command with that poll, so echoes in
+// the one after.  Past that the command was lost and goes out again.
+//
+//*****************************************************************************
+static void
+DeliveryPoll(int iSlave, bool bRelayed)
+{
+    tDelivery *psDelivery = &g_psDelivery[iSlave];
+
+    if ((psDelivery->sCmd.ui8Len == 0) || !psDelivery->bSent)
+    {
+        return;
+    }
+    if (++psDelivery->ui8Polls <= (bRelayed ? 2 : 1))
+    {
+        return;
+    }
+    psDelivery->bSent = false;
+    if (psDelivery->ui8Tries >= DELIVER_MAX_TRIES)
+    {
+        DeliveryDone(iSlave, &psDelivery->sCmd, false, 0,
+                     psDelivery->ui8Tries);
+        psDelivery->sCmd.ui8Len = 0;
+    }
+}
+
+//*****************************************************************************
+//
+// Print delivery counts and the command in delivery for each slave.
+//
+//*****************************************************************************
+void
+DeliveryPrint(void)
+{
+    tDelivery *psDelivery;
+    tDeliveryStat *psStat;
+    int i;
+
+    ConsolePrintf("Node  Delivered  Retries  Failed  Last us  Pending\n");
+    for (i = 0; i < NUM_SLAVES; i++)
+    {
+        psDelivery = &g_psDelivery[i];
+        psStat = &g_psDeliveryStat[i];
+        ConsolePrintf("%4d  %9u  %7u  %6u  %7u  ", i, psStat->ui32Delivered,
+                      psStat->ui32Retries, psStat->ui32Failed,
+                      psStat->ui32LastLatency);
+        if (psDelivery->sCmd.ui8Len != 0)
+        {
+            ConsolePrintf("seq %u, %s, try %u\n", psDelivery->sCmd.ui8Seq,
+                          psDelivery->bSent ? "awaiting echo" : "unsent",
+                          psDelivery->ui8Tries + (psDelivery->bSent ? 0 : 1));
+        } else if (g_psAckData[i].ui8Len != 0) {
+            ConsolePrintf("seq %u, queued", g_psAckData[i].ui8Seq);
+            if (g_psAckBehind[i].ui8Len != 0)
+            {
+                ConsolePrintf(", seq %u behind", g_psAckBehind[i].ui8Seq);
+            }
+            ConsolePrintf("\n");
+        } else {
+            ConsolePrintf("-\n");
+        }
+    }
+}
+
+//*****************************************************************************
+//
+// Stage the next ACK payload for a slave: its command, if that has not gone
+// out or was lost, else a new slot assignment, else the arrival time of its
+// last poll.  A queued command goes into delivery once the last is settled.
+// A pace hint leads any of these but the command, or goes alone.
+//
+//*****************************************************************************
+void
+AckPrepare(int iSlave)
+{
+    tDelivery *psDelivery = &g_psDelivery[iSlave];
+    uint8_t pui8Plain[SECURE_MAX_PAYLOAD];
+    int iLen, iHint;
+
+    if ((psDelivery->sCmd.ui8Len == 0) && (g_psAckData[iSlave].ui8Len != 0))
+    {
+        psDelivery->sCmd = g_psAckData[iSlave];
+        psDelivery->ui8Tries = 0;
+        psDelivery->bSent = false;
+        g_psAckData[iSlave] = g_psAckBehind[iSlave];
+        g_psAckBehind[iSlave].ui8Len = 0;
+    }
+
+    if ((psDelivery->sCmd.ui8Len != 0) && !psDelivery->bSent) {
+        pui8Plain[0] = DELIVER_MSG_CMD;
+        pui8Plain[1] = psDelivery->sCmd.ui8Seq;
+        memcpy(pui8Plain + DELIVER_HDR_LEN, psDelivery->sCmd.pcCmd,
+               psDelivery->sCmd.ui8Len);
+        AckStage(iSlave, true, pui8Plain,
+                 psDelivery->sCmd.ui8Len + DELIVER_HDR_LEN);
+        return;
+    }
+
+    iHint = 0;
+    if (g_psPaceHint[iSlave].bValid)
+    {
+        pui8Plain[iHint++] = TDMA_MSG_PACE;
+        pui8Plain[iHint++] = g_psPaceHint[iSlave].ui8Pace;
+    }
+    if (SchedAssignGet(iSlave, pui8Plain + iHint)) {
+        AckStage(iSlave, false, pui8Plain, iHint + TDMA_ASSIGN_LEN);
+    } else if (g_psTimeReply[iSlave].bValid) {
+        iLen = TimeSyncTimeEncode(g_psTimeReply[iSlave].ui16Seq,
+                                  g_psTimeReply[iSlave].ui32Arrival,
+                                  pui8Plain + iHint);
+        if (AckStage(iSlave, false, pui8Plain, iHint + iLen))
+        {
+            g_psTimeReply[iSlave].bValid = false;
+        }
+    } else if (iHint != 0) {
+        AckStage(iSlave, false, pui8Plain, iHint);
+    }
+}
+
+//*****************************************************************************
+//
+// Record the clock error a node reported in a TIMESYNC_MSG_SKEW message.
+//
+//*****************************************************************************
+static void
+SkewRecord(int iSlave, const uint8_t *pui8Msg)
+{
+    int32_t i32Skew;
+
+    memcpy(&i32Skew, pui8Msg + 1, 4);
+    g_psSkew[iSlave].i32Last = i32Skew;
+    g_psSkew[iSlave].ui32RTT = pui8Msg[5] | (pui8Msg[6] << 8);
+    g_psSkew[iSlave].ui32Reports++;
+    if (i32Skew < 0)
+    {
+        i32Skew = -i32Skew;
+    }
+    if (i32Skew > g_psSkew[iSlave].ui32MaxAbs)
+    {
+        g_psSkew[iSlave].ui32MaxAbs = i32Skew;
+    }
+}
+
+//*****************************************************************************
+//
+// Log the start-up times a node reported in a BOOT_MSG_STATUS message.  A
+// node repeats the report until a poll carrying it is acknowledged, so a
+// report the same as the node's last is not logged again.  After its reset
+// the node refuses the epochs it last took from the master, so its link,
+// and broadcasts from the next one on, move on to fresh ones.
+//
+//*****************************************************************************
+static void
+BootRecord(int iSlave, const uint8_t *pui8Msg)
+{
+    static uint32_t pui32Last[NUM_SLAVES];
+    uint32_t ui32Report;
+
+    SecureLinkEpochNext(&g_psLinks[iSlave]);
+    g_bBroadcastEpochDue = true;
+
+    memcpy(&ui32Report, pui8Msg + 1, 4);
+    if (ui32Report == pui32Last[iSlave])
+    {
+        return;
+    }
+    pui32Last[iSlave] = ui32Report;
+    ConsolePrintf("Node %d started: radio up at %u ms, first poll at %u ms\n",
+                  iSlave, pui8Msg[1] | (pui8Msg[2] << 8),
+                  pui8Msg[3] | (pui8Msg[4] << 8));
+}
+
+//*****************************************************************************
+//
+// Handle one poll from a radio's RX FIFO, which arrived at network time
+// ui32Arrival.  bTimed is false if that time was taken after the fact,
+// rather than by the radio IRQ, and is too late to sync a node's clock.
+// bAckSent is true if the radio raised TX_DS for the poll's ACK, so sent
+// the staged payload with it.
+//
+//*****************************************************************************
+void
+PollHandle(int iRadio, uint32_t ui32Arrival, bool bTimed, bool bAckSent)
+{
+    static bool bPolled;
+    uint8_t pui8Frame[SECURE_MAX_FRAME];
+    uint8_t pui8Plain[SECURE_MAX_PAYLOAD];
+    uint16_t ui16Seq;
+    uint32_t ui32Start, ui32Replays;
+    uint8_t ui8Route, ui8Pace;
+    tStagedAck sTaken;
+    bool bTaken;
+    int iSlaveIndex, iLen, i;
+
+    //
+    // Read the poll.  A width over 32 bytes means a corrupt packet, which
+    // the datasheet says must be flushed.
+    //
+    iLen = nRFGetPayloadWidth();
+    if (iLen > SECURE_MAX_FRAME)
+    {
+        nRFFlushRX();
+        return;
+    }
+    nRFDataGet(pui8Frame, iLen);
+    CapturePoll(ui32Arrival, bTimed, pui8Frame, iLen);
+
+    //
+    // Polls passed on by a relay carry a route header in front of the
+    // node's frame.
+    //
+    ui8Route = 0;
+    if ((iLen > 1) && (pui8Frame[0] & RELAY_FRAME_FLAG))
+    {
+        ui8Route = pui8Frame[0];
+        memmove(pui8Frame, pui8Frame + 1, --iLen);
+    }
+    iSlaveIndex = pui8Frame[0] & ~RELAY_FRAME_FLAG;
+    ui16Seq = pui8Frame[1] | (pui8Frame[2] << 8);
+
+    //
+    // One payload is staged at a time.  If the ACK went out without it, the
+    // poll came in before it was staged; it was meant for the node due to
+    // poll after the last, and would go to whoever polls next.  Note what
+    // was taken before the FIFO is emptied, but settle it only once the
+    // poll authenticates, as the ID in front of the frame is sent in clear.
+    //
+    ui8Pace = ACK_PACE_KEEP;
+    bTaken = bAckSent && AckPending(iRadio);
+    if (bTaken)
+    {
+        sTaken = g_psStaged[iRadio][g_pui32StagedHead[iRadio]];
+    }
+    AckFlush(iRadio);
+    if ((iSlaveIndex >= NUM_SLAVES) || (CHANNEL_RADIO(iSlaveIndex) != iRadio))
+    {
+        if (bTaken)
+        {
+            AckTaken(&sTaken, -1, ui32Arrival);
+        }
+        return;
+    }
+
+    //
+    // Drop polls that fail authentication or replay an old counter, without
+    // handing out any queued command.
+    //
+    ui32Start = CycleCountGet();
+    ui32Replays = g_psLinks[iSlaveIndex].ui32Replay;
+    iLen = SecureOpen(&g_psLinks[iSlaveIndex], SECURE_DIR_UP, pui8Frame, iLen,
+                      pui8Plain);
+    if (iLen < 0)
+    {
+        if (g_bVerbose)
+        {
+            ConsolePrintf("Rejected poll from Node %d\n", iSlaveIndex);
+        }
+        if (bTaken)
+        {
+            AckTaken(&sTaken, -1, ui32Arrival);
+        }
+
+        //
+        // Since the master reset, it refuses polls from the epoch each node
+        // was in, as they may be replays.  A node goes on polling in that
+        // epoch until an ACK payload in the master's new one reaches it.
+        // One not heard from since is scheduled, so that its slot
+        // assignment is staged for it: now, for the follow-up of a node
+        // polling free-running, and later before each of its slots.
+        //
+        if ((g_psLinks[iSlaveIndex].ui32Replay != ui32Replays) &&
+            !g_pbHeard[iSlaveIndex] && (ui8Route == 0) &&
+            SchedRefused(iSlaveIndex, ui32Arrival))
+        {
+            AckPrepare(iSlaveIndex);
+        }
+        else
+        {
+            AckPrepare(SchedNext(iSlaveIndex, ui32Arrival));
+        }
+        return;
+    }
+    CycleStatAdd(&g_sOpenCycles, ui32Start);
+    g_pbHeard[iSlaveIndex] = true;
+    if (bTaken)
+    {
+        ui8Pace = AckTaken(&sTaken, iSlaveIndex, ui32Arrival);
+    }
+    RouteUpdate(iSlaveIndex, ui8Route);
+
+    //
+    // Network time starts at boot, so the first poll's arrival is the time
+    // the master took to be heard from.
+    //
+    if (!bPolled)
+    {
+        bPolled = true;
+        ConsolePrintf("First poll at %u ms, from Node %d\n",
+                      ui32Arrival / 1000, iSlaveIndex);
+    }
+
+    if (g_bVerbose)
+    {
+        ConsolePrintf("Request received from Node %d\n", iSlaveIndex);
+    }
+
+    //
+    // A poll holds a sequence of messages.  Sensor batches run to the end
+    // of the payload; the rest have fixed lengths.
+    //
+    for (i = 0; i < iLen; )
+    {
+        if (pui8Plain[i] == SENSOR_MSG_BATCH)
+        {
+            SensorBatchAdd(iSlaveIndex, pui8Plain + i, iLen - i);
+            break;
+        }
+        else if ((pui8Plain[i] == TIMESYNC_MSG_SKEW) &&
+                 (iLen - i >= TIMESYNC_SKEW_LEN))
+        {
+            //
+            // Nodes that keep network time report their clock error in
+            // every poll.  Only they are sent the poll's arrival time, and
+            // only if they are in range.
+            //
+            SkewRecord(iSlaveIndex, pui8Plain + i);
+            if (bTimed && (ui8Route == 0))
+            {
+                g_psTimeReply[iSlaveIndex].ui16Seq = ui16Seq;
+                g_psTimeReply[iSlaveIndex].ui32Arrival = ui32Arrival;
+                g_psTimeReply[iSlaveIndex].bValid = true;
+            }
+            i += TIMESYNC_SKEW_LEN;
+        }
+        else if ((pui8Plain[i] == TDMA_MSG_STATUS) &&
+                 (iLen - i >= TDMA_STATUS_LEN))
+        {
+            //
+            // Relayed nodes have no network time to keep a slot with.
+            //
+            if (ui8Route == 0)
+            {
+                SchedPoll(iSlaveIndex, pui8Plain + i, ui32Arrival);
+            }
+            i += TDMA_STATUS_LEN;
+        }
+        else if ((pui8Plain[i] == RELAY_MSG_STATUS) &&
+                 (iLen - i >= RELAY_STATUS_LEN))
+        {
+            RouteRelayStatus(iSlaveIndex, pui8Plain + i);
+            i += RELAY_STATUS_LEN;
+        }
+        else if ((pui8Plain[i] == DELIVER_MSG_ACK) &&
+                 (iLen - i >= DELIVER_ACK_LEN))
+        {
+            DeliveryConfirm(iSlaveIndex, pui8Plain[i + 1]);
+            i += DELIVER_ACK_LEN;
+        }
+        else if ((pui8Plain[i] == BOOT_MSG_STATUS) &&
+                 (iLen - i >= BOOT_STATUS_LEN))
+        {
+            BootRecord(iSlaveIndex, pui8Plain + i);
+            i += BOOT_STATUS_LEN;
+        }
+        else
+        {
+            break;
+        }
+    }
+    DeliveryPoll(iSlaveIndex, ui8Route != 0);
+
+    //
+    // The poll's status gave the node's pace before it read the ACK, which
+    // may have changed it.
+    //
+    if ((ui8Pace != ACK_PACE_KEEP) && (ui8Route == 0))
+    {
+        SchedPaceSet(iSlaveIndex, ui8Pace);
+    }
+
+    //
+    // The ACK payload staged now goes out with the next poll, which comes
+    // from the node due soonest, or from this node again if it promised a
+    // follow-up.
+    //
+    if ((ui8Route == 0) && SchedFollowing(iSlaveIndex))
+    {
+        AckPrepare(iSlaveIndex);
+    }
+    else
+    {
+        AckPrepare(SchedNext(iSlaveIndex, ui32Arrival));
+    }
+}
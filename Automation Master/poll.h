@@ -0,0 +1,131 @@
+//*****************************************************************************
+//
+// poll.h - Poll handling and ACK payload staging for the master.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __POLL_H__
+#define __POLL_H__
+
+#include "utilities/secure.h"
+
+//
+// A command waiting for a slave.
+//
+typedef struct
+{
+    //
+    //! A pointer to a string containing the name of the command.
+    //
+    uint8_t ui8Len;
+
+    char pcCmd[32];
+
+    //
+    // Latency class, and the network time the command was entered.
+    //
+    uint8_t ui8Class;
+
+    uint32_t ui32Issued;
+
+    //
+    // Sequence number the node echoes once it has the command.
+    //
+    uint8_t ui8Seq;
+}
+tAutoCmd;
+
+#define EMPTY_COMMAND {0, {0x00}}
+
+//
+// Number of slave nodes.  Node IDs run from 0 to NUM_SLAVES - 1, and are
+// below BROADCAST_ID.  host/sim builds with more.
+//
+#ifndef NUM_SLAVES
+#define NUM_SLAVES 5
+#endif
+
+//
+// Depth of the radio's TX FIFO, which holds staged ACK payloads.
+//
+#define ACK_FIFO_DEPTH          3
+
+//
+// What AckTaken() returns when the payload taken set no pace.
+//
+#define ACK_PACE_KEEP           0xFF
+
+//
+// A payload staged in a radio's ACK payload FIFO.
+//
+typedef struct
+{
+    int iSlave;
+
+    //
+    // Whether the payload carries the node's command in delivery, or its
+    // pace hint, and the pace that hint sets.
+    //
+    bool bCommand;
+
+    bool bHint;
+
+    uint8_t ui8Pace;
+}
+tStagedAck;
+
+//
+// Running cycle counts for one crypto operation.
+//
+typedef struct
+{
+    uint32_t ui32Count;
+
+    uint64_t ui64Total;
+
+    uint32_t ui32Max;
+}
+tCycleStat;
+
+//
+// Clock error reported by one node after each time sync.
+//
+typedef struct
+{
+    int32_t i32Last;
+
+    uint32_t ui32MaxAbs;
+
+    uint32_t ui32RTT;
+
+    uint32_t ui32Reports;
+}
+tSkewStat;
+
+extern bool g_bVerbose;
+extern tAutoCmd g_psAckData[NUM_SLAVES];
+extern tAutoCmd g_psAckBehind[NUM_SLAVES];
+extern tSecureLink g_psLinks[NUM_SLAVES];
+extern bool g_bBroadcastEpochDue;
+extern tCycleStat g_sOpenCycles;
+extern tCycleStat g_sSealCycles;
+extern tSkewStat g_psSkew[NUM_SLAVES];
+
+void CycleStatAdd(tCycleStat *psStat, uint32_t ui32Start);
+bool AckStage(int iSlave, bool bCommand, uint8_t *pui8Plain, int iLen);
+bool AckPending(int iRadio);
+uint8_t AckTaken(const tStagedAck *psTaken, int iPoller, uint32_t ui32Now);
+void AckFlush(int iRadio);
+void AckPrepare(int iSlave);
+bool AckRequeue(int iSlave, const tAutoCmd *psCmd);
+void PaceHintSet(int iSlave, uint8_t ui8Pace);
+uint8_t DeliverySeqNext(int iSlave);
+void DeliveryDone(int iSlave, const tAutoCmd *psCmd, bool bOk,
+                  uint32_t ui32Latency, uint32_t ui32Tries);
+void DeliveryPrint(void);
+void PollHandle(int iRadio, uint32_t ui32Arrival, bool bTimed,
+                bool bAckSent);
+
+#endif
@@ -0,0 +1,273 @@
+//*****************************************************************************
+//
+// profile.c - Statistical profiler for the master.
+//
+// A timer interrupt samples the address the core was interrupted at and
+// counts it in a small table of addresses.  The timer is at the highest
+// priority, so interrupt handlers are sampled as well as the main loop;
+// time asleep shows up at the instruction after the WFI in EventWait().
+//
+// The dump is a block of text lines that host/profile.py maps to functions
+// with the linker's map file:
+//
+//     PROFILE <version> <rate Hz> <samples> <dropped> <addresses>
+//     P <address>:<count> ...
+//     PROFILE END
+//
+// Addresses and counts are hex.  A sample is dropped if its address finds
+// no free entry in PROFILE_PROBES tries.  Sampling stops for the dump, so
+// the console output it makes is not counted, and starts afresh with the
+// next "profile start".
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "driverlib/interrupt.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_timer.h"
+#include "inc/hw_types.h"
+
+#include "console.h"
+#include "profile.h"
+
+#define PROFILE_PERIPH          SYSCTL_PERIPH_TIMER4
+#define PROFILE_BASE            TIMER4_BASE
+#define PROFILE_INT             INT_TIMER4A_SNOWFLAKE
+
+//
+// Longest data line, with the "\r\n" uartstdio writes for '\n'.
+//
+#define PROFILE_LINE_MAX        (2 + (PROFILE_DUMP_PER_LINE * 18) + 2)
+
+typedef struct
+{
+    uint32_t ui32Addr;
+
+    uint32_t ui32Count;
+}
+tProfileEntry;
+
+static tProfileEntry g_psProfile[PROFILE_ENTRIES];
+
+static uint32_t g_ui32Samples;
+
+static uint32_t g_ui32Dropped;
+
+static uint32_t g_ui32Used;
+
+static uint32_t g_ui32SysClock;
+
+static uint32_t g_ui32Rate;
+
+static bool g_bRunning;
+
+//
+// Dump progress: the next entry to look at, and whether the header is out.
+//
+static bool g_bDumping;
+
+static bool g_bHeaderSent;
+
+static uint32_t g_ui32DumpIndex;
+
+//
+// Count one sample at ui32Addr.  Called from ProfileIntHandler() with the
+// interrupted address, so this runs as the timer's handler.
+//
+void
+ProfileSample(uint32_t ui32Addr)
+{
+    tProfileEntry *psEntry;
+    uint32_t ui32Slot;
+    int i;
+
+    HWREG(PROFILE_BASE + TIMER_O_ICR) = TIMER_TIMA_TIMEOUT;
+    g_ui32Samples++;
+
+    //
+    // Thumb instructions are halfword aligned, so neighbouring addresses
+    // take neighbouring slots.
+    //
+    ui32Slot = (ui32Addr >> 1) & (PROFILE_ENTRIES - 1);
+    for(i = 0; i < PROFILE_PROBES; i++)
+    {
+        psEntry = &g_psProfile[ui32Slot];
+        if(psEntry->ui32Count == 0)
+        {
+            psEntry->ui32Addr = ui32Addr;
+            psEntry->ui32Count = 1;
+            g_ui32Used++;
+            return;
+        }
+        if(psEntry->ui32Addr == ui32Addr)
+        {
+            psEntry->ui32Count++;
+            return;
+        }
+        ui32Slot = (ui32Slot + 1) & (PROFILE_ENTRIES - 1);
+    }
+    g_ui32Dropped++;
+}
+
+//
+// The timer interrupt.  The interrupted address is the return address in
+// the exception frame, on the main or process stack as EXC_RETURN says.
+// ProfileSample() returns straight from the exception.
+//
+#if defined(__ARMCC_VERSION)
+__asm void
+ProfileIntHandler(void)
+{
+    tst     lr, #4
+    ite     eq
+    mrseq   r0, msp
+    mrsne   r0, psp
+    ldr     r0, [r0, #24]
+    b       __cpp(ProfileSample)
+}
+#else
+void __attribute__((naked))
+ProfileIntHandler(void)
+{
+    __asm volatile("    tst     lr, #4\n"
+                   "    ite     eq\n"
+                   "    mrseq   r0, msp\n"
+                   "    mrsne   r0, psp\n"
+                   "    ldr     r0, [r0, #24]\n"
+                   "    b       ProfileSample\n");
+}
+#endif
+
+void
+ProfileInit(uint32_t ui32SysClock)
+{
+    g_ui32SysClock = ui32SysClock;
+    MAP_SysCtlPeripheralEnable(PROFILE_PERIPH);
+    MAP_TimerConfigure(PROFILE_BASE, TIMER_CFG_PERIODIC);
+    MAP_TimerIntEnable(PROFILE_BASE, TIMER_TIMA_TIMEOUT);
+    MAP_IntPrioritySet(PROFILE_INT, PROFILE_PRIORITY);
+}
+
+//
+// Clear the table and start sampling ui32Hz times a second.
+//
+void
+ProfileStart(uint32_t ui32Hz)
+{
+    ProfileStop();
+    g_bDumping = false;
+    memset(g_psProfile, 0, sizeof(g_psProfile));
+    g_ui32Samples = 0;
+    g_ui32Dropped = 0;
+    g_ui32Used = 0;
+    g_ui32Rate = ui32Hz;
+
+    MAP_TimerLoadSet(PROFILE_BASE, TIMER_A, (g_ui32SysClock / ui32Hz) - 1);
+    MAP_TimerEnable(PROFILE_BASE, TIMER_A);
+    MAP_IntEnable(PROFILE_INT);
+    g_bRunning = true;
+}
+
+void
+ProfileStop(void)
+{
+    MAP_IntDisable(PROFILE_INT);
+    MAP_TimerDisable(PROFILE_BASE, TIMER_A);
+    MAP_TimerIntClear(PROFILE_BASE, TIMER_TIMA_TIMEOUT);
+    g_bRunning = false;
+}
+
+void
+ProfilePrint(void)
+{
+    ConsolePrintf("Profiler %s at %u Hz: %u samples, %u dropped, "
+                  "%u of %u addresses\n", g_bRunning ? "running" : "stopped",
+                  g_ui32Rate, g_ui32Samples, g_ui32Dropped, g_ui32Used,
+                  PROFILE_ENTRIES);
+}
+
+void
+ProfileDumpStart(void)
+{
+    ProfileStop();
+    g_ui32DumpIndex = 0;
+    g_bHeaderSent = false;
+    g_bDumping = true;
+}
+
+//
+// Write as much of the dump as the console has room for.  Call from the
+// main loop.
+//
+void
+ProfileDumpService(void)
+{
+    static const char pcHex[] = "0123456789abcdef";
+    char pcLine[PROFILE_LINE_MAX];
+    tProfileEntry *psEntry;
+    int i, iPos, iShift;
+
+    if(!g_bDumping)
+    {
+        return;
+    }
+
+    if(!g_bHeaderSent)
+    {
+        if(ConsoleTxFree() < 64)
+        {
+            return;
+        }
+        ConsolePrintf("PROFILE %u %u %u %u %u\n", PROFILE_DUMP_VERSION,
+                      g_ui32Rate, g_ui32Samples, g_ui32Dropped, g_ui32Used);
+        g_bHeaderSent = true;
+    }
+
+    while((g_ui32DumpIndex < PROFILE_ENTRIES) &&
+          (ConsoleTxFree() >= PROFILE_LINE_MAX))
+    {
+        pcLine[0] = 'P';
+        iPos = 1;
+        for(i = 0; (i < PROFILE_DUMP_PER_LINE) &&
+                   (g_ui32DumpIndex < PROFILE_ENTRIES); g_ui32DumpIndex++)
+        {
+            psEntry = &g_psProfile[g_ui32DumpIndex];
+            if(psEntry->ui32Count == 0)
+            {
+                continue;
+            }
+            pcLine[iPos++] = ' ';
+            for(iShift = 28; iShift >= 0; iShift -= 4)
+            {
+                pcLine[iPos++] = pcHex[(psEntry->ui32Addr >> iShift) & 0x0F];
+            }
+            pcLine[iPos++] = ':';
+            for(iShift = 28; iShift >= 0; iShift -= 4)
+            {
+                pcLine[iPos++] = pcHex[(psEntry->ui32Count >> iShift) & 0x0F];
+            }
+            i++;
+        }
+        if(i != 0)
+        {
+            pcLine[iPos] = 0;
+            ConsolePrintf("%s\n", pcLine);
+        }
+    }
+
+    if((g_ui32DumpIndex == PROFILE_ENTRIES) && (ConsoleTxFree() >= 16))
+    {
+        ConsolePrintf("PROFILE END\n");
+        g_bDumping = false;
+    }
+}
@@ -0,0 +1,50 @@
+//*****************************************************************************
+//
+// profile.h - Statistical profiler for the master.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+//
+// Dump format version, printed in the header line.
+//
+#define PROFILE_DUMP_VERSION    1
+
+//
+// Default sample rate.  It is prime so that sampling does not lock to the
+// SysTick or anything else that runs at a round rate.
+//
+#define PROFILE_HZ              1009
+
+//
+// Distinct addresses kept, a power of two, and the entries tried for each
+// sample before it is dropped.
+//
+#define PROFILE_ENTRIES         256
+#define PROFILE_PROBES          8
+
+//
+// Entries per data line.
+//
+#define PROFILE_DUMP_PER_LINE   6
+
+//
+// The profiler's timer runs at the highest priority, and every other
+// handler must be at PROFILE_HANDLER_PRIORITY or lower to be sampled.
+//
+#define PROFILE_PRIORITY        0x00
+#define PROFILE_HANDLER_PRIORITY 0x20
+
+void ProfileInit(uint32_t ui32SysClock);
+void ProfileStart(uint32_t ui32Hz);
+void ProfileStop(void);
+void ProfilePrint(void);
+void ProfileDumpStart(void);
+void ProfileDumpService(void);
+void ProfileIntHandler(void);
+
+#endif
@@ -0,0 +1,146 @@
+//*****************************************************************************
+//
+// route.c - Routes the master reaches each node by, and relay statistics.
+//
+// A node's route is learnt from the header on its last authenticated poll.
+// Nodes behind a relay only hear the master through ACK payloads passed
+// down the chain, so they cannot be pushed to and are not sent network
+// time, whose round trip would include each relay's hold.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "utilities/relay.h"
+
+#include "console.h"
+#include "route.h"
+
+typedef struct
+{
+    bool bSeen;
+
+    //
+    // Relays between the node and the master, and the one nearest the node.
+    //
+    uint8_t ui8Hops;
+
+    uint8_t ui8Relay;
+
+    uint32_t ui32Changes;
+}
+tRouteNode;
+
+typedef struct
+{
+    uint32_t ui32Reports;
+
+    uint32_t ui32Forwards;
+
+    uint32_t ui32Drops;
+
+    //
+    // Longest a poll was held, from the child's transmission to the
+    // parent's acknowledgement, in the last report and overall.
+    //
+    uint32_t ui32LastHold;
+
+    uint32_t ui32MaxHold;
+}
+tRouteRelay;
+
+static tRouteNode g_psRoutes[ROUTE_MAX_NODES];
+
+static tRouteRelay g_psRelays[ROUTE_MAX_NODES];
+
+//
+// Note the route taken by a poll from iNode.  ui8Hdr is the route header of
+// a forwarded poll, or 0 for one heard directly.
+//
+void
+RouteUpdate(int iNode, uint8_t ui8Hdr)
+{
+    tRouteNode *psRoute = &g_psRoutes[iNode];
+    uint8_t ui8Hops, ui8Relay;
+
+    ui8Hops = (ui8Hdr & RELAY_FRAME_FLAG) ? RELAY_HDR_HOPS(ui8Hdr) : 0;
+    ui8Relay = RELAY_HDR_ID(ui8Hdr);
+
+    if(psRoute->bSeen &&
+       ((psRoute->ui8Hops != ui8Hops) ||
+        (ui8Hops && (psRoute->ui8Relay != ui8Relay))))
+    {
+        psRoute->ui32Changes++;
+    }
+    psRoute->bSeen = true;
+    psRoute->ui8Hops = ui8Hops;
+    psRoute->ui8Relay = ui8Relay;
+}
+
+//
+// Nodes not yet heard from are taken to be in range.
+//
+bool
+RouteIsDirect(int iNode)
+{
+    return(g_psRoutes[iNode].ui8Hops == 0);
+}
+
+//
+// Take a RELAY_MSG_STATUS report from a relay.
+//
+void
+RouteRelayStatus(int iRelay, const uint8_t *pui8Status)
+{
+    tRouteRelay *psRelay = &g_psRelays[iRelay];
+
+    psRelay->ui32Reports++;
+    psRelay->ui32Forwards += pui8Status[1];
+    psRelay->ui32Drops += pui8Status[2];
+    psRelay->ui32LastHold = pui8Status[3] | (pui8Status[4] << 8);
+    if(psRelay->ui32LastHold > psRelay->ui32MaxHold)
+    {
+        psRelay->ui32MaxHold = psRelay->ui32LastHold;
+    }
+}
+
+void
+RoutePrint(void)
+{
+    int i;
+
+    ConsolePrintf("Node  Hops  Relay  Changes\n");
+    for(i = 0; i < ROUTE_MAX_NODES; i++)
+    {
+        if(!g_psRoutes[i].bSeen)
+        {
+            continue;
+        }
+        if(g_psRoutes[i].ui8Hops)
+        {
+            ConsolePrintf("%4d  %4u  %5u  %7u\n", i, g_psRoutes[i].ui8Hops,
+                          g_psRoutes[i].ui8Relay, g_psRoutes[i].ui32Changes);
+        }
+        else
+        {
+            ConsolePrintf("%4d     0      -  %7u\n", i,
+                          g_psRoutes[i].ui32Changes);
+        }
+    }
+
+    ConsolePrintf("Relay  Forwarded  Dropped  Hold (us) last/max\n");
+    for(i = 0; i < ROUTE_MAX_NODES; i++)
+    {
+        if(g_psRelays[i].ui32Reports == 0)
+        {
+            continue;
+        }
+        ConsolePrintf("%5d  %9u  %7u  %u/%u\n", i, g_psRelays[i].ui32Forwards,
+                      g_psRelays[i].ui32Drops, g_psRelays[i].ui32LastHold,
+                      g_psRelays[i].ui32MaxHold);
+    }
+    ConsolePrintf("Polls are dropped if held over %u us\n", RELAY_MAX_HOLD_US);
+}
@@ -0,0 +1,19 @@
+//*****************************************************************************
+//
+// route.h - Routes the master reaches each node by, and relay statistics.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __ROUTE_H__
+#define __ROUTE_H__
+
+#define ROUTE_MAX_NODES         16
+
+void RouteUpdate(int iNode, uint8_t ui8Hdr);
+bool RouteIsDirect(int iNode);
+void RouteRelayStatus(int iRelay, const uint8_t *pui8Status);
+void RoutePrint(void);
+
+#endif
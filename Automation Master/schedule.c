@@ -0,0 +1,309 @@
+//*****************************************************************************
+//
+// schedule.c - Master-assigned polling slots.
+//
+// Nodes that report a schedule status join on their first poll.  Slots are
+// handed out evenly over the period in slave index order and reassigned
+// whenever a node joins or drops out; a node learns of a change from the
+// ACK to its next poll.  Each node reports the pace it keeps, and the master
+// follows the changes its own ACK payloads make to it, so it knows when
+// each node is due and which polls next.  That lets it stage the next
+// poller's ACK payload ahead of time.  Free-running nodes, not yet in their
+// slots, are left out of that guess; they ask for a follow-up poll instead,
+// and the master stages their payload for it, as it does for a slotted
+// node with more to send.
+// Each of the master's radios has a schedule of its own, for the nodes on
+// its channel, so the radios' periods overlap.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "utilities/tdma.h"
+#include "utilities/channel.h"
+
+#include "console.h"
+#include "schedule.h"
+
+typedef struct
+{
+    bool bActive;
+
+    uint8_t ui8Slot;
+
+    //
+    // Slot and slot count the node last reported using.
+    //
+    uint8_t ui8ReportedSlot;
+
+    uint8_t ui8ReportedSlots;
+
+    //
+    // Pace the node last reported, and the one it is expected to keep,
+    // which differs once an ACK payload has changed it.
+    //
+    uint8_t ui8ReportedPace;
+
+    uint8_t ui8Pace;
+
+    //
+    // The node's last status said it polls free-running, and that a
+    // follow-up poll comes shortly.
+    //
+    bool bFree;
+
+    bool bFollow;
+
+    uint32_t ui32LastSeen;
+
+    uint32_t ui32Polls;
+
+    uint32_t ui32Retries;
+}
+tSchedNode;
+
+static tSchedNode g_psSched[SCHED_MAX_NODES];
+
+//
+// Time between a node's polls at a pace.
+//
+#define SCHED_INTERVAL(p)       (1 << (TDMA_PERIOD_LOG2 + (p)))
+
+//
+// Slots in use on each radio.
+//
+static uint8_t g_pui8Slots[CHANNEL_RADIOS];
+
+static uint32_t g_ui32Rebalances;
+
+//
+// ACK payloads taken by a node other than the one they were staged for.
+//
+static uint32_t g_ui32Misdirected;
+
+//
+// Give the active nodes on each radio evenly spaced slots in index order.
+//
+static void
+SchedRebalance(void)
+{
+    int i;
+
+    for(i = 0; i < CHANNEL_RADIOS; i++)
+    {
+        g_pui8Slots[i] = 0;
+    }
+    for(i = 0; i < SCHED_MAX_NODES; i++)
+    {
+        if(g_psSched[i].bActive)
+        {
+            g_psSched[i].ui8Slot = g_pui8Slots[CHANNEL_RADIO(i)]++;
+        }
+    }
+    g_ui32Rebalances++;
+}
+
+//
+// Account for a poll carrying a TDMA_MSG_STATUS message, adding the node to
+// the schedule if it is new.
+//
+void
+SchedPoll(int iNode, const uint8_t *pui8Status, uint32_t ui32Now)
+{
+    tSchedNode *psNode = &g_psSched[iNode];
+
+    psNode->ui8ReportedSlot = pui8Status[1];
+    psNode->ui8ReportedSlots = pui8Status[2];
+    psNode->ui32Retries += pui8Status[3];
+    psNode->ui8ReportedPace = (((pui8Status[4] & TDMA_STATUS_PACE_M) >
+                                TDMA_PACE_MAX) ? TDMA_PACE_MAX :
+                               (pui8Status[4] & TDMA_STATUS_PACE_M));
+    psNode->ui8Pace = psNode->ui8ReportedPace;
+    psNode->bFree = (pui8Status[4] & TDMA_STATUS_FREE) ? true : false;
+    psNode->bFollow = (pui8Status[4] & TDMA_STATUS_FOLLOW) ? true : false;
+    psNode->ui32Polls++;
+    psNode->ui32LastSeen = ui32Now;
+
+    if(!psNode->bActive)
+    {
+        psNode->bActive = true;
+        SchedRebalance();
+    }
+}
+
+//
+// Account for a poll from iNode that the master refused as a replay.  A
+// node not in the schedule is taken to be one still polling in the epoch
+// it was in before the master reset.  Its slot and pace are unknown, so it
+// is added as due every period, and kept as long as a node at the slowest
+// pace, until it reports them.  Returns true if the node was added.
+//
+bool
+SchedRefused(int iNode, uint32_t ui32Now)
+{
+    tSchedNode *psNode = &g_psSched[iNode];
+
+    if(psNode->bActive)
+    {
+        return(false);
+    }
+    psNode->ui8ReportedSlot = 0;
+    psNode->ui8ReportedSlots = 0;
+    psNode->ui8ReportedPace = TDMA_PACE_MAX;
+    psNode->ui8Pace = TDMA_PACE_ACTIVE;
+    psNode->bFree = false;
+    psNode->bFollow = false;
+    psNode->ui32LastSeen = ui32Now;
+    psNode->bActive = true;
+    SchedRebalance();
+    return(true);
+}
+
+//
+// A payload the node took with the ACK to its last poll set its pace.
+//
+void
+SchedPaceSet(int iNode, uint8_t ui8Pace)
+{
+    g_psSched[iNode].ui8Pace = ui8Pace;
+}
+
+//
+// Return true, once, if iNode's last poll promised a follow-up, so its own
+// ACK payload should be staged for it.
+//
+bool
+SchedFollowing(int iNode)
+{
+    if((iNode < 0) || !g_psSched[iNode].bFollow)
+    {
+        return(false);
+    }
+    g_psSched[iNode].bFollow = false;
+    return(true);
+}
+
+//
+// Return the node on iNode's radio due to poll soonest after ui32Now, or
+// iNode itself if it is not scheduled.  A node that missed its poll is due
+// a full interval after it, as it counts from the attempt.  Free-running
+// nodes poll on their own clocks and are not predicted.
+//
+int
+SchedNext(int iNode, uint32_t ui32Now)
+{
+    uint32_t ui32Interval, ui32Wait, ui32Best;
+    int i, iNext;
+
+    if((iNode < 0) || !g_psSched[iNode].bActive)
+    {
+        return(iNode);
+    }
+
+    iNext = iNode;
+    ui32Best = 0xFFFFFFFF;
+    for(i = 0; i < SCHED_MAX_NODES; i++)
+    {
+        if(!g_psSched[i].bActive || g_psSched[i].bFree ||
+           (CHANNEL_RADIO(i) != CHANNEL_RADIO(iNode)))
+        {
+            continue;
+        }
+        ui32Interval = SCHED_INTERVAL(g_psSched[i].ui8Pace);
+        ui32Wait = ui32Interval - ((ui32Now - g_psSched[i].ui32LastSeen) %
+                                   ui32Interval);
+        if(ui32Wait < ui32Best)
+        {
+            ui32Best = ui32Wait;
+            iNext = i;
+        }
+    }
+    return(iNext);
+}
+
+//
+// If a node is not using the slot it was assigned, build the assignment
+// into pui8Msg and return true.
+//
+bool
+SchedAssignGet(int iNode, uint8_t *pui8Msg)
+{
+    tSchedNode *psNode = &g_psSched[iNode];
+
+    if(!psNode->bActive || ((psNode->ui8ReportedSlot == psNode->ui8Slot) &&
+                            (psNode->ui8ReportedSlots ==
+                             g_pui8Slots[CHANNEL_RADIO(iNode)])))
+    {
+        return(false);
+    }
+
+    pui8Msg[0] = TDMA_MSG_ASSIGN;
+    pui8Msg[1] = psNode->ui8Slot;
+    pui8Msg[2] = g_pui8Slots[CHANNEL_RADIO(iNode)];
+    pui8Msg[3] = TDMA_PERIOD_LOG2;
+    return(true);
+}
+
+//
+// Drop nodes that have stopped polling, so the others close the gap.  A
+// node is given the interval of the pace it last reported, which it keeps
+// even if an ACK payload meant to speed it up was lost.
+//
+void
+SchedTick(uint32_t ui32Now)
+{
+    bool bChanged = false;
+    int i;
+
+    for(i = 0; i < SCHED_MAX_NODES; i++)
+    {
+        if(g_psSched[i].bActive &&
+           ((ui32Now - g_psSched[i].ui32LastSeen) >
+            (SCHED_MISSED_PERIODS *
+             SCHED_INTERVAL(g_psSched[i].ui8ReportedPace))))
+        {
+            g_psSched[i].bActive = false;
+            bChanged = true;
+        }
+    }
+    if(bChanged)
+    {
+        SchedRebalance();
+    }
+}
+
+void
+SchedMisdirected(void)
+{
+    g_ui32Misdirected++;
+}
+
+void
+SchedPrint(void)
+{
+    int i;
+
+    ConsolePrintf("Period %u ms, %u rebalances, %u misdirected ACK payloads\n",
+                  (1 << TDMA_PERIOD_LOG2) / 1000, g_ui32Rebalances,
+                  g_ui32Misdirected);
+    for(i = 0; i < CHANNEL_RADIOS; i++)
+    {
+        ConsolePrintf("Radio %d: channel %u, %u slots\n", i,
+                      CHANNEL_RADIO_RF(i), g_pui8Slots[i]);
+    }
+    ConsolePrintf("Node  Radio  Slot  Using  Pace  Polls  Retries\n");
+    for(i = 0; i < SCHED_MAX_NODES; i++)
+    {
+        if(!g_psSched[i].bActive)
+        {
+            continue;
+        }
+        ConsolePrintf("%4d  %5d  %4u  %2u/%u   %4u  %5u  %7u\n", i,
+                      CHANNEL_RADIO(i), g_psSched[i].ui8Slot, g_psSched[i].ui8ReportedSlot,
+                      g_psSched[i].ui8ReportedSlots, g_psSched[i].ui8Pace,
+                      g_psSched[i].ui32Polls, g_psSched[i].ui32Retries);
+    }
+}
@@ -0,0 +1,35 @@
+//*****************************************************************************
+//
+// schedule.h - Master-assigned polling slots.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __SCHEDULE_H__
+#define __SCHEDULE_H__
+
+//
+// Nodes that the schedule can hold; slave indexes run from 0 to
+// SCHED_MAX_NODES - 1.
+//
+#ifndef SCHED_MAX_NODES
+#define SCHED_MAX_NODES         5
+#endif
+
+//
+// A node that misses this many polls at its pace loses its slot.
+//
+#define SCHED_MISSED_PERIODS    4
+
+void SchedPoll(int iNode, const uint8_t *pui8Status, uint32_t ui32Now);
+bool SchedRefused(int iNode, uint32_t ui32Now);
+void SchedPaceSet(int iNode, uint8_t ui8Pace);
+bool SchedFollowing(int iNode);
+int SchedNext(int iNode, uint32_t ui32Now);
+bool SchedAssignGet(int iNode, uint8_t *pui8Msg);
+void SchedTick(uint32_t ui32Now);
+void SchedMisdirected(void);
+void SchedPrint(void);
+
+#endif
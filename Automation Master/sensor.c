@@ -0,0 +1,352 @@
+//*****************************************************************************
+//
+// sensor.c - Aggregation of sample batches from sensor nodes.
+//
+// Every node gets a fixed-size record: a short ring of raw samples and two
+// rings of min/max/mean summaries at coarser resolutions.  Memory per node
+// does not grow with the sample rate, only the time each ring covers shrinks.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "console.h"
+#include "sensor.h"
+
+//
+// A ring of summaries plus the accumulator for the entry being built.
+//
+typedef struct
+{
+    tSensorSummary *psEntries;
+
+    uint32_t ui32Len;
+
+    uint32_t ui32Fold;
+
+    //
+    // Entries written since start-up; the newest is at (ui32Written - 1)
+    // modulo ui32Len.
+    //
+    uint32_t ui32Written;
+
+    uint32_t ui32Count;
+
+    uint32_t pui32Sum[SENSOR_CHANNELS];
+
+    uint16_t pui16Min[SENSOR_CHANNELS];
+
+    uint16_t pui16Max[SENSOR_CHANNELS];
+}
+tSensorTier;
+
+typedef struct
+{
+    //
+    // Slave index of the node using this slot, or -1 if free.
+    //
+    int iNode;
+
+    //
+    // Sample period in 10 ms units, from the latest batch.
+    //
+    uint8_t ui8Period;
+
+    //
+    // Full index of the next expected sample, and samples never received.
+    //
+    uint32_t ui32NextIndex;
+
+    uint32_t ui32Lost;
+
+    tSensorSample psRaw[SENSOR_RAW_LEN];
+
+    uint32_t ui32RawWritten;
+
+    tSensorTier psTier[SENSOR_TIERS];
+
+    tSensorSummary psTier1[SENSOR_TIER1_LEN];
+
+    tSensorSummary psTier2[SENSOR_TIER2_LEN];
+}
+tSensorNode;
+
+static tSensorNode g_psSensors[SENSOR_MAX_NODES];
+
+static const char *g_ppcTierNames[SENSOR_TIERS + 1] =
+{
+    "raw", "10s", "5m"
+};
+
+static void
+SensorTierReset(tSensorTier *psTier)
+{
+    int iChan;
+
+    psTier->ui32Count = 0;
+    for(iChan = 0; iChan < SENSOR_CHANNELS; iChan++)
+    {
+        psTier->pui32Sum[iChan] = 0;
+        psTier->pui16Min[iChan] = 0xFFFF;
+        psTier->pui16Max[iChan] = 0;
+    }
+}
+
+void
+SensorInit(void)
+{
+    int i;
+
+    memset(g_psSensors, 0, sizeof(g_psSensors));
+    for(i = 0; i < SENSOR_MAX_NODES; i++)
+    {
+        g_psSensors[i].iNode = -1;
+        g_psSensors[i].psTier[0].psEntries = g_psSensors[i].psTier1;
+        g_psSensors[i].psTier[0].ui32Len = SENSOR_TIER1_LEN;
+        g_psSensors[i].psTier[0].ui32Fold = SENSOR_TIER1_FOLD;
+        g_psSensors[i].psTier[1].psEntries = g_psSensors[i].psTier2;
+        g_psSensors[i].psTier[1].ui32Len = SENSOR_TIER2_LEN;
+        g_psSensors[i].psTier[1].ui32Fold = SENSOR_TIER2_FOLD;
+        SensorTierReset(&g_psSensors[i].psTier[0]);
+        SensorTierReset(&g_psSensors[i].psTier[1]);
+    }
+}
+
+//
+// Find the slot for a node, claiming a free one if it has none.
+//
+static tSensorNode *
+SensorNodeGet(int iNode, bool bCreate)
+{
+    int i;
+
+    for(i = 0; i < SENSOR_MAX_NODES; i++)
+    {
+        if(g_psSensors[i].iNode == iNode)
+        {
+            return(&g_psSensors[i]);
+        }
+    }
+    if(bCreate)
+    {
+        for(i = 0; i < SENSOR_MAX_NODES; i++)
+        {
+            if(g_psSensors[i].iNode < 0)
+            {
+                g_psSensors[i].iNode = iNode;
+                return(&g_psSensors[i]);
+            }
+        }
+    }
+    return(0);
+}
+
+//
+// Fold one summary (min, max and mean of a lower level) into a tier, and
+// carry completed entries up to the next tier.
+//
+static void
+SensorTierAdd(tSensorNode *psNode, int iTier, const uint16_t *pui16Min,
+              const uint16_t *pui16Max, const uint16_t *pui16Mean)
+{
+    tSensorTier *psTier = &psNode->psTier[iTier];
+    tSensorSummary *psEntry;
+    int iChan;
+
+    for(iChan = 0; iChan < SENSOR_CHANNELS; iChan++)
+    {
+        psTier->pui32Sum[iChan] += pui16Mean[iChan];
+        if(pui16Min[iChan] < psTier->pui16Min[iChan])
+        {
+            psTier->pui16Min[iChan] = pui16Min[iChan];
+        }
+        if(pui16Max[iChan] > psTier->pui16Max[iChan])
+        {
+            psTier->pui16Max[iChan] = pui16Max[iChan];
+        }
+    }
+
+    if(++psTier->ui32Count < psTier->ui32Fold)
+    {
+        return;
+    }
+
+    psEntry = &psTier->psEntries[psTier->ui32Written % psTier->ui32Len];
+    for(iChan = 0; iChan < SENSOR_CHANNELS; iChan++)
+    {
+        psEntry->pui16Min[iChan] = psTier->pui16Min[iChan];
+        psEntry->pui16Max[iChan] = psTier->pui16Max[iChan];
+        psEntry->pui16Mean[iChan] = psTier->pui32Sum[iChan] /
+                                    psTier->ui32Count;
+    }
+    psTier->ui32Written++;
+    SensorTierReset(psTier);
+
+    if(iTier + 1 < SENSOR_TIERS)
+    {
+        SensorTierAdd(psNode, iTier + 1, psEntry->pui16Min, psEntry->pui16Max,
+                      psEntry->pui16Mean);
+    }
+}
+
+//
+// Add a batch received from slave iNode.  Samples already seen (a
+// retransmitted batch) are skipped and gaps in the index are counted.
+//
+void
+SensorBatchAdd(int iNode, const uint8_t *pui8Buf, int iLen)
+{
+    tSensorSample psSamples[SENSOR_BATCH_MAX];
+    tSensorNode *psNode;
+    uint16_t ui16Index;
+    uint32_t ui32Index;
+    uint8_t ui8Period;
+    int iCount, i;
+
+    iCount = SensorBatchDecode(pui8Buf, iLen, &ui16Index, &ui8Period,
+                               psSamples);
+    psNode = SensorNodeGet(iNode, true);
+    if((iCount < 0) || (psNode == 0))
+    {
+        return;
+    }
+
+    //
+    // Extend the 16-bit index to the full index closest to the one
+    // expected.
+    //
+    ui32Index = (psNode->ui32NextIndex & 0xFFFF0000) | ui16Index;
+    if((int32_t)(ui32Index - psNode->ui32NextIndex) < -0x8000)
+    {
+        ui32Index += 0x10000;
+    }
+    else if((int32_t)(ui32Index - psNode->ui32NextIndex) > 0x8000)
+    {
+        ui32Index -= 0x10000;
+    }
+    if((psNode->ui32RawWritten == 0) && (psNode->ui32NextIndex == 0))
+    {
+        //
+        // First batch from this node.
+        //
+        ui32Index = ui16Index;
+    }
+    psNode->ui8Period = ui8Period;
+
+    for(i = 0; i < iCount; i++, ui32Index++)
+    {
+        if((int32_t)(ui32Index - psNode->ui32NextIndex) < 0)
+        {
+            continue;
+        }
+        if(psNode->ui32RawWritten != 0)
+        {
+            psNode->ui32Lost += ui32Index - psNode->ui32NextIndex;
+        }
+        psNode->ui32NextIndex = ui32Index + 1;
+
+        psNode->psRaw[psNode->ui32RawWritten % SENSOR_RAW_LEN] = psSamples[i];
+        psNode->ui32RawWritten++;
+        SensorTierAdd(psNode, 0, psSamples[i].pui16Value,
+                      psSamples[i].pui16Value, psSamples[i].pui16Value);
+    }
+}
+
+//
+// Convert a temperature sensor reading to tenths of a degree Celsius
+// (TM4C123 datasheet: T = 147.5 - 75 * 3.3 * ADC / 4096).
+//
+static int
+SensorTempDeciC(uint16_t ui16Raw)
+{
+    return(1475 - (int)((2475 * (uint32_t)ui16Raw) / 4096));
+}
+
+static void
+SensorPrintValue(char *pcLabel, uint16_t ui16Temp, uint16_t ui16Light)
+{
+    int iTemp = SensorTempDeciC(ui16Temp);
+
+    ConsolePrintf("%s%s%d.%d C  light %4u\n", pcLabel, (iTemp < 0) ? "-" : "",
+                  ((iTemp < 0) ? -iTemp : iTemp) / 10,
+                  ((iTemp < 0) ? -iTemp : iTemp) % 10, ui16Light);
+}
+
+//
+// Print a node's raw samples (iTier 0) or one of its summary tiers, oldest
+// first.
+//
+void
+SensorPrint(int iNode, int iTier)
+{
+    tSensorNode *psNode = SensorNodeGet(iNode, false);
+    tSensorSummary *psEntry;
+    tSensorTier *psTier;
+    uint32_t ui32N, ui32First, i;
+
+    if(psNode == 0)
+    {
+        ConsolePrintf("No sensor data from node %d\n", iNode);
+        return;
+    }
+
+    ConsolePrintf("Node %d: %u samples every %u0 ms, %u lost, tier %s\n",
+                  iNode, psNode->ui32RawWritten, psNode->ui8Period,
+                  psNode->ui32Lost, g_ppcTierNames[iTier]);
+
+    if(iTier == 0)
+    {
+        ui32N = (psNode->ui32RawWritten < SENSOR_RAW_LEN) ?
+                psNode->ui32RawWritten : SENSOR_RAW_LEN;
+        ui32First = psNode->ui32RawWritten - ui32N;
+        for(i = ui32First; i < psNode->ui32RawWritten; i++)
+        {
+            SensorPrintValue("  ",
+                psNode->psRaw[i % SENSOR_RAW_LEN].pui16Value[SENSOR_CHAN_TEMP],
+                psNode->psRaw[i % SENSOR_RAW_LEN].pui16Value[SENSOR_CHAN_LIGHT]);
+        }
+        return;
+    }
+
+    psTier = &psNode->psTier[iTier - 1];
+    ui32N = (psTier->ui32Written < psTier->ui32Len) ?
+            psTier->ui32Written : psTier->ui32Len;
+    ui32First = psTier->ui32Written - ui32N;
+    for(i = ui32First; i < psTier->ui32Written; i++)
+    {
+        psEntry = &psTier->psEntries[i % psTier->ui32Len];
+
+        //
+        // The temperature reading falls as temperature rises, so its raw
+        // maximum is the coldest point.
+        //
+        SensorPrintValue("  min ", psEntry->pui16Max[SENSOR_CHAN_TEMP],
+                         psEntry->pui16Min[SENSOR_CHAN_LIGHT]);
+        SensorPrintValue("  max ", psEntry->pui16Min[SENSOR_CHAN_TEMP],
+                         psEntry->pui16Max[SENSOR_CHAN_LIGHT]);
+        SensorPrintValue("  avg ", psEntry->pui16Mean[SENSOR_CHAN_TEMP],
+                         psEntry->pui16Mean[SENSOR_CHAN_LIGHT]);
+    }
+}
+
+//
+// Return the tier number for a console name, or -1.
+//
+int
+SensorTierLookup(const char *pcName)
+{
+    int i;
+
+    for(i = 0; i <= SENSOR_TIERS; i++)
+    {
+        if(!strcmp(pcName, g_ppcTierNames[i]))
+        {
+            return(i);
+        }
+    }
+    return(-1);
+}
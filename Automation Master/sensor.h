@@ -0,0 +1,52 @@
+//*****************************************************************************
+//
+// sensor.h - Aggregation of sample batches from sensor nodes.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __SENSOR_H__
+#define __SENSOR_H__
+
+#include "utilities/sensorpack.h"
+
+//
+// Sensor nodes tracked at once.  A slot is claimed by a node's first batch.
+//
+#define SENSOR_MAX_NODES        4
+
+//
+// Raw samples kept per node, newest last.
+//
+#define SENSOR_RAW_LEN          32
+
+//
+// Downsampling tiers.  Each tier entry summarises SENSOR_TIERn_FOLD entries
+// of the level below it (raw samples for tier 1).
+//
+#define SENSOR_TIERS            2
+#define SENSOR_TIER1_FOLD       100
+#define SENSOR_TIER1_LEN        30
+#define SENSOR_TIER2_FOLD       30
+#define SENSOR_TIER2_LEN        48
+
+//
+// Min, max and mean of each channel over one tier entry.
+//
+typedef struct
+{
+    uint16_t pui16Min[SENSOR_CHANNELS];
+
+    uint16_t pui16Max[SENSOR_CHANNELS];
+
+    uint16_t pui16Mean[SENSOR_CHANNELS];
+}
+tSensorSummary;
+
+void SensorInit(void);
+void SensorBatchAdd(int iNode, const uint8_t *pui8Buf, int iLen);
+void SensorPrint(int iNode, int iTier);
+int SensorTierLookup(const char *pcName);
+
+#endif
@@ -78,8 +78,10 @@ __heap_limit
 ; External declarations for the interrupt handlers used by the application.
 ;
 ;******************************************************************************
-        EXTERN  UARTStdioIntHandler
+        EXTERN  UART0IntHandler
+        EXTERN  SysTickIntHandler
         EXTERN  GPIOPortHIntHandler
+        EXTERN  ProfileIntHandler
 
 ;******************************************************************************
 ;
@@ -103,13 +105,13 @@ __Vectors
         DCD     IntDefaultHandler           ; Debug monitor handler
         DCD     0                           ; Reserved
         DCD     IntDefaultHandler           ; The PendSV handler
-        DCD     IntDefaultHandler           ; The SysTick handler
+        DCD     SysTickIntHandler           ; The SysTick handler
         DCD     IntDefaultHandler           ; GPIO Port A
         DCD     IntDefaultHandler           ; GPIO Port B
         DCD     IntDefaultHandler           ; GPIO Port C
         DCD     IntDefaultHandler           ; GPIO Port D
         DCD     IntDefaultHandler           ; GPIO Port E
-        DCD     UARTStdioIntHandler        ; UART0 Rx and Tx
+        DCD     UART0IntHandler             ; UART0 Rx and Tx
         DCD     IntDefaultHandler           ; UART1 Rx and Tx
         DCD     IntDefaultHandler           ; SSI0 Rx and Tx
         DCD     IntDefaultHandler           ; I2C0 Master and Slave
@@ -167,7 +169,7 @@ __Vectors
         DCD     IntDefaultHandler           ; UART7 Rx and Tx
         DCD     IntDefaultHandler           ; I2C2 Master and Slave
         DCD     IntDefaultHandler           ; I2C3 Master and Slave
-        DCD     IntDefaultHandler           ; Timer 4 subtimer A
+        DCD     ProfileIntHandler           ; Timer 4 subtimer A
         DCD     IntDefaultHandler           ; Timer 4 subtimer B
         DCD     IntDefaultHandler           ; Timer 5 subtimer A
         DCD     IntDefaultHandler           ; Timer 5 subtimer B
@@ -0,0 +1,112 @@
+//*****************************************************************************
+//
+// trace.c - Console dump of the SPI transaction trace.
+//
+// The dump is a block of text lines that host/spitrace.py decodes:
+//
+//     SPITRACE <version> <clock Hz> <transactions> <entries dumped>
+//     S <entries as hex>
+//     ...
+//     SPITRACE END
+//
+// Each entry is the raw little-endian tSPITraceEntry.  Lines are only
+// written while the console has room for them, a few per main loop pass,
+// so the dump never drops output or holds up the radio.  Recording pauses
+// until the dump is finished.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "utilities/spitrace.h"
+
+#include "console.h"
+#include "trace.h"
+
+//
+// Longest data line, with the "\r\n" uartstdio writes for '\n'.
+//
+#define TRACE_LINE_MAX          (2 + (TRACE_DUMP_PER_LINE *                  \
+                                      sizeof(tSPITraceEntry) * 2) + 2)
+
+static bool g_bDumping;
+
+static bool g_bHeaderSent;
+
+static uint32_t g_ui32DumpClock;
+
+static uint32_t g_ui32DumpSeq;
+
+static uint32_t g_ui32DumpEnd;
+
+void
+TraceDumpStart(uint32_t ui32ClockHz)
+{
+    SPITraceEnable(false);
+    g_ui32DumpClock = ui32ClockHz;
+    g_ui32DumpEnd = SPITraceCount();
+    g_ui32DumpSeq = (g_ui32DumpEnd > SPI_TRACE_ENTRIES) ?
+                    (g_ui32DumpEnd - SPI_TRACE_ENTRIES) : 0;
+    g_bHeaderSent = false;
+    g_bDumping = true;
+}
+
+//
+// Write as much of the dump as the console has room for.  Call from the
+// main loop.
+//
+void
+TraceDumpService(void)
+{
+    static const char pcHex[] = "0123456789abcdef";
+    char pcLine[TRACE_LINE_MAX];
+    const uint8_t *pui8Entry;
+    int i, j, iPos;
+
+    if(!g_bDumping)
+    {
+        return;
+    }
+
+    if(!g_bHeaderSent)
+    {
+        if(ConsoleTxFree() < 64)
+        {
+            return;
+        }
+        ConsolePrintf("SPITRACE %u %u %u %u\n", TRACE_DUMP_VERSION,
+                      g_ui32DumpClock, g_ui32DumpEnd,
+                      g_ui32DumpEnd - g_ui32DumpSeq);
+        g_bHeaderSent = true;
+    }
+
+    while((g_ui32DumpSeq < g_ui32DumpEnd) &&
+          (ConsoleTxFree() >= TRACE_LINE_MAX))
+    {
+        pcLine[0] = 'S';
+        pcLine[1] = ' ';
+        iPos = 2;
+        for(i = 0; (i < TRACE_DUMP_PER_LINE) && (g_ui32DumpSeq < g_ui32DumpEnd);
+            i++)
+        {
+            pui8Entry = (const uint8_t *)SPITraceGet(g_ui32DumpSeq++);
+            for(j = 0; j < (int)sizeof(tSPITraceEntry); j++)
+            {
+                pcLine[iPos++] = pcHex[pui8Entry[j] >> 4];
+                pcLine[iPos++] = pcHex[pui8Entry[j] & 0x0F];
+            }
+        }
+        pcLine[iPos] = 0;
+        ConsolePrintf("%s\n", pcLine);
+    }
+
+    if((g_ui32DumpSeq == g_ui32DumpEnd) && (ConsoleTxFree() >= 16))
+    {
+        ConsolePrintf("SPITRACE END\n");
+        SPITraceEnable(true);
+        g_bDumping = false;
+    }
+}
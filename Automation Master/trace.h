@@ -0,0 +1,25 @@
+//*****************************************************************************
+//
+// trace.h - Console dump of the SPI transaction trace.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+//
+// Dump format version, printed in the header line.
+//
+#define TRACE_DUMP_VERSION      1
+
+//
+// Entries per data line.
+//
+#define TRACE_DUMP_PER_LINE     4
+
+void TraceDumpStart(uint32_t ui32ClockHz);
+void TraceDumpService(void);
+
+#endif
@@ -0,0 +1,309 @@
+//*****************************************************************************
+//
+//------------------------------- Bench Node ----------------------------------
+//
+// Responder for the master's radio benchmark, described in
+// utilities/bench.h.  It listens at the control settings for a setup frame,
+// changes to the case's data rate and retransmit setting, and answers the
+// master's test packets until the end frame or BENCH_IDLE_US of silence.
+//
+// Nothing else runs: the radio's IRQ line is polled rather than taken as an
+// interrupt, so the node answers as soon as the radio allows and the
+// numbers measure the radio, not this code.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "driverlib/sysctl.h"
+#include "driverlib/ssi.h"
+#include "driverlib/gpio.h"
+#include "driverlib/pin_map.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+
+#include "utilities/nRF24L01.h"
+#include "utilities/cyclecount.h"
+#include "utilities/board.h"
+#include "utilities/boot.h"
+#include "utilities/bench.h"
+
+//
+// The case running, or BENCH_TESTS at the control settings, and its
+// payload size.
+//
+uint8_t g_ui8Test = BENCH_TESTS;
+uint8_t g_ui8Size;
+
+//
+// Counts to look at in the debugger: cases started, cases that ended
+// without an end frame, pings echoed and echoes that got no ACK.
+//
+uint32_t g_ui32Cases;
+uint32_t g_ui32Idle;
+uint32_t g_ui32Echoes;
+uint32_t g_ui32EchoFails;
+
+static uint32_t g_ui32CyclesPerUs;
+
+static const uint8_t g_pui8RateSetup[BENCH_RATES] = BENCH_RATE_SETUP;
+static const uint16_t g_pui16ArdUs[BENCH_RETRIES] = BENCH_RETRY_ARD_US;
+static const uint8_t g_pui8Arc[BENCH_RETRIES] = BENCH_RETRY_ARC;
+
+//
+// Spin until ui32Us have passed since the cycle count ui32Start.
+//
+static void
+WaitSince(uint32_t ui32Start, uint32_t ui32Us)
+{
+    while(CycleCountGet() - ui32Start < ui32Us * g_ui32CyclesPerUs)
+    {
+    }
+}
+
+//
+// Setup peripherals, clock gating, and pin-muxing.  The IRQ line is an
+// input only.
+//
+void
+setup()
+{
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOB);
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOE);
+    MAP_SysCtlPeripheralEnable(BOARD_RADIO0_SSI_PERIPH);
+
+    MAP_GPIOPinTypeGPIOInput(BOARD_RADIO0_IRQ_PORT, BOARD_RADIO0_IRQ_PIN);
+
+    //
+    // Configure the chip enable pin.
+    //
+    MAP_GPIOPinTypeGPIOOutput(BOARD_RADIO0_CE_PORT, BOARD_RADIO0_CE_PIN);
+    BoardPinWrite(BOARD_RADIO0_CE_PORT, BOARD_RADIO0_CE_PIN, 0x00);
+
+    //
+    // Configure pins for the radio's SSI and its chip select
+    //
+    MAP_GPIOPinConfigure(BOARD_RADIO0_SSI_TX);
+    MAP_GPIOPinConfigure(BOARD_RADIO0_SSI_RX);
+    MAP_GPIOPinConfigure(BOARD_RADIO0_SSI_CLK);
+    MAP_GPIOPinTypeSSI(BOARD_RADIO0_SSI_PORT, BOARD_RADIO0_SSI_PINS);
+    MAP_GPIOPinTypeGPIOOutput(BOARD_RADIO0_CS_PORT, BOARD_RADIO0_CS_PIN);
+    GPIOPinWrite(BOARD_RADIO0_CS_PORT, BOARD_RADIO0_CS_PIN,
+                 BOARD_RADIO0_CS_PIN);
+
+    //
+    // Configure the radio's SSI for SPI mode 0 at 8Mbps, 8 bit transfers.
+    //
+    MAP_SSIConfigSetExpClk(BOARD_RADIO0_SSI_BASE, MAP_SysCtlClockGet(),
+                           SSI_FRF_MOTO_MODE_0, SSI_MODE_MASTER, 8000000, 8);
+    MAP_SSIEnable(BOARD_RADIO0_SSI_BASE);
+}
+
+//
+// Change to a data rate and retransmit setting and listen.  A radio that
+// does not take them is tried again every BOOT_RADIO_RETRY_MS.
+//
+static void
+RadioApply(int iRate, int iRetry)
+{
+    tnRFRegister psRegs[] =
+        BENCH_REGISTERS(g_pui8RateSetup[iRate],
+                        BENCH_SETUP_RETR(g_pui16ArdUs[iRetry],
+                                         g_pui8Arc[iRetry]));
+
+    BoardPinWrite(BOARD_RADIO0_CE_PORT, BOARD_RADIO0_CE_PIN, 0x00);
+    while(!nRFBringUp(MAP_SysCtlClockGet(), BENCH_CFG | nRF_CFG_PRIM_RX,
+                      psRegs, sizeof(psRegs) / sizeof(psRegs[0])))
+    {
+        SysCtlDelay((MAP_SysCtlClockGet() / 3000) * BOOT_RADIO_RETRY_MS);
+    }
+    BoardPinWrite(BOARD_RADIO0_CE_PORT, BOARD_RADIO0_CE_PIN,
+                  BOARD_RADIO0_CE_PIN);
+}
+
+//
+// Fill the ACK payload FIFO with payloads of the case's size, so that
+// every test packet is answered with one.
+//
+static void
+AckPayloadsFill(void)
+{
+    static uint8_t ui8Seq;
+    uint8_t pui8Data[BENCH_SIZE_MAX];
+    int i;
+
+    ui8Seq++;
+    for(i = 0; i < g_ui8Size; i++)
+    {
+        pui8Data[i] = (ui8Seq + i) & 0x7F;
+    }
+    while(!(nRFRegisterRead(nRF_O_FIFO_STATUS) & nRF_FIFO_TX_FULL))
+    {
+        nRFDataPutAck(0, pui8Data, g_ui8Size);
+    }
+}
+
+//
+// Send a ping back to the master once the radio has sent its ACK, then
+// listen again.
+//
+static void
+PingEcho(uint8_t *pui8Data, int iLen, uint32_t ui32Arrival)
+{
+    uint32_t ui32Start;
+
+    WaitSince(ui32Arrival, BENCH_ECHO_WAIT_US);
+    BoardPinWrite(BOARD_RADIO0_CE_PORT, BOARD_RADIO0_CE_PIN, 0x00);
+    nRFConfig(BENCH_CFG);
+    nRFDataPut(pui8Data, iLen);
+
+    ui32Start = CycleCountGet();
+    BoardPinWrite(BOARD_RADIO0_CE_PORT, BOARD_RADIO0_CE_PIN,
+                  BOARD_RADIO0_CE_PIN);
+    WaitSince(ui32Start, BENCH_CE_US);
+    BoardPinWrite(BOARD_RADIO0_CE_PORT, BOARD_RADIO0_CE_PIN, 0x00);
+
+    while(BoardPinRead(BOARD_RADIO0_IRQ_PORT, BOARD_RADIO0_IRQ_PIN) &&
+          (CycleCountGet() - ui32Start < BENCH_TIMEOUT_US * g_ui32CyclesPerUs))
+    {
+    }
+    g_ui32Echoes++;
+    if(!(nRFClearInterrupt() & nRF_INT_TX_DS))
+    {
+        g_ui32EchoFails++;
+        nRFFlushTX();
+    }
+
+    nRFConfig(BENCH_CFG | nRF_CFG_PRIM_RX);
+    BoardPinWrite(BOARD_RADIO0_CE_PORT, BOARD_RADIO0_CE_PIN,
+                  BOARD_RADIO0_CE_PIN);
+}
+
+//
+// Act on one frame received at ui32Arrival.
+//
+static void
+FrameHandle(uint8_t *pui8Data, int iLen, uint32_t ui32Arrival)
+{
+    if((pui8Data[0] == BENCH_MSG_SETUP) && (iLen == BENCH_SETUP_LEN))
+    {
+        if((pui8Data[1] >= BENCH_TESTS) || (pui8Data[2] == 0) ||
+           (pui8Data[2] > BENCH_SIZE_MAX) || (pui8Data[3] >= BENCH_RATES) ||
+           (pui8Data[4] >= BENCH_RETRIES))
+        {
+            return;
+        }
+        WaitSince(ui32Arrival, BENCH_SWITCH_US);
+        g_ui8Test = pui8Data[1];
+        g_ui8Size = pui8Data[2];
+        RadioApply(pui8Data[3], pui8Data[4]);
+        if(g_ui8Test == BENCH_TEST_ACKPL)
+        {
+            AckPayloadsFill();
+        }
+        g_ui32Cases++;
+        return;
+    }
+
+    if(pui8Data[0] == BENCH_MSG_END)
+    {
+        WaitSince(ui32Arrival, BENCH_SWITCH_US);
+        g_ui8Test = BENCH_TESTS;
+        RadioApply(BENCH_CONTROL_RATE, BENCH_CONTROL_RETRY);
+        return;
+    }
+
+    switch(g_ui8Test)
+    {
+        case BENCH_TEST_PING:
+        {
+            PingEcho(pui8Data, iLen, ui32Arrival);
+            break;
+        }
+        case BENCH_TEST_ACKPL:
+        {
+            AckPayloadsFill();
+            break;
+        }
+        default:
+        {
+            //
+            // Streamed packets only need the ACK the radio has sent.
+            //
+            break;
+        }
+    }
+}
+
+int
+main(void)
+{
+    uint8_t pui8Data[BENCH_SIZE_MAX];
+    uint32_t ui32Reset, ui32Arrival, ui32Last, ui32Len;
+
+    //
+    // Set the system clock to run from the PLL at 80 MHz
+    //
+    MAP_SysCtlClockSet(SYSCTL_USE_PLL | SYSCTL_OSC_MAIN | SYSCTL_XTAL_16MHZ
+                   | SYSCTL_SYSDIV_2_5);
+
+    CycleCountEnable();
+    g_ui32CyclesPerUs = MAP_SysCtlClockGet() / 1000000;
+    ui32Reset = MAP_SysCtlResetCauseGet();
+    MAP_SysCtlResetCauseClear(ui32Reset);
+
+    setup();
+
+    if(ui32Reset & (SYSCTL_CAUSE_POR | SYSCTL_CAUSE_BOR))
+    {
+        nRFPowerOnWait(MAP_SysCtlClockGet());
+    }
+    RadioApply(BENCH_CONTROL_RATE, BENCH_CONTROL_RETRY);
+    ui32Last = CycleCountGet();
+
+    while(1)
+    {
+        if(BoardPinRead(BOARD_RADIO0_IRQ_PORT, BOARD_RADIO0_IRQ_PIN))
+        {
+            //
+            // Go back to the control settings if the master has gone
+            // quiet without ending the case.
+            //
+            if((g_ui8Test != BENCH_TESTS) &&
+               (CycleCountGet() - ui32Last > BENCH_IDLE_US * g_ui32CyclesPerUs))
+            {
+                g_ui32Idle++;
+                g_ui8Test = BENCH_TESTS;
+                RadioApply(BENCH_CONTROL_RATE, BENCH_CONTROL_RETRY);
+            }
+            continue;
+        }
+
+        ui32Arrival = CycleCountGet();
+        if(!(nRFClearInterrupt() & nRF_INT_RX_DR))
+        {
+            //
+            // An ACK payload went out.
+            //
+            continue;
+        }
+        ui32Last = ui32Arrival;
+
+        while(!(nRFRegisterRead(nRF_O_FIFO_STATUS) & nRF_FIFO_RX_EMPTY))
+        {
+            ui32Len = nRFGetPayloadWidth();
+            if((ui32Len == 0) || (ui32Len > BENCH_SIZE_MAX))
+            {
+                nRFFlushRX();
+                break;
+            }
+            nRFDataGet(pui8Data, ui32Len);
+            FrameHandle(pui8Data, ui32Len, ui32Arrival);
+        }
+    }
+}
@@ -11,88 +11,44 @@
 #include <stdbool.h>
 
 #include "driverlib/sysctl.h"
-#include "driverlib/ssi.h"
-#include "driverlib/flash.h"
 #include "driverlib/gpio.h"
-#include "driverlib/pin_map.h"
 #include "driverlib/rom.h"
 #include "driverlib/rom_map.h"
-#include "driverlib/interrupt.h"
 
-#include "inc/hw_ints.h"
 #include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
 
-#include "utilities/nRF24L01.h"
+#include "utilities/cyclecount.h"
+#include "utilities/node.h"
 
-#define PIN_IRQ
-#define PIN_CE
-
-#ifdef TARGET_IS_BLIZZARD_RA3
-    #define CS_PORT GPIO_PORTE_BASE
-    #define CS_PIN  GPIO_PIN_0
-#else
-    #define CS_PORT GPIO_PORTQ_BASE
-    #define CS_PIN  GPIO_PIN_7
-#endif
-void SPISend(int iLen, uint8_t *data)
+//
+// The node listens between polls, so commands can be pushed to it and it
+// can relay, and paces its polls by the commands it gets.
+//
+static const tNodeConfig g_sNodeConfig =
 {
-    GPIOPinWrite(CS_PORT, CS_PIN, 0x00);
-    while(iLen-- > 0)
-    {
-        SSIDataPut(SSI2_BASE, *data++);
-    }
-    while(SSIBusy(SSI2_BASE))
-    {
-        // Wait for SSI to finish transmitting
-    }
-    GPIOPinWrite(CS_PORT, CS_PIN, CS_PIN);
-}
+    true, NODE_PACE_ADAPT, 0
+};
 
 //
-// Unique 8-bit ID for this node.
+// Carry out a command from the master.
 //
-uint8_t g_ui8ID;
-
 void
-GPIOPortBIntHandler(void)
+CommandExecute(uint8_t *pui8Cmd, int iLen)
 {
-    uint8_t ui8RXData;
-
-    //
-    // Clear the interrupt.
-    //
-    GPIOIntClear(GPIO_PORTB_BASE, GPIO_INT_PIN_0);
-
-    //
-    // Finish SPI transmission, if any.
-    //
-    while(SSIBusy(SSI2_BASE))
-    {
-    }
-    GPIOPinWrite(GPIO_PORTE_BASE, GPIO_PIN_0, GPIO_PIN_0);
-
-    //
-    // Clear the RX interrupt flag on the radio.
-    //
-    nRFClearInterrupt();
-
-    //
-    // Flush the RX FIFO.
-    //
-    nRFDataGet(&ui8RXData, nRFGetPayloadWidth());
-
     //
     // Toggle the LED
     //
-    if (ui8RXData == 0xA1) {
+    if (pui8Cmd[0] == 0xA1) {
         GPIOPinWrite(GPIO_PORTF_BASE, GPIO_PIN_3, GPIO_PIN_3);
-    } else if (ui8RXData == 0xA2) {
+    } else if (pui8Cmd[0] == 0xA2) {
         GPIOPinWrite(GPIO_PORTF_BASE, GPIO_PIN_3, 0x00);
     }
 }
 
 //
-// Setup peripherals, clock gating, and pin-muxing.
+// Setup peripherals, clock gating, and pin-muxing.  The radio's are set up
+// by NodeInit().
 //
 void
 setup()
@@ -100,55 +56,20 @@ setup()
     //
     // Enable peripherals
     //
-    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOB);
-    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOE);
     MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOF);
-    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_SSI2);
-
-    //
-    // Setup GPIO interrupt to receive interrupts from the radio.
-    //
-    MAP_GPIOPinTypeGPIOInput(GPIO_PORTB_BASE, GPIO_PIN_0);
-    MAP_GPIOIntTypeSet(GPIO_PORTB_BASE, GPIO_PIN_0, GPIO_FALLING_EDGE);
-
-    //
-    // Configure the chip enable pin.
-    //
-    MAP_GPIOPinTypeGPIOOutput(GPIO_PORTB_BASE, GPIO_PIN_1);
-    GPIOPinWrite(GPIO_PORTB_BASE, GPIO_PIN_1, 0x00);
 
     //
     // Configure pins for LED output
     //
     MAP_GPIOPinTypeGPIOOutput(GPIO_PORTF_BASE, GPIO_PIN_3);
     GPIOPinWrite(GPIO_PORTF_BASE, GPIO_PIN_3, 0x00);
-
-    //
-    // Configure pins for SSI2
-    //
-    MAP_GPIOPinConfigure(GPIO_PB7_SSI2TX);
-    MAP_GPIOPinConfigure(GPIO_PB6_SSI2RX);
-    MAP_GPIOPinConfigure(GPIO_PB4_SSI2CLK);
-    MAP_GPIOPinTypeSSI(GPIO_PORTB_BASE, GPIO_PIN_4 | GPIO_PIN_6 | GPIO_PIN_7);
-    MAP_GPIOPinTypeGPIOOutput(GPIO_PORTE_BASE, GPIO_PIN_0);
-    GPIOPinWrite(GPIO_PORTE_BASE, GPIO_PIN_0, GPIO_PIN_0);
-
-    //
-    // Configure SSI2 for SPI mode 0 at 8Mbps, 8 bit transfers.
-    //
-    MAP_SSIConfigSetExpClk(SSI2_BASE, MAP_SysCtlClockGet(), SSI_FRF_MOTO_MODE_0,
-                           SSI_MODE_MASTER, 8000000, 8);
-    MAP_SSIEnable(SSI2_BASE);
 }
 
 
 int
 main(void)
 {
-    //
-    // Contents of the user-programmable non-volatile memory
-    //
-    uint32_t ui32User0, ui32User1;
+    uint32_t ui32Reset;
     
     //
     // Set the system clock to run from the PLL at 80 MHz
@@ -157,55 +78,22 @@ main(void)
                    | SYSCTL_SYSDIV_2_5);
 
     //
-    // Setup peripherals
+    // Start the cycle counter straight away, since it times the radio's
+    // power on reset, and note what reset the node.
     //
-    setup();
+    CycleCountEnable();
+    ui32Reset = MAP_SysCtlResetCauseGet();
+    MAP_SysCtlResetCauseClear(ui32Reset);
 
     //
-    // Load the 8-bit unique node ID from the non-volatile user registers.
-    //
-    FlashUserGet(&ui32User0, &ui32User1);
-    g_ui8ID = ui32User0 & 0xFF;
-
-    //
-    // Delay for radio startup.
-    //
-    SysCtlDelay(1000);
-
-    //
-    // Configure the radio.
-    //
-    nRFConfig(nRF_CFG_MASK_TX_DS | nRF_CFG_EN_CRC | nRF_CFG_PWR_UP);
-    nRFFeatureSet(nRF_EN_DPL | nRF_EN_ACK_PAY);
-    nRFDynPayloadEnable(nRF_DATA_PIPE_0);
-
-    //
-    // Enable interrupts from the radio
-    //
-    GPIOIntEnable(GPIO_PORTB_BASE, GPIO_INT_PIN_0);
-    MAP_IntEnable(INT_GPIOB_BLIZZARD);
-    MAP_IntMasterEnable();
-    
-    //
-    // Set the TX payload
+    // Setup peripherals
     //
-    nRFDataPut(&g_ui8ID, 1);
-    nRFPayloadReuseEnable();
-
+    setup();
 
     //
-    // Loop forever, requesting instructions at regular intervals.
+    // Join the network, then poll and listen for commands forever.
     //
-    while(1)
-    {
-        SysCtlDelay(100000000);
-
-        //
-        // Pulse the radio's chip enable.
-        //
-        GPIOPinWrite(GPIO_PORTB_BASE, GPIO_PIN_1, GPIO_PIN_1);
-        SysCtlDelay(500);
-        GPIOPinWrite(GPIO_PORTB_BASE, GPIO_PIN_1, 0x00);
-    }
+    NodeInit(ui32Reset, &g_sNodeConfig);
+    NodeRun();
 
 }
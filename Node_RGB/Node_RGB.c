@@ -9,73 +9,147 @@
 //*****************************************************************************
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "driverlib/sysctl.h"
-#include "driverlib/ssi.h"
-#include "driverlib/flash.h"
 #include "driverlib/gpio.h"
 #include "driverlib/pin_map.h"
 #include "driverlib/rom.h"
 #include "driverlib/rom_map.h"
 #include "driverlib/interrupt.h"
-#include "drivers/rgb.h"
+#include "driverlib/timer.h"
 
 #include "inc/hw_ints.h"
 #include "inc/hw_memmap.h"
+#include "inc/hw_timer.h"
+#include "inc/hw_types.h"
 
-#include "utilities/nRF24L01.h"
+#include "utilities/cyclecount.h"
+#include "utilities/node.h"
 
-#define PIN_IRQ
-#define PIN_CE
+#include "gamma.h"
+#include "rgbgamma.h"
 
 //
-// Unique 8-bit ID for this node.
+// LED channels, in the order the master sends their levels.  Red is driven
+// by Timer0B, green by Timer1B and blue by Timer1A, all in PWM mode with a
+// period of GAMMA_PWM_PERIOD counts.  Timer0A runs in step with them and
+// interrupts at the start of every period.
 //
-uint8_t g_ui8ID;
+#define RGB_RED                 0
+#define RGB_GREEN               1
+#define RGB_BLUE                2
 
+//
+// New levels are written to the buffer not in use, which then becomes the
+// active one, so the PWM interrupt never sees half an update.
+//
+tRGBLevels g_psRGBLevels[2];
+volatile uint32_t g_ui32RGBActive;
+uint32_t g_ui32RGBFrame;
+
+//
+// Cycles taken by the last PWM interrupt, for inspection from the debugger.
+//
+uint32_t g_ui32PWMCycles;
+
+//
+// Set the three channel levels.  They take effect from the next PWM period.
+//
 void
-GPIOPortBIntHandler(void)
+RGBLevelsSet(uint16_t *pui16Levels)
 {
-    uint8_t ui8RXData[8];
-    uint32_t pui32Colors[3];
+    RGBLevelsFill(&g_psRGBLevels[g_ui32RGBActive ^ 1], pui16Levels);
+    g_ui32RGBActive ^= 1;
+}
 
-    //
-    // Clear the interrupt.
-    //
-    GPIOIntClear(GPIO_PORTB_BASE, GPIO_INT_PIN_0);
+//
+// Start of a PWM period.  Load the match values for the next one; the
+// timers hold them until their next timeout, so each period runs with
+// consistent values however late this runs.
+//
+void
+Timer0AIntHandler(void)
+{
+    uint32_t ui32Start = CycleCountGet();
+    uint32_t pui32Match[RGB_CHANNELS];
 
-    //
-    // Finish SPI transmission, if any.
-    //
-    while(SSIBusy(SSI2_BASE))
-    {
-    }
-    GPIOPinWrite(GPIO_PORTE_BASE, GPIO_PIN_0, GPIO_PIN_0);
+    HWREG(TIMER0_BASE + TIMER_O_ICR) = TIMER_TIMA_TIMEOUT;
 
-    //
-    // Clear the RX interrupt flag on the radio.
-    //
-    nRFClearInterrupt();
+    RGBDitherStep(&g_psRGBLevels[g_ui32RGBActive], g_ui32RGBFrame++,
+                  pui32Match);
+    HWREG(TIMER0_BASE + TIMER_O_TBMATCHR) = pui32Match[RGB_RED];
+    HWREG(TIMER1_BASE + TIMER_O_TBMATCHR) = pui32Match[RGB_GREEN];
+    HWREG(TIMER1_BASE + TIMER_O_TAMATCHR) = pui32Match[RGB_BLUE];
 
-    //
-    // Flush the RX FIFO.
-    //
-    nRFDataGet(ui8RXData, nRFGetPayloadWidth());
+    g_ui32PWMCycles = CycleCountGet() - ui32Start;
+}
 
-    //
-    // Toggle the LED
-    //
-    if (*ui8RXData == 0xA3) {
+//
+// The node listens between polls, so commands can be pushed to it and it
+// can relay, and paces its polls by the commands it gets.
+//
+static const tNodeConfig g_sNodeConfig =
+{
+    true, NODE_PACE_ADAPT, 0
+};
+
+//
+// Carry out a command from the master.
+//
+void
+CommandExecute(uint8_t *pui8Cmd, int iLen)
+{
+    uint16_t pui16Levels[3];
+
+    if ((pui8Cmd[0] == 0xA3) && (iLen >= 8)) {
         // Set RGB values
-        pui32Colors[0] = *((uint16_t *) (ui8RXData + 2));
-        pui32Colors[1] = *((uint16_t *) (ui8RXData + 4));
-        pui32Colors[2] = *((uint16_t *) (ui8RXData + 6));
-        RGBColorSet(pui32Colors);
+        memcpy(pui16Levels, pui8Cmd + 2, sizeof(pui16Levels));
+        RGBLevelsSet(pui16Levels);
     }
 }
 
 //
-// Setup peripherals, clock gating, and pin-muxing.
+// Start the LED PWM with all channels off.
+//
+void
+PWMInit(void)
+{
+    MAP_GPIOPinConfigure(GPIO_PF1_T0CCP1);
+    MAP_GPIOPinConfigure(GPIO_PF2_T1CCP0);
+    MAP_GPIOPinConfigure(GPIO_PF3_T1CCP1);
+    MAP_GPIOPinTypeTimer(GPIO_PORTF_BASE, GPIO_PIN_1 | GPIO_PIN_2 |
+                         GPIO_PIN_3);
+
+    MAP_TimerConfigure(TIMER0_BASE, TIMER_CFG_SPLIT_PAIR |
+                       TIMER_CFG_A_PERIODIC | TIMER_CFG_B_PWM);
+    MAP_TimerConfigure(TIMER1_BASE, TIMER_CFG_SPLIT_PAIR | TIMER_CFG_A_PWM |
+                       TIMER_CFG_B_PWM);
+    MAP_TimerLoadSet(TIMER0_BASE, TIMER_BOTH, GAMMA_PWM_PERIOD - 1);
+    MAP_TimerLoadSet(TIMER1_BASE, TIMER_BOTH, GAMMA_PWM_PERIOD - 1);
+    MAP_TimerMatchSet(TIMER0_BASE, TIMER_B, 0);
+    MAP_TimerMatchSet(TIMER1_BASE, TIMER_BOTH, 0);
+
+    //
+    // Invert the outputs, so the match value is the on time, and have new
+    // match values wait for the end of the period.
+    //
+    MAP_TimerControlLevel(TIMER0_BASE, TIMER_B, true);
+    MAP_TimerControlLevel(TIMER1_BASE, TIMER_BOTH, true);
+    HWREG(TIMER0_BASE + TIMER_O_TBMR) |= TIMER_TBMR_TBMRSU;
+    HWREG(TIMER1_BASE + TIMER_O_TAMR) |= TIMER_TAMR_TAMRSU;
+    HWREG(TIMER1_BASE + TIMER_O_TBMR) |= TIMER_TBMR_TBMRSU;
+
+    MAP_TimerIntEnable(TIMER0_BASE, TIMER_TIMA_TIMEOUT);
+    MAP_TimerEnable(TIMER0_BASE, TIMER_BOTH);
+    MAP_TimerEnable(TIMER1_BASE, TIMER_BOTH);
+    MAP_TimerSynchronize(TIMER0_BASE, TIMER_0A_SYNC | TIMER_0B_SYNC |
+                         TIMER_1A_SYNC | TIMER_1B_SYNC);
+}
+
+//
+// Setup peripherals, clock gating, and pin-muxing.  The radio's are set up
+// by NodeInit().
 //
 void
 setup()
@@ -83,56 +157,23 @@ setup()
     //
     // Enable peripherals
     //
-    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOB);
-    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOE);
     MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOF);
-    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_SSI2);
-
-    //
-    // Setup GPIO interrupt to receive interrupts from the radio.
-    //
-    MAP_GPIOPinTypeGPIOInput(GPIO_PORTB_BASE, GPIO_PIN_0);
-    MAP_GPIOIntTypeSet(GPIO_PORTB_BASE, GPIO_PIN_0, GPIO_FALLING_EDGE);
-
-    //
-    // Configure the chip enable pin.
-    //
-    MAP_GPIOPinTypeGPIOOutput(GPIO_PORTB_BASE, GPIO_PIN_1);
-    GPIOPinWrite(GPIO_PORTB_BASE, GPIO_PIN_1, 0x00);
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER0);
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER1);
 
     //
     // Configure pins for LED output
     //
     MAP_GPIOPinTypeGPIOOutput(GPIO_PORTF_BASE, GPIO_PIN_3);
     GPIOPinWrite(GPIO_PORTF_BASE, GPIO_PIN_3, 0x00);
-
-    //
-    // Configure pins for SSI2
-    //
-    MAP_GPIOPinConfigure(GPIO_PB7_SSI2TX);
-    MAP_GPIOPinConfigure(GPIO_PB6_SSI2RX);
-    MAP_GPIOPinConfigure(GPIO_PB4_SSI2CLK);
-    MAP_GPIOPinTypeSSI(GPIO_PORTB_BASE, GPIO_PIN_4 | GPIO_PIN_6 | GPIO_PIN_7);
-    MAP_GPIOPinTypeGPIOOutput(GPIO_PORTE_BASE, GPIO_PIN_0);
-    GPIOPinWrite(GPIO_PORTE_BASE, GPIO_PIN_0, GPIO_PIN_0);
-
-    //
-    // Configure SSI2 for SPI mode 0 at 8Mbps, 8 bit transfers.
-    //
-    MAP_SSIConfigSetExpClk(SSI2_BASE, MAP_SysCtlClockGet(), SSI_FRF_MOTO_MODE_0,
-                           SSI_MODE_MASTER, 8000000, 8);
-    MAP_SSIEnable(SSI2_BASE);
-    RGBInit(1);
+    PWMInit();
 }
 
 
 int
 main(void)
 {
-    //
-    // Contents of the user-programmable non-volatile memory
-    //
-    uint32_t ui32User0, ui32User1;
+    uint32_t ui32Reset;
     
     //
     // Set the system clock to run from the PLL at 80 MHz
@@ -141,55 +182,24 @@ main(void)
                    | SYSCTL_SYSDIV_2_5);
 
     //
-    // Setup peripherals
-    //
-    setup();
-
-    //
-    // Load the 8-bit unique node ID from the non-volatile user registers.
-    //
-    FlashUserGet(&ui32User0, &ui32User1);
-    g_ui8ID = ui32User0 & 0xFF;
-
-    //
-    // Delay for radio startup.
-    //
-    SysCtlDelay(1000);
-
-    //
-    // Configure the radio.
+    // Start the cycle counter straight away, since it times the radio's
+    // power on reset, and note what reset the node.
     //
-    nRFConfig(nRF_CFG_MASK_TX_DS | nRF_CFG_EN_CRC | nRF_CFG_PWR_UP);
-    nRFFeatureSet(nRF_EN_DPL | nRF_EN_ACK_PAY);
-    nRFDynPayloadEnable(nRF_DATA_PIPE_0);
+    CycleCountEnable();
+    ui32Reset = MAP_SysCtlResetCauseGet();
+    MAP_SysCtlResetCauseClear(ui32Reset);
 
     //
-    // Enable interrupts from the radio
-    //
-    GPIOIntEnable(GPIO_PORTB_BASE, GPIO_INT_PIN_0);
-    MAP_IntEnable(INT_GPIOB_BLIZZARD);
-    MAP_IntMasterEnable();
-    
-    //
-    // Set the TX payload
+    // Setup peripherals
     //
-    nRFDataPut(&g_ui8ID, 1);
-    nRFPayloadReuseEnable();
-
+    setup();
 
     //
-    // Loop forever, requesting instructions at regular intervals.
+    // Join the network, then poll and listen for commands forever.  The PWM
+    // interrupt runs from the start.
     //
-    while(1)
-    {
-        SysCtlDelay(100000000);
-
-        //
-        // Pulse the radio's chip enable.
-        //
-        GPIOPinWrite(GPIO_PORTB_BASE, GPIO_PIN_1, GPIO_PIN_1);
-        SysCtlDelay(500);
-        GPIOPinWrite(GPIO_PORTB_BASE, GPIO_PIN_1, 0x00);
-    }
+    NodeInit(ui32Reset, &g_sNodeConfig);
+    MAP_IntEnable(INT_TIMER0A_BLIZZARD);
+    NodeRun();
 
 }
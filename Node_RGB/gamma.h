@@ -0,0 +1,77 @@
+//*****************************************************************************
+//
+// gamma.h - Gamma correction and dither tables for the RGB node.
+//
+// Generated by host/gammagen.py --gamma 2.2 --period-bits 12 --dither-bits 4
+// --segments 256.  Do not edit.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __GAMMA_H__
+#define __GAMMA_H__
+
+//
+// PWM period in timer counts, and the fraction bits of duty that are
+// spread over GAMMA_DITHER_FRAMES periods.
+//
+#define GAMMA_PWM_PERIOD        4096
+#define GAMMA_DITHER_BITS       4
+#define GAMMA_DITHER_FRAMES     (1 << GAMMA_DITHER_BITS)
+
+//
+// Duty, in 1/GAMMA_DITHER_FRAMES counts, for levels at multiples of
+// 65536 / GAMMA_SEGMENTS.  Levels in between are interpolated.
+//
+#define GAMMA_SEGMENTS          256
+#define GAMMA_SEGMENT_SHIFT     8
+
+static const uint16_t g_pui16GammaLUT[257] =
+{
+        0,     0,     2,     4,     7,    11,    17,    24,
+       32,    41,    52,    64,    78,    93,   110,   128,
+      147,   168,   190,   215,   240,   267,   296,   327,
+      359,   392,   428,   465,   504,   544,   586,   630,
+      675,   723,   772,   823,   875,   930,   986,  1044,
+     1104,  1165,  1229,  1294,  1361,  1430,  1501,  1574,
+     1648,  1725,  1803,  1883,  1965,  2050,  2136,  2224,
+     2314,  2405,  2499,  2595,  2693,  2792,  2894,  2998,
+     3104,  3211,  3321,  3433,  3546,  3662,  3780,  3900,
+     4022,  4145,  4271,  4399,  4530,  4662,  4796,  4932,
+     5071,  5211,  5354,  5498,  5645,  5794,  5945,  6098,
+     6253,  6411,  6570,  6732,  6896,  7062,  7230,  7400,
+     7573,  7747,  7924,  8103,  8284,  8468,  8653,  8841,
+     9031,  9223,  9417,  9614,  9813, 10014, 10217, 10422,
+    10630, 10840, 11052, 11267, 11483, 11702, 11923, 12147,
+    12373, 12601, 12831, 13063, 13298, 13535, 13774, 14016,
+    14260, 14506, 14755, 15006, 15259, 15514, 15772, 16032,
+    16295, 16559, 16827, 17096, 17368, 17642, 17918, 18197,
+    18478, 18762, 19047, 19336, 19626, 19919, 20214, 20512,
+    20812, 21115, 21419, 21727, 22036, 22348, 22662, 22979,
+    23298, 23620, 23944, 24270, 24599, 24930, 25264, 25600,
+    25938, 26279, 26622, 26968, 27316, 27667, 28020, 28376,
+    28733, 29094, 29457, 29822, 30190, 30560, 30933, 31308,
+    31685, 32066, 32448, 32833, 33221, 33611, 34003, 34398,
+    34796, 35195, 35598, 36003, 36410, 36820, 37233, 37648,
+    38065, 38485, 38908, 39333, 39760, 40190, 40623, 41058,
+    41495, 41936, 42378, 42823, 43271, 43722, 44174, 44630,
+    45088, 45548, 46011, 46477, 46945, 47416, 47889, 48365,
+    48843, 49324, 49808, 50294, 50783, 51274, 51768, 52265,
+    52764, 53265, 53769, 54276, 54786, 55298, 55812, 56330,
+    56849, 57372, 57897, 58424, 58955, 59488, 60023, 60561,
+    61102, 61645, 62191, 62740, 63291, 63845, 64401, 64960,
+    65520
+};
+
+//
+// Frame i of each dither cycle adds a count to channels whose duty
+// fraction is over entry i, so a fraction of n adds a count in n frames of
+// the cycle, spread evenly.
+//
+static const uint8_t g_pui8DitherLUT[16] =
+{
+     0,  8,  4, 12,  2, 10,  6, 14,  1,  9,  5, 13,  3, 11,  7, 15
+};
+
+#endif
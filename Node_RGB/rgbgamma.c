@@ -0,0 +1,65 @@
+//*****************************************************************************
+//
+// rgbgamma.c - Gamma corrected, dithered PWM duty for the RGB node.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "gamma.h"
+#include "rgbgamma.h"
+
+//
+// Return the duty, in 1/GAMMA_DITHER_FRAMES counts, that makes a channel
+// look ui16Level/65535 as bright as full on.
+//
+uint32_t
+RGBGamma(uint16_t ui16Level)
+{
+    uint32_t ui32Index = ui16Level >> GAMMA_SEGMENT_SHIFT;
+    uint32_t ui32Frac = ui16Level & ((1 << GAMMA_SEGMENT_SHIFT) - 1);
+    uint32_t ui32Low = g_pui16GammaLUT[ui32Index];
+
+    return ui32Low + (((g_pui16GammaLUT[ui32Index + 1] - ui32Low) *
+                       ui32Frac) >> GAMMA_SEGMENT_SHIFT);
+}
+
+//
+// Split the gamma corrected duty of each channel level into whole counts
+// and the fraction to dither.
+//
+void
+RGBLevelsFill(tRGBLevels *psLevels, const uint16_t *pui16Levels)
+{
+    uint32_t ui32Duty;
+    int i;
+
+    for (i = 0; i < RGB_CHANNELS; i++)
+    {
+        ui32Duty = RGBGamma(pui16Levels[i]);
+        psLevels->pui16Duty[i] = ui32Duty >> GAMMA_DITHER_BITS;
+        psLevels->pui8Frac[i] = ui32Duty & (GAMMA_DITHER_FRAMES - 1);
+    }
+}
+
+//
+// Return in pui32Match each channel's match value for PWM period
+// ui32Frame.  Called from the PWM interrupt, so it is branch free.
+//
+void
+RGBDitherStep(const tRGBLevels *psLevels, uint32_t ui32Frame,
+              uint32_t *pui32Match)
+{
+    uint8_t ui8Threshold = g_pui8DitherLUT[ui32Frame &
+                                           (GAMMA_DITHER_FRAMES - 1)];
+
+    pui32Match[0] = psLevels->pui16Duty[0] +
+                    (psLevels->pui8Frac[0] > ui8Threshold);
+    pui32Match[1] = psLevels->pui16Duty[1] +
+                    (psLevels->pui8Frac[1] > ui8Threshold);
+    pui32Match[2] = psLevels->pui16Duty[2] +
+                    (psLevels->pui8Frac[2] > ui8Threshold);
+}
@@ -0,0 +1,35 @@
+//*****************************************************************************
+//
+// rgbgamma.h - Gamma corrected, dithered PWM duty for the RGB node.
+//
+// A channel level is turned into a duty of whole timer counts and a
+// fraction of a count, and each PWM period the fraction is dithered into
+// the whole counts.  Kept apart from Node_RGB.c so host/gamma can check it.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __RGBGAMMA_H__
+#define __RGBGAMMA_H__
+
+#define RGB_CHANNELS            3
+
+//
+// Duty of each channel, as whole timer counts and a fraction that the
+// dither adds a count for in some periods.
+//
+typedef struct
+{
+    uint16_t pui16Duty[RGB_CHANNELS];
+
+    uint8_t pui8Frac[RGB_CHANNELS];
+}
+tRGBLevels;
+
+uint32_t RGBGamma(uint16_t ui16Level);
+void RGBLevelsFill(tRGBLevels *psLevels, const uint16_t *pui16Levels);
+void RGBDitherStep(const tRGBLevels *psLevels, uint32_t ui32Frame,
+                   uint32_t *pui32Match);
+
+#endif
@@ -0,0 +1,224 @@
+//*****************************************************************************
+//
+//------------------------------- Sensor Node ---------------------------------
+//
+// Sensor slave node for the home automation system.  Temperature and light
+// are sampled on a timer and buffered locally; each poll carries the samples
+// taken since the last one, delta encoded, with follow-up polls for those
+// that do not fit.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "driverlib/sysctl.h"
+#include "driverlib/gpio.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/adc.h"
+#include "driverlib/timer.h"
+
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_types.h"
+
+#include "utilities/secure.h"
+#include "utilities/sensorpack.h"
+#include "utilities/cyclecount.h"
+#include "utilities/node.h"
+
+//
+// Sampling rate.  The sample period is sent with every batch in 10 ms units.
+//
+#define SENSOR_SAMPLE_HZ        10
+#define SENSOR_PERIOD           (100 / SENSOR_SAMPLE_HZ)
+
+//
+// The node polls in its slot at this pace, about every 1 s.  The first
+// poll has room for a few samples beside its reports, and each follow-up
+// for SENSOR_BATCH_MAX - 5 more, so one follow-up a slot keeps up and the
+// rest catch up after a missed poll.
+//
+#define SENSOR_PACE             1
+
+//
+// Samples buffered between polls.  This must cover the free-running poll
+// interval, about 3.75 s, that the node keeps until it has a slot; older
+// samples are overwritten.
+//
+#define SENSOR_RING_LEN         64
+
+//
+// Sample ring.  The ADC interrupt writes at g_ui32SampleHead, the main loop
+// reads from g_ui32SampleTail; both count samples since start-up, so the
+// tail doubles as the index of the next sample to send.
+//
+tSensorSample g_psSamples[SENSOR_RING_LEN];
+volatile uint32_t g_ui32SampleHead;
+uint32_t g_ui32SampleTail;
+
+//
+// Samples overwritten before they could be sent.
+//
+uint32_t g_ui32Overrun;
+
+void
+ADC0SS1IntHandler(void)
+{
+    uint32_t pui32Data[2];
+    tSensorSample *psSample;
+
+    ADCIntClear(ADC0_BASE, 1);
+
+    if(ADCSequenceDataGet(ADC0_BASE, 1, pui32Data) < SENSOR_CHANNELS)
+    {
+        return;
+    }
+
+    psSample = &g_psSamples[g_ui32SampleHead % SENSOR_RING_LEN];
+    psSample->pui16Value[SENSOR_CHAN_TEMP] = pui32Data[0];
+    psSample->pui16Value[SENSOR_CHAN_LIGHT] = pui32Data[1];
+    g_ui32SampleHead++;
+}
+
+//
+// No commands are defined for sensor nodes.
+//
+void
+CommandExecute(uint8_t *pui8Cmd, int iLen)
+{
+}
+
+//
+// Add a batch of the samples taken since the last poll to a poll, as many
+// as fit in iSpace bytes.  The batch must end the poll, as the master reads
+// it to the end of the payload.
+//
+static int
+SensorReport(uint8_t *pui8Buf, int iSpace, bool *pbMore)
+{
+    tSensorSample psBatch[SENSOR_BATCH_MAX];
+    uint32_t ui32Head;
+    int iCount, iLen, i;
+
+    //
+    // Drop samples that the ADC interrupt may already be overwriting.
+    //
+    ui32Head = g_ui32SampleHead;
+    if(ui32Head - g_ui32SampleTail > SENSOR_RING_LEN - SENSOR_BATCH_MAX)
+    {
+        g_ui32Overrun += ui32Head - g_ui32SampleTail -
+                         (SENSOR_RING_LEN - SENSOR_BATCH_MAX);
+        g_ui32SampleTail = ui32Head - (SENSOR_RING_LEN - SENSOR_BATCH_MAX);
+    }
+
+    iCount = ui32Head - g_ui32SampleTail;
+    if(iCount > iSpace - SENSOR_BATCH_HDR_LEN + 1)
+    {
+        iCount = iSpace - SENSOR_BATCH_HDR_LEN + 1;
+    }
+    iLen = 0;
+    if(iCount > 0)
+    {
+        for(i = 0; i < iCount; i++)
+        {
+            psBatch[i] = g_psSamples[(g_ui32SampleTail + i) % SENSOR_RING_LEN];
+        }
+        iLen = SensorBatchEncode(psBatch, iCount, g_ui32SampleTail,
+                                 SENSOR_PERIOD, pui8Buf);
+
+        //
+        // Samples are not resent if the master never acknowledges them; it
+        // counts the gap in the index instead.
+        //
+        g_ui32SampleTail += iCount;
+    }
+
+    *pbMore = (ui32Head != g_ui32SampleTail);
+    return(iLen);
+}
+
+//
+// The node only has its radio on to poll, and polls at a fixed pace, as
+// the rate of samples to send does not change.
+//
+static const tNodeConfig g_sNodeConfig =
+{
+    false, SENSOR_PACE, SensorReport
+};
+
+//
+// Setup peripherals, clock gating, and pin-muxing.  The radio's are set up
+// by NodeInit().
+//
+void
+setup()
+{
+    //
+    // Enable peripherals
+    //
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOE);
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_ADC0);
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER0);
+
+    //
+    // Light sensor divider on PE3 (AIN0).
+    //
+    MAP_GPIOPinTypeADC(GPIO_PORTE_BASE, GPIO_PIN_3);
+
+    //
+    // ADC0 sequence 1 samples the internal temperature sensor, then the
+    // light sensor, each time Timer0A expires.  Hardware averaging over 16
+    // conversions takes out most of the noise at no CPU cost.
+    //
+    MAP_ADCHardwareOversampleConfigure(ADC0_BASE, 16);
+    MAP_ADCSequenceConfigure(ADC0_BASE, 1, ADC_TRIGGER_TIMER, 0);
+    MAP_ADCSequenceStepConfigure(ADC0_BASE, 1, 0, ADC_CTL_TS);
+    MAP_ADCSequenceStepConfigure(ADC0_BASE, 1, 1,
+                                 ADC_CTL_CH0 | ADC_CTL_IE | ADC_CTL_END);
+    MAP_ADCSequenceEnable(ADC0_BASE, 1);
+    MAP_ADCIntEnable(ADC0_BASE, 1);
+
+    MAP_TimerConfigure(TIMER0_BASE, TIMER_CFG_PERIODIC);
+    MAP_TimerLoadSet(TIMER0_BASE, TIMER_A,
+                     MAP_SysCtlClockGet() / SENSOR_SAMPLE_HZ - 1);
+    MAP_TimerControlTrigger(TIMER0_BASE, TIMER_A, true);
+}
+
+int
+main(void)
+{
+    uint32_t ui32Reset;
+
+    //
+    // Set the system clock to run from the PLL at 80 MHz
+    //
+    MAP_SysCtlClockSet(SYSCTL_USE_PLL | SYSCTL_OSC_MAIN | SYSCTL_XTAL_16MHZ
+                   | SYSCTL_SYSDIV_2_5);
+
+    //
+    // Start the cycle counter straight away, since it times the radio's
+    // power on reset and the node's start-up, and note what reset the node.
+    //
+    CycleCountEnable();
+    ui32Reset = MAP_SysCtlResetCauseGet();
+    MAP_SysCtlResetCauseClear(ui32Reset);
+
+    //
+    // Setup peripherals
+    //
+    setup();
+
+    //
+    // Join the network, then start sampling and poll in the node's slot
+    // forever.
+    //
+    NodeInit(ui32Reset, &g_sNodeConfig);
+    MAP_IntEnable(INT_ADC0SS1_BLIZZARD);
+    MAP_TimerEnable(TIMER0_BASE, TIMER_A);
+    NodeRun();
+
+}
@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+#
+# bench.py - Set radio benchmark results from the hardware and the model
+# side by side.
+#
+# Run "bench full" (or "bench quick") on the master with a Node_Bench board
+# in range, capture the console to a file, run the model over the same
+# suite and compare:
+#
+#     host/bench/bench > model.log
+#     host/bench.py console.log model.log
+#
+# Cases are matched on test, payload size, data rate and retransmit
+# setting.  For each, the packets per second and a latency percentile are
+# printed from both, with the hardware as a share of the model; cases only
+# one side ran are left out.  Either file may hold any number of blocks;
+# the last complete one is used.  Given one file, its block is printed as a
+# table.
+#
+# Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+#
+
+import argparse
+import sys
+
+FIELDS = ('sent', 'ok', 'retries', 'elapsed', 'pps', 'goodput', 'p50', 'p90',
+          'p99', 'max')
+
+
+def read_block(lines):
+    """Return (source, {(test, size, kbps, ard, arc): {field: value}}) from
+    the last complete block found.  Latencies of cases with nothing
+    answered are None."""
+    block = None
+    result = None
+    for line in lines:
+        fields = line.split()
+        #
+        # The header can follow the console's prompt on the same line.
+        #
+        if fields and fields[0] == '>':
+            fields = fields[1:]
+        if not fields:
+            continue
+        if fields[0] == 'BENCH' and len(fields) > 1 and fields[1] == 'END':
+            if block is not None:
+                result = block
+                block = None
+        elif fields[0] == 'BENCH' and len(fields) == 4:
+            if int(fields[1]) != 1:
+                raise ValueError('unknown benchmark version %s' % fields[1])
+            block = (fields[3], {})
+        elif fields[0] == 'B' and block is not None and len(fields) == 16:
+            key = (fields[1],) + tuple(int(f) for f in fields[2:6])
+            block[1][key] = dict(zip(FIELDS, (None if f == '-' else int(f)
+                                              for f in fields[6:])))
+    if result is None:
+        raise ValueError('no complete BENCH block found')
+    return result
+
+
+def ratio(hw, model):
+    if hw is None or not model:
+        return '-'
+    return '%.2f' % (hw / model)
+
+
+def value(v):
+    return '-' if v is None else str(v)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Set radio benchmark results from the hardware and the '
+                    'model side by side.')
+    parser.add_argument('logs', nargs='+', type=argparse.FileType('r'),
+                        help='console capture and model output')
+    parser.add_argument('-t', '--test', choices=('ping', 'ackpl', 'stream'),
+                        help='only this test')
+    parser.add_argument('-p', '--percentile', default='p50',
+                        choices=('p50', 'p90', 'p99', 'max'),
+                        help='latency to compare (default: %(default)s)')
+    args = parser.parse_args()
+    if len(args.logs) > 2:
+        parser.error('at most two result files')
+
+    try:
+        blocks = [read_block(log) for log in args.logs]
+    except ValueError as err:
+        sys.exit('bench: %s' % err)
+
+    key_header = '%-6s %4s %5s %5s %3s' % ('test', 'size', 'kbps', 'ard',
+                                             'arc')
+    lat = args.percentile
+
+    if len(blocks) == 1:
+        source, cases = blocks[0]
+        print('%s results' % source)
+        print('%s %5s %5s %7s %6s %8s %6s %6s %6s %6s' %
+              ((key_header,) + ('ok', 'retry', 'pkt/s', 'B/s', 'elapsed',
+                                'p50', 'p90', 'p99', 'max')))
+        for key in sorted(cases):
+            if args.test and key[0] != args.test:
+                continue
+            c = cases[key]
+            print('%-6s %4d %5d %5d %3d' % key +
+                  ' %5d %5d %7d %6d %8d %6s %6s %6s %6s' %
+                  (c['ok'], c['retries'], c['pps'], c['goodput'],
+                   c['elapsed'], value(c['p50']), value(c['p90']),
+                   value(c['p99']), value(c['max'])))
+        return
+
+    #
+    # Put the hardware first whichever order the files came in.
+    #
+    if blocks[0][0] == 'model' and blocks[1][0] != 'model':
+        blocks.reverse()
+    (a_name, a), (b_name, b) = blocks
+
+    print('%s %9s %9s %5s  %9s %9s %5s' %
+          (key_header, a_name + ' pps', b_name + ' pps', 'ratio',
+           a_name + ' ' + lat, b_name + ' ' + lat, 'ratio'))
+    matched = 0
+    for key in sorted(set(a) & set(b)):
+        if args.test and key[0] != args.test:
+            continue
+        matched += 1
+        print('%-6s %4d %5d %5d %3d' % key +
+              ' %9d %9d %5s  %9s %9s %5s' %
+              (a[key]['pps'], b[key]['pps'],
+               ratio(a[key]['pps'], b[key]['pps']), value(a[key][lat]),
+               value(b[key][lat]), ratio(a[key][lat], b[key][lat])))
+    if not matched:
+        sys.exit('bench: no cases in common')
+    only = len(set(a) ^ set(b))
+    if only:
+        print('%d cases ran on one side only' % only)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,403 @@
+//*****************************************************************************
+//
+// bench.c - Model of the radio benchmark, for comparison with the master's
+// "bench" results.
+//
+// Runs the suite in utilities/bench.h against a timing model of the
+// nRF24L01+ and prints the same block of result lines the master does,
+// with "model" as the source:
+//
+//     host/bench/bench [-q] [-l loss %] [-s seed] > model.log
+//     host/bench.py console.log model.log
+//
+// The model follows each packet on air: the radio's 130 us settling time
+// before every transmission and reception, air time from
+// BENCH_AIR_US(), auto-acknowledgement with the ACK due within the
+// retransmit delay, and retransmissions the retransmit delay apart.  The
+// SPI traffic each side makes between packets is counted at 8 Mbps; the
+// time the processors take to run the code is not, so a gap between model
+// and hardware is the software's share.  With -l each packet and ACK is
+// lost with the given probability, from a seeded generator so that runs
+// can be repeated.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "utilities/bench.h"
+
+//
+// Microseconds to shift one byte over SPI at 8 Mbps, and for a command with
+// one byte of data, such as a register write or reading STATUS and
+// clearing it.
+//
+#define MODEL_SPI_BYTE_US       1.0
+#define MODEL_SPI_CMD_US        (2 * MODEL_SPI_BYTE_US)
+
+//
+// One case's settings.
+//
+typedef struct
+{
+    int iTest;
+
+    int iSize;
+
+    double dKbps;
+
+    double dArdUs;
+
+    int iArc;
+}
+tModelCase;
+
+typedef struct
+{
+    uint32_t ui32Sent;
+
+    uint32_t ui32OK;
+
+    uint32_t ui32Retries;
+
+    double dElapsedUs;
+}
+tModelResult;
+
+static const char *g_ppcTestNames[BENCH_TESTS] = BENCH_TEST_NAMES;
+static const uint16_t g_pui16Kbps[BENCH_RATES] = BENCH_RATE_KBPS;
+static const uint16_t g_pui16ArdUs[BENCH_RETRIES] = BENCH_RETRY_ARD_US;
+static const uint8_t g_pui8Arc[BENCH_RETRIES] = BENCH_RETRY_ARC;
+static const uint8_t g_pui8QuickSizes[] = BENCH_QUICK_SIZES;
+
+static double g_dLoss;
+
+static uint32_t g_ui32Random = 1;
+
+static uint32_t g_pui32Latency[BENCH_PACKETS];
+
+//
+// True if a packet is lost, with probability g_dLoss.
+//
+static bool
+ModelLost(void)
+{
+    if(g_dLoss <= 0.0)
+    {
+        return(false);
+    }
+
+    //
+    // xorshift32.
+    //
+    g_ui32Random ^= g_ui32Random << 13;
+    g_ui32Random ^= g_ui32Random >> 17;
+    g_ui32Random ^= g_ui32Random << 5;
+    return((g_ui32Random / 4294967296.0) < g_dLoss);
+}
+
+static double
+ModelAir(const tModelCase *psCase, int iLen)
+{
+    return(BENCH_AIR_US((double)iLen, psCase->dKbps));
+}
+
+//
+// Send a packet of iLen bytes with auto-acknowledgement, answered by an
+// ACK carrying iAckLen bytes.  The first transmission goes on air at
+// dStart; the receiver hears nothing that starts before dListen.  Returns
+// true if an ACK came back, with the time the sender raised TX_DS or
+// MAX_RT in *pdDone, its retransmissions in *piRetries and the time the
+// receiver first had the packet in *pdReceived, or a negative time if it
+// never did.
+//
+static bool
+ModelSend(const tModelCase *psCase, int iLen, int iAckLen, double dStart,
+          double dListen, double *pdDone, int *piRetries, double *pdReceived)
+{
+    double dAir = ModelAir(psCase, iLen);
+    double dAck = BENCH_SETTLE_US + ModelAir(psCase, iAckLen);
+    double dEnd;
+    int i;
+
+    *pdReceived = -1.0;
+    for(i = 0; ; i++)
+    {
+        dEnd = dStart + dAir;
+        if((dStart >= dListen) && !ModelLost())
+        {
+            if(*pdReceived < 0.0)
+            {
+                *pdReceived = dEnd;
+            }
+
+            //
+            // An ACK that does not arrive within the retransmit delay is
+            // missed.
+            //
+            if((dAck <= psCase->dArdUs) && !ModelLost())
+            {
+                *pdDone = dEnd + dAck;
+                *piRetries = i;
+                return(true);
+            }
+        }
+        if(i == psCase->iArc)
+        {
+            *pdDone = dEnd + psCase->dArdUs;
+            *piRetries = i;
+            return(false);
+        }
+        dStart = dEnd + psCase->dArdUs;
+    }
+}
+
+//
+// ping and ackpl, as BenchRoundTrips() runs them on the master.  Time is
+// measured from the start of the case.
+//
+static void
+ModelRoundTrips(const tModelCase *psCase, tModelResult *psResult)
+{
+    double dNow = 0.0, dStart, dDone, dReceived, dListen, dEcho;
+    double dNodeListen = 0.0;
+    int iRetries, i;
+    bool bOK;
+
+    for(i = 0; i < BENCH_PACKETS; i++)
+    {
+        //
+        // The payload is written before the CE pulse that starts the
+        // latency.
+        //
+        dNow += (psCase->iSize + 1) * MODEL_SPI_BYTE_US;
+        dStart = dNow;
+        psResult->ui32Sent++;
+
+        bOK = ModelSend(psCase, psCase->iSize,
+                        (psCase->iTest == BENCH_TEST_ACKPL) ? psCase->iSize : 0,
+                        dStart + BENCH_SETTLE_US, dNodeListen, &dDone,
+                        &iRetries, &dReceived);
+        psResult->ui32Retries += iRetries;
+
+        //
+        // Reading STATUS and OBSERVE_TX.
+        //
+        dNow = dDone + (2 * MODEL_SPI_CMD_US);
+        if(!bOK)
+        {
+            dNow += 2 * MODEL_SPI_BYTE_US;
+            continue;
+        }
+
+        if(psCase->iTest == BENCH_TEST_ACKPL)
+        {
+            g_pui32Latency[psResult->ui32OK++] = dDone - dStart;
+            dNow += MODEL_SPI_BYTE_US;
+            continue;
+        }
+
+        //
+        // ping: the master listens once CONFIG is written and the radio has
+        // settled.  The node waits for its ACK to go, writes CONFIG and the
+        // echo, and sends it; it listens again once the echo is done.
+        //
+        dListen = dNow + MODEL_SPI_CMD_US + BENCH_SETTLE_US;
+        dEcho = dReceived + BENCH_ECHO_WAIT_US + MODEL_SPI_CMD_US +
+                ((psCase->iSize + 1) * MODEL_SPI_BYTE_US) + BENCH_SETTLE_US;
+        bOK = ModelSend(psCase, psCase->iSize, 0, dEcho, dListen, &dDone,
+                        &iRetries, &dReceived);
+        dNodeListen = dDone + MODEL_SPI_CMD_US + BENCH_SETTLE_US;
+        if(dReceived >= 0.0)
+        {
+            g_pui32Latency[psResult->ui32OK++] = dReceived - dStart;
+            dNow = dReceived;
+        }
+        else
+        {
+            dNow = dListen + BENCH_TIMEOUT_US;
+        }
+
+        //
+        // Reading STATUS, staying in RX while the ACK goes, then CONFIG
+        // and flushing the RX FIFO.
+        //
+        dNow += MODEL_SPI_CMD_US + BENCH_ECHO_WAIT_US + MODEL_SPI_CMD_US +
+                MODEL_SPI_BYTE_US;
+    }
+    psResult->dElapsedUs = dNow;
+}
+
+//
+// stream, as BenchStream() runs it: the TX FIFO is filled and CE held
+// high, so that each packet goes out as soon as the last is acknowledged.
+//
+static void
+ModelStream(const tModelCase *psCase, tModelResult *psResult)
+{
+    double dFill = 3 * (psCase->iSize + 1) * MODEL_SPI_BYTE_US;
+    double dNext, dDone, dReceived, dLast = 0.0;
+    int iRetries;
+
+    dNext = dFill + BENCH_SETTLE_US;
+    while(psResult->ui32Sent < BENCH_PACKETS)
+    {
+        psResult->ui32Sent++;
+        if(ModelSend(psCase, psCase->iSize, 0, dNext, 0.0, &dDone, &iRetries,
+                     &dReceived))
+        {
+            g_pui32Latency[psResult->ui32OK++] = dDone - dLast;
+            dNext = dDone + BENCH_SETTLE_US;
+        }
+        else
+        {
+            //
+            // The master flushes the FIFO and fills it again.
+            //
+            dNext = dDone + (2 * MODEL_SPI_CMD_US) + MODEL_SPI_BYTE_US +
+                    dFill + BENCH_SETTLE_US;
+        }
+        psResult->ui32Retries += iRetries;
+        dLast = dDone;
+    }
+    psResult->dElapsedUs = dLast;
+}
+
+static int
+ModelCompare(const void *pvA, const void *pvB)
+{
+    uint32_t ui32A = *(const uint32_t *)pvA, ui32B = *(const uint32_t *)pvB;
+
+    return((ui32A > ui32B) - (ui32A < ui32B));
+}
+
+//
+// Run one case and print its line as the master does.
+//
+static void
+ModelCaseRun(int iTest, int iSize, int iRate, int iRetry)
+{
+    tModelCase sCase;
+    tModelResult sResult;
+    uint32_t ui32Elapsed, ui32Rate = 0, ui32Goodput = 0, ui32N;
+
+    sCase.iTest = iTest;
+    sCase.iSize = iSize;
+    sCase.dKbps = g_pui16Kbps[iRate];
+    sCase.dArdUs = g_pui16ArdUs[iRetry];
+    sCase.iArc = g_pui8Arc[iRetry];
+    memset(&sResult, 0, sizeof(sResult));
+
+    if(iTest == BENCH_TEST_STREAM)
+    {
+        ModelStream(&sCase, &sResult);
+    }
+    else
+    {
+        ModelRoundTrips(&sCase, &sResult);
+    }
+
+    ui32Elapsed = sResult.dElapsedUs;
+    if(ui32Elapsed)
+    {
+        ui32Rate = ((uint64_t)sResult.ui32OK * 1000000) / ui32Elapsed;
+        ui32Goodput = ((uint64_t)sResult.ui32OK * iSize * 1000000) /
+                      ui32Elapsed;
+    }
+    printf("B %s %u %u %u %u %u %u %u %u %u %u", g_ppcTestNames[iTest], iSize,
+           g_pui16Kbps[iRate], g_pui16ArdUs[iRetry], g_pui8Arc[iRetry],
+           sResult.ui32Sent, sResult.ui32OK, sResult.ui32Retries, ui32Elapsed,
+           ui32Rate, ui32Goodput);
+
+    ui32N = sResult.ui32OK;
+    if(ui32N == 0)
+    {
+        printf(" - - - -\n");
+        return;
+    }
+    qsort(g_pui32Latency, ui32N, sizeof(g_pui32Latency[0]), ModelCompare);
+    printf(" %u %u %u %u\n", g_pui32Latency[((ui32N - 1) * 50) / 100],
+           g_pui32Latency[((ui32N - 1) * 90) / 100],
+           g_pui32Latency[((ui32N - 1) * 99) / 100],
+           g_pui32Latency[ui32N - 1]);
+}
+
+int
+main(int argc, char **argv)
+{
+    bool bQuick = false;
+    int iOpt, iRate, iRetry, iTest, iSize;
+    unsigned int i;
+
+    while((iOpt = getopt(argc, argv, "ql:s:")) != -1)
+    {
+        switch(iOpt)
+        {
+            case 'q':
+            {
+                bQuick = true;
+                break;
+            }
+            case 'l':
+            {
+                g_dLoss = atof(optarg) / 100.0;
+                break;
+            }
+            case 's':
+            {
+                g_ui32Random = strtoul(optarg, 0, 0);
+                if(g_ui32Random == 0)
+                {
+                    g_ui32Random = 1;
+                }
+                break;
+            }
+            default:
+            {
+                fprintf(stderr, "usage: %s [-q] [-l loss %%] [-s seed]\n",
+                        argv[0]);
+                return(2);
+            }
+        }
+    }
+
+    //
+    // Cases in the order the master runs them.
+    //
+    printf("BENCH %u %u model\n", BENCH_DUMP_VERSION, BENCH_PACKETS);
+    if(bQuick)
+    {
+        for(iTest = 0; iTest < BENCH_TESTS; iTest++)
+        {
+            for(i = 0; i < sizeof(g_pui8QuickSizes); i++)
+            {
+                ModelCaseRun(iTest, g_pui8QuickSizes[i], BENCH_QUICK_RATE,
+                             BENCH_QUICK_RETRY);
+            }
+        }
+    }
+    else
+    {
+        for(iRate = 0; iRate < BENCH_RATES; iRate++)
+        {
+            for(iRetry = 0; iRetry < BENCH_RETRIES; iRetry++)
+            {
+                for(iTest = 0; iTest < BENCH_TESTS; iTest++)
+                {
+                    for(iSize = 1; iSize <= BENCH_SIZE_MAX; iSize++)
+                    {
+                        ModelCaseRun(iTest, iSize, iRate, iRetry);
+                    }
+                }
+            }
+        }
+    }
+    printf("BENCH END\n");
+    return(0);
+}
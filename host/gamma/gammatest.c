@@ -0,0 +1,130 @@
+//*****************************************************************************
+//
+// gammatest.c - Check the RGB node's gamma correction and dither on Linux.
+//
+// Builds RGBGamma(), RGBLevelsFill() and RGBDitherStep() from
+// Node_RGB/rgbgamma.c unchanged and, over all 65536 channel levels, checks
+// that:
+//
+//     - the interpolated duty is within GAMMA_TEST_MAX_ERROR PWM counts of
+//       the exact curve, and never falls as the level rises;
+//     - no PWM period's match value, whole counts plus a dither count,
+//       passes the timer's load value of GAMMA_PWM_PERIOD - 1;
+//     - over a dither cycle the match values add up to the duty exactly.
+//
+// Run "make check".  The exit status is nonzero if any check fails.  The
+// dither step runs in the PWM interrupt, once every GAMMA_PWM_PERIOD
+// counts; "make mca" reports its cycles on a Cortex-M4.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "gamma.h"
+#include "rgbgamma.h"
+
+//
+// The curve host/gammagen.py built gamma.h for; the Makefile passes it.
+//
+#ifndef GAMMA_CURVE
+#define GAMMA_CURVE             2.2
+#endif
+
+//
+// Largest error allowed against the exact curve, in PWM counts.
+//
+#define GAMMA_TEST_MAX_ERROR    0.25
+
+//
+// Duty, in 1/GAMMA_DITHER_FRAMES counts, of a channel at full level.  One
+// count short of the period, as gammagen.py makes it.
+//
+#define GAMMA_TEST_FULL         ((GAMMA_PWM_PERIOD - 1) << GAMMA_DITHER_BITS)
+
+int
+main(void)
+{
+    tRGBLevels sLevels;
+    uint16_t pui16Levels[RGB_CHANNELS];
+    uint32_t pui32Match[RGB_CHANNELS], pui32Sum[RGB_CHANNELS];
+    uint32_t ui32Duty, ui32Last = 0, ui32MaxMatch = 0, ui32Frame;
+    uint32_t ui32Level, ui32Falls = 0, ui32Over = 0, ui32Drift = 0;
+    uint32_t ui32WorstLevel = 0;
+    double dExact, dError, dWorst = 0.0;
+    int i;
+
+    for(ui32Level = 0; ui32Level < 65536; ui32Level++)
+    {
+        ui32Duty = RGBGamma(ui32Level);
+        dExact = GAMMA_TEST_FULL * pow(ui32Level / 65535.0, GAMMA_CURVE);
+        dError = fabs(ui32Duty - dExact) / GAMMA_DITHER_FRAMES;
+        if(dError > dWorst)
+        {
+            dWorst = dError;
+            ui32WorstLevel = ui32Level;
+        }
+        if(ui32Duty < ui32Last)
+        {
+            ui32Falls++;
+        }
+        ui32Last = ui32Duty;
+
+        //
+        // Give each channel a different level, so all three are exercised
+        // over the sweep.
+        //
+        pui16Levels[0] = ui32Level;
+        pui16Levels[1] = 65535 - ui32Level;
+        pui16Levels[2] = (ui32Level * 40503) & 0xFFFF;
+        RGBLevelsFill(&sLevels, pui16Levels);
+        for(i = 0; i < RGB_CHANNELS; i++)
+        {
+            pui32Sum[i] = 0;
+        }
+        for(ui32Frame = 0; ui32Frame < GAMMA_DITHER_FRAMES; ui32Frame++)
+        {
+            RGBDitherStep(&sLevels, ui32Frame, pui32Match);
+            for(i = 0; i < RGB_CHANNELS; i++)
+            {
+                if(pui32Match[i] > ui32MaxMatch)
+                {
+                    ui32MaxMatch = pui32Match[i];
+                }
+                if(pui32Match[i] > GAMMA_PWM_PERIOD - 1)
+                {
+                    ui32Over++;
+                }
+                pui32Sum[i] += pui32Match[i];
+            }
+        }
+        for(i = 0; i < RGB_CHANNELS; i++)
+        {
+            if(pui32Sum[i] != RGBGamma(pui16Levels[i]))
+            {
+                ui32Drift++;
+            }
+        }
+    }
+
+    printf("Gamma %.2f, period %u counts, %u dither frames\n", GAMMA_CURVE,
+           GAMMA_PWM_PERIOD, GAMMA_DITHER_FRAMES);
+    printf("Worst error %.3f PWM counts at level %u, limit %.3f\n", dWorst,
+           ui32WorstLevel, GAMMA_TEST_MAX_ERROR);
+    printf("Largest match %u, limit %u\n", ui32MaxMatch,
+           GAMMA_PWM_PERIOD - 1);
+    printf("%u falling steps, %u matches over the limit, %u dither cycles "
+           "off their duty\n", ui32Falls, ui32Over, ui32Drift);
+
+    if((dWorst > GAMMA_TEST_MAX_ERROR) || ui32Falls || ui32Over || ui32Drift)
+    {
+        printf("FAIL\n");
+        return(1);
+    }
+    printf("PASS\n");
+    return(0);
+}
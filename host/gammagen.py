@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+#
+# gammagen.py - Generate the gamma and dither tables for Node_RGB.
+#
+# The node turns the 16-bit channel levels it is sent into PWM duty with
+# these tables, so it does no floating point and no curve math.  Run:
+#
+#     host/gammagen.py > Node_RGB/gamma.h
+#
+# after changing any of the options, and commit the result.  The worst error
+# of the node's interpolation against the exact curve is printed to stderr.
+#
+# Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+#
+
+import argparse
+import sys
+
+
+def bit_reverse(value, bits):
+    result = 0
+    for _ in range(bits):
+        result = (result << 1) | (value & 1)
+        value >>= 1
+    return result
+
+
+def gamma_table(gamma, full, segments):
+    """Return segments + 1 entries sampling full * x ** gamma.  Entry i is
+    the output for level i * 65536 / segments, with the last one taken at
+    the top level, 65535."""
+    step = 65536 // segments
+    return [round(full * (min(i * step, 65535) / 65535.0) ** gamma)
+            for i in range(segments + 1)]
+
+
+def interpolate(table, level, segments):
+    """Mirror of RGBGamma() in Node_RGB/rgbgamma.c."""
+    shift = 16 - (segments.bit_length() - 1)
+    index = level >> shift
+    frac = level & ((1 << shift) - 1)
+    low = table[index]
+    return low + (((table[index + 1] - low) * frac) >> shift)
+
+
+def worst_error(table, gamma, full, segments):
+    worst = (0.0, 0)
+    for level in range(65536):
+        exact = full * (level / 65535.0) ** gamma
+        error = abs(interpolate(table, level, segments) - exact)
+        if error > worst[0]:
+            worst = (error, level)
+    return worst
+
+
+def format_table(name, ctype, values, per_line):
+    lines = ['static const %s %s[%d] =' % (ctype, name, len(values)), '{']
+    width = len(str(max(values)))
+    for i in range(0, len(values), per_line):
+        chunk = values[i:i + per_line]
+        lines.append('    ' + ', '.join('%*d' % (width, v) for v in chunk) +
+                     (',' if i + per_line < len(values) else ''))
+    lines.append('};')
+    return '\n'.join(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Generate the gamma and dither tables for Node_RGB.')
+    parser.add_argument('--gamma', type=float, default=2.2,
+                        help='display gamma (default: 2.2)')
+    parser.add_argument('--period-bits', type=int, default=12,
+                        help='PWM period as a power of two (default: 12)')
+    parser.add_argument('--dither-bits', type=int, default=4,
+                        help='duty fraction bits spread over that many '
+                             'PWM periods (default: 4)')
+    parser.add_argument('--segments', type=int, default=256,
+                        help='interpolation segments, a power of two '
+                             '(default: 256)')
+    args = parser.parse_args()
+
+    if args.period_bits + args.dither_bits > 16:
+        sys.exit('gammagen: duty and fraction must fit in 16 bits')
+    if args.segments & (args.segments - 1):
+        sys.exit('gammagen: segments must be a power of two')
+
+    #
+    # Full scale is one count short of the period, so the whole part plus a
+    # dither count never passes the timer's load value.
+    #
+    full = ((1 << args.period_bits) - 1) << args.dither_bits
+    table = gamma_table(args.gamma, full, args.segments)
+    frames = 1 << args.dither_bits
+    dither = [bit_reverse(i, args.dither_bits) for i in range(frames)]
+
+    error, level = worst_error(table, args.gamma, full, args.segments)
+    sys.stderr.write('gammagen: worst error %.2f of %d (%.3f PWM counts) at '
+                     'level %d\n' % (error, full, error / frames, level))
+
+    print('''//*****************************************************************************
+//
+// gamma.h - Gamma correction and dither tables for the RGB node.
+//
+// Generated by host/gammagen.py --gamma %g --period-bits %d --dither-bits %d
+// --segments %d.  Do not edit.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __GAMMA_H__
+#define __GAMMA_H__
+
+//
+// PWM period in timer counts, and the fraction bits of duty that are
+// spread over GAMMA_DITHER_FRAMES periods.
+//
+#define GAMMA_PWM_PERIOD        %d
+#define GAMMA_DITHER_BITS       %d
+#define GAMMA_DITHER_FRAMES     (1 << GAMMA_DITHER_BITS)
+
+//
+// Duty, in 1/GAMMA_DITHER_FRAMES counts, for levels at multiples of
+// 65536 / GAMMA_SEGMENTS.  Levels in between are interpolated.
+//
+#define GAMMA_SEGMENTS          %d
+#define GAMMA_SEGMENT_SHIFT     %d
+
+%s
+
+//
+// Frame i of each dither cycle adds a count to channels whose duty
+// fraction is over entry i, so a fraction of n adds a count in n frames of
+// the cycle, spread evenly.
+//
+%s
+
+#endif''' % (args.gamma, args.period_bits, args.dither_bits, args.segments,
+             1 << args.period_bits, args.dither_bits, args.segments,
+             16 - (args.segments.bit_length() - 1),
+             format_table('g_pui16GammaLUT', 'uint16_t', table, 8),
+             format_table('g_pui8DitherLUT', 'uint8_t', dither, 16)))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,377 @@
+//*****************************************************************************
+//
+// fakemaster.c - Stand in for the master's console on a pseudo-terminal.
+//
+// Run:
+//
+//     host/gateway/fakemaster [-b baud] [-d delivery ms]
+//
+// It prints the path of the terminal to hand to host/gateway/gateway.  Like
+// the master, it echoes input until told "echo off", keeps input in a 128
+// byte buffer and drops what overruns it, answers each line in turn and
+// ends the answer with "> ", and sends output no faster than the baud rate
+// allows.  It knows a few commands:
+//
+//     LED on|off <id list>    queue commands; each is confirmed with a
+//     RGB <id list> r g b     DELIVERY line after the delivery time
+//     echo on|off
+//     help
+//     status
+//
+// Anything else gets "ERROR: Bad Command".  Overruns are counted on
+// stderr; the gateway should never cause one.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+//
+// The master's UART receive buffer and command line buffer.
+//
+#define FAKE_RX_MAX             128
+#define FAKE_CMD_MAX            128
+
+#define FAKE_TX_MAX             (64 * 1024)
+
+#define FAKE_NODES              5
+
+//
+// Commands waiting for their delivery time.
+//
+#define FAKE_PENDING_MAX        256
+
+typedef struct
+{
+    int iNode;
+
+    unsigned int uiSeq;
+
+    uint64_t ui64Queued;
+}
+tPending;
+
+static char g_pcRX[FAKE_RX_MAX];
+static int g_iRXLen;
+static char g_pcTX[FAKE_TX_MAX];
+static int g_iTXLen;
+static bool g_bEcho = true;
+
+static tPending g_psPending[FAKE_PENDING_MAX];
+static int g_iPendingHead;
+static int g_iPendingCount;
+static unsigned int g_puiSeq[FAKE_NODES];
+
+static uint32_t g_ui32Overruns;
+static uint32_t g_ui32Commands;
+
+static uint64_t
+NowMicros(void)
+{
+    struct timespec sNow;
+
+    clock_gettime(CLOCK_MONOTONIC, &sNow);
+    return(((uint64_t)sNow.tv_sec * 1000000) + (sNow.tv_nsec / 1000));
+}
+
+//
+// Queue output, expanding '\n' to "\r\n" as uartstdio does.  Like
+// ConsolePrintf(), a message that does not fit is dropped whole.
+//
+static void
+FakePrintf(const char *pcFormat, ...)
+{
+    char pcLine[256];
+    va_list vaArgP;
+    int iLen, i;
+
+    va_start(vaArgP, pcFormat);
+    iLen = vsnprintf(pcLine, sizeof(pcLine), pcFormat, vaArgP);
+    va_end(vaArgP);
+    if(iLen >= (int)sizeof(pcLine))
+    {
+        iLen = sizeof(pcLine) - 1;
+    }
+    if(g_iTXLen + (iLen * 2) > FAKE_TX_MAX)
+    {
+        return;
+    }
+    for(i = 0; i < iLen; i++)
+    {
+        if(pcLine[i] == '\n')
+        {
+            g_pcTX[g_iTXLen++] = '\r';
+        }
+        g_pcTX[g_iTXLen++] = pcLine[i];
+    }
+}
+
+static void
+CommandQueue(int iNode)
+{
+    tPending *psPending;
+
+    if(++g_puiSeq[iNode] == 256)
+    {
+        g_puiSeq[iNode] = 1;
+    }
+    FakePrintf("DELIVERY %d %u queued\n", iNode, g_puiSeq[iNode]);
+    if(g_iPendingCount == FAKE_PENDING_MAX)
+    {
+        return;
+    }
+    psPending = &g_psPending[(g_iPendingHead + g_iPendingCount) %
+                             FAKE_PENDING_MAX];
+    psPending->iNode = iNode;
+    psPending->uiSeq = g_puiSeq[iNode];
+    psPending->ui64Queued = NowMicros();
+    g_iPendingCount++;
+}
+
+//
+// Queue a command for each node in a list such as "0,2,3".
+//
+static bool
+NodeListRun(char *pcList)
+{
+    char *pcEnd;
+    long lNode;
+    int iMask = 0, i;
+
+    while(1)
+    {
+        lNode = strtol(pcList, &pcEnd, 10);
+        if((pcEnd == pcList) || (lNode < 0) || (lNode >= FAKE_NODES))
+        {
+            return(false);
+        }
+        iMask |= 1 << lNode;
+        if(*pcEnd != ',')
+        {
+            break;
+        }
+        pcList = pcEnd + 1;
+    }
+    for(i = 0; i < FAKE_NODES; i++)
+    {
+        if(iMask & (1 << i))
+        {
+            CommandQueue(i);
+        }
+    }
+    return(true);
+}
+
+static void
+CommandRun(char *pcLine)
+{
+    char *ppcArgs[8];
+    int iArgs = 0;
+    char *pcSave, *pcArg;
+
+    for(pcArg = strtok_r(pcLine, " ", &pcSave); pcArg && (iArgs < 8);
+        pcArg = strtok_r(NULL, " ", &pcSave))
+    {
+        ppcArgs[iArgs++] = pcArg;
+    }
+    g_ui32Commands++;
+
+    if(iArgs == 0)
+    {
+        FakePrintf("ERROR: Bad Command\n");
+    } else if(!strcmp(ppcArgs[0], "echo") && (iArgs == 2)) {
+        g_bEcho = strcmp(ppcArgs[1], "off") != 0;
+    } else if(!strcmp(ppcArgs[0], "help")) {
+        FakePrintf("\nAvailable commands\n------------------\n");
+        FakePrintf("help     : Display list of commands\n");
+        FakePrintf("status   : Read the radio's status register\n");
+        FakePrintf("LED      : \"LED state id\"\n");
+        FakePrintf("RGB      : \"RGB id R G B\"\n");
+        FakePrintf("echo     : \"echo [on|off]\"\n");
+    } else if(!strcmp(ppcArgs[0], "status")) {
+        FakePrintf("Status: 0e\n");
+    } else if(!strcmp(ppcArgs[0], "LED") && (iArgs == 3)) {
+        if(!NodeListRun(ppcArgs[2]))
+        {
+            FakePrintf("ERROR: Invalid argument!\n");
+        }
+    } else if(!strcmp(ppcArgs[0], "RGB") && (iArgs == 5)) {
+        if(!NodeListRun(ppcArgs[1]))
+        {
+            FakePrintf("ERROR: Invalid argument!\n");
+        }
+    } else {
+        FakePrintf("ERROR: Bad Command\n");
+    }
+    FakePrintf("> ");
+}
+
+//
+// Take input into the receive buffer, echoing it, and run every complete
+// line, as the master's UART interrupt and ConsoleService() do.
+//
+static void
+InputRead(int iFd)
+{
+    char pcBuf[512], pcCmd[FAKE_CMD_MAX];
+    char *pcEnd;
+    int iLen, i, iLine;
+
+    iLen = read(iFd, pcBuf, sizeof(pcBuf));
+    for(i = 0; i < iLen; i++)
+    {
+        if(g_iRXLen == FAKE_RX_MAX)
+        {
+            g_ui32Overruns++;
+            fprintf(stderr, "fakemaster: receive overrun (%u)\n",
+                    g_ui32Overruns);
+            continue;
+        }
+        g_pcRX[g_iRXLen++] = pcBuf[i];
+        if(g_bEcho && (g_iTXLen + 2 <= FAKE_TX_MAX))
+        {
+            if(pcBuf[i] == '\r')
+            {
+                g_pcTX[g_iTXLen++] = '\r';
+                g_pcTX[g_iTXLen++] = '\n';
+            } else {
+                g_pcTX[g_iTXLen++] = pcBuf[i];
+            }
+        }
+    }
+
+    while((pcEnd = memchr(g_pcRX, '\r', g_iRXLen)) != NULL)
+    {
+        iLine = pcEnd - g_pcRX;
+        if(iLine >= FAKE_CMD_MAX)
+        {
+            iLine = FAKE_CMD_MAX - 1;
+        }
+        memcpy(pcCmd, g_pcRX, iLine);
+        pcCmd[iLine] = 0;
+        g_iRXLen -= pcEnd + 1 - g_pcRX;
+        memmove(g_pcRX, pcEnd + 1, g_iRXLen);
+        CommandRun(pcCmd);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    struct termios sTerm;
+    struct pollfd sPoll;
+    tPending *psPending;
+    uint64_t ui64Last, ui64Now, ui64Delivery = 50000;
+    double dCredit = 0, dBytesPerUs;
+    int iPty, iSlave, iBaud = 115200, iOpt, iSend;
+
+    while((iOpt = getopt(argc, argv, "b:d:")) != -1)
+    {
+        switch(iOpt)
+        {
+            case 'b':
+                iBaud = atoi(optarg);
+                break;
+            case 'd':
+                ui64Delivery = atoi(optarg) * 1000ULL;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-b baud] [-d delivery ms]\n",
+                        argv[0]);
+                return(1);
+        }
+    }
+    dBytesPerUs = iBaud / 10.0 / 1e6;
+
+    iPty = posix_openpt(O_RDWR | O_NOCTTY);
+    if((iPty < 0) || grantpt(iPty) || unlockpt(iPty))
+    {
+        perror("fakemaster: posix_openpt");
+        return(1);
+    }
+
+    //
+    // Hold the terminal open, in raw mode, so that the gateway coming and
+    // going does not hang it up.
+    //
+    iSlave = open(ptsname(iPty), O_RDWR | O_NOCTTY);
+    if((iSlave < 0) || (tcgetattr(iSlave, &sTerm) < 0))
+    {
+        perror("fakemaster: ptsname");
+        return(1);
+    }
+    cfmakeraw(&sTerm);
+    tcsetattr(iSlave, TCSANOW, &sTerm);
+    printf("%s\n", ptsname(iPty));
+    fflush(stdout);
+
+    FakePrintf("Automation master (fake)\n> ");
+    sPoll.fd = iPty;
+    ui64Last = NowMicros();
+    while(1)
+    {
+        sPoll.events = POLLIN;
+        poll(&sPoll, 1, 1);
+        if(sPoll.revents & POLLIN)
+        {
+            InputRead(iPty);
+        }
+
+        //
+        // Confirm commands whose delivery time has come.
+        //
+        ui64Now = NowMicros();
+        while(g_iPendingCount)
+        {
+            psPending = &g_psPending[g_iPendingHead];
+            if(ui64Now - psPending->ui64Queued < ui64Delivery)
+            {
+                break;
+            }
+            FakePrintf("DELIVERY %d %u ok %llu 1\n", psPending->iNode,
+                       psPending->uiSeq,
+                       (unsigned long long)(ui64Now - psPending->ui64Queued));
+            g_iPendingHead = (g_iPendingHead + 1) % FAKE_PENDING_MAX;
+            g_iPendingCount--;
+        }
+
+        //
+        // Send what the baud rate has allowed since the last pass.
+        //
+        dCredit += (ui64Now - ui64Last) * dBytesPerUs;
+        ui64Last = ui64Now;
+        iSend = (int)dCredit;
+        if(iSend > g_iTXLen)
+        {
+            iSend = g_iTXLen;
+        }
+        if(iSend > 0)
+        {
+            iSend = write(iPty, g_pcTX, iSend);
+            if(iSend > 0)
+            {
+                memmove(g_pcTX, g_pcTX + iSend, g_iTXLen - iSend);
+                g_iTXLen -= iSend;
+                dCredit -= iSend;
+            }
+        }
+        if(g_iTXLen == 0)
+        {
+            dCredit = 0;
+        }
+    }
+}
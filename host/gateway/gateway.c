@@ -0,0 +1,916 @@
+//*****************************************************************************
+//
+// gateway.c - Share the master's console between local programs.
+//
+// The gateway owns the serial port to the master and serves a Unix socket.
+// Run:
+//
+//     host/gateway/gateway [-b baud] [-s socket] /dev/ttyACM0
+//
+// Clients send lines of text:
+//
+//     C <id> <command>    run a console command; <id> is the client's own
+//                         tag for it, up to 15 characters without spaces
+//     S                   subscribe to events
+//     U                   unsubscribe
+//     T                   report the gateway's counters
+//
+// and get back:
+//
+//     R <id> <line>       a line of the command's output
+//     D <id>              the command finished
+//     X <id> <reason>     the command was not run or did not finish
+//     E <line>            an event, to subscribers
+//     T <counters>        as listed in StatsReply()
+//
+// Many C lines may be written at once; they are queued in order.  Commands
+// are pipelined to the master without waiting for each to finish, up to
+// what its UART receive buffer holds, so the serial line stays busy.  The
+// master answers them in order and ends each with its "> " prompt, which is
+// how output is matched to commands.  Clients are served round robin.
+//
+// "DELIVERY" lines from the master are passed to subscribers whenever they
+// come, as well as to the command they come under, as are any lines that
+// come while no command is running.
+//
+// host/gateway/fakemaster stands in for the master on a pseudo-terminal.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#define _GNU_SOURCE
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+//
+// Longest command line; the master's input buffer is 128 bytes.
+//
+#define GATEWAY_CMD_MAX         127
+
+#define GATEWAY_ID_MAX          15
+
+//
+// Bytes sent to the master and not yet answered.  The master's UART
+// receive buffer holds 128, and a line stays in it until it is run.
+//
+#define GATEWAY_WINDOW          120
+
+//
+// Commands sent to the master and not yet answered.
+//
+#define GATEWAY_INFLIGHT_MAX    64
+
+//
+// Commands queued per client, and output held for a client that is slow to
+// read it before the gateway drops the client.
+//
+#define GATEWAY_QUEUE_MAX       256
+#define GATEWAY_OUT_MAX         (256 * 1024)
+
+#define GATEWAY_CLIENTS_MAX     64
+
+//
+// A command the master has not answered in this long is failed, along with
+// everything sent after it; the master has probably been reset.
+//
+#define GATEWAY_TIMEOUT_MS      3000
+
+#define GATEWAY_LINE_MAX        512
+
+//
+// Tags for epoll events.
+//
+#define EV_SERIAL               -1
+#define EV_LISTEN               -2
+
+typedef struct
+{
+    char pcId[GATEWAY_ID_MAX + 1];
+
+    char pcCmd[GATEWAY_CMD_MAX + 1];
+}
+tRequest;
+
+typedef struct
+{
+    int iFd;
+
+    //
+    // Bumped each time the slot is reused, so output for a command sent by
+    // a client that has gone is not handed to its successor.
+    //
+    uint32_t ui32Gen;
+
+    bool bSubscribed;
+
+    char pcIn[GATEWAY_LINE_MAX];
+    int iInLen;
+
+    tRequest *psQueue;
+    int iQueueHead;
+    int iQueueCount;
+
+    char *pcOut;
+    int iOutLen;
+}
+tClient;
+
+//
+// A command sent to the master.  iClient is -1 for the gateway's own.
+//
+typedef struct
+{
+    int iClient;
+
+    uint32_t ui32Gen;
+
+    char pcId[GATEWAY_ID_MAX + 1];
+
+    int iLen;
+
+    uint64_t ui64Sent;
+}
+tInFlight;
+
+static tClient g_psClients[GATEWAY_CLIENTS_MAX];
+static int g_iNextClient;
+
+static tInFlight g_psInFlight[GATEWAY_INFLIGHT_MAX];
+static int g_iInFlightHead;
+static int g_iInFlightCount;
+static int g_iWindowUsed;
+
+static int g_iEpoll;
+static int g_iSerial;
+static int g_iListen;
+
+//
+// Bytes waiting to go to the master, and output from it not yet parsed,
+// which always starts at the start of a line.
+//
+static char g_pcSerialOut[GATEWAY_WINDOW + GATEWAY_CMD_MAX + 2];
+static int g_iSerialOutLen;
+static char g_pcSerialIn[GATEWAY_LINE_MAX * 2];
+static int g_iSerialInLen;
+
+static struct
+{
+    uint64_t ui64Submitted;
+
+    uint64_t ui64Completed;
+
+    uint64_t ui64Failed;
+
+    uint64_t ui64Events;
+
+    uint64_t ui64BytesTX;
+
+    uint64_t ui64BytesRX;
+}
+g_sStats;
+
+static uint64_t
+NowMillis(void)
+{
+    struct timespec sNow;
+
+    clock_gettime(CLOCK_MONOTONIC, &sNow);
+    return(((uint64_t)sNow.tv_sec * 1000) + (sNow.tv_nsec / 1000000));
+}
+
+static void
+EpollSet(int iFd, int iTag, uint32_t ui32Events, int iOp)
+{
+    struct epoll_event sEvent;
+
+    sEvent.events = ui32Events;
+    sEvent.data.u64 = (uint32_t)iTag;
+    if(epoll_ctl(g_iEpoll, iOp, iFd, &sEvent) < 0)
+    {
+        perror("gateway: epoll_ctl");
+        exit(1);
+    }
+}
+
+//*****************************************************************************
+//
+// Clients.
+//
+//*****************************************************************************
+
+static void
+ClientClose(int iClient)
+{
+    tClient *psClient = &g_psClients[iClient];
+
+    close(psClient->iFd);
+    psClient->iFd = -1;
+    psClient->ui32Gen++;
+    psClient->iQueueCount = 0;
+    psClient->iOutLen = 0;
+}
+
+//
+// Write as much of a client's pending output as its socket takes, asking
+// for EPOLLOUT if some is left.
+//
+static void
+ClientFlush(int iClient)
+{
+    tClient *psClient = &g_psClients[iClient];
+    int iSent;
+
+    if(psClient->iOutLen == 0)
+    {
+        return;
+    }
+    iSent = write(psClient->iFd, psClient->pcOut, psClient->iOutLen);
+    if(iSent < 0)
+    {
+        if((errno != EAGAIN) && (errno != EINTR))
+        {
+            ClientClose(iClient);
+            return;
+        }
+        iSent = 0;
+    }
+    memmove(psClient->pcOut, psClient->pcOut + iSent,
+            psClient->iOutLen - iSent);
+    psClient->iOutLen -= iSent;
+    EpollSet(psClient->iFd, iClient,
+             EPOLLIN | (psClient->iOutLen ? EPOLLOUT : 0), EPOLL_CTL_MOD);
+}
+
+//
+// Queue a line of output for a client.  One that has let too much pile up
+// is dropped rather than holding up the others.
+//
+static void
+ClientPrintf(int iClient, const char *pcFormat, ...)
+{
+    tClient *psClient = &g_psClients[iClient];
+    va_list vaArgP;
+    int iLen;
+
+    if(psClient->iFd < 0)
+    {
+        return;
+    }
+    va_start(vaArgP, pcFormat);
+    iLen = vsnprintf(psClient->pcOut + psClient->iOutLen,
+                     GATEWAY_OUT_MAX - psClient->iOutLen, pcFormat, vaArgP);
+    va_end(vaArgP);
+    if(psClient->iOutLen + iLen >= GATEWAY_OUT_MAX)
+    {
+        fprintf(stderr, "gateway: dropping client %d, not reading\n",
+                iClient);
+        ClientClose(iClient);
+        return;
+    }
+    psClient->iOutLen += iLen;
+}
+
+static void
+EventPublish(const char *pcLine)
+{
+    int i;
+
+    g_sStats.ui64Events++;
+    for(i = 0; i < GATEWAY_CLIENTS_MAX; i++)
+    {
+        if((g_psClients[i].iFd >= 0) && g_psClients[i].bSubscribed)
+        {
+            ClientPrintf(i, "E %s\n", pcLine);
+        }
+    }
+}
+
+static void
+StatsReply(int iClient)
+{
+    int i, iQueued = 0;
+
+    for(i = 0; i < GATEWAY_CLIENTS_MAX; i++)
+    {
+        iQueued += g_psClients[i].iQueueCount;
+    }
+    ClientPrintf(iClient, "T inflight %d window %d queued %d submitted %llu "
+                 "completed %llu failed %llu events %llu tx %llu rx %llu\n",
+                 g_iInFlightCount, g_iWindowUsed, iQueued,
+                 (unsigned long long)g_sStats.ui64Submitted,
+                 (unsigned long long)g_sStats.ui64Completed,
+                 (unsigned long long)g_sStats.ui64Failed,
+                 (unsigned long long)g_sStats.ui64Events,
+                 (unsigned long long)g_sStats.ui64BytesTX,
+                 (unsigned long long)g_sStats.ui64BytesRX);
+}
+
+//
+// Handle one line from a client.
+//
+static void
+ClientLine(int iClient, char *pcLine)
+{
+    tClient *psClient = &g_psClients[iClient];
+    tRequest *psRequest;
+    char *pcId, *pcCmd;
+    int iIdLen;
+
+    if(!strcmp(pcLine, "S"))
+    {
+        psClient->bSubscribed = true;
+        return;
+    }
+    if(!strcmp(pcLine, "U"))
+    {
+        psClient->bSubscribed = false;
+        return;
+    }
+    if(!strcmp(pcLine, "T"))
+    {
+        StatsReply(iClient);
+        return;
+    }
+    if(strncmp(pcLine, "C ", 2) != 0)
+    {
+        ClientPrintf(iClient, "X - unknown request\n");
+        return;
+    }
+
+    pcId = pcLine + 2;
+    pcCmd = strchr(pcId, ' ');
+    iIdLen = pcCmd ? (pcCmd - pcId) : (int)strlen(pcId);
+    if((iIdLen == 0) || (iIdLen > GATEWAY_ID_MAX))
+    {
+        ClientPrintf(iClient, "X - bad id\n");
+        return;
+    }
+    if(!pcCmd || (pcCmd[1] == 0))
+    {
+        ClientPrintf(iClient, "X %.*s empty command\n", iIdLen, pcId);
+        return;
+    }
+    pcCmd++;
+    if(strlen(pcCmd) > GATEWAY_CMD_MAX)
+    {
+        ClientPrintf(iClient, "X %.*s command too long\n", iIdLen, pcId);
+        return;
+    }
+    if(psClient->iQueueCount == GATEWAY_QUEUE_MAX)
+    {
+        ClientPrintf(iClient, "X %.*s queue full\n", iIdLen, pcId);
+        return;
+    }
+
+    psRequest = &psClient->psQueue[(psClient->iQueueHead +
+                                    psClient->iQueueCount) %
+                                   GATEWAY_QUEUE_MAX];
+    memcpy(psRequest->pcId, pcId, iIdLen);
+    psRequest->pcId[iIdLen] = 0;
+    strcpy(psRequest->pcCmd, pcCmd);
+    psClient->iQueueCount++;
+    g_sStats.ui64Submitted++;
+}
+
+static void
+ClientRead(int iClient)
+{
+    tClient *psClient = &g_psClients[iClient];
+    char *pcEnd;
+    int iLen, iUsed;
+
+    iLen = read(psClient->iFd, psClient->pcIn + psClient->iInLen,
+                sizeof(psClient->pcIn) - psClient->iInLen);
+    if(iLen <= 0)
+    {
+        if((iLen == 0) || ((errno != EAGAIN) && (errno != EINTR)))
+        {
+            ClientClose(iClient);
+        }
+        return;
+    }
+    psClient->iInLen += iLen;
+
+    //
+    // Run every whole line.  A line too long for the buffer is cut off and
+    // run as it is, to be rejected.
+    //
+    iUsed = 0;
+    while((pcEnd = memchr(psClient->pcIn + iUsed, '\n',
+                          psClient->iInLen - iUsed)) != NULL)
+    {
+        *pcEnd = 0;
+        if((pcEnd > psClient->pcIn + iUsed) && (pcEnd[-1] == '\r'))
+        {
+            pcEnd[-1] = 0;
+        }
+        ClientLine(iClient, psClient->pcIn + iUsed);
+        if(psClient->iFd < 0)
+        {
+            return;
+        }
+        iUsed = pcEnd + 1 - psClient->pcIn;
+    }
+    if((iUsed == 0) && (psClient->iInLen == sizeof(psClient->pcIn)))
+    {
+        psClient->pcIn[sizeof(psClient->pcIn) - 1] = 0;
+        ClientLine(iClient, psClient->pcIn);
+        iUsed = psClient->iInLen;
+    }
+    memmove(psClient->pcIn, psClient->pcIn + iUsed, psClient->iInLen - iUsed);
+    psClient->iInLen -= iUsed;
+}
+
+static void
+ClientAccept(void)
+{
+    tClient *psClient;
+    int iFd, i;
+
+    while((iFd = accept4(g_iListen, NULL, NULL, SOCK_NONBLOCK)) >= 0)
+    {
+        for(i = 0; i < GATEWAY_CLIENTS_MAX; i++)
+        {
+            if(g_psClients[i].iFd < 0)
+            {
+                break;
+            }
+        }
+        if(i == GATEWAY_CLIENTS_MAX)
+        {
+            close(iFd);
+            continue;
+        }
+        psClient = &g_psClients[i];
+        psClient->iFd = iFd;
+        psClient->bSubscribed = false;
+        psClient->iInLen = 0;
+        psClient->iQueueHead = 0;
+        psClient->iQueueCount = 0;
+        psClient->iOutLen = 0;
+        EpollSet(iFd, i, EPOLLIN, EPOLL_CTL_ADD);
+    }
+}
+
+//*****************************************************************************
+//
+// The master.
+//
+//*****************************************************************************
+
+static void
+SerialFlush(void)
+{
+    int iSent;
+
+    if(g_iSerialOutLen == 0)
+    {
+        return;
+    }
+    iSent = write(g_iSerial, g_pcSerialOut, g_iSerialOutLen);
+    if(iSent < 0)
+    {
+        if((errno != EAGAIN) && (errno != EINTR))
+        {
+            perror("gateway: serial write");
+            exit(1);
+        }
+        iSent = 0;
+    }
+    g_sStats.ui64BytesTX += iSent;
+    memmove(g_pcSerialOut, g_pcSerialOut + iSent, g_iSerialOutLen - iSent);
+    g_iSerialOutLen -= iSent;
+    EpollSet(g_iSerial, EV_SERIAL,
+             EPOLLIN | (g_iSerialOutLen ? EPOLLOUT : 0), EPOLL_CTL_MOD);
+}
+
+//
+// Send a command to the master if it fits in the window.
+//
+static bool
+SerialSend(int iClient, const char *pcId, const char *pcCmd)
+{
+    tInFlight *psInFlight;
+    int iLen = strlen(pcCmd) + 1;
+
+    if((g_iInFlightCount == GATEWAY_INFLIGHT_MAX) ||
+       (g_iWindowUsed + iLen > GATEWAY_WINDOW))
+    {
+        return(false);
+    }
+    psInFlight = &g_psInFlight[(g_iInFlightHead + g_iInFlightCount) %
+                               GATEWAY_INFLIGHT_MAX];
+    psInFlight->iClient = iClient;
+    psInFlight->ui32Gen = (iClient >= 0) ? g_psClients[iClient].ui32Gen : 0;
+    strcpy(psInFlight->pcId, pcId);
+    psInFlight->iLen = iLen;
+    psInFlight->ui64Sent = NowMillis();
+    g_iInFlightCount++;
+    g_iWindowUsed += iLen;
+
+    memcpy(g_pcSerialOut + g_iSerialOutLen, pcCmd, iLen - 1);
+    g_pcSerialOut[g_iSerialOutLen + iLen - 1] = '\r';
+    g_iSerialOutLen += iLen;
+    return(true);
+}
+
+//
+// Fill the window with queued commands, taking one from each client in
+// turn.
+//
+static void
+SerialPump(void)
+{
+    tClient *psClient;
+    tRequest *psRequest;
+    int i, iIdle = 0;
+
+    while(iIdle < GATEWAY_CLIENTS_MAX)
+    {
+        i = g_iNextClient;
+        g_iNextClient = (g_iNextClient + 1) % GATEWAY_CLIENTS_MAX;
+        psClient = &g_psClients[i];
+        if((psClient->iFd < 0) || (psClient->iQueueCount == 0))
+        {
+            iIdle++;
+            continue;
+        }
+        psRequest = &psClient->psQueue[psClient->iQueueHead];
+        if(!SerialSend(i, psRequest->pcId, psRequest->pcCmd))
+        {
+            //
+            // Let this client go first once there is room.
+            //
+            g_iNextClient = i;
+            break;
+        }
+        psClient->iQueueHead = (psClient->iQueueHead + 1) % GATEWAY_QUEUE_MAX;
+        psClient->iQueueCount--;
+        iIdle = 0;
+    }
+    SerialFlush();
+}
+
+//
+// Return the oldest command in flight if its client is still there to hear
+// about it.
+//
+static tInFlight *
+InFlightOwner(void)
+{
+    tInFlight *psInFlight;
+
+    if(g_iInFlightCount == 0)
+    {
+        return(NULL);
+    }
+    psInFlight = &g_psInFlight[g_iInFlightHead];
+    if((psInFlight->iClient < 0) ||
+       (g_psClients[psInFlight->iClient].iFd < 0) ||
+       (g_psClients[psInFlight->iClient].ui32Gen != psInFlight->ui32Gen))
+    {
+        return(NULL);
+    }
+    return(psInFlight);
+}
+
+static void
+InFlightPop(void)
+{
+    g_iWindowUsed -= g_psInFlight[g_iInFlightHead].iLen;
+    g_iInFlightHead = (g_iInFlightHead + 1) % GATEWAY_INFLIGHT_MAX;
+    g_iInFlightCount--;
+}
+
+static void
+MasterLine(const char *pcLine)
+{
+    tInFlight *psInFlight = InFlightOwner();
+
+    if(psInFlight)
+    {
+        ClientPrintf(psInFlight->iClient, "R %s %s\n", psInFlight->pcId,
+                     pcLine);
+    }
+    if((g_iInFlightCount == 0) || !strncmp(pcLine, "DELIVERY ", 9))
+    {
+        EventPublish(pcLine);
+    }
+}
+
+static void
+MasterPrompt(void)
+{
+    tInFlight *psInFlight = InFlightOwner();
+
+    //
+    // A prompt with nothing in flight follows a reset of the master, or a
+    // command that timed out.
+    //
+    if(g_iInFlightCount == 0)
+    {
+        return;
+    }
+    if(psInFlight)
+    {
+        ClientPrintf(psInFlight->iClient, "D %s\n", psInFlight->pcId);
+        g_sStats.ui64Completed++;
+    }
+    InFlightPop();
+}
+
+//
+// Split the master's output into lines and prompts.  Each line ends in
+// "\r\n"; each prompt is "> " at the start of a line, with no newline.
+//
+static void
+SerialRead(void)
+{
+    char *pcEnd;
+    int iLen, iUsed;
+
+    iLen = read(g_iSerial, g_pcSerialIn + g_iSerialInLen,
+                sizeof(g_pcSerialIn) - g_iSerialInLen);
+    if(iLen <= 0)
+    {
+        if((iLen == 0) || ((errno != EAGAIN) && (errno != EINTR)))
+        {
+            fprintf(stderr, "gateway: serial port closed\n");
+            exit(1);
+        }
+        return;
+    }
+    g_sStats.ui64BytesRX += iLen;
+    g_iSerialInLen += iLen;
+
+    iUsed = 0;
+    while(iUsed < g_iSerialInLen)
+    {
+        if(g_pcSerialIn[iUsed] == '>')
+        {
+            if(iUsed + 1 == g_iSerialInLen)
+            {
+                break;
+            }
+            if(g_pcSerialIn[iUsed + 1] == ' ')
+            {
+                MasterPrompt();
+                iUsed += 2;
+                continue;
+            }
+        }
+        pcEnd = memchr(g_pcSerialIn + iUsed, '\n', g_iSerialInLen - iUsed);
+        if(!pcEnd)
+        {
+            //
+            // Pass on a line too long to hold in pieces.
+            //
+            if((iUsed == 0) && (g_iSerialInLen == sizeof(g_pcSerialIn)))
+            {
+                pcEnd = g_pcSerialIn + g_iSerialInLen - 1;
+            } else {
+                break;
+            }
+        }
+        *pcEnd = 0;
+        if((pcEnd > g_pcSerialIn + iUsed) && (pcEnd[-1] == '\r'))
+        {
+            pcEnd[-1] = 0;
+        }
+        MasterLine(g_pcSerialIn + iUsed);
+        iUsed = pcEnd + 1 - g_pcSerialIn;
+    }
+    memmove(g_pcSerialIn, g_pcSerialIn + iUsed, g_iSerialInLen - iUsed);
+    g_iSerialInLen -= iUsed;
+}
+
+//
+// Fail everything in flight if the oldest command has gone unanswered too
+// long.  Returns the milliseconds until it would, or -1 if nothing is in
+// flight.
+//
+static int
+TimeoutCheck(void)
+{
+    uint64_t ui64Age;
+    tInFlight *psInFlight;
+
+    if(g_iInFlightCount == 0)
+    {
+        return(-1);
+    }
+    ui64Age = NowMillis() - g_psInFlight[g_iInFlightHead].ui64Sent;
+    if(ui64Age < GATEWAY_TIMEOUT_MS)
+    {
+        return(GATEWAY_TIMEOUT_MS - ui64Age);
+    }
+
+    fprintf(stderr, "gateway: master not answering, failing %d commands\n",
+            g_iInFlightCount);
+    while(g_iInFlightCount)
+    {
+        psInFlight = InFlightOwner();
+        if(psInFlight)
+        {
+            ClientPrintf(psInFlight->iClient, "X %s timeout\n",
+                         psInFlight->pcId);
+        }
+        g_sStats.ui64Failed++;
+        InFlightPop();
+    }
+    g_iSerialInLen = 0;
+    return(-1);
+}
+
+static speed_t
+BaudGet(int iBaud)
+{
+    switch(iBaud)
+    {
+        case 9600: return(B9600);
+        case 19200: return(B19200);
+        case 38400: return(B38400);
+        case 57600: return(B57600);
+        case 115200: return(B115200);
+        case 230400: return(B230400);
+        case 460800: return(B460800);
+        case 921600: return(B921600);
+        default: return(0);
+    }
+}
+
+static void
+SerialOpen(const char *pcPath, int iBaud)
+{
+    struct termios sTerm;
+    speed_t sSpeed = BaudGet(iBaud);
+
+    if(!sSpeed)
+    {
+        fprintf(stderr, "gateway: unsupported baud rate %d\n", iBaud);
+        exit(1);
+    }
+    g_iSerial = open(pcPath, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if((g_iSerial < 0) || (tcgetattr(g_iSerial, &sTerm) < 0))
+    {
+        perror(pcPath);
+        exit(1);
+    }
+    cfmakeraw(&sTerm);
+    cfsetispeed(&sTerm, sSpeed);
+    cfsetospeed(&sTerm, sSpeed);
+    sTerm.c_cflag |= CLOCAL | CREAD;
+    if(tcsetattr(g_iSerial, TCSANOW, &sTerm) < 0)
+    {
+        perror(pcPath);
+        exit(1);
+    }
+    tcflush(g_iSerial, TCIOFLUSH);
+}
+
+static void
+ListenOpen(const char *pcPath)
+{
+    struct sockaddr_un sAddr;
+
+    g_iListen = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    memset(&sAddr, 0, sizeof(sAddr));
+    sAddr.sun_family = AF_UNIX;
+    if(strlen(pcPath) >= sizeof(sAddr.sun_path))
+    {
+        fprintf(stderr, "gateway: socket path too long\n");
+        exit(1);
+    }
+    strcpy(sAddr.sun_path, pcPath);
+    unlink(pcPath);
+    if((g_iListen < 0) ||
+       (bind(g_iListen, (struct sockaddr *)&sAddr, sizeof(sAddr)) < 0) ||
+       (listen(g_iListen, 16) < 0))
+    {
+        perror(pcPath);
+        exit(1);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    struct epoll_event psEvents[32];
+    const char *pcSocket = "/tmp/automation.sock";
+    int iBaud = 115200, iTimeout, iCount, iTag, i, iOpt;
+
+    while((iOpt = getopt(argc, argv, "b:s:")) != -1)
+    {
+        switch(iOpt)
+        {
+            case 'b':
+                iBaud = atoi(optarg);
+                break;
+            case 's':
+                pcSocket = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-b baud] [-s socket] device\n",
+                        argv[0]);
+                return(1);
+        }
+    }
+    if(optind != argc - 1)
+    {
+        fprintf(stderr, "usage: %s [-b baud] [-s socket] device\n", argv[0]);
+        return(1);
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    for(i = 0; i < GATEWAY_CLIENTS_MAX; i++)
+    {
+        g_psClients[i].iFd = -1;
+        g_psClients[i].psQueue = malloc(GATEWAY_QUEUE_MAX * sizeof(tRequest));
+        g_psClients[i].pcOut = malloc(GATEWAY_OUT_MAX);
+        if(!g_psClients[i].psQueue || !g_psClients[i].pcOut)
+        {
+            fprintf(stderr, "gateway: out of memory\n");
+            return(1);
+        }
+    }
+
+    g_iEpoll = epoll_create1(0);
+    SerialOpen(argv[optind], iBaud);
+    ListenOpen(pcSocket);
+    EpollSet(g_iSerial, EV_SERIAL, EPOLLIN, EPOLL_CTL_ADD);
+    EpollSet(g_iListen, EV_LISTEN, EPOLLIN, EPOLL_CTL_ADD);
+
+    //
+    // End whatever was half typed at the master, then turn off its echo.
+    //
+    SerialSend(-1, "", "");
+    SerialSend(-1, "", "echo off");
+    SerialFlush();
+    fprintf(stderr, "gateway: serving %s on %s\n", argv[optind], pcSocket);
+
+    while(1)
+    {
+        iTimeout = TimeoutCheck();
+        iCount = epoll_wait(g_iEpoll, psEvents, 32, iTimeout);
+        if((iCount < 0) && (errno != EINTR))
+        {
+            perror("gateway: epoll_wait");
+            return(1);
+        }
+        for(i = 0; i < iCount; i++)
+        {
+            iTag = (int32_t)psEvents[i].data.u64;
+            if(iTag == EV_SERIAL)
+            {
+                if(psEvents[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                {
+                    SerialRead();
+                }
+                if(psEvents[i].events & EPOLLOUT)
+                {
+                    SerialFlush();
+                }
+            } else if(iTag == EV_LISTEN) {
+                ClientAccept();
+            } else if(g_psClients[iTag].iFd >= 0) {
+                if(psEvents[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+                {
+                    ClientRead(iTag);
+                }
+                if((g_psClients[iTag].iFd >= 0) &&
+                   (psEvents[i].events & EPOLLOUT))
+                {
+                    ClientFlush(iTag);
+                }
+            }
+        }
+
+        //
+        // Answers free up the window for more commands; send them, then
+        // pass on everything the master said.
+        //
+        SerialPump();
+        for(i = 0; i < GATEWAY_CLIENTS_MAX; i++)
+        {
+            if(g_psClients[i].iFd >= 0)
+            {
+                ClientFlush(i);
+            }
+        }
+    }
+}
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+#
+# memory.py - Report flash and SRAM use from a Keil link map.
+#
+# Build the target, then run:
+#
+#     host/memory.py
+#     host/memory.py -m Node_LED/rvmdk/Node_LED.map
+#
+# Prints each load and execution region of the scatter file with its size,
+# its limit and how full it is, the functions placed in RW_IRAM_HOT by
+# RAMFUNC (see utilities/ramfunc.h), and the objects taking the most flash
+# and SRAM.  Exits with status 1 if a region is fuller than --warn percent,
+# so it can follow a build.
+#
+# Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+#
+
+import argparse
+import os
+import re
+import sys
+
+DEFAULT_MAP = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..',
+                           'Automation Master', 'rvmdk',
+                           'automation_master.map')
+
+HOT_REGION = 'RW_IRAM_HOT'
+
+#
+# A region heading, in either of the forms armlink writes:
+#
+#     Load Region LR_IROM (Base: 0x00000000, Size: 0x00004f2c, Max: 0x00040000, ABSOLUTE)
+#     Execution Region RW_IRAM_HOT (Exec base: 0x20000000, Load base: 0x00004d60, Size: 0x000001c8, Max: 0x00001000, ABSOLUTE)
+#
+REGION = re.compile(r'^\s*(Load|Execution) Region (\S+) \((?:Exec base|Base): '
+                    r'0x([0-9a-fA-F]+),.*?Size: 0x([0-9a-fA-F]+), '
+                    r'Max: 0x([0-9a-fA-F]+)')
+
+#
+# A code symbol in the map's image symbol table, as in profile.py.
+#
+SYMBOL = re.compile(r'^\s*(\S+)\s+0x([0-9a-fA-F]+)\s+(?:Thumb|ARM) Code\s+'
+                    r'(\d+)\s+(\S+?)(?:\(.*\))?\s*$')
+
+#
+# A row of the image component sizes table:
+#
+#     Code (inc. data)   RO Data    RW Data    ZI Data      Debug   Object Name
+#      1284        112         24         40       2048      18244   poll.o
+#
+COMPONENT = re.compile(r'^\s*(\d+)\s+(\d+)\s+(\d+)\s+(\d+)\s+(\d+)\s+(\d+)\s+'
+                       r'(\S+\.o)\s*$')
+
+
+def read_map(path):
+    """Return (regions, symbols, objects) from a map file.  Regions are
+    (kind, name, base, size, max) in map order, symbols (address, size,
+    name, object) and objects (name, code, ro, rw, zi)."""
+    regions = []
+    symbols = {}
+    objects = []
+    in_components = False
+    with open(path) as mapfile:
+        for line in mapfile:
+            match = REGION.match(line)
+            if match:
+                kind, name, base, size, limit = match.groups()
+                regions.append((kind, name, int(base, 16), int(size, 16),
+                                int(limit, 16)))
+                continue
+            match = SYMBOL.match(line)
+            if match:
+                name, value, size, obj = match.groups()
+                start = int(value, 16) & ~1
+                if int(size) or start not in symbols:
+                    symbols[start] = (start, int(size), name, obj)
+                continue
+            if 'Image component sizes' in line:
+                in_components = True
+            elif in_components and 'Object Totals' in line:
+                in_components = False
+            elif in_components:
+                match = COMPONENT.match(line)
+                if match:
+                    code, _, ro, rw, zi, _, name = match.groups()
+                    objects.append((name, int(code), int(ro), int(rw),
+                                    int(zi)))
+    return regions, sorted(symbols.values()), objects
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Report flash and SRAM use from a Keil link map.')
+    parser.add_argument('-m', '--map', default=DEFAULT_MAP,
+                        help='link map (default: the master\'s)')
+    parser.add_argument('-n', '--top', type=int, default=10,
+                        help='objects to list (default: %(default)s)')
+    parser.add_argument('-w', '--warn', type=float, default=90,
+                        help='percent full to fail at (default: %(default)s)')
+    args = parser.parse_args()
+
+    try:
+        regions, symbols, objects = read_map(args.map)
+    except OSError as err:
+        sys.exit('memory: %s' % err)
+    if not regions:
+        sys.exit('memory: no regions in %s' % args.map)
+
+    full = []
+    print('%-9s %-12s %10s %8s %8s %6s' % ('region', 'name', 'base', 'used',
+                                           'max', 'full'))
+    for kind, name, base, size, limit in regions:
+        percent = 100.0 * size / limit if limit else 0
+        print('%-9s %-12s 0x%08x %8d %8d %5.1f%%' %
+              (kind.lower(), name, base, size, limit, percent))
+        if percent > args.warn:
+            full.append(name)
+
+    hot = [r for r in regions if r[0] == 'Execution' and r[1] == HOT_REGION]
+    if hot:
+        _, _, base, size, _ = hot[0]
+        print()
+        print('%s functions' % HOT_REGION)
+        for start, length, name, obj in symbols:
+            if base <= start < base + size:
+                print('  0x%08x %6d  %-28s %s' % (start, length, name, obj))
+
+    if objects:
+        print()
+        print('%-24s %8s %8s %8s %8s %8s' % ('object', 'code', 'ro', 'rw',
+                                             'zi', 'sram'))
+        objects.sort(key=lambda o: o[1] + o[2] + o[3] + o[4], reverse=True)
+        for name, code, ro, rw, zi in objects[:args.top]:
+            print('%-24s %8d %8d %8d %8d %8d' % (name, code, ro, rw, zi,
+                                                 rw + zi))
+
+    if full:
+        print()
+        print('over %g%% full: %s' % (args.warn, ', '.join(full)))
+        sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+#
+# profile.py - Map a profile dump from the master's console to functions.
+#
+# Run "profile start", let the master work, then capture the console output
+# of "profile dump" to a file and run:
+#
+#     host/profile.py console.log
+#
+# Sampled addresses are looked up in the map file the Keil target writes to
+# "Automation Master/rvmdk/automation_master.map", so use the map from the
+# build that is running.  Prints the share of samples in each function, or
+# in each object file with --objects, and the hottest addresses with
+# --addresses.
+#
+# Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+#
+
+import argparse
+import bisect
+import os
+import re
+import sys
+from collections import Counter
+
+DEFAULT_MAP = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..',
+                           'Automation Master', 'rvmdk',
+                           'automation_master.map')
+
+#
+# Regions with no symbols in the map.  MAP_ calls into driverlib run from
+# the ROM.
+#
+REGIONS = [
+    (0x01000000, 0x01010000, '[driverlib ROM]'),
+    (0x20000000, 0x20040000, '[SRAM]'),
+]
+
+#
+# A code symbol in the map's image symbol table, for example:
+#
+#     PollHandle    0x00001e35   Thumb Code   420  poll.o(.text)
+#
+SYMBOL = re.compile(r'^\s*(\S+)\s+0x([0-9a-fA-F]+)\s+(?:Thumb|ARM) Code\s+'
+                    r'(\d+)\s+(\S+?)(?:\(.*\))?\s*$')
+
+
+def read_map(path):
+    """Return code symbols as a sorted list of (start, end, name, object)."""
+    symbols = {}
+    with open(path) as mapfile:
+        for line in mapfile:
+            match = SYMBOL.match(line)
+            if not match:
+                continue
+            name, value, size, obj = match.groups()
+            start = int(value, 16) & ~1
+            size = int(size)
+            #
+            # Keep the sized entry where a symbol is listed twice.
+            #
+            if size or start not in symbols:
+                symbols[start] = (start, start + size, name, obj)
+    return sorted(symbols.values())
+
+
+def read_dump(lines):
+    """Return (rate Hz, samples, dropped, {address: count}) from the last
+    complete dump found."""
+    dump = None
+    result = None
+    for line in lines:
+        line = line.strip()
+        if line.startswith('PROFILE END'):
+            if dump is not None:
+                result = dump
+        elif line.startswith('PROFILE '):
+            fields = line.split()
+            if int(fields[1]) != 1:
+                raise ValueError('unknown dump version %s' % fields[1])
+            dump = (int(fields[2]), int(fields[3]), int(fields[4]), {})
+        elif line.startswith('P ') and dump is not None:
+            for entry in line[2:].split():
+                address, count = entry.split(':')
+                dump[3][int(address, 16)] = int(count, 16)
+    if result is None:
+        raise ValueError('no complete PROFILE dump found')
+    return result
+
+
+def lookup(symbols, starts, address):
+    """Return (function, object, offset) for an address."""
+    for low, high, name in REGIONS:
+        if low <= address < high:
+            return name, '', address - low
+    i = bisect.bisect_right(starts, address) - 1
+    if i < 0:
+        return '[unknown]', '', address
+    start, end, name, obj = symbols[i]
+    if address >= end:
+        #
+        # Past the end of the nearest symbol: a literal pool, padding or
+        # code the map does not size.
+        #
+        name = '~' + name
+    return name, obj, address - start
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Map a profile dump from the master\'s console to '
+                    'functions.')
+    parser.add_argument('log', nargs='?', type=argparse.FileType('r'),
+                        default=sys.stdin,
+                        help='console capture (default: stdin)')
+    parser.add_argument('-m', '--map', default=DEFAULT_MAP,
+                        help='linker map file (default: %(default)s)')
+    parser.add_argument('-o', '--objects', action='store_true',
+                        help='total by object file instead of function')
+    parser.add_argument('-a', '--addresses', type=int, default=0,
+                        metavar='N', help='also list the N hottest addresses')
+    parser.add_argument('-n', '--top', type=int, default=30,
+                        help='rows to print (default: 30, 0 for all)')
+    args = parser.parse_args()
+
+    try:
+        rate, samples, dropped, counts = read_dump(args.log)
+    except ValueError as err:
+        sys.exit('profile: %s' % err)
+    try:
+        symbols = read_map(args.map)
+    except OSError as err:
+        sys.exit('profile: %s' % err)
+    if not symbols:
+        sys.exit('profile: no code symbols in %s' % args.map)
+    starts = [symbol[0] for symbol in symbols]
+
+    kept = sum(counts.values())
+    if not kept:
+        sys.exit('profile: no samples')
+
+    totals = Counter()
+    where = {}
+    for address, count in counts.items():
+        name, obj, offset = lookup(symbols, starts, address)
+        totals[obj if args.objects else name] += count
+        where[address] = (name, offset)
+
+    print('%d samples at %d Hz, %.2f s' % (samples, rate, samples / rate))
+    if dropped:
+        print('%d samples (%.1f%%) found the table full and were dropped' %
+              (dropped, 100.0 * dropped / samples))
+    print()
+
+    rows = totals.most_common(args.top or None)
+    print('%8s %7s %7s  %s' % ('samples', '%', 'cum %', 'object' if
+                                args.objects else 'function'))
+    cumulative = 0
+    for key, count in rows:
+        cumulative += count
+        print('%8d %6.2f%% %6.2f%%  %s' % (count, 100.0 * count / kept,
+                                          100.0 * cumulative / kept,
+                                          key or '-'))
+
+    if args.addresses:
+        print()
+        print('%8s %7s  %-10s  %s' % ('samples', '%', 'address', 'location'))
+        for address, count in sorted(counts.items(), key=lambda item: -item[1])[
+                :args.addresses]:
+            name, offset = where[address]
+            print('%8d %6.2f%%  0x%08x  %s+0x%x' %
+                  (count, 100.0 * count / kept, address, name, offset))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,106 @@
+//*****************************************************************************
+//
+// provision.c - Write the keys a node needs into its EEPROM.
+//
+// Nodes do not carry the network key; only the master does.  Each node
+// holds its own link key and the broadcast key, both derived from the
+// network key, in EEPROM.  This tool derives them for one node ID and
+// writes a uVision debugger script that programs them through the EEPROM
+// registers:
+//
+//     host/provision/provision 3 > node3.ini
+//
+// then, with the node's board connected and its user register 0 set to the
+// same ID, start a debug session and run "INCLUDE node3.ini" in the command
+// window.  A node refuses to start until it has been provisioned for the ID
+// in its user register.
+//
+// The counter epochs in EEPROM are left as they are, so a node provisioned
+// again never reuses a nonce.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "utilities/secure.h"
+#include "utilities/netkey.h"
+#include "utilities/broadcast.h"
+
+//
+// TM4C123 EEPROM and clock gating registers.  EEPROM words are addressed
+// as a block of 16 words and an offset into it.
+//
+#define PROV_RCGCEEPROM         0x400FE658
+#define PROV_PREEPROM           0x400FEA58
+#define PROV_EEBLOCK            0x400AF004
+#define PROV_EEOFFSET           0x400AF008
+#define PROV_EERDWR             0x400AF010
+#define PROV_EEDONE             0x400AF018
+
+//
+// Print the script lines that program 4-byte aligned EEPROM at ui32Addr
+// with iLen bytes from pui8Data, a little-endian word at a time.
+//
+static void
+ProvisionWrite(uint32_t ui32Addr, const uint8_t *pui8Data, int iLen)
+{
+    int i;
+
+    for(i = 0; i < iLen; i += 4)
+    {
+        printf("  EEWrite(0x%03X, 0x%02X%02X%02X%02X);\n", ui32Addr + i,
+               pui8Data[i + 3], pui8Data[i + 2], pui8Data[i + 1],
+               pui8Data[i]);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    static const uint8_t pui8NetKey[16] = NETWORK_KEY;
+    uint8_t pui8Key[16], pui8ID[4] = {0};
+    unsigned long ulID;
+    char *pcEnd;
+
+    ulID = (argc == 2) ? strtoul(argv[1], &pcEnd, 0) : 0;
+    if((argc != 2) || (*pcEnd != '\0') || (ulID >= BROADCAST_ID))
+    {
+        fprintf(stderr, "usage: %s id > node.ini, with id below %d\n",
+                argv[0], BROADCAST_ID);
+        return(2);
+    }
+    pui8ID[0] = ulID;
+
+    SecureInit();
+
+    printf("// Keys for node %lu, generated by host/provision.\n", ulID);
+    printf("FUNC void EEWait (void) {\n"
+           "  while (_RDWORD(0x%08X) & 1) { }\n"
+           "}\n", PROV_EEDONE);
+    printf("FUNC void EEWrite (unsigned long addr, unsigned long data) {\n"
+           "  _WDWORD(0x%08X, addr >> 6);\n"
+           "  _WDWORD(0x%08X, (addr >> 2) & 0xF);\n"
+           "  _WDWORD(0x%08X, data);\n"
+           "  EEWait();\n"
+           "}\n", PROV_EEBLOCK, PROV_EEOFFSET, PROV_EERDWR);
+    printf("FUNC void Provision (void) {\n"
+           "  _WDWORD(0x%08X, 1);\n"
+           "  while ((_RDWORD(0x%08X) & 1) == 0) { }\n"
+           "  EEWait();\n", PROV_RCGCEEPROM, PROV_PREEPROM);
+
+    SecureKeyDerive(pui8NetKey, ulID, pui8Key);
+    ProvisionWrite(SECURE_EE_KEY, pui8Key, 16);
+    ProvisionWrite(SECURE_EE_KEY_ID, pui8ID, 4);
+    SecureKeyDerive(pui8NetKey, BROADCAST_ID, pui8Key);
+    ProvisionWrite(SECURE_EE_BCAST_KEY, pui8Key, 16);
+    printf("  printf(\"Node %lu provisioned\\n\");\n"
+           "}\n"
+           "Provision();\n", ulID);
+
+    return(0);
+}
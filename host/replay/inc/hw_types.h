@@ -0,0 +1,20 @@
+//*****************************************************************************
+//
+// hw_types.h - Stand-in for TivaWare's hw_types.h in the replay build.
+//
+// The master's radio code reads the DWT cycle counter through HWREG() to
+// time its crypto.  There is no counter on the host, so every register
+// reads as one variable, which replay.c leaves at zero.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __HW_TYPES_H__
+#define __HW_TYPES_H__
+
+extern volatile uint32_t g_ui32ReplayCycles;
+
+#define HWREG(x)                g_ui32ReplayCycles
+
+#endif
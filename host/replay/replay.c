@@ -0,0 +1,722 @@
+//*****************************************************************************
+//
+// replay.c - Replay radio traffic captured on the master through its poll
+// handling code.
+//
+// Capture traffic with the master's "capture on" and "capture off" commands,
+// log the console to a file and run:
+//
+//     host/replay/replay [-v] console.log
+//
+// Each captured command is queued as the console would have queued it, and
+// each captured poll is handed to PollHandle() from the master's poll.c at
+// the time it arrived.  A simulated radio stands in for the nRF24L01: it
+// keeps the ACK payload FIFO and gives its oldest payload to each poll, as
+// the radio does.  What the master staged is then checked from the node
+// side to report throughput, queueing delay and per-node command latency,
+// so a change to the poll handling can be compared against the same traffic
+// before it goes on the target.
+//
+// The master has CHANNEL_RADIOS radios, each with its own ACK FIFO and its
+// share of the nodes, and the report adds up the airtime each spends on
+// polls and their ACKs at 2 Mbps.  Build with "make RADIOS=1" to compare the
+// same traffic on one radio.
+//
+// Commands the master pushed to a node are counted but not replayed; the
+// push path drives the radio directly and is not part of poll.c.  Captured
+// commands keep their sequence numbers, so a node's echo in a captured poll
+// confirms the command if the replay delivered it no later than the master
+// did; one delivered later is sent again until it gives up.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "utilities/nRF24L01.h"
+#include "utilities/secure.h"
+#include "utilities/netkey.h"
+#include "utilities/timesync.h"
+#include "utilities/tdma.h"
+#include "utilities/relay.h"
+#include "utilities/deliver.h"
+#include "utilities/channel.h"
+
+#include "capture.h"
+#include "console.h"
+#include "events.h"
+#include "latency.h"
+#include "poll.h"
+#include "route.h"
+#include "schedule.h"
+
+//
+// Longest console line read from the log.
+//
+#define REPLAY_LINE_MAX         256
+
+//
+// Interval between the master's SysTick events, in microseconds.
+//
+#define REPLAY_TICK_US          (1000000 / SYSTICK_HZ)
+
+//
+// Time on air of a packet with a len byte payload at 2 Mbps: preamble, 5
+// byte address, 9 bit packet control field and 2 byte CRC around it.  The
+// radio takes 130 us to turn round from receiving the poll to sending the
+// ACK.
+//
+#define REPLAY_AIR_US(len)      ((8 * (1 + 5 + (len) + 2) + 9) / 2.0)
+#define REPLAY_TURNAROUND_US    130
+
+//
+// A payload in the simulated ACK FIFO.
+//
+typedef struct
+{
+    int iLen;
+
+    uint8_t pui8Frame[SECURE_MAX_FRAME];
+
+    //
+    // Time it was staged, and whether it carries a command rather than a
+    // time message or slot assignment.
+    //
+    uint32_t ui32Staged;
+
+    bool bCommand;
+}
+tSimAck;
+
+//
+// What happened to one node's traffic.
+//
+typedef struct
+{
+    uint32_t ui32Polls;
+
+    uint32_t ui32Commands;
+
+    uint32_t ui32Pushed;
+
+    //
+    // Commands overwritten by a newer one before they were staged.
+    //
+    uint32_t ui32Replaced;
+
+    uint32_t ui32Delivered;
+
+    //
+    // Payloads staged for this node that another node's poll took.
+    //
+    uint32_t ui32Misdirected;
+
+    uint32_t ui32CapturedAcks;
+
+    uint32_t ui32ReplayedAcks;
+
+    //
+    // Command timing: entered to staged, staged to taken by the node's
+    // poll, and the two together.
+    //
+    uint64_t ui64Queued;
+
+    uint64_t ui64Staged;
+
+    uint64_t ui64Latency;
+
+    uint32_t ui32MaxLatency;
+
+    //
+    // Network time the pending command was entered.
+    //
+    bool bPending;
+
+    uint32_t ui32Issued;
+}
+tNodeStats;
+
+//
+// One radio of the master: its ACK payload FIFO and what it spent on air.
+//
+typedef struct
+{
+    tSimAck psFIFO[ACK_FIFO_DEPTH];
+
+    int iHead;
+
+    int iCount;
+
+    uint32_t ui32Polls;
+
+    double dAirUs;
+}
+tSimRadio;
+
+bool g_bVerbose;
+
+volatile uint32_t g_ui32ReplayCycles;
+
+//
+// The simulated radios, the one the poll being read came in on, and the
+// poll.
+//
+static tSimRadio g_psSimRadios[CHANNEL_RADIOS];
+static tSimRadio *g_psSimRadio = &g_psSimRadios[0];
+
+static uint8_t g_pui8SimPoll[SECURE_MAX_FRAME + 1];
+static int g_iSimPollLen;
+
+//
+// Time of the record being replayed.
+//
+static uint32_t g_ui32Now;
+
+//
+// Receiving side of each node's link, used to check what the master sent.
+//
+static tSecureLink g_psNodeLinks[NUM_SLAVES];
+
+static tNodeStats g_psStats[NUM_SLAVES];
+
+static bool g_bConsoleQuiet = true;
+
+//*****************************************************************************
+//
+// Stand-ins for the nRF24L01 driver calls that poll.c makes.
+//
+//*****************************************************************************
+uint32_t
+nRFGetPayloadWidth(void)
+{
+    return(g_iSimPollLen);
+}
+
+void
+nRFDataGet(uint8_t *pui8Data, int iLen)
+{
+    memcpy(pui8Data, g_pui8SimPoll, iLen);
+}
+
+//
+// Return true if a staged frame carries a command.  The check opens it with
+// a copy of the node's link, so the frame's counter is not used up.
+//
+static bool
+SimIsCommand(const uint8_t *pui8Frame, int iLen)
+{
+    tSecureLink sLink;
+    uint8_t pui8Plain[SECURE_MAX_PAYLOAD];
+    int iSlave = pui8Frame[0];
+
+    if(iSlave >= NUM_SLAVES)
+    {
+        return(false);
+    }
+    sLink = g_psNodeLinks[iSlave];
+    iLen = SecureOpen(&sLink, SECURE_DIR_DOWN, pui8Frame, iLen, pui8Plain);
+    return((iLen > 0) && (pui8Plain[0] == DELIVER_MSG_CMD));
+}
+
+void
+nRFDataPutAck(int iPipe, uint8_t *pui8Data, int iLen)
+{
+    tSimRadio *psRadio = g_psSimRadio;
+    tSimAck *psAck;
+
+    //
+    // The radio drops payloads written to a full FIFO.
+    //
+    if(psRadio->iCount == ACK_FIFO_DEPTH)
+    {
+        return;
+    }
+    psAck = &psRadio->psFIFO[(psRadio->iHead + psRadio->iCount) %
+                             ACK_FIFO_DEPTH];
+    psRadio->iCount++;
+
+    psAck->iLen = iLen;
+    memcpy(psAck->pui8Frame, pui8Data, iLen);
+    psAck->ui32Staged = g_ui32Now;
+    psAck->bCommand = SimIsCommand(pui8Data, iLen);
+    if(pui8Data[0] < NUM_SLAVES)
+    {
+        g_psStats[pui8Data[0]].ui32ReplayedAcks++;
+    }
+}
+
+void
+nRFFlushTX(void)
+{
+    g_psSimRadio->iCount = 0;
+}
+
+void
+nRFFlushRX(void)
+{
+}
+
+//*****************************************************************************
+//
+// Console and capture stand-ins.  The master's own report functions print
+// through ConsolePrintf(), so its output is kept for the summary and, with
+// -v, shown while replaying.
+//
+//*****************************************************************************
+void
+ConsolePrintf(const char *pcString, ...)
+{
+    va_list vaArgP;
+
+    if(g_bConsoleQuiet)
+    {
+        return;
+    }
+    va_start(vaArgP, pcString);
+    vprintf(pcString, vaArgP);
+    va_end(vaArgP);
+}
+
+int
+ConsoleTxFree(void)
+{
+    return(CONSOLE_LINE_LEN);
+}
+
+void
+CapturePoll(uint32_t ui32Arrival, bool bTimed, const uint8_t *pui8Frame,
+            int iLen)
+{
+}
+
+void
+CaptureAck(int iSlave, const uint8_t *pui8Frame, int iLen)
+{
+}
+
+void
+CaptureCommand(int iSlave, const tAutoCmd *psCmd, bool bPushed)
+{
+}
+
+//*****************************************************************************
+//
+// Replay.
+//
+//*****************************************************************************
+
+//
+// The radio sends the oldest staged payload with the ACK to a poll of
+// iPollLen bytes from iPoller.  Check it from the node side as the node
+// would.  Returns true if there was one, as the radio raises TX_DS.
+//
+static bool
+SimDeliver(int iPoller, int iPollLen)
+{
+    tSimRadio *psRadio = g_psSimRadio;
+    tSimAck *psAck;
+    tNodeStats *psStats;
+    uint8_t pui8Plain[SECURE_MAX_PAYLOAD];
+    uint32_t ui32Latency;
+    int iOwner;
+
+    psRadio->ui32Polls++;
+    psRadio->dAirUs += REPLAY_AIR_US(iPollLen) + REPLAY_TURNAROUND_US;
+    if(psRadio->iCount == 0)
+    {
+        psRadio->dAirUs += REPLAY_AIR_US(0);
+        return(false);
+    }
+    psAck = &psRadio->psFIFO[psRadio->iHead];
+    psRadio->iHead = (psRadio->iHead + 1) % ACK_FIFO_DEPTH;
+    psRadio->iCount--;
+    psRadio->dAirUs += REPLAY_AIR_US(psAck->iLen);
+
+    iOwner = psAck->pui8Frame[0];
+    if(iOwner >= NUM_SLAVES)
+    {
+        return(true);
+    }
+    psStats = &g_psStats[iOwner];
+    if(iOwner != iPoller)
+    {
+        psStats->ui32Misdirected++;
+        return(true);
+    }
+
+    if(SecureOpen(&g_psNodeLinks[iOwner], SECURE_DIR_DOWN, psAck->pui8Frame,
+                  psAck->iLen, pui8Plain) < 0)
+    {
+        return(true);
+    }
+    if(psAck->bCommand && psStats->bPending)
+    {
+        ui32Latency = g_ui32Now - psStats->ui32Issued;
+        psStats->ui32Delivered++;
+        psStats->ui64Queued += psAck->ui32Staged - psStats->ui32Issued;
+        psStats->ui64Staged += g_ui32Now - psAck->ui32Staged;
+        psStats->ui64Latency += ui32Latency;
+        if(ui32Latency > psStats->ui32MaxLatency)
+        {
+            psStats->ui32MaxLatency = ui32Latency;
+        }
+        psStats->bPending = false;
+    }
+    return(true);
+}
+
+//
+// Queue a captured command for the next poll from its node.
+//
+static void
+ReplayCommand(uint32_t ui32Time, const uint8_t *pui8Body, int iLen)
+{
+    tAutoCmd *psCmd;
+    tNodeStats *psStats;
+    int iSlave = pui8Body[0];
+
+    if((iSlave >= NUM_SLAVES) || (iLen < 5) ||
+       (iLen - 4 > (int)sizeof(psCmd->pcCmd)))
+    {
+        return;
+    }
+    psStats = &g_psStats[iSlave];
+    if(pui8Body[2] & CAPTURE_CMD_PUSHED)
+    {
+        psStats->ui32Pushed++;
+        return;
+    }
+
+    psCmd = &g_psAckData[iSlave];
+    psStats->ui32Commands++;
+    if(psCmd->ui8Len != 0)
+    {
+        psStats->ui32Replaced++;
+    }
+    psCmd->ui8Class = pui8Body[1];
+    psCmd->ui32Issued = ui32Time;
+    psCmd->ui8Seq = pui8Body[3];
+    psCmd->ui8Len = iLen - 4;
+    memcpy(psCmd->pcCmd, pui8Body + 4, iLen - 4);
+
+    psStats->bPending = true;
+    psStats->ui32Issued = ui32Time;
+}
+
+//
+// Hand a captured poll to the master's poll handler, returning the host
+// time it took in nanoseconds.
+//
+static uint64_t
+ReplayPoll(uint32_t ui32Time, const uint8_t *pui8Body, int iLen)
+{
+    struct timespec sStart, sEnd;
+    const uint8_t *pui8Frame = pui8Body + 1;
+    bool bAckSent;
+    int iPoller;
+
+    iLen--;
+    if((iLen < 1) || (iLen > SECURE_MAX_FRAME + 1))
+    {
+        return(0);
+    }
+    memcpy(g_pui8SimPoll, pui8Frame, iLen);
+    g_iSimPollLen = iLen;
+
+    iPoller = pui8Frame[(pui8Frame[0] & RELAY_FRAME_FLAG) ? 1 : 0] &
+              ~RELAY_FRAME_FLAG;
+    if(iPoller < NUM_SLAVES)
+    {
+        g_psStats[iPoller].ui32Polls++;
+    }
+    g_psSimRadio = &g_psSimRadios[CHANNEL_RADIO(iPoller)];
+    bAckSent = SimDeliver(iPoller, iLen);
+
+    clock_gettime(CLOCK_MONOTONIC, &sStart);
+    PollHandle(CHANNEL_RADIO(iPoller), ui32Time,
+               (pui8Body[0] & CAPTURE_POLL_TIMED) != 0, bAckSent);
+    clock_gettime(CLOCK_MONOTONIC, &sEnd);
+
+    return(((uint64_t)(sEnd.tv_sec - sStart.tv_sec) * 1000000000) +
+           sEnd.tv_nsec - sStart.tv_nsec);
+}
+
+//
+// Convert a line of hex to bytes, returning the count or -1 if it is not
+// valid hex.
+//
+static int
+HexDecode(const char *pcHex, uint8_t *pui8Buf, int iMax)
+{
+    unsigned int uiByte;
+    int iLen = 0;
+
+    while((pcHex[0] != 0) && (pcHex[0] != '\r') && (pcHex[0] != '\n'))
+    {
+        if((iLen == iMax) || (sscanf(pcHex, "%2x", &uiByte) != 1) ||
+           (pcHex[1] == 0))
+        {
+            return(-1);
+        }
+        pui8Buf[iLen++] = uiByte;
+        pcHex += 2;
+    }
+    return(iLen);
+}
+
+static void
+ReportPrint(uint32_t ui32Records, uint32_t ui32Span, uint32_t ui32Polls,
+            uint64_t ui64PollNanos, uint64_t ui64MaxNanos)
+{
+    tNodeStats *psStats;
+    tSimRadio *psRadio;
+    uint32_t ui32Acks = 0, ui32Delivered = 0, ui32Misdirected = 0;
+    double dSeconds = ui32Span / 1e6, dMax, dTotal = 0;
+    int i;
+
+    for(i = 0; i < NUM_SLAVES; i++)
+    {
+        ui32Acks += g_psStats[i].ui32ReplayedAcks;
+        ui32Delivered += g_psStats[i].ui32Delivered;
+        ui32Misdirected += g_psStats[i].ui32Misdirected;
+    }
+
+    printf("%u records over %.3f s\n\n", ui32Records, dSeconds);
+    printf("Throughput: %.1f polls/s, %.1f ACK payloads/s, "
+           "%.2f commands delivered/s\n",
+           dSeconds ? ui32Polls / dSeconds : 0.0,
+           dSeconds ? ui32Acks / dSeconds : 0.0,
+           dSeconds ? ui32Delivered / dSeconds : 0.0);
+    printf("Misdirected payloads: %u\n", ui32Misdirected);
+    printf("Host time per poll: avg %.2f us, max %.2f us\n\n",
+           ui32Polls ? ui64PollNanos / 1000.0 / ui32Polls : 0.0,
+           ui64MaxNanos / 1000.0);
+
+    printf("node  polls  cmds pushed replaced delivered  queued ms  "
+           "staged ms  avg ms  max ms  misdir  acks cap/replay\n");
+    for(i = 0; i < NUM_SLAVES; i++)
+    {
+        psStats = &g_psStats[i];
+        if(!psStats->ui32Polls && !psStats->ui32Commands &&
+           !psStats->ui32Pushed && !psStats->ui32CapturedAcks)
+        {
+            continue;
+        }
+        printf("%4d %6u %5u %6u %8u %9u %10.1f %10.1f %7.1f %7.1f %7u "
+               "%6u/%u\n", i, psStats->ui32Polls, psStats->ui32Commands,
+               psStats->ui32Pushed, psStats->ui32Replaced,
+               psStats->ui32Delivered,
+               psStats->ui32Delivered ?
+               psStats->ui64Queued / 1000.0 / psStats->ui32Delivered : 0.0,
+               psStats->ui32Delivered ?
+               psStats->ui64Staged / 1000.0 / psStats->ui32Delivered : 0.0,
+               psStats->ui32Delivered ?
+               psStats->ui64Latency / 1000.0 / psStats->ui32Delivered : 0.0,
+               psStats->ui32MaxLatency / 1000.0, psStats->ui32Misdirected,
+               psStats->ui32CapturedAcks, psStats->ui32ReplayedAcks);
+    }
+
+    //
+    // Airtime each radio spent on polls and their ACKs, and the polls per
+    // second it could take if it did nothing else.
+    //
+    printf("\nradio channel  polls  air ms  busy %%  us/poll  max polls/s\n");
+    for(i = 0; i < CHANNEL_RADIOS; i++)
+    {
+        psRadio = &g_psSimRadios[i];
+        dMax = psRadio->ui32Polls ? 1e6 * psRadio->ui32Polls / psRadio->dAirUs :
+               0.0;
+        dTotal += dMax;
+        printf("%5d %7d %6u %7.1f %7.2f %8.1f %12.0f\n", i,
+               CHANNEL_RADIO_RF(i), psRadio->ui32Polls, psRadio->dAirUs / 1000,
+               ui32Span ? psRadio->dAirUs * 100 / ui32Span : 0.0,
+               psRadio->ui32Polls ? psRadio->dAirUs / psRadio->ui32Polls : 0.0,
+               dMax);
+    }
+    printf("Most polls/s on %d radio%s: %.0f\n", CHANNEL_RADIOS,
+           (CHANNEL_RADIOS == 1) ? "" : "s", dTotal);
+
+    //
+    // The master's own views of the same run.
+    //
+    g_bConsoleQuiet = false;
+    printf("\nLatency as recorded by the master:\n");
+    LatencyPrint();
+    printf("\nDelivery:\n");
+    DeliveryPrint();
+    printf("\nSchedule:\n");
+    SchedPrint();
+    printf("\nRoutes:\n");
+    RoutePrint();
+}
+
+int
+main(int argc, char **argv)
+{
+    static const uint8_t pui8NetKey[16] = NETWORK_KEY;
+    uint8_t pui8Key[16];
+    uint8_t pui8Record[CAPTURE_RECORD_MAX + 8];
+    char pcLine[REPLAY_LINE_MAX];
+    uint32_t ui32Time, ui32First = 0, ui32NextTick = 0, ui32Records = 0;
+    uint32_t ui32Polls = 0, ui32Lost = 0;
+    uint64_t ui64Nanos, ui64PollNanos = 0, ui64MaxNanos = 0;
+    bool bInCapture = false, bEnded = false;
+    FILE *psLog;
+    int iArg, iLen, i;
+
+    for(iArg = 1; (iArg < argc) && (argv[iArg][0] == '-'); iArg++)
+    {
+        if(strcmp(argv[iArg], "-v") == 0)
+        {
+            g_bVerbose = true;
+            g_bConsoleQuiet = false;
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [-v] [console.log]\n", argv[0]);
+            return(2);
+        }
+    }
+    psLog = (iArg < argc) ? fopen(argv[iArg], "r") : stdin;
+    if(!psLog)
+    {
+        perror(argv[iArg]);
+        return(1);
+    }
+
+    //
+    // Both ends of every link start from epoch 0, as a freshly provisioned
+    // network would.  Polls in the capture carry the nodes' real counters,
+    // which are always above that.
+    //
+    SecureInit();
+    for(i = 0; i < NUM_SLAVES; i++)
+    {
+        SecureKeyDerive(pui8NetKey, i, pui8Key);
+        SecureLinkInit(&g_psLinks[i], i, pui8Key, 0, 0);
+        SecureLinkInit(&g_psNodeLinks[i], i, pui8Key, 0, 0);
+    }
+
+    while(fgets(pcLine, sizeof(pcLine), psLog))
+    {
+        if(strncmp(pcLine, "CAPTURE END", 11) == 0)
+        {
+            bEnded = bInCapture;
+            bInCapture = false;
+            continue;
+        }
+        if(strncmp(pcLine, "CAPTURE ", 8) == 0)
+        {
+            if(atoi(pcLine + 8) != CAPTURE_VERSION)
+            {
+                fprintf(stderr, "replay: unknown capture version %d\n",
+                        atoi(pcLine + 8));
+                return(1);
+            }
+            if(ui32Records)
+            {
+                fprintf(stderr, "replay: replaying the first capture only\n");
+                break;
+            }
+            bInCapture = true;
+            continue;
+        }
+        if(!bInCapture || (strncmp(pcLine, "CAP ", 4) != 0))
+        {
+            continue;
+        }
+
+        iLen = HexDecode(pcLine + 4, pui8Record, sizeof(pui8Record));
+        if((iLen < CAPTURE_HDR_LEN) ||
+           (iLen != CAPTURE_HDR_LEN + pui8Record[1]))
+        {
+            fprintf(stderr, "replay: skipping bad record: %s", pcLine);
+            continue;
+        }
+        memcpy(&ui32Time, pui8Record + 2, 4);
+        iLen -= CAPTURE_HDR_LEN;
+
+        if(ui32Records++ == 0)
+        {
+            ui32First = ui32Time;
+            ui32NextTick = ui32Time;
+        }
+        g_ui32Now = ui32Time;
+
+        //
+        // Run the SysTick work that would have happened in between.
+        //
+        while((int32_t)(ui32Time - ui32NextTick) >= 0)
+        {
+            SchedTick(ui32NextTick);
+            ui32NextTick += REPLAY_TICK_US;
+        }
+
+        switch(pui8Record[0])
+        {
+            case CAPTURE_POLL:
+            {
+                ui64Nanos = ReplayPoll(ui32Time,
+                                       pui8Record + CAPTURE_HDR_LEN, iLen);
+                ui64PollNanos += ui64Nanos;
+                if(ui64Nanos > ui64MaxNanos)
+                {
+                    ui64MaxNanos = ui64Nanos;
+                }
+                ui32Polls++;
+                break;
+            }
+            case CAPTURE_ACK:
+            {
+                if(pui8Record[CAPTURE_HDR_LEN] < NUM_SLAVES)
+                {
+                    g_psStats[pui8Record[CAPTURE_HDR_LEN]].ui32CapturedAcks++;
+                }
+                break;
+            }
+            case CAPTURE_CMD:
+            {
+                ReplayCommand(ui32Time, pui8Record + CAPTURE_HDR_LEN, iLen);
+                break;
+            }
+            case CAPTURE_LOST:
+            {
+                ui32Lost += pui8Record[CAPTURE_HDR_LEN] |
+                            (pui8Record[CAPTURE_HDR_LEN + 1] << 8);
+                break;
+            }
+            default:
+            {
+                break;
+            }
+        }
+    }
+
+    if(!ui32Records)
+    {
+        fprintf(stderr, "replay: no capture found\n");
+        return(1);
+    }
+    if(!bEnded)
+    {
+        fprintf(stderr, "replay: capture is incomplete\n");
+    }
+    if(ui32Lost)
+    {
+        fprintf(stderr, "replay: %u records were lost during the capture; "
+                "results are approximate\n", ui32Lost);
+    }
+
+    g_bConsoleQuiet = true;
+    ReportPrint(ui32Records, g_ui32Now - ui32First, ui32Polls, ui64PollNanos,
+                ui64MaxNanos);
+
+    return(0);
+}
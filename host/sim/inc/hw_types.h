@@ -0,0 +1,20 @@
+//*****************************************************************************
+//
+// hw_types.h - Stand-in for TivaWare's hw_types.h in the simulator build.
+//
+// The master's radio code reads the DWT cycle counter through HWREG() to
+// time its crypto.  The simulator costs crypto from its own figures, so
+// every register reads as one variable, which sim.c leaves at zero.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __HW_TYPES_H__
+#define __HW_TYPES_H__
+
+extern volatile uint32_t g_ui32SimCycles;
+
+#define HWREG(x)                g_ui32SimCycles
+
+#endif
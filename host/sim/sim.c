@@ -0,0 +1,1459 @@
+//*****************************************************************************
+//
+// sim.c - Discrete-event simulation of the polling network at scale.
+//
+// Asks how the poll and ACK payload protocol holds up as nodes are added,
+// before there is hardware for it:
+//
+//     host/sim/sim -n 10,100,500,1000 -r 60 -t 900 -j 8
+//
+// runs each node count for 900 simulated seconds with every node sent a
+// command a minute on average, and prints delivery latency percentiles,
+// the share of transmissions lost to collisions and the master's CPU load
+// for each, with how many nodes had found a slot by the end.
+//
+// Each master is the firmware's own poll handling, built from poll.c,
+// schedule.c and the modules they report to, as host/replay does, on
+// CHANNEL_RADIOS simulated radios.  A radio keeps the nRF24L01's 3 deep RX
+// and TX FIFOs, sends the oldest staged payload with each auto ACK, drops
+// polls while its RX FIFO is full and acknowledges a retransmission of a
+// poll it already has without taking it again.  The master's CPU takes the
+// polls in turn, and a payload it stages is only there for a poll that
+// comes after the work that staged it is done.  That work is costed in
+// target cycles: a fixed amount for the interrupt and service, SPI bytes at
+// 8 MHz, and the CCM seal and open cycles the "crypto" command reports,
+// which -O and -S override.
+//
+// Nodes follow the poll loop of utilities/node.c: free-running polls, each
+// with a follow-up TDMA_JOIN_FOLLOW_US later that the master stages a
+// payload for, until they have a slot and network time, then polls in their
+// slot at the pace commands and idling set, each sealed and carrying slot
+// status, retries, pace and the echo of the last command, and all but
+// follow-ups the clock skew.  Their radios retransmit 3 times 500 us apart
+// and back off as backoff.c does after a poll fails.  Node clocks run up to
+// -p ppm fast or slow and are disciplined by timesync.c from the master's
+// replies.  Packets are on air for their length at 2 Mbps, and any two that
+// overlap on a channel are both lost.  Relaying, pushes, broadcasts and
+// sensor nodes are not modelled.
+//
+// Node IDs are one byte below BROADCAST_ID, so one master takes at most
+// NUM_SLAVES nodes, set with "make NODES=n".  Larger counts are split over
+// as many masters as needed, each on radio channels of its own, so that
+// masters do not interfere.  The firmware keeps its state in globals, so
+// every master runs in a worker process of its own; -j sets how many run at
+// once.  Node counts and command rates given as lists are swept.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "utilities/nRF24L01.h"
+#include "utilities/secure.h"
+#include "utilities/netkey.h"
+#include "utilities/timesync.h"
+#include "utilities/tdma.h"
+#include "utilities/relay.h"
+#include "utilities/broadcast.h"
+#include "utilities/deliver.h"
+#include "utilities/channel.h"
+#include "utilities/backoff.h"
+
+#include "capture.h"
+#include "console.h"
+#include "events.h"
+#include "latency.h"
+#include "poll.h"
+#include "schedule.h"
+
+#if NUM_SLAVES > BROADCAST_ID
+#error "Node IDs must be below BROADCAST_ID"
+#endif
+#if SCHED_MAX_NODES != NUM_SLAVES
+#error "SCHED_MAX_NODES must match NUM_SLAVES"
+#endif
+
+//
+// Interval between the master's SysTick events, in microseconds.
+//
+#define SIM_TICK_US             (1000000 / SYSTICK_HZ)
+
+//
+// Time on air of a packet with a len byte payload at 2 Mbps, rounded up to
+// a microsecond: preamble, 5 byte address, 9 bit packet control field and
+// 2 byte CRC around it.  A receiver takes 130 us to turn round and send
+// the ACK.
+//
+#define SIM_AIR_US(len)         ((8 * (1 + 5 + (len) + 2) + 9 + 1) / 2)
+#define SIM_TURNAROUND_US       130
+
+//
+// The nodes' retransmit setting, as utilities/node.c sets it.
+//
+#define SIM_ARD_US              500
+#define SIM_ARC                 3
+
+//
+// Interval between polls of a node without a slot, as utilities/node.c
+// uses.
+//
+#define SIM_POLL_INTERVAL_US    3750000
+
+//
+// Depth of each radio's RX FIFO.
+//
+#define SIM_RX_DEPTH            3
+
+//
+// Master CPU cost model: the clock, the cycles a poll takes outside SPI
+// transfers and crypto, the SPI bytes RadioService() moves besides those
+// the stand-ins below count, and one SPI byte's cycles at 8 MHz.
+//
+#define SIM_CPU_HZ              120000000
+#define SIM_SERVICE_CYCLES      3000
+#define SIM_SERVICE_SPI_BYTES   4
+#define SIM_SPI_BYTE_CYCLES     (SIM_CPU_HZ / 1000000)
+
+//
+// Default cycles for one CCM seal or open of a poll-sized frame.
+//
+#define SIM_CRYPTO_CYCLES       15000
+
+//
+// Delivery latency histogram: 10 ms buckets, the last taking the rest.
+//
+#define SIM_HIST_MS             10
+#define SIM_HIST_BUCKETS        12000
+
+//
+// The command sent, an LED on.
+//
+#define SIM_CMD                 0xA1
+
+//
+// Sweep lists and the jobs they make.
+//
+#define SIM_MAX_POINTS          32
+#define SIM_MAX_JOBS            1024
+
+//
+// Event types.
+//
+#define EV_POLL                 0 // Node starts sending a poll
+#define EV_POLL_END             1 // Node's poll leaves the air
+#define EV_ACK                  2 // Master radio starts the ACK to a poll
+#define EV_ACK_END              3 // ACK leaves the air
+#define EV_SERVICE              4 // Master services a radio's RX FIFO
+#define EV_COMMAND              5 // Command entered for a node
+#define EV_TICK                 6 // Master SysTick
+
+typedef struct
+{
+    uint64_t ui64Time;
+
+    //
+    // Order scheduled, so that events at the same time run in that order.
+    //
+    uint32_t ui32Order;
+
+    uint16_t ui16Type;
+
+    uint16_t ui16Index;
+}
+tSimEvent;
+
+//
+// A packet on air, and whether another overlapped it.
+//
+typedef struct
+{
+    uint64_t ui64Start;
+
+    uint64_t ui64End;
+
+    bool bCollided;
+}
+tSimTx;
+
+typedef struct
+{
+    uint8_t ui8ID;
+
+    tSecureLink sLink;
+
+    tTimeSync sSync;
+
+    tBackoff sBackoff;
+
+    uint32_t ui32BackoffUs;
+
+    //
+    // Slot assignment, as SlotAssign() takes it.
+    //
+    uint8_t ui8Slot;
+
+    uint8_t ui8Slots;
+
+    uint8_t ui8PeriodLog2;
+
+    //
+    // Pace, and polls made at it without a command, as PaceSet() keeps
+    // them.
+    //
+    uint8_t ui8Pace;
+
+    uint8_t ui8IdlePolls;
+
+    //
+    // Retransmissions the last poll took, reported in the next, and the
+    // command sequence number to echo.
+    //
+    uint8_t ui8Retries;
+
+    bool bEchoDue;
+
+    uint8_t ui8CmdSeq;
+
+    //
+    // Local clock: offset and rate against simulation time.
+    //
+    double dOffset;
+
+    double dRate;
+
+    uint32_t ui32LastPoll;
+
+    //
+    // The last poll asked for a follow-up, as g_bFollowDue.
+    //
+    bool bFollowDue;
+
+    //
+    // The poll in flight: its frame, the echo it carries, the attempt
+    // under way, whether the master has it and the ACK payload it returns.
+    //
+    uint8_t pui8Frame[SECURE_MAX_FRAME];
+
+    int iLen;
+
+    bool bEcho;
+
+    uint8_t ui8Echo;
+
+    int iAttempt;
+
+    bool bTaken;
+
+    uint8_t pui8Ack[SECURE_MAX_FRAME];
+
+    int iAckLen;
+
+    tSimTx sPollTx;
+
+    tSimTx sAckTx;
+
+    //
+    // Simulation time each outstanding command was entered, by sequence
+    // number, or 0.
+    //
+    uint64_t pui64Issued[256];
+}
+tSimNode;
+
+//
+// A payload in a radio's TX FIFO, and the time the master finished staging
+// it.
+//
+typedef struct
+{
+    uint8_t pui8Frame[SECURE_MAX_FRAME];
+
+    int iLen;
+
+    uint64_t ui64Ready;
+}
+tSimAck;
+
+//
+// A poll in a radio's RX FIFO, with the time the IRQ was raised for it and
+// whether its ACK carried a payload.
+//
+typedef struct
+{
+    uint8_t pui8Frame[SECURE_MAX_FRAME];
+
+    int iLen;
+
+    uint32_t ui32Arrival;
+
+    bool bAckSent;
+}
+tSimRX;
+
+typedef struct
+{
+    tSimAck psTX[ACK_FIFO_DEPTH];
+
+    int iTXHead;
+
+    int iTXCount;
+
+    tSimRX psRX[SIM_RX_DEPTH];
+
+    int iRXHead;
+
+    int iRXCount;
+
+    bool bServicing;
+
+    //
+    // Packets on air on the radio's channel.
+    //
+    tSimTx *ppsOnAir[NUM_SLAVES * 2];
+
+    int iOnAir;
+}
+tSimRadio;
+
+//
+// What one master and its nodes did after the warm-up.
+//
+typedef struct
+{
+    bool bDone;
+
+    uint32_t ui32Nodes;
+
+    //
+    // Nodes keeping network time in a slot at the end.
+    //
+    uint32_t ui32Slotted;
+
+    uint64_t ui64Exchanges;
+
+    uint64_t ui64Failed;
+
+    uint64_t ui64Packets;
+
+    uint64_t ui64Collided;
+
+    uint64_t ui64RXFull;
+
+    uint64_t ui64Misdirected;
+
+    uint64_t ui64Issued;
+
+    uint64_t ui64Replaced;
+
+    uint64_t ui64Delivered;
+
+    uint64_t ui64Lost;
+
+    //
+    // Master CPU cycles in total and in the busiest second.
+    //
+    uint64_t ui64Busy;
+
+    uint64_t ui64PeakBusy;
+
+    uint32_t pui32Hist[SIM_HIST_BUCKETS];
+}
+tSimResult;
+
+//
+// One master to simulate, and the sweep point it belongs to.
+//
+typedef struct
+{
+    int iPoint;
+
+    uint32_t ui32Nodes;
+
+    uint32_t ui32Seed;
+}
+tSimJob;
+
+//
+// Run settings.
+//
+typedef struct
+{
+    uint64_t ui64Duration;
+
+    uint64_t ui64Warmup;
+
+    uint32_t ui32OpenCycles;
+
+    uint32_t ui32SealCycles;
+
+    double dDriftPPM;
+}
+tSimConfig;
+
+bool g_bVerbose;
+
+volatile uint32_t g_ui32SimCycles;
+
+static tSimConfig g_sConfig;
+
+//
+// State of the master being simulated by this process.
+//
+static tSimNode g_psNodes[NUM_SLAVES];
+static int g_iNodes;
+static tSimRadio g_psRadios[CHANNEL_RADIOS];
+static tSimRadio *g_psSimRadio = &g_psRadios[0];
+static tSimRX *g_psSimPoll;
+static tSimResult *g_psResult;
+static double g_dCommandRate;
+static uint64_t g_ui64Now;
+static uint64_t g_ui64CPUFree;
+static uint64_t g_ui64Second, g_ui64SecondBusy;
+static uint32_t g_ui32SPIBytes;
+static uint64_t g_ui64Random;
+
+static tSimEvent *g_psEvents;
+static int g_iEvents;
+static uint32_t g_ui32Order;
+
+//*****************************************************************************
+//
+// Random numbers and the event queue.
+//
+//*****************************************************************************
+
+//
+// Uniform in (0, 1), from xorshift64*.
+//
+static double
+SimRandom(void)
+{
+    g_ui64Random ^= g_ui64Random >> 12;
+    g_ui64Random ^= g_ui64Random << 25;
+    g_ui64Random ^= g_ui64Random >> 27;
+    return(((g_ui64Random * 2685821657736338717ULL) >> 11) * (1.0 / 9007199254740992.0) +
+           (0.5 / 9007199254740992.0));
+}
+
+static bool
+SimBefore(const tSimEvent *psA, const tSimEvent *psB)
+{
+    return((psA->ui64Time < psB->ui64Time) ||
+           ((psA->ui64Time == psB->ui64Time) &&
+            (psA->ui32Order < psB->ui32Order)));
+}
+
+static void
+SimSchedule(uint64_t ui64Time, int iType, int iIndex)
+{
+    tSimEvent sEvent, sTemp;
+    int i = g_iEvents++;
+
+    sEvent.ui64Time = ui64Time;
+    sEvent.ui32Order = g_ui32Order++;
+    sEvent.ui16Type = iType;
+    sEvent.ui16Index = iIndex;
+    g_psEvents[i] = sEvent;
+    while((i > 0) && SimBefore(&g_psEvents[i], &g_psEvents[(i - 1) / 2]))
+    {
+        sTemp = g_psEvents[i];
+        g_psEvents[i] = g_psEvents[(i - 1) / 2];
+        g_psEvents[(i - 1) / 2] = sTemp;
+        i = (i - 1) / 2;
+    }
+}
+
+static tSimEvent
+SimNext(void)
+{
+    tSimEvent sEvent = g_psEvents[0], sTemp;
+    int i = 0, iChild;
+
+    g_psEvents[0] = g_psEvents[--g_iEvents];
+    while((iChild = 2 * i + 1) < g_iEvents)
+    {
+        if((iChild + 1 < g_iEvents) &&
+           SimBefore(&g_psEvents[iChild + 1], &g_psEvents[iChild]))
+        {
+            iChild++;
+        }
+        if(!SimBefore(&g_psEvents[iChild], &g_psEvents[i]))
+        {
+            break;
+        }
+        sTemp = g_psEvents[i];
+        g_psEvents[i] = g_psEvents[iChild];
+        g_psEvents[iChild] = sTemp;
+        i = iChild;
+    }
+    return(sEvent);
+}
+
+static bool
+SimMeasuring(void)
+{
+    return(g_ui64Now >= g_sConfig.ui64Warmup);
+}
+
+//*****************************************************************************
+//
+// Stand-ins for the nRF24L01 driver calls that poll.c makes, acting on the
+// radio and poll being serviced.
+//
+//*****************************************************************************
+uint32_t
+nRFGetPayloadWidth(void)
+{
+    g_ui32SPIBytes += 2;
+    return(g_psSimPoll->iLen);
+}
+
+void
+nRFDataGet(uint8_t *pui8Data, int iLen)
+{
+    g_ui32SPIBytes += iLen + 1;
+    memcpy(pui8Data, g_psSimPoll->pui8Frame, iLen);
+}
+
+void
+nRFDataPutAck(int iPipe, uint8_t *pui8Data, int iLen)
+{
+    tSimRadio *psRadio = g_psSimRadio;
+    tSimAck *psAck;
+
+    g_ui32SPIBytes += iLen + 1;
+    if(psRadio->iTXCount == ACK_FIFO_DEPTH)
+    {
+        return;
+    }
+    psAck = &psRadio->psTX[(psRadio->iTXHead + psRadio->iTXCount) %
+                           ACK_FIFO_DEPTH];
+    psRadio->iTXCount++;
+    memcpy(psAck->pui8Frame, pui8Data, iLen);
+    psAck->iLen = iLen;
+
+    //
+    // Ready once the service that staged it is over; SimService() fills in
+    // the time.
+    //
+    psAck->ui64Ready = UINT64_MAX;
+}
+
+void
+nRFFlushTX(void)
+{
+    g_ui32SPIBytes++;
+    g_psSimRadio->iTXCount = 0;
+}
+
+void
+nRFFlushRX(void)
+{
+    g_ui32SPIBytes++;
+}
+
+//*****************************************************************************
+//
+// Console and capture stand-ins.  The master reports each command's fate
+// on its console in the form deliver.h gives; failures are counted from
+// there.
+//
+//*****************************************************************************
+void
+ConsolePrintf(const char *pcString, ...)
+{
+    char pcLine[CONSOLE_LINE_LEN];
+    char pcWhat[16];
+    unsigned int uiSeq;
+    va_list vaArgP;
+    int iNode;
+
+    va_start(vaArgP, pcString);
+    vsnprintf(pcLine, sizeof(pcLine), pcString, vaArgP);
+    va_end(vaArgP);
+
+    if((sscanf(pcLine, "DELIVERY %d %u %15s", &iNode, &uiSeq, pcWhat) == 3) &&
+       (strcmp(pcWhat, "failed") == 0) && (iNode < g_iNodes) &&
+       (uiSeq < 256) && g_psNodes[iNode].pui64Issued[uiSeq])
+    {
+        if(g_psNodes[iNode].pui64Issued[uiSeq] >= g_sConfig.ui64Warmup)
+        {
+            g_psResult->ui64Lost++;
+        }
+        g_psNodes[iNode].pui64Issued[uiSeq] = 0;
+    }
+    if(g_bVerbose)
+    {
+        fputs(pcLine, stdout);
+    }
+}
+
+int
+ConsoleTxFree(void)
+{
+    return(CONSOLE_LINE_LEN);
+}
+
+void
+CapturePoll(uint32_t ui32Arrival, bool bTimed, const uint8_t *pui8Frame,
+            int iLen)
+{
+}
+
+void
+CaptureAck(int iSlave, const uint8_t *pui8Frame, int iLen)
+{
+}
+
+void
+CaptureCommand(int iSlave, const tAutoCmd *psCmd, bool bPushed)
+{
+}
+
+//*****************************************************************************
+//
+// The air.
+//
+//*****************************************************************************
+
+//
+// Put a packet on air on a radio's channel for iAirUs, marking it and
+// anything it overlaps as collided.
+//
+static void
+AirStart(tSimRadio *psRadio, tSimTx *psTx, uint32_t ui32AirUs)
+{
+    int i;
+
+    psTx->ui64Start = g_ui64Now;
+    psTx->ui64End = g_ui64Now + ui32AirUs;
+    psTx->bCollided = false;
+    for(i = 0; i < psRadio->iOnAir; i++)
+    {
+        psRadio->ppsOnAir[i]->bCollided = true;
+        psTx->bCollided = true;
+    }
+    psRadio->ppsOnAir[psRadio->iOnAir++] = psTx;
+    if(SimMeasuring())
+    {
+        g_psResult->ui64Packets++;
+    }
+}
+
+//
+// Take a packet off the air, returning true if it got through.
+//
+static bool
+AirEnd(tSimRadio *psRadio, tSimTx *psTx)
+{
+    int i;
+
+    for(i = 0; i < psRadio->iOnAir; i++)
+    {
+        if(psRadio->ppsOnAir[i] == psTx)
+        {
+            psRadio->ppsOnAir[i] = psRadio->ppsOnAir[--psRadio->iOnAir];
+            break;
+        }
+    }
+    if(psTx->bCollided && (psTx->ui64Start >= g_sConfig.ui64Warmup))
+    {
+        g_psResult->ui64Collided++;
+    }
+    return(!psTx->bCollided);
+}
+
+//*****************************************************************************
+//
+// Nodes.
+//
+//*****************************************************************************
+
+static uint32_t
+NodeTime(const tSimNode *psNode)
+{
+    return((uint32_t)(uint64_t)(psNode->dOffset +
+                                (double)g_ui64Now * psNode->dRate));
+}
+
+//
+// Schedule the node's next poll as SlotWait() would time it.
+//
+static void
+NodeNext(tSimNode *psNode)
+{
+    uint32_t ui32Local = NodeTime(psNode);
+    uint32_t ui32Period, ui32Net, ui32Next, ui32Earliest;
+    int32_t i32Wait;
+
+    if(psNode->bFollowDue)
+    {
+        ui32Next = psNode->ui32LastPoll + TDMA_JOIN_FOLLOW_US;
+    }
+    else if((psNode->ui8Slots == 0) || !psNode->sSync.bSynced)
+    {
+        ui32Next = psNode->ui32LastPoll + SIM_POLL_INTERVAL_US +
+                   psNode->ui32BackoffUs;
+    }
+    else
+    {
+        ui32Period = 1 << psNode->ui8PeriodLog2;
+        ui32Earliest = psNode->ui32LastPoll + psNode->ui32BackoffUs +
+                       ((ui32Period << psNode->ui8Pace) - ui32Period);
+        if((int32_t)(ui32Earliest - ui32Local) < 0)
+        {
+            ui32Earliest = ui32Local;
+        }
+        ui32Net = TimeSyncToNetwork(&psNode->sSync, ui32Earliest);
+        ui32Next = (ui32Net & ~(ui32Period - 1)) +
+                   psNode->ui8Slot * (ui32Period / psNode->ui8Slots);
+        while((int32_t)(ui32Next - ui32Net) < TDMA_GUARD_US)
+        {
+            ui32Next += ui32Period;
+        }
+        ui32Next = TimeSyncToLocal(&psNode->sSync, ui32Next);
+    }
+
+    i32Wait = (int32_t)(ui32Next - ui32Local);
+    psNode->iAttempt = 0;
+    SimSchedule(g_ui64Now + ((i32Wait > 0) ? (uint64_t)(i32Wait /
+                                                         psNode->dRate) : 0),
+                EV_POLL, psNode->ui8ID);
+}
+
+//
+// Start sending a poll, sealing a fresh one on the first attempt.
+//
+static void
+NodePoll(tSimNode *psNode)
+{
+    uint8_t pui8Report[TIMESYNC_SKEW_LEN + TDMA_STATUS_LEN + DELIVER_ACK_LEN];
+    bool bFree, bFollowUp;
+    int iLen;
+
+    if(psNode->iAttempt == 0)
+    {
+        psNode->ui32LastPoll = NodeTime(psNode);
+        bFollowUp = psNode->bFollowDue;
+        if(!bFollowUp &&
+           (++psNode->ui8IdlePolls >= TDMA_PACE_IDLE_POLLS) &&
+           (psNode->ui8Pace < TDMA_PACE_MAX))
+        {
+            psNode->ui8Pace++;
+            psNode->ui8IdlePolls = 0;
+        }
+        bFree = (psNode->ui8Slots == 0) || !psNode->sSync.bSynced;
+        psNode->bFollowDue = bFree && !bFollowUp;
+        iLen = bFollowUp ? 0 : TimeSyncSkewEncode(&psNode->sSync, pui8Report);
+        pui8Report[iLen++] = TDMA_MSG_STATUS;
+        pui8Report[iLen++] = psNode->ui8Slot;
+        pui8Report[iLen++] = psNode->ui8Slots;
+        pui8Report[iLen++] = psNode->ui8Retries;
+        pui8Report[iLen++] = (psNode->ui8Pace |
+                              (bFree ? TDMA_STATUS_FREE : 0) |
+                              (psNode->bFollowDue ? TDMA_STATUS_FOLLOW : 0));
+        psNode->bEcho = psNode->bEchoDue;
+        psNode->ui8Echo = psNode->ui8CmdSeq;
+        if(psNode->bEcho)
+        {
+            pui8Report[iLen++] = DELIVER_MSG_ACK;
+            pui8Report[iLen++] = psNode->ui8Echo;
+        }
+        psNode->iLen = SecureSeal(&psNode->sLink, SECURE_DIR_UP, pui8Report,
+                                  iLen, psNode->pui8Frame);
+        TimeSyncPollSent(&psNode->sSync, psNode->sLink.ui32TXCounter & 0xFFFF,
+                         psNode->ui32LastPoll);
+        psNode->bTaken = false;
+        if(SimMeasuring())
+        {
+            g_psResult->ui64Exchanges++;
+        }
+    }
+
+    AirStart(&g_psRadios[CHANNEL_RADIO(psNode->ui8ID)], &psNode->sPollTx,
+             SIM_AIR_US(psNode->iLen));
+    SimSchedule(psNode->sPollTx.ui64End, EV_POLL_END, psNode->ui8ID);
+}
+
+//
+// Take a new pace as PaceSet() does.
+//
+static void
+NodePaceSet(tSimNode *psNode, uint8_t ui8Pace)
+{
+    psNode->ui8Pace = (ui8Pace > TDMA_PACE_MAX) ? TDMA_PACE_MAX : ui8Pace;
+    psNode->ui8IdlePolls = 0;
+}
+
+//
+// Handle an ACK payload as RadioPacketHandle() does.
+//
+static void
+NodePayload(tSimNode *psNode)
+{
+    uint8_t pui8Plain[SECURE_MAX_PAYLOAD];
+    uint8_t *pui8Msg = pui8Plain;
+    uint64_t ui64Issued, ui64Latency;
+    int iLen;
+
+    if(psNode->pui8Ack[0] != psNode->ui8ID)
+    {
+        if(SimMeasuring())
+        {
+            g_psResult->ui64Misdirected++;
+        }
+        return;
+    }
+    iLen = SecureOpen(&psNode->sLink, SECURE_DIR_DOWN, psNode->pui8Ack,
+                      psNode->iAckLen, pui8Plain);
+    if(iLen < 1)
+    {
+        return;
+    }
+
+    if((pui8Msg[0] == TDMA_MSG_PACE) && (iLen >= TDMA_PACE_LEN))
+    {
+        NodePaceSet(psNode, pui8Msg[1]);
+        pui8Msg += TDMA_PACE_LEN;
+        iLen -= TDMA_PACE_LEN;
+        if(iLen == 0)
+        {
+            return;
+        }
+    }
+
+    if((pui8Msg[0] == DELIVER_MSG_CMD) && (iLen > DELIVER_HDR_LEN))
+    {
+        psNode->bEchoDue = true;
+        if(pui8Msg[1] == psNode->ui8CmdSeq)
+        {
+            return;
+        }
+        psNode->ui8CmdSeq = pui8Msg[1];
+        NodePaceSet(psNode, TDMA_PACE_ACTIVE);
+        ui64Issued = psNode->pui64Issued[pui8Msg[1]];
+        if(ui64Issued >= g_sConfig.ui64Warmup)
+        {
+            ui64Latency = (g_ui64Now - ui64Issued) / (1000 * SIM_HIST_MS);
+            g_psResult->ui64Delivered++;
+            g_psResult->pui32Hist[(ui64Latency < SIM_HIST_BUCKETS) ?
+                                  ui64Latency : SIM_HIST_BUCKETS - 1]++;
+        }
+        psNode->pui64Issued[pui8Msg[1]] = 0;
+        pui8Msg += DELIVER_HDR_LEN;
+        iLen -= DELIVER_HDR_LEN;
+    }
+
+    if(pui8Msg[0] == TIMESYNC_MSG_TIME)
+    {
+        TimeSyncUpdate(&psNode->sSync, pui8Msg, iLen);
+    }
+    else if((pui8Msg[0] == TDMA_MSG_ASSIGN) && (iLen >= TDMA_ASSIGN_LEN) &&
+            (pui8Msg[1] < pui8Msg[2]) && (pui8Msg[3] <= 31))
+    {
+        psNode->ui8Slot = pui8Msg[1];
+        psNode->ui8Slots = pui8Msg[2];
+        psNode->ui8PeriodLog2 = pui8Msg[3];
+    }
+}
+
+//
+// The poll went unacknowledged: retransmit, or give up and back off.
+//
+static void
+NodeRetry(tSimNode *psNode)
+{
+    uint64_t ui64Retry = psNode->sPollTx.ui64End + SIM_ARD_US;
+
+    if(psNode->iAttempt < SIM_ARC)
+    {
+        psNode->iAttempt++;
+        SimSchedule((ui64Retry > g_ui64Now) ? ui64Retry : g_ui64Now, EV_POLL,
+                    psNode->ui8ID);
+        return;
+    }
+    psNode->ui8Retries = SIM_ARC;
+    psNode->ui32BackoffUs = BackoffFail(&psNode->sBackoff);
+    psNode->bFollowDue = false;
+    if(SimMeasuring())
+    {
+        g_psResult->ui64Failed++;
+    }
+    NodeNext(psNode);
+}
+
+static void
+NodeAcked(tSimNode *psNode)
+{
+    psNode->ui8Retries = psNode->iAttempt;
+    BackoffReset(&psNode->sBackoff);
+    psNode->ui32BackoffUs = 0;
+    TimeSyncAckReceived(&psNode->sSync, NodeTime(psNode));
+    if(psNode->iAckLen)
+    {
+        NodePayload(psNode);
+    }
+    if(psNode->bEcho && (psNode->ui8CmdSeq == psNode->ui8Echo))
+    {
+        psNode->bEchoDue = false;
+    }
+    NodeNext(psNode);
+}
+
+//*****************************************************************************
+//
+// The master's radios and CPU.
+//
+//*****************************************************************************
+
+//
+// A poll left the air.  If it got through, the master's radio takes it, or
+// just acknowledges it again if it already has it, and raises its IRQ.
+//
+static void
+RadioPollEnd(tSimNode *psNode)
+{
+    tSimRadio *psRadio = &g_psRadios[CHANNEL_RADIO(psNode->ui8ID)];
+    tSimRX *psRX;
+    tSimAck *psAck;
+
+    if(!AirEnd(psRadio, &psNode->sPollTx))
+    {
+        NodeRetry(psNode);
+        return;
+    }
+
+    if(!psNode->bTaken)
+    {
+        if(psRadio->iRXCount == SIM_RX_DEPTH)
+        {
+            if(SimMeasuring())
+            {
+                g_psResult->ui64RXFull++;
+            }
+            NodeRetry(psNode);
+            return;
+        }
+        psRX = &psRadio->psRX[(psRadio->iRXHead + psRadio->iRXCount) %
+                              SIM_RX_DEPTH];
+        psRadio->iRXCount++;
+        memcpy(psRX->pui8Frame, psNode->pui8Frame, psNode->iLen);
+        psRX->iLen = psNode->iLen;
+        psRX->ui32Arrival = (uint32_t)g_ui64Now;
+
+        psNode->iAckLen = 0;
+        psAck = &psRadio->psTX[psRadio->iTXHead];
+        if(psRadio->iTXCount && (psAck->ui64Ready <= g_ui64Now))
+        {
+            memcpy(psNode->pui8Ack, psAck->pui8Frame, psAck->iLen);
+            psNode->iAckLen = psAck->iLen;
+            psRadio->iTXHead = (psRadio->iTXHead + 1) % ACK_FIFO_DEPTH;
+            psRadio->iTXCount--;
+        }
+        psRX->bAckSent = (psNode->iAckLen != 0);
+        psNode->bTaken = true;
+
+        if(!psRadio->bServicing)
+        {
+            psRadio->bServicing = true;
+            SimSchedule(g_ui64Now, EV_SERVICE, psRadio - g_psRadios);
+        }
+    }
+    SimSchedule(g_ui64Now + SIM_TURNAROUND_US, EV_ACK, psNode->ui8ID);
+}
+
+//
+// Run PollHandle() for the oldest poll in a radio's RX FIFO once the CPU is
+// free, and cost the work.
+//
+static void
+RadioService(int iRadio)
+{
+    tSimRadio *psRadio = &g_psRadios[iRadio];
+    uint32_t ui32Opens = g_sOpenCycles.ui32Count;
+    uint32_t ui32Seals = g_sSealCycles.ui32Count;
+    uint64_t ui64Cycles;
+    int i;
+
+    if(g_ui64CPUFree > g_ui64Now)
+    {
+        SimSchedule(g_ui64CPUFree, EV_SERVICE, iRadio);
+        return;
+    }
+    if(psRadio->iRXCount == 0)
+    {
+        psRadio->bServicing = false;
+        return;
+    }
+
+    g_psSimRadio = psRadio;
+    g_psSimPoll = &psRadio->psRX[psRadio->iRXHead];
+    g_ui32SPIBytes = SIM_SERVICE_SPI_BYTES;
+    PollHandle(iRadio, g_psSimPoll->ui32Arrival, true, g_psSimPoll->bAckSent);
+    psRadio->iRXHead = (psRadio->iRXHead + 1) % SIM_RX_DEPTH;
+    psRadio->iRXCount--;
+
+    ui64Cycles = SIM_SERVICE_CYCLES +
+                 ((uint64_t)g_ui32SPIBytes * SIM_SPI_BYTE_CYCLES) +
+                 ((uint64_t)(g_sOpenCycles.ui32Count - ui32Opens) *
+                  g_sConfig.ui32OpenCycles) +
+                 ((uint64_t)(g_sSealCycles.ui32Count - ui32Seals) *
+                  g_sConfig.ui32SealCycles);
+    g_ui64CPUFree = g_ui64Now + ((ui64Cycles * 1000000 + SIM_CPU_HZ - 1) /
+                                 SIM_CPU_HZ);
+    for(i = 0; i < psRadio->iTXCount; i++)
+    {
+        if(psRadio->psTX[(psRadio->iTXHead + i) % ACK_FIFO_DEPTH].ui64Ready ==
+           UINT64_MAX)
+        {
+            psRadio->psTX[(psRadio->iTXHead + i) % ACK_FIFO_DEPTH].ui64Ready =
+                g_ui64CPUFree;
+        }
+    }
+
+    if(SimMeasuring())
+    {
+        g_psResult->ui64Busy += ui64Cycles;
+        if(g_ui64Now / 1000000 != g_ui64Second)
+        {
+            g_ui64Second = g_ui64Now / 1000000;
+            g_ui64SecondBusy = 0;
+        }
+        g_ui64SecondBusy += ui64Cycles;
+        if(g_ui64SecondBusy > g_psResult->ui64PeakBusy)
+        {
+            g_psResult->ui64PeakBusy = g_ui64SecondBusy;
+        }
+    }
+
+    SimSchedule(g_ui64CPUFree, EV_SERVICE, iRadio);
+}
+
+//
+// Queue a command for a node as CommandQueue() does, replacing one still
+// waiting.
+//
+static void
+MasterCommand(tSimNode *psNode)
+{
+    tAutoCmd *psCmd = &g_psAckData[psNode->ui8ID];
+
+    if(psCmd->ui8Len != 0)
+    {
+        if(psNode->pui64Issued[psCmd->ui8Seq] >= g_sConfig.ui64Warmup)
+        {
+            g_psResult->ui64Replaced++;
+        }
+        psNode->pui64Issued[psCmd->ui8Seq] = 0;
+    }
+    psCmd->ui8Class = LATENCY_BULK;
+    psCmd->ui32Issued = (uint32_t)g_ui64Now;
+    psCmd->pcCmd[0] = SIM_CMD;
+    psCmd->ui8Len = 1;
+    psCmd->ui8Seq = DeliverySeqNext(psNode->ui8ID);
+
+    //
+    // Nothing is entered at time 0, so 0 can stand for none.
+    //
+    psNode->pui64Issued[psCmd->ui8Seq] = g_ui64Now;
+    if(SimMeasuring())
+    {
+        g_psResult->ui64Issued++;
+    }
+}
+
+static void
+CommandNext(tSimNode *psNode)
+{
+    if(g_dCommandRate > 0)
+    {
+        SimSchedule(g_ui64Now + 1 +
+                    (uint64_t)(-log(SimRandom()) * 3.6e9 / g_dCommandRate),
+                    EV_COMMAND, psNode->ui8ID);
+    }
+}
+
+//*****************************************************************************
+//
+// Simulate one master and its nodes.
+//
+//*****************************************************************************
+static void
+SimRun(const tSimJob *psJob, double dCommandRate, tSimResult *psResult)
+{
+    static const uint8_t pui8NetKey[16] = NETWORK_KEY;
+    uint8_t pui8Key[16];
+    tSimNode *psNode;
+    tSimEvent sEvent;
+    int i;
+
+    g_psResult = psResult;
+    g_dCommandRate = dCommandRate;
+    g_iNodes = psJob->ui32Nodes;
+    g_ui64Random = ((uint64_t)psJob->ui32Seed << 32) | 0x9E3779B9;
+    g_psEvents = calloc(g_iNodes * 4 + CHANNEL_RADIOS * 2 + 2,
+                        sizeof(tSimEvent));
+    psResult->ui32Nodes = g_iNodes;
+
+    //
+    // Nodes start up at random over one free-running poll interval, with
+    // clocks at random offsets and rates.
+    //
+    SecureInit();
+    for(i = 0; i < g_iNodes; i++)
+    {
+        psNode = &g_psNodes[i];
+        psNode->ui8ID = i;
+        SecureKeyDerive(pui8NetKey, i, pui8Key);
+        SecureLinkInit(&g_psLinks[i], i, pui8Key, 0, 0);
+        SecureLinkInit(&psNode->sLink, i, pui8Key, 0, 0);
+        TimeSyncInit(&psNode->sSync);
+        BackoffInit(&psNode->sBackoff, (i << 24) ^ psJob->ui32Seed);
+        psNode->ui8Pace = TDMA_PACE_START;
+        psNode->dOffset = SimRandom() * 4294967296.0;
+        psNode->dRate = 1 + (2 * SimRandom() - 1) * g_sConfig.dDriftPPM / 1e6;
+        SimSchedule(1 + (uint64_t)(SimRandom() * SIM_POLL_INTERVAL_US),
+                    EV_POLL, i);
+        CommandNext(psNode);
+    }
+    SimSchedule(SIM_TICK_US, EV_TICK, 0);
+
+    while(g_iEvents)
+    {
+        sEvent = SimNext();
+        if(sEvent.ui64Time >= g_sConfig.ui64Duration)
+        {
+            break;
+        }
+        g_ui64Now = sEvent.ui64Time;
+        psNode = &g_psNodes[sEvent.ui16Index];
+
+        switch(sEvent.ui16Type)
+        {
+            case EV_POLL:
+            {
+                NodePoll(psNode);
+                break;
+            }
+            case EV_POLL_END:
+            {
+                RadioPollEnd(psNode);
+                break;
+            }
+            case EV_ACK:
+            {
+                AirStart(&g_psRadios[CHANNEL_RADIO(psNode->ui8ID)],
+                         &psNode->sAckTx, SIM_AIR_US(psNode->iAckLen));
+                SimSchedule(psNode->sAckTx.ui64End, EV_ACK_END,
+                            psNode->ui8ID);
+                break;
+            }
+            case EV_ACK_END:
+            {
+                if(AirEnd(&g_psRadios[CHANNEL_RADIO(psNode->ui8ID)],
+                          &psNode->sAckTx))
+                {
+                    NodeAcked(psNode);
+                }
+                else
+                {
+                    NodeRetry(psNode);
+                }
+                break;
+            }
+            case EV_SERVICE:
+            {
+                RadioService(sEvent.ui16Index);
+                break;
+            }
+            case EV_COMMAND:
+            {
+                MasterCommand(psNode);
+                CommandNext(psNode);
+                break;
+            }
+            case EV_TICK:
+            {
+                SchedTick((uint32_t)g_ui64Now);
+                SimSchedule(g_ui64Now + SIM_TICK_US, EV_TICK, 0);
+                break;
+            }
+        }
+    }
+    for(i = 0; i < g_iNodes; i++)
+    {
+        if(g_psNodes[i].ui8Slots && g_psNodes[i].sSync.bSynced)
+        {
+            psResult->ui32Slotted++;
+        }
+    }
+    psResult->bDone = true;
+}
+
+//*****************************************************************************
+//
+// Sweeps and the report.
+//
+//*****************************************************************************
+
+//
+// Parse a comma separated list of positive numbers, returning the count or
+// 0 if it is not one.
+//
+static int
+ListParse(char *pcList, double *pdValues, int iMax)
+{
+    char *pcEnd;
+    int iCount = 0;
+
+    while(*pcList && (iCount < iMax))
+    {
+        pdValues[iCount] = strtod(pcList, &pcEnd);
+        if((pcEnd == pcList) || (pdValues[iCount] < 0) ||
+           ((*pcEnd != ',') && (*pcEnd != 0)))
+        {
+            return(0);
+        }
+        iCount++;
+        pcList = (*pcEnd == ',') ? pcEnd + 1 : pcEnd;
+    }
+    return(*pcList ? 0 : iCount);
+}
+
+//
+// Latency in ms below which a fraction of the deliveries in a histogram
+// came.
+//
+static uint32_t
+HistPercentile(const uint32_t *pui32Hist, uint64_t ui64Total, double dFrac)
+{
+    uint64_t ui64Sum = 0;
+    int i;
+
+    for(i = 0; i < SIM_HIST_BUCKETS; i++)
+    {
+        ui64Sum += pui32Hist[i];
+        if(ui64Sum && (ui64Sum >= dFrac * ui64Total))
+        {
+            return((i + 1) * SIM_HIST_MS);
+        }
+    }
+    return(0);
+}
+
+static void
+Usage(const char *pcName)
+{
+    fprintf(stderr,
+            "usage: %s [-n nodes,...] [-r commands/hour,...] [-t seconds] "
+            "[-w warmup] [-j workers]\n"
+            "       [-s seed] [-p ppm] [-O open cycles] [-S seal cycles] "
+            "[-v]\n", pcName);
+    exit(2);
+}
+
+int
+main(int argc, char **argv)
+{
+    double pdCounts[SIM_MAX_POINTS], pdRates[SIM_MAX_POINTS];
+    static tSimJob psJobs[SIM_MAX_JOBS];
+    static tSimResult sTotal;
+    tSimResult *psResults, *psResult;
+    uint32_t ui32Seed = 1, ui32Masters;
+    double dSeconds, dLoad, dMaxLoad, dPeak;
+    char pcCounts[] = "10,50,100,200,500,1000", pcRates[] = "60";
+    char *pcCountList = pcCounts, *pcRateList = pcRates;
+    int iCounts, iRates, iJobs = 0, iWorkers, iRunning = 0, iNext = 0;
+    int iOpt, iPoint, i, j, k;
+
+    g_sConfig.ui64Duration = 900 * 1000000ULL;
+    g_sConfig.ui64Warmup = 120 * 1000000ULL;
+    g_sConfig.ui32OpenCycles = SIM_CRYPTO_CYCLES;
+    g_sConfig.ui32SealCycles = SIM_CRYPTO_CYCLES;
+    g_sConfig.dDriftPPM = 20;
+    iWorkers = sysconf(_SC_NPROCESSORS_ONLN);
+
+    while((iOpt = getopt(argc, argv, "n:r:t:w:j:s:p:O:S:v")) != -1)
+    {
+        switch(iOpt)
+        {
+            case 'n': pcCountList = optarg; break;
+            case 'r': pcRateList = optarg; break;
+            case 't': g_sConfig.ui64Duration = atof(optarg) * 1e6; break;
+            case 'w': g_sConfig.ui64Warmup = atof(optarg) * 1e6; break;
+            case 'j': iWorkers = atoi(optarg); break;
+            case 's': ui32Seed = strtoul(optarg, 0, 0); break;
+            case 'p': g_sConfig.dDriftPPM = atof(optarg); break;
+            case 'O': g_sConfig.ui32OpenCycles = strtoul(optarg, 0, 0); break;
+            case 'S': g_sConfig.ui32SealCycles = strtoul(optarg, 0, 0); break;
+            case 'v': g_bVerbose = true; break;
+            default: Usage(argv[0]);
+        }
+    }
+    iCounts = ListParse(pcCountList, pdCounts, SIM_MAX_POINTS);
+    iRates = ListParse(pcRateList, pdRates, SIM_MAX_POINTS);
+    if((optind != argc) || !iCounts || !iRates || (iWorkers < 1) ||
+       (g_sConfig.ui64Warmup >= g_sConfig.ui64Duration) ||
+       (iCounts * iRates > SIM_MAX_POINTS))
+    {
+        Usage(argv[0]);
+    }
+
+    //
+    // Split each node count over as few masters as will take it, as evenly
+    // as they go.
+    //
+    for(i = 0; i < iRates; i++)
+    {
+        for(j = 0; j < iCounts; j++)
+        {
+            ui32Masters = ((uint32_t)pdCounts[j] + NUM_SLAVES - 1) /
+                          NUM_SLAVES;
+            for(k = 0; k < (int)ui32Masters; k++)
+            {
+                if(iJobs == SIM_MAX_JOBS)
+                {
+                    fprintf(stderr, "sim: too many masters\n");
+                    return(1);
+                }
+                psJobs[iJobs].iPoint = i * iCounts + j;
+                psJobs[iJobs].ui32Nodes = ((uint32_t)pdCounts[j] / ui32Masters) +
+                                          ((uint32_t)k < ((uint32_t)pdCounts[j] %
+                                                          ui32Masters));
+                psJobs[iJobs].ui32Seed = ui32Seed * 2654435761U + iJobs + 1;
+                iJobs++;
+            }
+        }
+    }
+
+    //
+    // Results go in memory shared with the workers.
+    //
+    psResults = mmap(0, iJobs * sizeof(tSimResult), PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(psResults == MAP_FAILED)
+    {
+        perror("sim: mmap");
+        return(1);
+    }
+    memset(psResults, 0, iJobs * sizeof(tSimResult));
+    fflush(stdout);
+
+    while((iNext < iJobs) || iRunning)
+    {
+        if((iNext < iJobs) && (iRunning < iWorkers))
+        {
+            switch(fork())
+            {
+                case -1:
+                {
+                    perror("sim: fork");
+                    return(1);
+                }
+                case 0:
+                {
+                    SimRun(&psJobs[iNext],
+                           pdRates[psJobs[iNext].iPoint / iCounts],
+                           &psResults[iNext]);
+                    _exit(0);
+                }
+                default:
+                {
+                    iNext++;
+                    iRunning++;
+                    continue;
+                }
+            }
+        }
+        if(wait(0) > 0)
+        {
+            iRunning--;
+        }
+    }
+
+    dSeconds = (g_sConfig.ui64Duration - g_sConfig.ui64Warmup) / 1e6;
+    printf("%.0f s simulated after %.0f s warm-up, up to %d nodes a master "
+           "on %d radio%s, open/seal %u/%u cycles\n\n", dSeconds,
+           g_sConfig.ui64Warmup / 1e6, NUM_SLAVES, CHANNEL_RADIOS,
+           (CHANNEL_RADIOS == 1) ? "" : "s", g_sConfig.ui32OpenCycles,
+           g_sConfig.ui32SealCycles);
+    printf("nodes masters slotted cmd/h  polls/s  fail%%  coll%%   issued  deliv  "
+           "lost  repl  misdir  p50ms  p90ms  p99ms  maxms  cpu%% avg  max  "
+           "peak\n");
+
+    for(iPoint = 0; iPoint < iCounts * iRates; iPoint++)
+    {
+        memset(&sTotal, 0, sizeof(sTotal));
+        ui32Masters = 0;
+        dLoad = dMaxLoad = dPeak = 0;
+        for(i = 0; i < iJobs; i++)
+        {
+            psResult = &psResults[i];
+            if(psJobs[i].iPoint != iPoint)
+            {
+                continue;
+            }
+            if(!psResult->bDone)
+            {
+                fprintf(stderr, "sim: a worker failed\n");
+                return(1);
+            }
+            ui32Masters++;
+            sTotal.ui32Nodes += psResult->ui32Nodes;
+            sTotal.ui32Slotted += psResult->ui32Slotted;
+            sTotal.ui64Exchanges += psResult->ui64Exchanges;
+            sTotal.ui64Failed += psResult->ui64Failed;
+            sTotal.ui64Packets += psResult->ui64Packets;
+            sTotal.ui64Collided += psResult->ui64Collided;
+            sTotal.ui64Misdirected += psResult->ui64Misdirected;
+            sTotal.ui64Issued += psResult->ui64Issued;
+            sTotal.ui64Replaced += psResult->ui64Replaced;
+            sTotal.ui64Delivered += psResult->ui64Delivered;
+            sTotal.ui64Lost += psResult->ui64Lost;
+            for(j = 0; j < SIM_HIST_BUCKETS; j++)
+            {
+                sTotal.pui32Hist[j] += psResult->pui32Hist[j];
+            }
+            dLoad += psResult->ui64Busy / (dSeconds * SIM_CPU_HZ);
+            if(psResult->ui64Busy / (dSeconds * SIM_CPU_HZ) > dMaxLoad)
+            {
+                dMaxLoad = psResult->ui64Busy / (dSeconds * SIM_CPU_HZ);
+            }
+            if((double)psResult->ui64PeakBusy / SIM_CPU_HZ > dPeak)
+            {
+                dPeak = (double)psResult->ui64PeakBusy / SIM_CPU_HZ;
+            }
+        }
+
+        printf("%5u %7u %7u %5.0f %8.1f %6.2f %6.2f %8llu %6llu %5llu %5llu "
+               "%7llu %6u %6u %6u %6u %8.2f %5.2f %5.2f\n", sTotal.ui32Nodes,
+               ui32Masters, sTotal.ui32Slotted, pdRates[iPoint / iCounts],
+               sTotal.ui64Exchanges / dSeconds,
+               sTotal.ui64Exchanges ?
+               100.0 * sTotal.ui64Failed / sTotal.ui64Exchanges : 0.0,
+               sTotal.ui64Packets ?
+               100.0 * sTotal.ui64Collided / sTotal.ui64Packets : 0.0,
+               (unsigned long long)sTotal.ui64Issued,
+               (unsigned long long)sTotal.ui64Delivered,
+               (unsigned long long)sTotal.ui64Lost,
+               (unsigned long long)sTotal.ui64Replaced,
+               (unsigned long long)sTotal.ui64Misdirected,
+               HistPercentile(sTotal.pui32Hist, sTotal.ui64Delivered, 0.5),
+               HistPercentile(sTotal.pui32Hist, sTotal.ui64Delivered, 0.9),
+               HistPercentile(sTotal.pui32Hist, sTotal.ui64Delivered, 0.99),
+               HistPercentile(sTotal.pui32Hist, sTotal.ui64Delivered, 1.0),
+               100 * dLoad / ui32Masters, 100 * dMaxLoad, 100 * dPeak);
+    }
+
+    return(0);
+}
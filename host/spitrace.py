@@ -0,0 +1,155 @@
+#!/usr/bin/env python3
+#
+# spitrace.py - Decode an SPI trace dump from the master's console.
+#
+# Capture the console output of the "spitrace" command to a file and run:
+#
+#     host/spitrace.py console.log
+#
+# Prints a timeline of the radio transactions, how many of each opcode were
+# made, and how busy the SPI bus was over the trace.
+#
+# Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+#
+
+import argparse
+import struct
+import sys
+from collections import Counter
+
+#
+# Must match tSPITraceEntry in utilities/spitrace.h.
+#
+ENTRY = struct.Struct('<IHBBBBH')
+FLAG_READ = 0x01
+FLAG_STATUS = 0x02
+
+REGISTERS = [
+    'CONFIG', 'EN_AA', 'EN_RXADDR', 'SETUP_AW', 'SETUP_RETR', 'RF_CH',
+    'RF_SETUP', 'STATUS', 'OBSERVE_TX', 'RPD', 'RX_ADDR_P0', 'RX_ADDR_P1',
+    'RX_ADDR_P2', 'RX_ADDR_P3', 'RX_ADDR_P4', 'RX_ADDR_P5', 'TX_ADDR',
+    'RX_PW_P0', 'RX_PW_P1', 'RX_PW_P2', 'RX_PW_P3', 'RX_PW_P4', 'RX_PW_P5',
+    'FIFO_STATUS', '0x18', '0x19', '0x1A', '0x1B', 'DYNPD', 'FEATURE',
+    '0x1E', '0x1F',
+]
+
+OPCODES = {
+    0x50: 'ACTIVATE',
+    0x60: 'R_RX_PL_WID',
+    0x61: 'R_RX_PAYLOAD',
+    0xA0: 'W_TX_PAYLOAD',
+    0xB0: 'W_TX_PAYLOAD_NOACK',
+    0xE1: 'FLUSH_TX',
+    0xE2: 'FLUSH_RX',
+    0xE3: 'REUSE_TX_PL',
+    0xFF: 'NOP',
+}
+
+
+def decode_command(cmd):
+    """Split a command byte into an opcode name and its argument."""
+    if cmd < 0x20:
+        return 'R_REGISTER', REGISTERS[cmd]
+    if cmd < 0x40:
+        return 'W_REGISTER', REGISTERS[cmd & 0x1F]
+    if 0xA8 <= cmd <= 0xAD:
+        return 'W_ACK_PAYLOAD', 'pipe %d' % (cmd & 0x07)
+    return OPCODES.get(cmd, '0x%02X' % cmd), ''
+
+
+def decode_status(status):
+    flags = [name for bit, name in ((0x40, 'RX_DR'), (0x20, 'TX_DS'),
+                                    (0x10, 'MAX_RT'), (0x01, 'TX_FULL'))
+             if status & bit]
+    pipe = (status >> 1) & 0x07
+    flags.append('RX_EMPTY' if pipe == 7 else 'P%d' % pipe)
+    return ' '.join(flags)
+
+
+def read_dump(lines):
+    """Return (clock Hz, transactions, entries) from the last dump found."""
+    dump = None
+    result = None
+    for line in lines:
+        line = line.strip()
+        if line.startswith('SPITRACE END'):
+            if dump is not None:
+                result = dump
+        elif line.startswith('SPITRACE '):
+            fields = line.split()
+            if int(fields[1]) != 1:
+                raise ValueError('unknown dump version %s' % fields[1])
+            dump = (int(fields[2]), int(fields[3]), [])
+        elif line.startswith('S ') and dump is not None:
+            data = bytes.fromhex(line[2:])
+            dump[2].extend(ENTRY.iter_unpack(data))
+    if result is None:
+        raise ValueError('no complete SPITRACE dump found')
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Decode an SPI trace dump from the master\'s console.')
+    parser.add_argument('log', nargs='?', type=argparse.FileType('r'),
+                        default=sys.stdin,
+                        help='console capture (default: stdin)')
+    parser.add_argument('-q', '--quiet', action='store_true',
+                        help='print only the summary')
+    args = parser.parse_args()
+
+    try:
+        clock, total, entries = read_dump(args.log)
+    except ValueError as err:
+        sys.exit('spitrace: %s' % err)
+    if not entries:
+        sys.exit('spitrace: trace is empty')
+
+    per_us = clock / 1e6
+    counts = Counter()
+    busy = 0
+    first = entries[0][0]
+    now = 0
+    last_start = first
+
+    if not args.quiet:
+        print('%12s %10s %8s  %-18s %-12s %3s  %s' %
+              ('time us', 'delta us', 'dur us', 'opcode', 'argument', 'len',
+               'status'))
+    for start, cycles, cmd, length, status, flags, _ in entries:
+        #
+        # Timestamps are a 32-bit cycle count, so only the difference from
+        # the previous entry is meaningful.
+        #
+        delta = (start - last_start) & 0xFFFFFFFF
+        now += delta
+        last_start = start
+
+        opcode, arg = decode_command(cmd)
+        counts[opcode] += 1
+        busy += cycles
+        if not args.quiet:
+            print('%12.1f %10.1f %8.2f  %-18s %-12s %3d  %s%s' %
+                  (now / per_us, delta / per_us, cycles / per_us, opcode,
+                   arg, length,
+                   decode_status(status) if flags & FLAG_STATUS else '-',
+                   '' if flags & FLAG_READ else ' (write only)'))
+
+    span = now + entries[-1][1]
+    print()
+    print('%d transactions recorded, %d in this dump, over %.3f ms' %
+          (total, len(entries), span / per_us / 1000))
+    if total > len(entries):
+        print('%d older transactions were overwritten' %
+              (total - len(entries)))
+    print()
+    print('%-20s %8s' % ('opcode', 'count'))
+    for opcode, count in counts.most_common():
+        print('%-20s %8d' % (opcode, count))
+    print()
+    print('Bus utilisation: %.2f%% (%.1f us with chip select asserted)' %
+          (100.0 * busy / span if span else 0.0, busy / per_us))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,55 @@
+//*****************************************************************************
+//
+// backoff.c - Randomised exponential backoff after failed transmissions.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "backoff.h"
+
+//
+// Seed the generator.  Nodes should mix in something of their own, such as
+// their ID, so that nodes started together do not back off in step.
+//
+void
+BackoffInit(tBackoff *psBackoff, uint32_t ui32Seed)
+{
+    psBackoff->ui32Seed = ui32Seed ? ui32Seed : 1;
+    psBackoff->ui8Failures = 0;
+}
+
+//
+// Note a failed transmission and return how long to back off, in
+// microseconds.
+//
+uint32_t
+BackoffFail(tBackoff *psBackoff)
+{
+    uint32_t ui32X = psBackoff->ui32Seed;
+
+    if(psBackoff->ui8Failures < BACKOFF_MAX_EXP)
+    {
+        psBackoff->ui8Failures++;
+    }
+
+    //
+    // xorshift32, which is plenty for spreading nodes out.
+    //
+    ui32X ^= ui32X << 13;
+    ui32X ^= ui32X >> 17;
+    ui32X ^= ui32X << 5;
+    psBackoff->ui32Seed = ui32X;
+
+    return((ui32X & ((1 << psBackoff->ui8Failures) - 1)) * BACKOFF_SLOT_US);
+}
+
+//
+// Note a successful transmission.
+//
+void
+BackoffReset(tBackoff *psBackoff)
+{
+    psBackoff->ui8Failures = 0;
+}
@@ -0,0 +1,34 @@
+//*****************************************************************************
+//
+// backoff.h - Randomised exponential backoff after failed transmissions.
+//
+// A node whose poll runs out of retransmissions waits a random number of
+// backoff slots, up to 2^n - 1 after n failures in a row, on top of its
+// usual wait before polling again.  Nodes that failed together, because
+// they collided or the master was busy, then come back at different times.
+//
+//*****************************************************************************
+
+#ifndef __BACKOFF_H__
+#define __BACKOFF_H__
+
+#define BACKOFF_SLOT_US         250000
+
+//
+// Failures in a row beyond this do not widen the window further.
+//
+#define BACKOFF_MAX_EXP         5
+
+typedef struct
+{
+    uint32_t ui32Seed;
+
+    uint8_t ui8Failures;
+}
+tBackoff;
+
+void BackoffInit(tBackoff *psBackoff, uint32_t ui32Seed);
+uint32_t BackoffFail(tBackoff *psBackoff);
+void BackoffReset(tBackoff *psBackoff);
+
+#endif
@@ -0,0 +1,169 @@
+//*****************************************************************************
+//
+// bench.h - Radio benchmark run between the master and a Node_Bench board.
+//
+// The master's "bench" command takes one of its radios off the network and
+// drives the tests; Node_Bench answers.  Both meet on BENCH_RF_CHANNEL at
+// BENCH_ADDR, away from the network's channels.  For each case of the suite
+// the master sends a BENCH_MSG_SETUP frame at the control settings, and
+// once it is acknowledged both sides change to the case's data rate and
+// retransmit setting.  The master then runs the test and ends it with a
+// BENCH_MSG_END frame; a node that misses the end goes back to the control
+// settings after BENCH_IDLE_US without a frame.
+//
+// Tests, each of BENCH_PACKETS packets with a payload of the case's size:
+//
+//     ping    The master sends a packet, the node sends it back.  Latency
+//             is from the master's CE pulse to the echo's arrival.
+//     ackpl   The master sends a packet, the node answers with an ACK
+//             payload of the same size, as polls are answered.  Latency is
+//             from the CE pulse to the ACK payload's arrival.
+//     stream  The master keeps its TX FIFO full with CE held high.
+//             Latency is the interval between successive ACKs.
+//
+// Results are printed as a block of lines, all fields decimal:
+//
+//     BENCH <version> <packets> <source>
+//     B <test> <size> <kbps> <ard us> <arc> <sent> <ok> <retries>
+//       <elapsed us> <packets/s> <goodput B/s> <p50> <p90> <p99> <max>
+//     BENCH END
+//
+// on one line per case, with latencies in microseconds.  <sent> counts
+// packets handed to the radio, <ok> those acknowledged (and, for ping and
+// ackpl, answered), <retries> the retransmissions the radio made.  The
+// master prints "hw" as the source; host/bench/bench prints the same block
+// for its model of the radio as "model", and host/bench.py sets the two
+// side by side.
+//
+//*****************************************************************************
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#define BENCH_DUMP_VERSION      1
+
+//
+// Where the benchmark runs.  Channel 100 is 2500 MHz, clear of the
+// network's channels.
+//
+#define BENCH_RF_CHANNEL        100
+#define BENCH_ADDR_LEN          5
+#define BENCH_ADDR              {0xB5, 0xB5, 0xB5, 0xB5, 0xB5}
+
+//
+// CONFIG for both sides as transmitters, every interrupt enabled; the
+// receiver adds nRF_CFG_PRIM_RX.
+//
+#define BENCH_CFG               (nRF_CFG_EN_CRC | nRF_CFG_PWR_UP)
+
+//
+// Registers both sides set with nRFBringUp() for a data rate and
+// retransmit setting: pipe 0 alone, auto-acknowledged, with dynamic
+// payloads and ACK payloads, sending and receiving at BENCH_ADDR.
+//
+#define BENCH_REGISTERS(rfsetup, retr)                                        \
+    {                                                                         \
+        {nRF_O_RF_CH, 1, {BENCH_RF_CHANNEL}},                                 \
+        {nRF_O_RF_SETUP, 1, {(rfsetup)}},                                     \
+        {nRF_O_SETUP_RETR, 1, {(retr)}},                                      \
+        {nRF_O_EN_AA, 1, {nRF_DATA_PIPE_0}},                                  \
+        {nRF_O_EN_RXADDR, 1, {nRF_DATA_PIPE_0}},                              \
+        {nRF_O_FEATURE, 1, {nRF_EN_DPL | nRF_EN_ACK_PAY}},                    \
+        {nRF_O_DYNPD, 1, {nRF_DATA_PIPE_0}},                                  \
+        {nRF_O_RX_ADDR_P0, BENCH_ADDR_LEN, BENCH_ADDR},                       \
+        {nRF_O_TX_ADDR, BENCH_ADDR_LEN, BENCH_ADDR},                          \
+    }
+
+//
+// Frames at the control settings.  Test data never has the top bit set in
+// its first byte, so it cannot be taken for either.
+//
+#define BENCH_MSG_SETUP         0x91 // [91][test][size][rate][retry]
+#define BENCH_MSG_END           0x92 // [92]
+
+#define BENCH_SETUP_LEN         5
+
+//
+// Setup frames the master sends before it gives the node up.
+//
+#define BENCH_SETUP_TRIES       3
+
+#define BENCH_TEST_PING         0
+#define BENCH_TEST_ACKPL        1
+#define BENCH_TEST_STREAM       2
+#define BENCH_TESTS             3
+
+#define BENCH_TEST_NAMES        {"ping", "ackpl", "stream"}
+
+//
+// Packets per case.
+//
+#define BENCH_PACKETS           200
+
+//
+// Payload sizes run, 1 to BENCH_SIZE_MAX.  The quick suite runs only the
+// sizes in BENCH_QUICK_SIZES, at one data rate and retransmit setting.
+//
+#define BENCH_SIZE_MAX          32
+#define BENCH_QUICK_SIZES       {1, 8, 16, 24, 32}
+#define BENCH_QUICK_RATE        2
+#define BENCH_QUICK_RETRY       1
+
+//
+// Data rates, by RF_SETUP value at 0 dBm.
+//
+#define BENCH_RATES             3
+#define BENCH_RATE_KBPS         {250, 1000, 2000}
+#define BENCH_RATE_SETUP        {0x26, 0x06, 0x0E}
+#define BENCH_CONTROL_RATE      2
+
+//
+// Retransmit settings: the delay between attempts and the retransmissions
+// allowed.  The first sends once; the last waits long enough for a full
+// ACK payload at 250 kbps.
+//
+#define BENCH_RETRIES           3
+#define BENCH_RETRY_ARD_US      {250, 500, 1500}
+#define BENCH_RETRY_ARC         {0, 3, 15}
+#define BENCH_CONTROL_RETRY     2
+
+//
+// SETUP_RETR register value for a delay and retransmission count.
+//
+#define BENCH_SETUP_RETR(ard, arc)                                            \
+    (((((ard) / 250) - 1) << 4) | (arc))
+
+//
+// Both sides wait this long after the setup frame before changing
+// settings, so that its ACK has gone out first.  A node that hears nothing
+// for BENCH_IDLE_US goes back to the control settings.  The master gives
+// up on a packet's answer after BENCH_TIMEOUT_US, longer than 16 attempts
+// at the slowest setting take.
+//
+#define BENCH_SWITCH_US         2000
+#define BENCH_IDLE_US           200000
+#define BENCH_TIMEOUT_US        60000
+
+//
+// Length of the CE pulse that sends a packet; the radio needs 10 us.
+//
+#define BENCH_CE_US             15
+
+//
+// A receiver waits this long after a packet arrives before taking CE low,
+// so that the radio has sent the ACK: 130 us to turn round plus an empty
+// ACK at 250 kbps, with margin.  The node turns round to echo a ping, and
+// the master stops listening after an echo.
+//
+#define BENCH_ECHO_WAIT_US      450
+
+//
+// Time on air of a packet with a len byte payload: 1 byte preamble, 5 byte
+// address, 9 bit packet control field and 2 byte CRC.  The radio takes
+// BENCH_SETTLE_US to go from standby to TX or RX.
+//
+#define BENCH_AIR_US(len, kbps)                                               \
+    (((8 * (1 + BENCH_ADDR_LEN + (len) + 2) + 9) * 1000) / (kbps))
+#define BENCH_SETTLE_US         130
+
+#endif
@@ -0,0 +1,104 @@
+//*****************************************************************************
+//
+// board.h - Radio wiring for the boards the firmware runs on.
+//
+// The board follows from the part the firmware is built for: the master is
+// a TM4C129 with two radios, the nodes are TM4C123s with one.  Each radio
+// has an SSI with its pin mux, a chip select, a chip enable and an IRQ, all
+// fixed at compile time so that the SPI code compiles to plain register
+// accesses.  To rewire a radio, edit its lines here; a pin on a GPIO port
+// that is not yet used must also be enabled in setup(), and an IRQ on
+// another port needs its handler in the startup file's vector table.
+//
+//*****************************************************************************
+
+#ifndef __BOARD_H__
+#define __BOARD_H__
+
+#if defined(PART_TM4C129XNCZAD)
+
+//
+// Automation master.
+//
+#define BOARD_RADIOS            2
+
+#define BOARD_RADIO0_SSI_BASE   SSI2_BASE
+#define BOARD_RADIO0_SSI_PERIPH SYSCTL_PERIPH_SSI2
+#define BOARD_RADIO0_SSI_PORT   GPIO_PORTG_BASE
+#define BOARD_RADIO0_SSI_PINS   (GPIO_PIN_4 | GPIO_PIN_5 | GPIO_PIN_7)
+#define BOARD_RADIO0_SSI_CLK    GPIO_PG7_SSI2CLK
+#define BOARD_RADIO0_SSI_TX     GPIO_PG5_SSI2XDAT0
+#define BOARD_RADIO0_SSI_RX     GPIO_PG4_SSI2XDAT1
+#define BOARD_RADIO0_CS_PORT    GPIO_PORTQ_BASE
+#define BOARD_RADIO0_CS_PIN     GPIO_PIN_7
+#define BOARD_RADIO0_CE_PORT    GPIO_PORTH_BASE
+#define BOARD_RADIO0_CE_PIN     GPIO_PIN_7
+#define BOARD_RADIO0_IRQ_PORT   GPIO_PORTH_BASE
+#define BOARD_RADIO0_IRQ_PIN    GPIO_PIN_6
+
+#define BOARD_RADIO1_SSI_BASE   SSI3_BASE
+#define BOARD_RADIO1_SSI_PERIPH SYSCTL_PERIPH_SSI3
+#define BOARD_RADIO1_SSI_PORT   GPIO_PORTQ_BASE
+#define BOARD_RADIO1_SSI_PINS   (GPIO_PIN_0 | GPIO_PIN_2 | GPIO_PIN_3)
+#define BOARD_RADIO1_SSI_CLK    GPIO_PQ0_SSI3CLK
+#define BOARD_RADIO1_SSI_TX     GPIO_PQ2_SSI3XDAT0
+#define BOARD_RADIO1_SSI_RX     GPIO_PQ3_SSI3XDAT1
+#define BOARD_RADIO1_CS_PORT    GPIO_PORTQ_BASE
+#define BOARD_RADIO1_CS_PIN     GPIO_PIN_1
+#define BOARD_RADIO1_CE_PORT    GPIO_PORTH_BASE
+#define BOARD_RADIO1_CE_PIN     GPIO_PIN_5
+
+//
+// Both IRQs share port H's handler, GPIOPortHIntHandler().
+//
+#define BOARD_RADIO1_IRQ_PORT   BOARD_RADIO0_IRQ_PORT
+#define BOARD_RADIO1_IRQ_PIN    GPIO_PIN_4
+
+#define BOARD_RADIO_IRQ_INT     INT_GPIOH_SNOWFLAKE
+
+#else
+
+//
+// Nodes.  The IRQ is handled by GPIOPortBIntHandler().
+//
+#define BOARD_RADIOS            1
+
+#define BOARD_RADIO0_SSI_BASE   SSI2_BASE
+#define BOARD_RADIO0_SSI_PERIPH SYSCTL_PERIPH_SSI2
+#define BOARD_RADIO0_SSI_PORT   GPIO_PORTB_BASE
+#define BOARD_RADIO0_SSI_PINS   (GPIO_PIN_4 | GPIO_PIN_6 | GPIO_PIN_7)
+#define BOARD_RADIO0_SSI_CLK    GPIO_PB4_SSI2CLK
+#define BOARD_RADIO0_SSI_TX     GPIO_PB7_SSI2TX
+#define BOARD_RADIO0_SSI_RX     GPIO_PB6_SSI2RX
+#define BOARD_RADIO0_CS_PORT    GPIO_PORTE_BASE
+#define BOARD_RADIO0_CS_PIN     GPIO_PIN_0
+#define BOARD_RADIO0_CE_PORT    GPIO_PORTB_BASE
+#define BOARD_RADIO0_CE_PIN     GPIO_PIN_1
+#define BOARD_RADIO0_IRQ_PORT   GPIO_PORTB_BASE
+#define BOARD_RADIO0_IRQ_PIN    GPIO_PIN_0
+
+#define BOARD_RADIO_IRQ_INT     INT_GPIOB_BLIZZARD
+
+#endif
+
+//
+// Write ui8Val to the pins ui8Pins of a GPIO port, as GPIOPinWrite() does,
+// with one store through the port's masked data address.  With constant
+// arguments there is no call and no read-modify-write.
+//
+#define BoardPinWrite(ui32Port, ui8Pins, ui8Val)                              \
+    HWREG((ui32Port) + GPIO_O_DATA + ((ui8Pins) << 2)) = (ui8Val)
+
+//
+// The pins ui8Pins of a GPIO port, as GPIOPinRead() reads them.
+//
+#define BoardPinRead(ui32Port, ui8Pins)                                       \
+    HWREG((ui32Port) + GPIO_O_DATA + ((ui8Pins) << 2))
+
+//
+// True while an SSI is still shifting data out, as SSIBusy().
+//
+#define BoardSSIBusy(ui32Base)                                                \
+    (HWREG((ui32Base) + SSI_O_SR) & SSI_SR_BSY)
+
+#endif
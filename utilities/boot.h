@@ -0,0 +1,36 @@
+//*****************************************************************************
+//
+// boot.h - Start-up times reported by nodes.
+//
+// A node times its own start on its local clock: until its radio passed
+// the readback check in nRFBringUp(), and until the master first
+// acknowledged one of its polls.  It reports both in its polls until one
+// carrying the report is acknowledged, so the master can log how long a
+// power-cycled node took to rejoin.  The report also tells the master the
+// node has reset, and now refuses the master's last epoch (see secure.h).
+//
+//*****************************************************************************
+
+#ifndef __BOOT_H__
+#define __BOOT_H__
+
+//
+// [F1][radio up 2][first poll 2], node to master, in milliseconds since the
+// node started, little-endian.  It fits in a poll alongside every other
+// report a node makes.
+//
+#define BOOT_MSG_STATUS         0xF1
+
+#define BOOT_STATUS_LEN         5
+
+//
+// Milliseconds for a report field from microseconds, saturating.
+//
+#define BOOT_MS(us)             (((us) >= 65535000) ? 0xFFFF : ((us) / 1000))
+
+//
+// A node with no radio answering tries to bring it up again this often.
+//
+#define BOOT_RADIO_RETRY_MS     1000
+
+#endif
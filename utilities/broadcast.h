@@ -0,0 +1,47 @@
+//*****************************************************************************
+//
+// broadcast.h - Commands sent to many nodes in one frame.
+//
+// Between polls, listening nodes also take frames on pipe 3 at a broadcast
+// address shared by all of them.  The master sends these without the auto
+// ACK, so one frame reaches every node in range on a radio's channel,
+// however many there are.  It sends each frame a few times over, a SysTick
+// apart, for nodes that missed a copy while sending a poll; the copies are
+// the same sealed frame, so a node drops the ones after the first by the
+// frame's counter without opening them.  Nothing confirms a broadcast, and
+// nodes reached only through a relay are sent the command in the usual way.
+//
+// Broadcasts are sealed on a link of their own, with ID BROADCAST_ID and a
+// key derived from the network key like a node's.  Every node holds that
+// key, so any node could forge a broadcast; they are trusted no further
+// than that.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __BROADCAST_H__
+#define __BROADCAST_H__
+
+//
+// ID of the broadcast link, which no node may have.  Byte 0 of the
+// broadcast address is the same, the rest as PUSH_NODE_ADDR, so it is the
+// push address the node would have.
+//
+#define BROADCAST_ID            0x7F
+
+//
+// [E3][mask0 mask1 mask2 mask3][command], master to nodes.  Bit n of the
+// little-endian mask is set if node n is to carry out the command.
+//
+#define BROADCAST_MSG_CMD       0xE3
+#define BROADCAST_HDR_LEN       5
+
+//
+// Copies of each broadcast sent on each radio, unless the console asks for
+// others, and the most it may ask for.
+//
+#define BROADCAST_COPIES        3
+#define BROADCAST_MAX_COPIES    10
+
+#endif
@@ -0,0 +1,315 @@
+//*****************************************************************************
+//
+// ccm.c - AES-128 CCM authenticated encryption for radio payloads.
+//
+// The CCM construction is shared by every build.  The AES block cipher
+// underneath it runs on the TM4C129 AES engine on the master and in
+// software everywhere else (the nodes and host builds).
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "ccm.h"
+
+#if defined(rvmdk) && defined(PART_TM4C129XNCZAD)
+#define CCM_HW_AES
+#endif
+
+#ifdef CCM_HW_AES
+#include "inc/hw_memmap.h"
+#include "driverlib/aes.h"
+#include "driverlib/sysctl.h"
+
+//
+// Key currently loaded in the AES engine, so back to back blocks under the
+// same key skip the key load.
+//
+static const tCCMKey *g_psLoadedKey;
+
+void
+CCMInit(void)
+{
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_CCM0);
+    while(!SysCtlPeripheralReady(SYSCTL_PERIPH_CCM0))
+    {
+    }
+    AESReset(AES_BASE);
+    AESConfigSet(AES_BASE, AES_CFG_KEY_SIZE_128BIT | AES_CFG_DIR_ENCRYPT |
+                 AES_CFG_MODE_ECB);
+    g_psLoadedKey = 0;
+}
+
+void
+CCMKeySet(tCCMKey *psKey, const uint8_t *pui8Key)
+{
+    memcpy(psKey->pui32Key, pui8Key, 16);
+    g_psLoadedKey = 0;
+}
+
+void
+CCMEncryptBlock(const tCCMKey *psKey, const uint8_t *pui8In, uint8_t *pui8Out)
+{
+    uint32_t pui32In[4], pui32Out[4];
+
+    if(g_psLoadedKey != psKey)
+    {
+        AESKey1Set(AES_BASE, (uint32_t *)psKey->pui32Key,
+                   AES_CFG_KEY_SIZE_128BIT);
+        g_psLoadedKey = psKey;
+    }
+    memcpy(pui32In, pui8In, 16);
+    AESDataProcess(AES_BASE, pui32In, pui32Out, 16);
+    memcpy(pui8Out, pui32Out, 16);
+}
+
+#else
+
+//
+// AES S-box.  Deliberately not const: it is placed in SRAM, which has a
+// fixed access time on the cacheless Cortex-M4, so the table lookups below
+// do not leak the key through timing.  No other step branches on or indexes
+// by secret data.
+//
+static uint8_t g_pui8SBox[256] =
+{
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5,
+    0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0,
+    0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc,
+    0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a,
+    0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0,
+    0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b,
+    0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85,
+    0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5,
+    0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17,
+    0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88,
+    0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c,
+    0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9,
+    0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6,
+    0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e,
+    0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94,
+    0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68,
+    0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+//
+// Multiply by x in GF(2^8) without a data dependent branch.
+//
+#define XTIME(x)                ((uint8_t)(((x) << 1) ^ \
+                                           (0x1b & -((x) >> 7))))
+
+void
+CCMInit(void)
+{
+}
+
+void
+CCMKeySet(tCCMKey *psKey, const uint8_t *pui8Key)
+{
+    uint8_t *pui8RK = psKey->pui8RoundKey;
+    uint8_t ui8Rcon = 0x01;
+    uint8_t pui8Temp[4];
+    int i;
+
+    memcpy(psKey->pui32Key, pui8Key, 16);
+    memcpy(pui8RK, pui8Key, 16);
+
+    for(i = 16; i < 176; i += 4)
+    {
+        memcpy(pui8Temp, pui8RK + i - 4, 4);
+        if((i & 15) == 0)
+        {
+            uint8_t ui8T = pui8Temp[0];
+
+            pui8Temp[0] = g_pui8SBox[pui8Temp[1]] ^ ui8Rcon;
+            pui8Temp[1] = g_pui8SBox[pui8Temp[2]];
+            pui8Temp[2] = g_pui8SBox[pui8Temp[3]];
+            pui8Temp[3] = g_pui8SBox[ui8T];
+            ui8Rcon = XTIME(ui8Rcon);
+        }
+        pui8RK[i + 0] = pui8RK[i - 16] ^ pui8Temp[0];
+        pui8RK[i + 1] = pui8RK[i - 15] ^ pui8Temp[1];
+        pui8RK[i + 2] = pui8RK[i - 14] ^ pui8Temp[2];
+        pui8RK[i + 3] = pui8RK[i - 13] ^ pui8Temp[3];
+    }
+}
+
+void
+CCMEncryptBlock(const tCCMKey *psKey, const uint8_t *pui8In, uint8_t *pui8Out)
+{
+    const uint8_t *pui8RK = psKey->pui8RoundKey;
+    uint8_t pui8S[16], pui8T[16];
+    int iRound, i;
+
+    for(i = 0; i < 16; i++)
+    {
+        pui8S[i] = pui8In[i] ^ pui8RK[i];
+    }
+
+    for(iRound = 1; iRound <= 10; iRound++)
+    {
+        //
+        // SubBytes and ShiftRows.  The state is column major, so row r of
+        // column c is byte 4c + r and moves left by r columns.
+        //
+        for(i = 0; i < 16; i++)
+        {
+            pui8T[i] = g_pui8SBox[pui8S[(i + 4 * (i & 3)) & 15]];
+        }
+
+        //
+        // MixColumns, skipped in the final round.
+        //
+        if(iRound != 10)
+        {
+            for(i = 0; i < 16; i += 4)
+            {
+                uint8_t ui8A0 = pui8T[i], ui8A1 = pui8T[i + 1];
+                uint8_t ui8A2 = pui8T[i + 2], ui8A3 = pui8T[i + 3];
+                uint8_t ui8All = ui8A0 ^ ui8A1 ^ ui8A2 ^ ui8A3;
+
+                pui8T[i + 0] ^= ui8All ^ XTIME((uint8_t)(ui8A0 ^ ui8A1));
+                pui8T[i + 1] ^= ui8All ^ XTIME((uint8_t)(ui8A1 ^ ui8A2));
+                pui8T[i + 2] ^= ui8All ^ XTIME((uint8_t)(ui8A2 ^ ui8A3));
+                pui8T[i + 3] ^= ui8All ^ XTIME((uint8_t)(ui8A3 ^ ui8A0));
+            }
+        }
+
+        for(i = 0; i < 16; i++)
+        {
+            pui8S[i] = pui8T[i] ^ pui8RK[16 * iRound + i];
+        }
+    }
+
+    memcpy(pui8Out, pui8S, 16);
+}
+
+#endif
+
+//
+// Build counter block A_i (RFC 3610 section 2.3) for the given nonce.
+//
+static void
+CCMCounterBlock(uint8_t *pui8Block, const uint8_t *pui8Nonce, int i)
+{
+    pui8Block[0] = 0x01;
+    memcpy(pui8Block + 1, pui8Nonce, CCM_NONCE_LEN);
+    pui8Block[14] = (uint8_t)(i >> 8);
+    pui8Block[15] = (uint8_t)i;
+}
+
+//
+// Compute the raw CBC-MAC, T, over a plaintext message with no associated
+// data.  The nonce already binds the frame header, so none is needed.
+//
+static void
+CCMMac(const tCCMKey *psKey, const uint8_t *pui8Nonce, const uint8_t *pui8Data,
+       int iLen, uint8_t *pui8X)
+{
+    int i, iBlock;
+
+    //
+    // B_0: flags (M and L encoded), nonce and message length.
+    //
+    pui8X[0] = (((CCM_MIC_LEN - 2) / 2) << 3) | 0x01;
+    memcpy(pui8X + 1, pui8Nonce, CCM_NONCE_LEN);
+    pui8X[14] = (uint8_t)(iLen >> 8);
+    pui8X[15] = (uint8_t)iLen;
+    CCMEncryptBlock(psKey, pui8X, pui8X);
+
+    for(iBlock = 0; iBlock < iLen; iBlock += CCM_BLOCK_LEN)
+    {
+        for(i = 0; (i < CCM_BLOCK_LEN) && (iBlock + i < iLen); i++)
+        {
+            pui8X[i] ^= pui8Data[iBlock + i];
+        }
+        CCMEncryptBlock(psKey, pui8X, pui8X);
+    }
+}
+
+//
+// XOR the data with the CTR keystream S_1, S_2, ...
+//
+static void
+CCMCtr(const tCCMKey *psKey, const uint8_t *pui8Nonce, uint8_t *pui8Data,
+       int iLen)
+{
+    uint8_t pui8S[CCM_BLOCK_LEN];
+    int i, iBlock;
+
+    for(iBlock = 0; iBlock < iLen; iBlock += CCM_BLOCK_LEN)
+    {
+        CCMCounterBlock(pui8S, pui8Nonce, 1 + iBlock / CCM_BLOCK_LEN);
+        CCMEncryptBlock(psKey, pui8S, pui8S);
+        for(i = 0; (i < CCM_BLOCK_LEN) && (iBlock + i < iLen); i++)
+        {
+            pui8Data[iBlock + i] ^= pui8S[i];
+        }
+    }
+}
+
+//
+// Encrypt iLen bytes of pui8Data in place and write the CCM_MIC_LEN byte
+// message integrity code to pui8MIC.
+//
+void
+CCMSeal(const tCCMKey *psKey, const uint8_t *pui8Nonce, uint8_t *pui8Data,
+        int iLen, uint8_t *pui8MIC)
+{
+    uint8_t pui8X[CCM_BLOCK_LEN], pui8S0[CCM_BLOCK_LEN];
+    int i;
+
+    CCMMac(psKey, pui8Nonce, pui8Data, iLen, pui8X);
+    CCMCounterBlock(pui8S0, pui8Nonce, 0);
+    CCMEncryptBlock(psKey, pui8S0, pui8S0);
+    for(i = 0; i < CCM_MIC_LEN; i++)
+    {
+        pui8MIC[i] = pui8X[i] ^ pui8S0[i];
+    }
+    CCMCtr(psKey, pui8Nonce, pui8Data, iLen);
+}
+
+//
+// Decrypt iLen bytes of pui8Data in place and check them against pui8MIC.
+// Returns false, with the buffer contents undefined, if the check fails.
+//
+bool
+CCMOpen(const tCCMKey *psKey, const uint8_t *pui8Nonce, uint8_t *pui8Data,
+        int iLen, const uint8_t *pui8MIC)
+{
+    uint8_t pui8X[CCM_BLOCK_LEN], pui8S0[CCM_BLOCK_LEN];
+    uint8_t ui8Diff = 0;
+    int i;
+
+    CCMCtr(psKey, pui8Nonce, pui8Data, iLen);
+    CCMMac(psKey, pui8Nonce, pui8Data, iLen, pui8X);
+    CCMCounterBlock(pui8S0, pui8Nonce, 0);
+    CCMEncryptBlock(psKey, pui8S0, pui8S0);
+
+    //
+    // Compare the whole MIC so the time taken does not depend on where the
+    // first mismatch is.
+    //
+    for(i = 0; i < CCM_MIC_LEN; i++)
+    {
+        ui8Diff |= pui8MIC[i] ^ pui8X[i] ^ pui8S0[i];
+    }
+    return(ui8Diff == 0);
+}
@@ -0,0 +1,39 @@
+//*****************************************************************************
+//
+// ccm.h - AES-128 CCM authenticated encryption for radio payloads.
+//
+//*****************************************************************************
+
+#ifndef __CCM_H__
+#define __CCM_H__
+
+//
+// CCM parameters used on the radio link (RFC 3610 notation).  L = 2 leaves
+// a 13 byte nonce, M = 4 keeps the MIC small enough for 32 byte payloads.
+//
+#define CCM_BLOCK_LEN           16
+#define CCM_NONCE_LEN           13
+#define CCM_MIC_LEN             4
+
+//
+// Expanded AES-128 key.  The raw key is kept for the TM4C129 AES engine,
+// the round keys for the software implementation.
+//
+typedef struct
+{
+    uint32_t pui32Key[4];
+
+    uint8_t pui8RoundKey[176];
+}
+tCCMKey;
+
+void CCMInit(void);
+void CCMKeySet(tCCMKey *psKey, const uint8_t *pui8Key);
+void CCMEncryptBlock(const tCCMKey *psKey, const uint8_t *pui8In,
+                     uint8_t *pui8Out);
+void CCMSeal(const tCCMKey *psKey, const uint8_t *pui8Nonce,
+             uint8_t *pui8Data, int iLen, uint8_t *pui8MIC);
+bool CCMOpen(const tCCMKey *psKey, const uint8_t *pui8Nonce,
+             uint8_t *pui8Data, int iLen, const uint8_t *pui8MIC);
+
+#endif
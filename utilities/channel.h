@@ -0,0 +1,35 @@
+//*****************************************************************************
+//
+// channel.h - How nodes are split between the master's radios.
+//
+// The master has CHANNEL_RADIOS radios, each on its own RF channel with its
+// own share of the nodes, so they poll in parallel.  A node's radio follows
+// from its ID; it tunes to that radio's channel and polls and relays only
+// within it.  Nodes and master must be built with the same count.
+//
+//*****************************************************************************
+
+#ifndef __CHANNEL_H__
+#define __CHANNEL_H__
+
+#ifndef CHANNEL_RADIOS
+#define CHANNEL_RADIOS          2
+#endif
+
+//
+// Radio 0 keeps the nRF24L01's reset channel, 2402 MHz.  The rest are
+// spread far enough apart that 2 Mbps traffic on one does not spill into
+// the next.
+//
+#define CHANNEL_BASE            2
+#define CHANNEL_SPACING         40
+
+#define CHANNEL_RADIO_RF(radio) (CHANNEL_BASE + ((radio) * CHANNEL_SPACING))
+
+//
+// The master's radio for node ID id, and the RF channel the node uses.
+//
+#define CHANNEL_RADIO(id)       ((id) % CHANNEL_RADIOS)
+#define CHANNEL_RF(id)          CHANNEL_RADIO_RF(CHANNEL_RADIO(id))
+
+#endif
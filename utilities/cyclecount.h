@@ -0,0 +1,31 @@
+//*****************************************************************************
+//
+// cyclecount.h - Cortex-M4 DWT cycle counter access for timing measurements.
+//
+//*****************************************************************************
+
+#ifndef __CYCLECOUNT_H__
+#define __CYCLECOUNT_H__
+
+#define DEM_CR                  0xE000EDFC // Debug Exception and Monitor Control
+#define DEM_CR_TRCENA           0x01000000 // Enable DWT and ITM
+#define DWT_CTRL                0xE0001000 // DWT Control
+#define DWT_CTRL_CYCCNTENA      0x00000001 // Enable CYCCNT
+#define DWT_CYCCNT              0xE0001004 // DWT Cycle Count
+
+//
+// Start the free-running core cycle counter.  Differences of two
+// CycleCountGet() readings are valid across a single 32-bit wrap.
+//
+#define CycleCountEnable()                                                    \
+    do                                                                        \
+    {                                                                         \
+        HWREG(DEM_CR) |= DEM_CR_TRCENA;                                       \
+        HWREG(DWT_CYCCNT) = 0;                                                \
+        HWREG(DWT_CTRL) |= DWT_CTRL_CYCCNTENA;                                \
+    }                                                                         \
+    while(0)
+
+#define CycleCountGet()         HWREG(DWT_CYCCNT)
+
+#endif
@@ -0,0 +1,44 @@
+//*****************************************************************************
+//
+// deliver.h - End to end confirmation of commands sent in ACK payloads.
+//
+// The radio's ACK only tells a node that its poll arrived; the master never
+// learns whether the ACK payload with a command made it back.  So commands
+// sent in ACK payloads carry a sequence number, which the node echoes in
+// its next poll.  The master sends a command again until it is echoed, and
+// the node carries out a repeat of the last sequence number only once.
+//
+// The master reports each command on its console, one line per event:
+//
+//     DELIVERY <node> <seq> queued
+//     DELIVERY <node> <seq> ok <latency us> <tries>
+//     DELIVERY <node> <seq> failed <tries>
+//     DELIVERY <node> <seq> replaced
+//
+// Latency runs from the command being entered to the ACK that delivered
+// it.  A command is replaced if another is entered for the node before it
+// is first sent.
+//
+//*****************************************************************************
+
+#ifndef __DELIVER_H__
+#define __DELIVER_H__
+
+//
+// [E1][seq][command], master to node.  Sequence numbers are never 0.
+//
+#define DELIVER_MSG_CMD         0xE1
+#define DELIVER_HDR_LEN         2
+
+//
+// [E2][seq], node to master, in the poll after a command.
+//
+#define DELIVER_MSG_ACK         0xE2
+#define DELIVER_ACK_LEN         2
+
+//
+// Times a command is sent before the master gives up on it.
+//
+#define DELIVER_MAX_TRIES       8
+
+#endif
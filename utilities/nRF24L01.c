@@ -10,17 +10,142 @@
 #include "driverlib/gpio.h"
 #include "driverlib/ssi.h"
 
+#include "inc/hw_gpio.h"
 #include "inc/hw_memmap.h"
+#include "inc/hw_ssi.h"
+#include "inc/hw_types.h"
 
 #include "nRF24L01.h"
+#include "board.h"
+#include "cyclecount.h"
+#include "ramfunc.h"
+#include "spitrace.h"
 
-#ifdef TARGET_IS_BLIZZARD_RA3
-    #define CS_PORT GPIO_PORTE_BASE
-    #define CS_PIN  GPIO_PIN_0
+static tnRFRadio g_snRFBoardRadio =
+{
+    BOARD_RADIO0_SSI_BASE, BOARD_RADIO0_CS_PORT, BOARD_RADIO0_CS_PIN
+};
+
+tnRFRadio *g_psnRFRadio = &g_snRFBoardRadio;
+
+//
+// The radio SPI transfers act on.  On a board with one radio it is known at
+// compile time, so the chip select and SSI accesses are single stores and
+// loads to fixed addresses.
+//
+#if BOARD_RADIOS > 1
+#define nRF_SSI                 (g_psnRFRadio->ui32SSIBase)
+#define nRF_CS_PORT             (g_psnRFRadio->ui32CSPort)
+#define nRF_CS_PIN              (g_psnRFRadio->ui8CSPin)
 #else
-    #define CS_PORT GPIO_PORTQ_BASE
-    #define CS_PIN  GPIO_PIN_7
+#define nRF_SSI                 BOARD_RADIO0_SSI_BASE
+#define nRF_CS_PORT             BOARD_RADIO0_CS_PORT
+#define nRF_CS_PIN              BOARD_RADIO0_CS_PIN
+#endif
+
+void
+nRFRadioSelect(tnRFRadio *psRadio)
+{
+    g_psnRFRadio = psRadio;
+}
+
+//
+// Clock iLen bytes out to the radio.  SSIDataPut() and the rest are done
+// on the registers directly, since each costs a call per byte.
+//
+RAMFUNC void
+SPISend(int iLen, uint8_t *data)
+{
+    uint32_t ui32SSI = nRF_SSI;
+#ifdef SPI_TRACE
+    uint32_t ui32Start, ui32RXData;
+    uint8_t ui8Cmd = *data;
+    int iTraceLen = iLen;
+
+    //
+    // The STATUS byte clocked out with the command is left at the head of
+    // the RX FIFO, so start with it empty.
+    //
+    while(HWREG(ui32SSI + SSI_O_SR) & SSI_SR_RNE)
+    {
+        ui32RXData = HWREG(ui32SSI + SSI_O_DR);
+    }
+    ui32Start = CycleCountGet();
+#endif
+    BoardPinWrite(nRF_CS_PORT, nRF_CS_PIN, 0x00);
+    while(iLen-- > 0)
+    {
+        while(!(HWREG(ui32SSI + SSI_O_SR) & SSI_SR_TNF))
+        {
+        }
+        HWREG(ui32SSI + SSI_O_DR) = *data++;
+    }
+    while(BoardSSIBusy(ui32SSI))
+    {
+        // Wait for SSI to finish transmitting
+    }
+    BoardPinWrite(nRF_CS_PORT, nRF_CS_PIN, nRF_CS_PIN);
+#ifdef SPI_TRACE
+    if(HWREG(ui32SSI + SSI_O_SR) & SSI_SR_RNE)
+    {
+        ui32RXData = HWREG(ui32SSI + SSI_O_DR);
+        SPITraceRecord(ui32Start, CycleCountGet(), ui8Cmd, iTraceLen,
+                       ui32RXData, SPI_TRACE_STATUS);
+    } else {
+        SPITraceRecord(ui32Start, CycleCountGet(), ui8Cmd, iTraceLen, 0, 0);
+    }
+#endif
+}
+
+//
+// Clock iLen bytes out to the radio and keep the iLen clocked back, the
+// first of which is its STATUS register.
+//
+RAMFUNC void
+SPIReceive(int iLen, uint8_t *p_ui8TXData, uint8_t *p_ui8RXData)
+{
+    uint32_t ui32SSI = nRF_SSI;
+    uint32_t ui32RXData;
+#ifdef SPI_TRACE
+    uint32_t ui32Start;
+    uint8_t *pui8Status = p_ui8RXData;
+    uint8_t ui8Cmd = *p_ui8TXData;
+    int iTraceLen = iLen;
+#endif
+    while(BoardSSIBusy(ui32SSI))
+    {
+        // Wait for SSI to finish transmitting
+    }
+    while(HWREG(ui32SSI + SSI_O_SR) & SSI_SR_RNE)
+    {
+        ui32RXData = HWREG(ui32SSI + SSI_O_DR);
+    }
+#ifdef SPI_TRACE
+    ui32Start = CycleCountGet();
 #endif
+    BoardPinWrite(nRF_CS_PORT, nRF_CS_PIN, 0x00);
+    while(iLen-- > 0)
+    {
+        while(!(HWREG(ui32SSI + SSI_O_SR) & SSI_SR_TNF))
+        {
+        }
+        HWREG(ui32SSI + SSI_O_DR) = *(p_ui8TXData++);
+        while(!(HWREG(ui32SSI + SSI_O_SR) & SSI_SR_RNE))
+        {
+        }
+        ui32RXData = HWREG(ui32SSI + SSI_O_DR);
+        *(p_ui8RXData++) = ui32RXData & 0x000000FF;
+    }
+    while(BoardSSIBusy(ui32SSI))
+    {
+        // Wait for SSI to finish transmitting
+    }
+    BoardPinWrite(nRF_CS_PORT, nRF_CS_PIN, nRF_CS_PIN);
+#ifdef SPI_TRACE
+    SPITraceRecord(ui32Start, CycleCountGet(), ui8Cmd, iTraceLen, *pui8Status,
+                   SPI_TRACE_READ | SPI_TRACE_STATUS);
+#endif
+}
 
 void
 nRFSetAddressWidth(uint8_t ui8Width)
@@ -52,29 +177,36 @@ nRFFlushRX()
 
 //
 // Clears any interrupts on the radio and returns the
-// state of the radio's interrupt flags.
+// state of the radio's interrupt flags.  The STATUS byte clocked out with
+// the write command is written straight back, clearing the flags it has
+// set.
 //
 // **WARNING** This function will discard any items
 //     pending in the SSI RX FIFO.
 //
-uint8_t
+RAMFUNC uint8_t
 nRFClearInterrupt()
 {
+    uint32_t ui32SSI = nRF_SSI;
     uint32_t ui32RXData;
-    while(SSIDataGetNonBlocking(SSI2_BASE, &ui32RXData))
+    while(HWREG(ui32SSI + SSI_O_SR) & SSI_SR_RNE)
     {
+        ui32RXData = HWREG(ui32SSI + SSI_O_DR);
     }
-    GPIOPinWrite(CS_PORT, CS_PIN, 0x00);
-    SSIDataPut(SSI2_BASE, nRF_WR_REG | nRF_O_STATUS);
-    SSIDataGet(SSI2_BASE, &ui32RXData);
-    SSIDataPut(SSI2_BASE, ui32RXData);
-    while(SSIBusy(SSI2_BASE))
+    BoardPinWrite(nRF_CS_PORT, nRF_CS_PIN, 0x00);
+    HWREG(ui32SSI + SSI_O_DR) = nRF_WR_REG | nRF_O_STATUS;
+    while(!(HWREG(ui32SSI + SSI_O_SR) & SSI_SR_RNE))
     {
     }
-    GPIOPinWrite(CS_PORT, CS_PIN, CS_PIN);
+    ui32RXData = HWREG(ui32SSI + SSI_O_DR);
+    HWREG(ui32SSI + SSI_O_DR) = ui32RXData;
+    while(BoardSSIBusy(ui32SSI))
+    {
+    }
+    BoardPinWrite(nRF_CS_PORT, nRF_CS_PIN, nRF_CS_PIN);
     return ui32RXData;
 }
-void
+RAMFUNC void
 nRFDataPut(uint8_t* pui8Data, int iLen)
 {
     uint8_t cmd[iLen + 1];
@@ -83,6 +215,19 @@ nRFDataPut(uint8_t* pui8Data, int iLen)
     SPISend(iLen + 1, cmd);
 }
 
+//
+// Write a packet to the TX FIFO to be sent without the auto ACK.  The
+// radio must have nRF_EN_DYN_ACK set in FEATURE.
+//
+void
+nRFDataPutNoAck(uint8_t* pui8Data, int iLen)
+{
+    uint8_t cmd[iLen + 1];
+    cmd[0] = nRF_WR_TX_PL_NO_ACK;
+    memcpy(cmd + 1, pui8Data, iLen);
+    SPISend(iLen + 1, cmd);
+}
+
 void
 nRFConfig(uint8_t ui8Flags)
 {
@@ -108,7 +253,7 @@ nRFSetPayloadWidth(uint8_t ui8Width)
 // **WARNING** This function will discard any items
 //     pending in the SSI RX FIFO.
 //
-uint32_t
+RAMFUNC uint32_t
 nRFGetPayloadWidth(void)
 {
     uint8_t cmd[] = {nRF_RD_RX_PL_WID, 0x00};
@@ -129,7 +274,7 @@ nRFGetPayloadWidth(void)
     return ui32RXData;*/
 }
 
-void
+RAMFUNC void
 nRFDataPutAck(int iPipe, uint8_t* pui8Data, int iLen)
 {
     uint8_t cmd[iLen + 1];
@@ -146,6 +291,13 @@ nRFDynPayloadEnable(int iPipe)
 }
 
 void
+nRFRXPipesEnable(uint8_t ui8Pipes)
+{
+    uint8_t cmd[] = {nRF_WR_REG | nRF_O_EN_RXADDR, ui8Pipes};
+    SPISend(2, cmd);
+}
+
+RAMFUNC void
 nRFDataGet(uint8_t* pui8Data, int iLen)
 {
     uint8_t cmd[iLen + 1];
@@ -197,7 +349,14 @@ nRFSetTXAddress(uint8_t* pui8Address, int iLen)
     SPISend(iLen + 1, cmd);
 }
 
-uint8_t
+void
+nRFSetChannel(uint8_t ui8Channel)
+{
+    uint8_t cmd[] = {nRF_WR_REG | nRF_O_RF_CH, ui8Channel};
+    SPISend(2, cmd);
+}
+
+RAMFUNC uint8_t
 nRFStatusGet(void)
 {
     uint8_t cmd = nRF_NOP;
@@ -214,3 +373,139 @@ nRFStatusGet(void)
     GPIOPinWrite(CS_PORT, CS_PIN, CS_PIN);
     return ui32RXData;*/
 }
+
+RAMFUNC uint8_t
+nRFRegisterRead(uint8_t ui8Reg)
+{
+    uint8_t cmd[] = {nRF_RD_REG | ui8Reg, nRF_NOP};
+    uint8_t RXData[2];
+    SPIReceive(2, cmd, RXData);
+    return RXData[1];
+}
+
+//
+// Busy wait until ui32Us microseconds after the cycle count ui32Start.
+//
+static void
+nRFWaitUntil(uint32_t ui32SysClock, uint32_t ui32Start, uint32_t ui32Us)
+{
+    uint32_t ui32Cycles = (ui32SysClock / 1000000) * ui32Us;
+
+    while(CycleCountGet() - ui32Start < ui32Cycles)
+    {
+    }
+}
+
+//
+// Wait out the radio's power on reset.  Only needed when the radio was
+// powered up along with the processor.  Timed from the cycle counter, which
+// must have been started as soon as the system clock was set, so no more of
+// the reset is waited for than is left.
+//
+void
+nRFPowerOnWait(uint32_t ui32SysClock)
+{
+    nRFWaitUntil(ui32SysClock, 0, nRF_POR_US);
+}
+
+//
+// Read back the registers in psRegs from the selected radio.  Returns true
+// if every one holds the value given.  STATUS comes back with each read,
+// and its top bit always reads as zero, so a MISO line stuck high fails
+// here too.
+//
+bool
+nRFRegistersCheck(const tnRFRegister *psRegs, int iCount)
+{
+    uint8_t pui8Cmd[6], pui8RXData[6];
+    int i;
+
+    memset(pui8Cmd, nRF_NOP, sizeof(pui8Cmd));
+    for(i = 0; i < iCount; i++)
+    {
+        pui8Cmd[0] = nRF_RD_REG | psRegs[i].ui8Reg;
+        SPIReceive(psRegs[i].ui8Len + 1, pui8Cmd, pui8RXData);
+        if((pui8RXData[0] & 0x80) ||
+           (memcmp(pui8RXData + 1, psRegs[i].pui8Value,
+                   psRegs[i].ui8Len) != 0))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+//
+// Write the registers in psRegs back to back, then read them back.  Returns
+// true if every one holds what was written.
+//
+static bool
+nRFRegistersApply(const tnRFRegister *psRegs, int iCount)
+{
+    uint8_t pui8Cmd[6];
+    int i;
+
+    for(i = 0; i < iCount; i++)
+    {
+        pui8Cmd[0] = nRF_WR_REG | psRegs[i].ui8Reg;
+        memcpy(pui8Cmd + 1, psRegs[i].pui8Value, psRegs[i].ui8Len);
+        SPISend(psRegs[i].ui8Len + 1, pui8Cmd);
+    }
+    return nRFRegistersCheck(psRegs, iCount);
+}
+
+//
+// Configure the selected radio from whatever state a reset left it in, and
+// check that the configuration took.  CE must be low.
+//
+// The registers in psRegs are written and read back, every
+// nRF_BOOT_RETRY_US until they match.  A radio that has not matched after
+// nRF_BOOT_TIMEOUT_US is taken to be missing, and false is returned.
+// Otherwise the FIFOs and interrupt flags are cleared of anything left from
+// before the reset, CONFIG is set to ui8Config and checked, and the call
+// returns once the radio has reached standby.  A radio that a warm reset
+// left powered up is kept up, so there is no crystal start to wait for.
+//
+bool
+nRFBringUp(uint32_t ui32SysClock, uint8_t ui8Config,
+           const tnRFRegister *psRegs, int iCount)
+{
+    uint8_t pui8Cmd[] = {nRF_WR_REG | nRF_O_STATUS,
+                         nRF_INT_RX_DR | nRF_INT_TX_DS | nRF_INT_MAX_RT};
+    uint32_t ui32Start;
+    uint8_t ui8PwrUp;
+
+    ui8PwrUp = nRFRegisterRead(nRF_O_CONFIG);
+    ui8PwrUp = (ui8PwrUp & 0x80) ? 0 : (ui8PwrUp & ui8Config & nRF_CFG_PWR_UP);
+
+    ui32Start = CycleCountGet();
+    while(1)
+    {
+        nRFConfig((ui8Config & ~nRF_CFG_PWR_UP) | ui8PwrUp);
+        if(nRFRegistersApply(psRegs, iCount))
+        {
+            break;
+        }
+        if(CycleCountGet() - ui32Start >=
+           (ui32SysClock / 1000000) * nRF_BOOT_TIMEOUT_US)
+        {
+            return false;
+        }
+        nRFWaitUntil(ui32SysClock, CycleCountGet(), nRF_BOOT_RETRY_US);
+    }
+
+    nRFFlushTX();
+    nRFFlushRX();
+    SPISend(2, pui8Cmd);
+    nRFConfig(ui8Config);
+    ui32Start = CycleCountGet();
+    if(nRFRegisterRead(nRF_O_CONFIG) != ui8Config)
+    {
+        return false;
+    }
+    if(!ui8PwrUp && (ui8Config & nRF_CFG_PWR_UP))
+    {
+        nRFWaitUntil(ui32SysClock, ui32Start, nRF_PD2STBY_US);
+    }
+    return true;
+}
@@ -71,6 +71,22 @@
 #define nRF_INT_MAX_RT          0x10 // Maximum Number of Re-Transmissions Interrupt
 #define nRF_STAT_RX_P_NO        0x0E // Data Pipe Number of Payload Available in RX FIFO
 #define nRF_STAT_TX_FULL        0x01 // TX FIFO Full Flag
+#define nRF_RX_P_NO_EMPTY       7    // RX_P_NO value when the RX FIFO is empty
+
+//
+// Defines for the bit fields in the OBSERVE_TX register.
+//
+#define nRF_OBS_PLOS_CNT        0xF0 // Count Lost Packets
+#define nRF_OBS_ARC_CNT         0x0F // Count Retransmitted Packets
+
+//
+// Defines for the bit fields in the FIFO_STATUS register.
+//
+#define nRF_FIFO_TX_REUSE       0x40 // Reuse Last Transmitted Data Packet
+#define nRF_FIFO_TX_FULL        0x20 // TX FIFO Full Flag
+#define nRF_FIFO_TX_EMPTY       0x10 // TX FIFO Empty Flag
+#define nRF_FIFO_RX_FULL        0x02 // RX FIFO Full Flag
+#define nRF_FIFO_RX_EMPTY       0x01 // RX FIFO Empty Flag
 
 //
 // Defines for the bit fields in the FEATURE register.
@@ -96,6 +112,55 @@
 #define nRF_AW_4_BYTES          0x10
 #define nRF_AW_5_BYTES          0x11
 
+//
+// Timing from the nRF24L01+ datasheet: power on reset, power down to
+// standby with the crystal starting, and standby to TX or RX settling.
+//
+#define nRF_POR_US              100000
+#define nRF_PD2STBY_US          1500
+#define nRF_STBY2A_US           130
+
+//
+// nRFBringUp() repeats its writes this often while the radio does not read
+// them back, and gives the radio up as missing after nRF_BOOT_TIMEOUT_US.
+//
+#define nRF_BOOT_RETRY_US       100
+#define nRF_BOOT_TIMEOUT_US     20000
+
+//
+// A register value for nRFBringUp().  Address registers take up to five
+// bytes, the rest one.
+//
+typedef struct
+{
+    uint8_t ui8Reg;
+
+    uint8_t ui8Len;
+
+    uint8_t pui8Value[5];
+}
+tnRFRegister;
+
+//
+// One radio: the SSI it is on and its chip select pin.  The driver calls,
+// SPISend() and SPIReceive() included, act on the radio last passed to
+// nRFRadioSelect(), which is radio 0 of board.h until then.  Select radios
+// from one context only; a program with one radio never needs to.
+//
+typedef struct
+{
+    uint32_t ui32SSIBase;
+
+    uint32_t ui32CSPort;
+
+    uint8_t ui8CSPin;
+}
+tnRFRadio;
+
+extern tnRFRadio *g_psnRFRadio;
+
+void nRFRadioSelect(tnRFRadio *psRadio);
+
 void SPISend(int iLen, uint8_t *data);
 void SPIReceive(int iLen, uint8_t *p_ui8TXData, uint8_t *p_ui8RXData);
 
@@ -105,15 +170,23 @@ void nRFFlushTX(void);
 void nRFFlushRX(void);
 uint8_t nRFClearInterrupt(void);
 void nRFDataPut(uint8_t* pui8Data, int iLen);
+void nRFDataPutNoAck(uint8_t* pui8Data, int iLen);
 void nRFDataGet(uint8_t* pui8Data, int iLen);
 void nRFDataPutAck(int iPipe, uint8_t* pui8Data, int iLen);
 void nRFConfig(uint8_t ui8Flags);
 void nRFFeatureSet(uint8_t ui8Flags);
 void nRFDynPayloadEnable (int iPipe);
+void nRFRXPipesEnable(uint8_t ui8Pipes);
 void nRFSetPayloadWidth(uint8_t ui8Width);
 uint32_t nRFGetPayloadWidth(void);
 void nRFSetAddress(int iDataPipe, uint8_t* pui8Address, int iLen);
 void nRFSetTXAddress(uint8_t* pui8Address, int iLen);
+void nRFSetChannel(uint8_t ui8Channel);
 uint8_t nRFStatusGet(void);
+uint8_t nRFRegisterRead(uint8_t ui8Reg);
+void nRFPowerOnWait(uint32_t ui32SysClock);
+bool nRFRegistersCheck(const tnRFRegister *psRegs, int iCount);
+bool nRFBringUp(uint32_t ui32SysClock, uint8_t ui8Config,
+                const tnRFRegister *psRegs, int iCount);
 
 #endif
@@ -0,0 +1,28 @@
+//*****************************************************************************
+//
+// netkey.h - Network master key for the home automation radio link.
+//
+// Every node key, and the broadcast key, is derived from this key and an ID
+// with SecureKeyDerive(), so only the master needs to hold it.  It is built
+// into the master and the host tools, never into a node image: a node's
+// flash would give away every other node's key.  Nodes are given their own
+// keys by host/provision.
+//
+// **WARNING** Replace this key before deploying a network.
+//
+//*****************************************************************************
+
+#ifndef __NETKEY_H__
+#define __NETKEY_H__
+
+#ifdef PART_TM4C123GH6PM
+#error "The network key must not be built into a node"
+#endif
+
+#define NETWORK_KEY                                                           \
+    {                                                                         \
+        0x48, 0x6f, 0x6d, 0x65, 0x41, 0x75, 0x74, 0x6f,                       \
+        0x6d, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x4b, 0x31                        \
+    }
+
+#endif
@@ -0,0 +1,1247 @@
+//*****************************************************************************
+//
+// node.c - Radio runtime shared by the slave nodes.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "driverlib/sysctl.h"
+#include "driverlib/cpu.h"
+#include "driverlib/ssi.h"
+#include "driverlib/flash.h"
+#include "driverlib/gpio.h"
+#include "driverlib/pin_map.h"
+#include "driverlib/rom.h"
+#include "driverlib/rom_map.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/timer.h"
+
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_timer.h"
+#include "inc/hw_types.h"
+
+#include "nRF24L01.h"
+#include "secure.h"
+#include "cyclecount.h"
+#include "timesync.h"
+#include "push.h"
+#include "broadcast.h"
+#include "tdma.h"
+#include "relay.h"
+#include "backoff.h"
+#include "deliver.h"
+#include "channel.h"
+#include "board.h"
+#include "boot.h"
+#include "node.h"
+
+//
+// How this node uses the runtime, as given to NodeInit().
+//
+static const tNodeConfig *g_psNode;
+
+//
+// Unique 8-bit ID for this node.
+//
+uint8_t g_ui8ID;
+
+//
+// Key and replay counters for the secure link to the master.  A frame from
+// a new master epoch may mean the master has reset, and refuses polls from
+// the epoch this node is in; the next poll moves on to a fresh one.
+//
+tSecureLink g_sLink;
+volatile bool g_bEpochDue;
+
+//
+// Link broadcasts from the master arrive on, and copies of broadcasts
+// already taken, which are dropped unopened.
+//
+tSecureLink g_sBroadcast;
+uint32_t g_ui32BroadcastRepeats;
+
+//
+// Cycles taken to seal the last poll and open the last command, for
+// inspection from the debugger.
+//
+uint32_t g_ui32SealCycles;
+uint32_t g_ui32OpenCycles;
+
+//
+// Local microsecond clock, built on Timer2, and its offset from the
+// master's network time.
+//
+tTimeClock g_sClock;
+tTimeSync g_sSync;
+
+//
+// Command waiting for its execute-at time, which Timer3A counts down to.
+// Commands received too late are run at once and counted.
+//
+uint8_t g_pui8AtCmd[SECURE_MAX_PAYLOAD];
+int g_iAtLen;
+uint32_t g_ui32AtLate;
+
+//
+// Sequence number of the last command from the master, the master's epoch
+// it came in, and whether the next poll must echo it.  A repeat, sent again
+// because the echo was lost, is echoed but not carried out twice.
+//
+uint8_t g_ui8CmdSeq;
+uint32_t g_ui32CmdEpoch;
+volatile bool g_bEchoDue;
+uint32_t g_ui32CmdRepeats;
+
+//
+// Radio configuration, less the PRIM_RX bit.  All three radio interrupts
+// are left enabled; the handler tells them apart by the status register.
+//
+#define RADIO_CFG               (nRF_CFG_EN_CRC | nRF_CFG_PWR_UP)
+
+//
+// Outcome of the last packet sent, as reported by the radio interrupt.
+//
+#define RADIO_TX_PENDING        0
+#define RADIO_TX_ACKED          1
+#define RADIO_TX_FAILED         2
+volatile uint8_t g_ui8TXResult;
+
+//
+// Retransmit delay and count.  At 2 Mbps the radio needs a delay of at
+// least 500 us to take an ACK carrying more than 15 bytes, which sealed
+// replies from the master do; with the reset 250 us the retransmission
+// starts while such an ACK is still on air and the poll is lost.
+//
+#define RADIO_ARD_US            500
+#define RADIO_ARC               3
+#define RADIO_SETUP_RETR        ((((RADIO_ARD_US / 250) - 1) << 4) | RADIO_ARC)
+
+//
+// Time allowed for the outcome, which covers every retransmission: each
+// attempt is a frame and its ACK, under 250 us on air between them, then
+// the delay.
+//
+#define RADIO_TX_TIMEOUT_US     ((RADIO_ARC + 1) * (RADIO_ARD_US + 250))
+
+//
+// Longest SleepUntil() sleeps in one go.
+//
+#define SLEEP_MAX_US            10000000
+
+//
+// Radio interrupts by cause, interrupts with no cause flagged, and packets
+// sent that the radio never reported on, for inspection from the debugger.
+//
+uint32_t g_ui32IntRX;
+uint32_t g_ui32IntTXDone;
+uint32_t g_ui32IntMaxRT;
+uint32_t g_ui32IntSpurious;
+uint32_t g_ui32TXTimeouts;
+
+//
+// Backoff after polls that fail, and the extra time it adds to the wait
+// for the next poll.
+//
+tBackoff g_sBackoff;
+uint32_t g_ui32BackoffUs;
+
+//
+// True while the radio is listening for pushed commands.
+//
+volatile bool g_bListening;
+
+//
+// Polling slot assigned by the master, as slot g_ui8Slot of g_ui8Slots in
+// each period of 2^g_ui8PeriodLog2 us of network time.  Nodes without a
+// slot poll at a fixed interval.
+//
+uint8_t g_ui8Slot;
+uint8_t g_ui8Slots;
+uint8_t g_ui8PeriodLog2;
+
+//
+// The node polls in its slot every 2^g_ui8Pace periods.  Polls made at the
+// present pace without a command coming in, after which it slows down.
+//
+uint8_t g_ui8Pace = TDMA_PACE_START;
+uint8_t g_ui8IdlePolls;
+
+//
+// Retransmissions the last poll needed, reported in the next.
+//
+uint8_t g_ui8Retries;
+
+//
+// Interval between polls, and local time of the last one, for nodes
+// without a slot.
+//
+#define POLL_INTERVAL_US        3750000
+uint32_t g_ui32LastPoll;
+
+//
+// The last poll asked the master to hold this node's ACK payload for a
+// follow-up poll TDMA_JOIN_FOLLOW_US later: because it was sent
+// free-running, or because the node has more to report.  Follow-ups sent
+// since the last poll that was not one.
+//
+bool g_bFollowDue;
+uint8_t g_ui8Follows;
+
+//
+// Local times the radio came up and the master first acknowledged a poll,
+// zero until then, and whether they have yet to reach the master.
+//
+uint32_t g_ui32BootRadioUs;
+uint32_t g_ui32BootPollUs;
+bool g_bBootDue;
+
+//
+// Parents this node can poll through, with the cost of the link to each.
+//
+tRelayTable g_sRoutes;
+
+//
+// Poll from a child waiting to be passed on, and the local time it came in.
+//
+uint8_t g_pui8RelayFrame[SECURE_MAX_FRAME];
+volatile int g_iRelayLen;
+uint32_t g_ui32RelayArrival;
+
+//
+// ACK payload from upstream for this node's children, staged on pipe 2
+// whenever the radio listens.
+//
+uint8_t g_pui8RelayAck[SECURE_MAX_FRAME];
+int g_iRelayAckLen;
+
+//
+// True while a child's poll is being passed on, so that its ACK is not
+// taken as the end of this node's own round trip.
+//
+volatile bool g_bForwarding;
+
+//
+// Polls forwarded and dropped, and the longest any was held, since the last
+// report to the master.
+//
+uint8_t g_ui8RelayForwards;
+uint8_t g_ui8RelayDrops;
+uint16_t g_ui16RelayMaxHold;
+
+//
+// Scheduled commands further ahead than this would overflow Timer3A.
+//
+#define AT_MAX_DELAY_US         50000000
+
+//
+// Return the local time in microseconds.
+//
+static uint32_t
+TimeNow(void)
+{
+    uint32_t ui32Now;
+    bool bMasked;
+
+    bMasked = MAP_IntMasterDisable();
+    ui32Now = TimeClockUpdate(&g_sClock, TimerValueGet(TIMER2_BASE, TIMER_A));
+    if(!bMasked)
+    {
+        MAP_IntMasterEnable();
+    }
+    return(ui32Now);
+}
+
+//
+// Sleep in WFI until local time ui32Until, or until any interrupt comes
+// first.  Timer2A, which keeps local time, raises a match interrupt at
+// ui32Until.  Call with interrupts masked, after checking what is waited
+// for, so an interrupt in between still ends the sleep; it runs once the
+// caller unmasks them.
+//
+static void
+SleepUntil(uint32_t ui32Until)
+{
+    uint32_t ui32Raw = TimerValueGet(TIMER2_BASE, TIMER_A);
+    int32_t i32Wait;
+
+    i32Wait = (int32_t)(ui32Until - TimeClockUpdate(&g_sClock, ui32Raw));
+    if(i32Wait <= 0)
+    {
+        return;
+    }
+
+    //
+    // Wake at least once in SLEEP_MAX_US, well within a wrap of the timer.
+    //
+    if(i32Wait > SLEEP_MAX_US)
+    {
+        i32Wait = SLEEP_MAX_US;
+    }
+    MAP_TimerMatchSet(TIMER2_BASE, TIMER_A,
+                      ui32Raw + i32Wait * g_sClock.ui32TicksPerUs);
+    MAP_TimerIntClear(TIMER2_BASE, TIMER_TIMA_MATCH);
+    MAP_TimerIntEnable(TIMER2_BASE, TIMER_TIMA_MATCH);
+    CPUwfi();
+    MAP_TimerIntDisable(TIMER2_BASE, TIMER_TIMA_MATCH);
+}
+
+//
+// The match SleepUntil() set has been reached.  Waking is all it is for.
+//
+void
+Timer2AIntHandler(void)
+{
+    MAP_TimerIntClear(TIMER2_BASE, TIMER_TIMA_MATCH);
+}
+
+//
+// Hold a TIMESYNC_MSG_AT command until the network time it names.  A newer
+// one replaces any still waiting.
+//
+static void
+CommandSchedule(uint8_t *pui8Msg, int iLen)
+{
+    uint32_t ui32At;
+    int32_t i32Delay;
+
+    if(iLen <= TIMESYNC_AT_HDR_LEN)
+    {
+        return;
+    }
+    memcpy(&ui32At, pui8Msg + 1, 4);
+    i32Delay = (int32_t)(TimeSyncToLocal(&g_sSync, ui32At) - TimeNow());
+
+    MAP_TimerDisable(TIMER3_BASE, TIMER_A);
+    if(!g_sSync.bSynced || (i32Delay <= 0) || (i32Delay > AT_MAX_DELAY_US))
+    {
+        g_ui32AtLate++;
+        CommandExecute(pui8Msg + TIMESYNC_AT_HDR_LEN,
+                       iLen - TIMESYNC_AT_HDR_LEN);
+        return;
+    }
+
+    memcpy(g_pui8AtCmd, pui8Msg + TIMESYNC_AT_HDR_LEN,
+           iLen - TIMESYNC_AT_HDR_LEN);
+    g_iAtLen = iLen - TIMESYNC_AT_HDR_LEN;
+    MAP_TimerLoadSet(TIMER3_BASE, TIMER_A,
+                     i32Delay * (MAP_SysCtlClockGet() / 1000000));
+    MAP_TimerEnable(TIMER3_BASE, TIMER_A);
+}
+
+void
+Timer3AIntHandler(void)
+{
+    MAP_TimerIntClear(TIMER3_BASE, TIMER_TIMA_TIMEOUT);
+    CommandExecute(g_pui8AtCmd, g_iAtLen);
+}
+
+//
+// Take a TDMA_MSG_ASSIGN message from the master.
+//
+static void
+SlotAssign(uint8_t *pui8Msg, int iLen)
+{
+    if((iLen < TDMA_ASSIGN_LEN) || (pui8Msg[1] >= pui8Msg[2]) ||
+       (pui8Msg[3] > 31))
+    {
+        return;
+    }
+    g_ui8Slot = pui8Msg[1];
+    g_ui8Slots = pui8Msg[2];
+    g_ui8PeriodLog2 = pui8Msg[3];
+}
+
+//
+// Take a new pace, from a TDMA_MSG_PACE hint or a command, and start
+// counting idle polls again.  A node with a fixed pace keeps it; the
+// status in its next poll tells the master so.
+//
+static void
+PaceSet(uint8_t ui8Pace)
+{
+    if(g_psNode->ui8Pace != NODE_PACE_ADAPT)
+    {
+        return;
+    }
+    g_ui8Pace = (ui8Pace > TDMA_PACE_MAX) ? TDMA_PACE_MAX : ui8Pace;
+    g_ui8IdlePolls = 0;
+}
+
+//
+// Return the local time of this node's next polling slot.  Until the node
+// has both a slot and network time, wait a fixed interval instead, or just
+// TDMA_JOIN_FOLLOW_US when a follow-up poll is due.  Either way, a backoff
+// after a failed poll is added.
+//
+static uint32_t
+SlotNext(void)
+{
+    uint32_t ui32Period, ui32Net, ui32Next, ui32Earliest;
+
+    if(g_bFollowDue)
+    {
+        ui32Next = g_ui32LastPoll + TDMA_JOIN_FOLLOW_US;
+    }
+    else if((g_ui8Slots == 0) || !g_sSync.bSynced)
+    {
+        ui32Next = g_ui32LastPoll + POLL_INTERVAL_US + g_ui32BackoffUs;
+    }
+    else
+    {
+        //
+        // Skip the periods the pace leaves out and, after a failed poll, the
+        // slots that fall within the backoff.
+        //
+        ui32Period = 1 << g_ui8PeriodLog2;
+        ui32Earliest = g_ui32LastPoll + g_ui32BackoffUs +
+                       ((ui32Period << g_ui8Pace) - ui32Period);
+        if((int32_t)(ui32Earliest - TimeNow()) < 0)
+        {
+            ui32Earliest = TimeNow();
+        }
+        ui32Net = TimeSyncToNetwork(&g_sSync, ui32Earliest);
+        ui32Next = (ui32Net & ~(ui32Period - 1)) +
+                   g_ui8Slot * (ui32Period / g_ui8Slots);
+        while((int32_t)(ui32Next - ui32Net) < TDMA_GUARD_US)
+        {
+            ui32Next += ui32Period;
+        }
+        ui32Next = TimeSyncToLocal(&g_sSync, ui32Next);
+    }
+    return(ui32Next);
+}
+
+//
+// Wait, asleep, for the start of this node's next polling slot.  Returns
+// false early if a child's poll needs passing on.
+//
+static bool
+SlotWait(void)
+{
+    uint32_t ui32Next;
+    uint8_t ui8Pace;
+    bool bSlot = true;
+
+    ui8Pace = g_ui8Pace;
+    ui32Next = SlotNext();
+    MAP_IntMasterDisable();
+    while((int32_t)(ui32Next - TimeNow()) > 0)
+    {
+        if(g_iRelayLen != 0)
+        {
+            bSlot = false;
+            break;
+        }
+
+        //
+        // A pushed command changes the pace during the wait.
+        //
+        if(g_ui8Pace != ui8Pace)
+        {
+            ui8Pace = g_ui8Pace;
+            ui32Next = SlotNext();
+            continue;
+        }
+
+        //
+        // The radio interrupt wakes the node for a push or a child's poll.
+        //
+        SleepUntil(ui32Next);
+        MAP_IntMasterEnable();
+        MAP_IntMasterDisable();
+    }
+    MAP_IntMasterEnable();
+    return(bSlot);
+}
+
+//
+// Stop for good, with the radio never brought up.  A node has no key until
+// host/provision writes one for its ID into EEPROM, and cannot join
+// without it.
+//
+static void
+KeyMissing(void)
+{
+    while(1)
+    {
+        MAP_SysCtlSleep();
+    }
+}
+
+//
+// Bring the radio up on the channel of the master's radio for this node,
+// with its push address on pipe 1, and its relay address on pipe 2 and the
+// broadcast address on pipe 3, which share all but the first byte with
+// pipe 1, retransmitting as RADIO_SETUP_RETR sets.  After a power on or
+// brown-out reset the radio's own power on reset is waited out first.  A
+// radio that does not answer is tried again every BOOT_RADIO_RETRY_MS,
+// rather than run with a configuration it never took.
+//
+static void
+RadioBringUp(bool bPowerOn)
+{
+    tnRFRegister psRegs[] =
+    {
+        {nRF_O_RF_CH, 1, {CHANNEL_RF(g_ui8ID)}},
+        {nRF_O_FEATURE, 1, {nRF_EN_DPL | nRF_EN_ACK_PAY}},
+        {nRF_O_DYNPD, 1, {nRF_DATA_PIPE_0 | nRF_DATA_PIPE_1 |
+                          nRF_DATA_PIPE_2 | nRF_DATA_PIPE_3}},
+        {nRF_O_RX_ADDR_P1, PUSH_ADDR_LEN, PUSH_NODE_ADDR},
+        {nRF_O_RX_ADDR_P2, 1, {g_ui8ID | RELAY_ADDR_FLAG}},
+        {nRF_O_RX_ADDR_P3, 1, {BROADCAST_ID}},
+        {nRF_O_SETUP_RETR, 1, {RADIO_SETUP_RETR}},
+    };
+
+    psRegs[3].pui8Value[0] = g_ui8ID;
+    if(bPowerOn)
+    {
+        nRFPowerOnWait(MAP_SysCtlClockGet());
+    }
+    while(!nRFBringUp(MAP_SysCtlClockGet(), RADIO_CFG, psRegs,
+                      sizeof(psRegs) / sizeof(psRegs[0])))
+    {
+        SysCtlDelay((MAP_SysCtlClockGet() / 3000) * BOOT_RADIO_RETRY_MS);
+    }
+    g_ui32BootRadioUs = TimeNow();
+}
+
+//
+// Listen on pipe 1 for commands pushed by the master, on pipe 2 for polls
+// from children, with any ACK payload held for them, and on pipe 3 for
+// broadcasts.  Pipe 0 is closed so that other nodes' polls to the master
+// are not acknowledged here.
+//
+static void
+RadioListen(void)
+{
+    nRFFlushTX();
+    nRFRXPipesEnable(nRF_DATA_PIPE_1 | nRF_DATA_PIPE_2 | nRF_DATA_PIPE_3);
+    nRFConfig(RADIO_CFG | nRF_CFG_PRIM_RX);
+    if(g_iRelayAckLen != 0)
+    {
+        nRFDataPutAck(2, g_pui8RelayAck, g_iRelayAckLen);
+    }
+    BoardPinWrite(BOARD_RADIO0_CE_PORT, BOARD_RADIO0_CE_PIN,
+                  BOARD_RADIO0_CE_PIN);
+    g_bListening = true;
+}
+
+//
+// Stop listening and get ready to send a poll to a parent, with pipe 0 open
+// for its acknowledgement.
+//
+static void
+RadioTransmit(uint8_t ui8Parent)
+{
+    uint8_t pui8Addr[PUSH_ADDR_LEN];
+
+    BoardPinWrite(BOARD_RADIO0_CE_PORT, BOARD_RADIO0_CE_PIN, 0x00);
+    g_bListening = false;
+    nRFConfig(RADIO_CFG);
+    RelayAddrGet(ui8Parent, pui8Addr);
+    nRFSetTXAddress(pui8Addr, PUSH_ADDR_LEN);
+    nRFSetAddress(0, pui8Addr, PUSH_ADDR_LEN);
+    nRFRXPipesEnable(nRF_DATA_PIPE_0);
+    g_ui8TXResult = RADIO_TX_PENDING;
+}
+
+//
+// Wait for the radio interrupt to report whether the packet just sent was
+// acknowledged, for at most RADIO_TX_TIMEOUT_US.
+//
+static void
+RadioWait(void)
+{
+    uint32_t ui32Start = TimeNow();
+
+    MAP_IntMasterDisable();
+    while((g_ui8TXResult == RADIO_TX_PENDING) &&
+          (TimeNow() - ui32Start < RADIO_TX_TIMEOUT_US))
+    {
+        SleepUntil(ui32Start + RADIO_TX_TIMEOUT_US);
+        MAP_IntMasterEnable();
+        MAP_IntMasterDisable();
+    }
+    MAP_IntMasterEnable();
+}
+
+//
+// Find whether the packet just sent to a parent was acknowledged and how
+// many retransmissions it took, and update the cost of the link.
+//
+static bool
+RadioResult(uint8_t ui8Parent, uint8_t *pui8Retries)
+{
+    bool bAcked;
+
+    if(g_ui8TXResult == RADIO_TX_PENDING)
+    {
+        g_ui32TXTimeouts++;
+    }
+    bAcked = (g_ui8TXResult == RADIO_TX_ACKED);
+    *pui8Retries = nRFRegisterRead(nRF_O_OBSERVE_TX) & nRF_OBS_ARC_CNT;
+    RelayResult(&g_sRoutes, ui8Parent, bAcked, *pui8Retries);
+
+    return(bAcked);
+}
+
+static void
+RelayDrop(void)
+{
+    if(g_ui8RelayDrops < 0xFF)
+    {
+        g_ui8RelayDrops++;
+    }
+}
+
+//
+// Hold a child's poll for the main loop to pass on, adding or updating the
+// route header.  Only one is held at a time; the child's slot keeps others
+// from arriving until it has gone.
+//
+static void
+RelayHold(uint8_t *pui8Frame, int iLen, uint32_t ui32Now)
+{
+    if((g_iRelayLen != 0) || (iLen < 1))
+    {
+        RelayDrop();
+        return;
+    }
+
+    if(pui8Frame[0] & RELAY_FRAME_FLAG)
+    {
+        if(RELAY_HDR_HOPS(pui8Frame[0]) == RELAY_MAX_HOPS)
+        {
+            RelayDrop();
+            return;
+        }
+        memcpy(g_pui8RelayFrame, pui8Frame, iLen);
+        g_pui8RelayFrame[0] += 1 << 4;
+    }
+    else
+    {
+        if(iLen >= SECURE_MAX_FRAME)
+        {
+            RelayDrop();
+            return;
+        }
+        g_pui8RelayFrame[0] = RELAY_HDR(1, g_ui8ID);
+        memcpy(g_pui8RelayFrame + 1, pui8Frame, iLen++);
+    }
+    g_ui32RelayArrival = ui32Now;
+    g_iRelayLen = iLen;
+}
+
+//
+// Pass the held poll on to this node's best parent.  The parent's ACK
+// payload is picked up by the radio interrupt.
+//
+static void
+RelayForward(void)
+{
+    uint8_t ui8Parent, ui8Retries;
+    uint32_t ui32Hold;
+
+    MAP_IntMasterDisable();
+    if((int32_t)(TimeNow() - g_ui32RelayArrival) > RELAY_MAX_HOLD_US)
+    {
+        RelayDrop();
+        g_iRelayLen = 0;
+        MAP_IntMasterEnable();
+        return;
+    }
+
+    ui8Parent = RelayParentBest(&g_sRoutes);
+    RadioTransmit(ui8Parent);
+    g_bForwarding = true;
+    nRFFlushTX();
+    nRFDataPut(g_pui8RelayFrame, g_iRelayLen);
+    BoardPinWrite(BOARD_RADIO0_CE_PORT, BOARD_RADIO0_CE_PIN,
+                  BOARD_RADIO0_CE_PIN);
+    SysCtlDelay(500);
+    BoardPinWrite(BOARD_RADIO0_CE_PORT, BOARD_RADIO0_CE_PIN, 0x00);
+    MAP_IntMasterEnable();
+
+    RadioWait();
+
+    MAP_IntMasterDisable();
+    if(RadioResult(ui8Parent, &ui8Retries))
+    {
+        ui32Hold = TimeNow() - g_ui32RelayArrival;
+        if(ui32Hold > 0xFFFF)
+        {
+            ui32Hold = 0xFFFF;
+        }
+        if(ui32Hold > g_ui16RelayMaxHold)
+        {
+            g_ui16RelayMaxHold = ui32Hold;
+        }
+        if(g_ui8RelayForwards < 0xFF)
+        {
+            g_ui8RelayForwards++;
+        }
+    }
+    else
+    {
+        RelayDrop();
+    }
+    g_bForwarding = false;
+    g_iRelayLen = 0;
+    RadioListen();
+    MAP_IntMasterEnable();
+}
+
+//
+// Take a broadcast from the master, and carry out its command if this node
+// is in its mask.  Copies of the one last taken carry the same counter, and
+// are dropped without the cost of opening them.
+//
+static void
+BroadcastHandle(uint8_t *pui8Frame, int iLen)
+{
+    uint8_t pui8Msg[SECURE_MAX_PAYLOAD];
+    uint32_t ui32Counter, ui32Mask;
+
+    if(iLen < SECURE_HDR_LEN)
+    {
+        return;
+    }
+    memcpy(&ui32Counter, pui8Frame + 1, 4);
+    if(ui32Counter == g_sBroadcast.ui32RXCounter)
+    {
+        g_ui32BroadcastRepeats++;
+        return;
+    }
+
+    iLen = SecureOpen(&g_sBroadcast, SECURE_DIR_DOWN, pui8Frame, iLen,
+                      pui8Msg);
+    if((iLen <= BROADCAST_HDR_LEN) || (pui8Msg[0] != BROADCAST_MSG_CMD))
+    {
+        return;
+    }
+    memcpy(&ui32Mask, pui8Msg + 1, 4);
+    if((g_ui8ID < 32) && (ui32Mask & (1 << g_ui8ID)))
+    {
+        CommandExecute(pui8Msg + BROADCAST_HDR_LEN, iLen - BROADCAST_HDR_LEN);
+    }
+}
+
+//
+// Read one packet from the RX FIFO, which arrived on pipe ui8Pipe: a child's
+// poll, an ACK payload for a child, a broadcast or a command from the
+// master.
+//
+static void
+RadioPacketHandle(uint8_t ui8Pipe, uint32_t ui32Now)
+{
+    uint8_t pui8Frame[SECURE_MAX_FRAME];
+    uint8_t pui8RXData[SECURE_MAX_PAYLOAD];
+    uint8_t *pui8Msg = pui8RXData;
+    uint32_t ui32Start, ui32Epoch;
+    int iLen;
+
+    //
+    // A width over 32 bytes means a corrupt packet, which the datasheet
+    // says must be flushed.
+    //
+    iLen = nRFGetPayloadWidth();
+    if(iLen > SECURE_MAX_FRAME)
+    {
+        nRFFlushRX();
+        return;
+    }
+    nRFDataGet(pui8Frame, iLen);
+
+    //
+    // Polls from children arrive on pipe 2.  The ACK payload held for them
+    // has gone out if the TX FIFO emptied.
+    //
+    if(g_bListening && (ui8Pipe == 2))
+    {
+        if(nRFRegisterRead(nRF_O_FIFO_STATUS) & nRF_FIFO_TX_EMPTY)
+        {
+            g_iRelayAckLen = 0;
+        }
+        RelayHold(pui8Frame, iLen, ui32Now);
+        return;
+    }
+    if(g_bListening && (ui8Pipe == 3))
+    {
+        BroadcastHandle(pui8Frame, iLen);
+        return;
+    }
+
+    //
+    // The ACK to a forwarded poll carries a payload for a child, unless it
+    // is addressed to this node.
+    //
+    if(g_bForwarding && (iLen > 0) && (pui8Frame[0] != g_ui8ID))
+    {
+        memcpy(g_pui8RelayAck, pui8Frame, iLen);
+        g_iRelayAckLen = iLen;
+        return;
+    }
+
+    ui32Start = CycleCountGet();
+    ui32Epoch = g_sLink.ui32RXCounter >> SECURE_EPOCH_SHIFT;
+    iLen = SecureOpen(&g_sLink, SECURE_DIR_DOWN, pui8Frame, iLen, pui8RXData);
+    g_ui32OpenCycles = CycleCountGet() - ui32Start;
+    if((g_sLink.ui32RXCounter >> SECURE_EPOCH_SHIFT) != ui32Epoch)
+    {
+        g_bEpochDue = true;
+    }
+    if(iLen < 1)
+    {
+        return;
+    }
+
+    //
+    // A pace hint may lead the payload, or be all of it.
+    //
+    if((pui8Msg[0] == TDMA_MSG_PACE) && (iLen >= TDMA_PACE_LEN))
+    {
+        PaceSet(pui8Msg[1]);
+        pui8Msg += TDMA_PACE_LEN;
+        iLen -= TDMA_PACE_LEN;
+        if(iLen == 0)
+        {
+            return;
+        }
+    }
+
+    //
+    // Commands come with a sequence number for the next poll to echo.
+    // Sequence numbers start again when the master restarts, in a new
+    // epoch.  More tend to follow a command, so the node polls every period
+    // for a while.
+    //
+    if((pui8Msg[0] == DELIVER_MSG_CMD) && (iLen > DELIVER_HDR_LEN))
+    {
+        ui32Epoch = g_sLink.ui32RXCounter >> SECURE_EPOCH_SHIFT;
+        if((pui8Msg[1] == g_ui8CmdSeq) && (ui32Epoch == g_ui32CmdEpoch))
+        {
+            g_ui32CmdRepeats++;
+            g_bEchoDue = true;
+            return;
+        }
+        g_ui8CmdSeq = pui8Msg[1];
+        g_ui32CmdEpoch = ui32Epoch;
+        g_bEchoDue = true;
+        PaceSet(TDMA_PACE_ACTIVE);
+        pui8Msg += DELIVER_HDR_LEN;
+        iLen -= DELIVER_HDR_LEN;
+    }
+
+    if(pui8Msg[0] == TIMESYNC_MSG_TIME)
+    {
+        TimeSyncUpdate(&g_sSync, pui8Msg, iLen);
+    }
+    else if(pui8Msg[0] == TIMESYNC_MSG_AT)
+    {
+        CommandSchedule(pui8Msg, iLen);
+    }
+    else if(pui8Msg[0] == TDMA_MSG_ASSIGN)
+    {
+        SlotAssign(pui8Msg, iLen);
+    }
+    else
+    {
+        CommandExecute(pui8Msg, iLen);
+    }
+}
+
+void
+GPIOPortBIntHandler(void)
+{
+    uint32_t ui32Now = TimeNow();
+    uint8_t ui8Status;
+
+    //
+    // Clear the interrupt.
+    //
+    GPIOIntClear(BOARD_RADIO0_IRQ_PORT, BOARD_RADIO0_IRQ_PIN);
+
+    //
+    // Finish SPI transmission, if any.
+    //
+    while(BoardSSIBusy(BOARD_RADIO0_SSI_BASE))
+    {
+    }
+    BoardPinWrite(BOARD_RADIO0_CS_PORT, BOARD_RADIO0_CS_PIN,
+                  BOARD_RADIO0_CS_PIN);
+
+    //
+    // Clear every interrupt flag on the radio at once, then act on each.
+    //
+    ui8Status = nRFClearInterrupt();
+    if((ui8Status & (nRF_INT_RX_DR | nRF_INT_TX_DS | nRF_INT_MAX_RT)) == 0)
+    {
+        g_ui32IntSpurious++;
+        return;
+    }
+
+    //
+    // A packet that ran out of retransmissions stays at the head of the TX
+    // FIFO, and stops anything behind it going out, until it is flushed.
+    //
+    if(ui8Status & nRF_INT_MAX_RT)
+    {
+        g_ui32IntMaxRT++;
+        nRFFlushTX();
+        g_ui8TXResult = RADIO_TX_FAILED;
+    }
+
+    //
+    // Any ACK to the poll just sent, with or without a payload, marks the
+    // end of its round trip.
+    //
+    if(ui8Status & nRF_INT_TX_DS)
+    {
+        g_ui32IntTXDone++;
+        g_ui8TXResult = RADIO_TX_ACKED;
+        if(!g_bListening && !g_bForwarding)
+        {
+            TimeSyncAckReceived(&g_sSync, ui32Now);
+        }
+    }
+    if(!(ui8Status & nRF_INT_RX_DR))
+    {
+        return;
+    }
+    g_ui32IntRX++;
+
+    //
+    // RX_DR is raised once for however many packets are waiting, so read
+    // until the status shows the RX FIFO empty.
+    //
+    while(((ui8Status & nRF_STAT_RX_P_NO) >> 1) != nRF_RX_P_NO_EMPTY)
+    {
+        RadioPacketHandle((ui8Status & nRF_STAT_RX_P_NO) >> 1, ui32Now);
+        ui8Status = nRFStatusGet();
+    }
+}
+
+//
+// Set up the radio's SSI and pins, and the timers for local time and
+// scheduled commands.
+//
+static void
+NodePeripheralsSetup(void)
+{
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOB);
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOE);
+    MAP_SysCtlPeripheralEnable(BOARD_RADIO0_SSI_PERIPH);
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER2);
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER3);
+
+    //
+    // Setup GPIO interrupt to receive interrupts from the radio.
+    //
+    MAP_GPIOPinTypeGPIOInput(BOARD_RADIO0_IRQ_PORT, BOARD_RADIO0_IRQ_PIN);
+    MAP_GPIOIntTypeSet(BOARD_RADIO0_IRQ_PORT, BOARD_RADIO0_IRQ_PIN,
+                       GPIO_FALLING_EDGE);
+
+    //
+    // Configure the chip enable pin.
+    //
+    MAP_GPIOPinTypeGPIOOutput(BOARD_RADIO0_CE_PORT, BOARD_RADIO0_CE_PIN);
+    BoardPinWrite(BOARD_RADIO0_CE_PORT, BOARD_RADIO0_CE_PIN, 0x00);
+
+    //
+    // Configure pins for the radio's SSI and its chip select
+    //
+    MAP_GPIOPinConfigure(BOARD_RADIO0_SSI_TX);
+    MAP_GPIOPinConfigure(BOARD_RADIO0_SSI_RX);
+    MAP_GPIOPinConfigure(BOARD_RADIO0_SSI_CLK);
+    MAP_GPIOPinTypeSSI(BOARD_RADIO0_SSI_PORT, BOARD_RADIO0_SSI_PINS);
+    MAP_GPIOPinTypeGPIOOutput(BOARD_RADIO0_CS_PORT, BOARD_RADIO0_CS_PIN);
+    GPIOPinWrite(BOARD_RADIO0_CS_PORT, BOARD_RADIO0_CS_PIN,
+                 BOARD_RADIO0_CS_PIN);
+
+    //
+    // Configure the radio's SSI for SPI mode 0 at 8Mbps, 8 bit transfers.
+    //
+    MAP_SSIConfigSetExpClk(BOARD_RADIO0_SSI_BASE, MAP_SysCtlClockGet(),
+                           SSI_FRF_MOTO_MODE_0, SSI_MODE_MASTER, 8000000, 8);
+    MAP_SSIEnable(BOARD_RADIO0_SSI_BASE);
+
+    //
+    // Timer2 runs free as the local clock.  Timer3A times scheduled
+    // commands.
+    //
+    MAP_TimerConfigure(TIMER2_BASE, TIMER_CFG_PERIODIC_UP);
+    MAP_TimerLoadSet(TIMER2_BASE, TIMER_A, 0xFFFFFFFF);
+    HWREG(TIMER2_BASE + TIMER_O_TAMR) |= TIMER_TAMR_TAMIE;
+    MAP_TimerEnable(TIMER2_BASE, TIMER_A);
+    MAP_TimerConfigure(TIMER3_BASE, TIMER_CFG_ONE_SHOT);
+    MAP_TimerIntEnable(TIMER3_BASE, TIMER_TIMA_TIMEOUT);
+}
+
+//
+// Bring the node onto the network: read its ID, set up the secure links
+// and clocks, and bring the radio up with its interrupts enabled.
+// ui32Reset is the cause of the last reset, as SysCtlResetCauseGet()
+// returned it.  psConfig must stay valid while the node runs.
+//
+void
+NodeInit(uint32_t ui32Reset, const tNodeConfig *psConfig)
+{
+    //
+    // Contents of the user-programmable non-volatile memory
+    //
+    uint32_t ui32User0, ui32User1;
+    uint8_t pui8Key[16];
+
+    g_psNode = psConfig;
+    if(psConfig->ui8Pace != NODE_PACE_ADAPT)
+    {
+        g_ui8Pace = psConfig->ui8Pace;
+    }
+    NodePeripheralsSetup();
+
+    //
+    // Load the 8-bit unique node ID from the non-volatile user registers.
+    //
+    FlashUserGet(&ui32User0, &ui32User1);
+    g_ui8ID = ui32User0 & 0xFF;
+
+    //
+    // Set up the secure links, to the master and for its broadcasts.  TX
+    // counters start in a fresh epoch.  Frames from the last master epoch
+    // taken on each link, and older ones, are refused until the master
+    // hears of the reset from the boot report and moves on.
+    //
+    SecureInit();
+    if(!SecureNodeKeyGet(g_ui8ID, pui8Key))
+    {
+        KeyMissing();
+    }
+    SecureLinkInit(&g_sLink, g_ui8ID, pui8Key, SecureEpochAdvance(),
+                   SecureRXEpochGet(SECURE_EE_RX_EPOCH));
+    SecureLinkPersistRX(&g_sLink, SECURE_EE_RX_EPOCH);
+    if(!SecureBroadcastKeyGet(pui8Key))
+    {
+        KeyMissing();
+    }
+    SecureLinkInit(&g_sBroadcast, BROADCAST_ID, pui8Key, 0,
+                   SecureRXEpochGet(SECURE_EE_BCAST_RX));
+    SecureLinkPersistRX(&g_sBroadcast, SECURE_EE_BCAST_RX);
+
+    //
+    // Local time counts from when the system clock was set, as the cycle
+    // counter does, so that start-up times include setup.
+    //
+    TimeClockInit(&g_sClock, MAP_SysCtlClockGet(),
+                  TimerValueGet(TIMER2_BASE, TIMER_A));
+    g_sClock.ui32Micros = CycleCountGet() / (MAP_SysCtlClockGet() / 1000000);
+    TimeSyncInit(&g_sSync);
+    RelayTableInit(&g_sRoutes, g_ui8ID);
+    BackoffInit(&g_sBackoff, (g_ui8ID << 24) ^
+                             TimerValueGet(TIMER2_BASE, TIMER_A));
+
+    RadioBringUp(ui32Reset & (SYSCTL_CAUSE_POR | SYSCTL_CAUSE_BOR));
+
+    //
+    // Enable interrupts from the radio
+    //
+    GPIOIntEnable(BOARD_RADIO0_IRQ_PORT, BOARD_RADIO0_IRQ_PIN);
+    MAP_IntEnable(BOARD_RADIO_IRQ_INT);
+    MAP_IntEnable(INT_TIMER3A_BLIZZARD);
+    MAP_IntEnable(INT_TIMER2A_BLIZZARD);
+    MAP_IntMasterEnable();
+}
+
+//
+// Send one poll to the master, or to a relay, and wait for its ACK.
+//
+static void
+NodePoll(void)
+{
+    uint8_t pui8Frame[SECURE_MAX_FRAME];
+    uint8_t pui8Report[SECURE_MAX_PAYLOAD];
+    uint8_t ui8Parent, ui8Echo;
+    uint32_t ui32Start;
+    bool bEcho, bBoot, bFree, bFollowUp, bMore;
+    int iLen, iStatus;
+
+    g_ui32LastPoll = TimeNow();
+
+    //
+    // Keep the radio interrupt out while the radio changes mode.
+    //
+    MAP_IntMasterDisable();
+    ui8Parent = RelayParentGet(&g_sRoutes);
+    RadioTransmit(ui8Parent);
+
+    //
+    // Slow down after TDMA_PACE_IDLE_POLLS polls at one pace bring no
+    // command.  A follow-up poll does not count.
+    //
+    bFollowUp = g_bFollowDue;
+    g_ui8Follows = bFollowUp ? (g_ui8Follows + 1) : 0;
+    if(!bFollowUp && (g_psNode->ui8Pace == NODE_PACE_ADAPT) &&
+       (++g_ui8IdlePolls >= TDMA_PACE_IDLE_POLLS) &&
+       (g_ui8Pace < TDMA_PACE_MAX))
+    {
+        g_ui8Pace++;
+        g_ui8IdlePolls = 0;
+    }
+
+    //
+    // Seal a fresh poll.  Each one carries a new counter, so the payload
+    // can no longer be reused from the TX FIFO.  The poll reports the
+    // clock error found at the last time sync, and the slot and pace in
+    // use.  A follow-up leaves out the clock error, as the reply to the
+    // poll before is what it comes to collect, and makes room for the
+    // node's own report.
+    //
+    ui32Start = CycleCountGet();
+    bFree = (g_ui8Slots == 0) || !g_sSync.bSynced;
+    iLen = bFollowUp ? 0 : TimeSyncSkewEncode(&g_sSync, pui8Report);
+    iStatus = iLen;
+    pui8Report[iLen++] = TDMA_MSG_STATUS;
+    pui8Report[iLen++] = g_ui8Slot;
+    pui8Report[iLen++] = g_ui8Slots;
+    pui8Report[iLen++] = g_ui8Retries;
+    pui8Report[iLen++] = g_ui8Pace | (bFree ? TDMA_STATUS_FREE : 0);
+    if((g_ui8RelayForwards | g_ui8RelayDrops) != 0)
+    {
+        pui8Report[iLen++] = RELAY_MSG_STATUS;
+        pui8Report[iLen++] = g_ui8RelayForwards;
+        pui8Report[iLen++] = g_ui8RelayDrops;
+        pui8Report[iLen++] = g_ui16RelayMaxHold & 0xFF;
+        pui8Report[iLen++] = g_ui16RelayMaxHold >> 8;
+        g_ui8RelayForwards = 0;
+        g_ui8RelayDrops = 0;
+        g_ui16RelayMaxHold = 0;
+    }
+    bEcho = g_bEchoDue;
+    ui8Echo = g_ui8CmdSeq;
+    if(bEcho)
+    {
+        pui8Report[iLen++] = DELIVER_MSG_ACK;
+        pui8Report[iLen++] = ui8Echo;
+    }
+    bBoot = g_bBootDue;
+    if(bBoot)
+    {
+        pui8Report[iLen++] = BOOT_MSG_STATUS;
+        pui8Report[iLen++] = BOOT_MS(g_ui32BootRadioUs) & 0xFF;
+        pui8Report[iLen++] = BOOT_MS(g_ui32BootRadioUs) >> 8;
+        pui8Report[iLen++] = BOOT_MS(g_ui32BootPollUs) & 0xFF;
+        pui8Report[iLen++] = BOOT_MS(g_ui32BootPollUs) >> 8;
+    }
+    bMore = false;
+    if(g_psNode->pfnReport)
+    {
+        iLen += g_psNode->pfnReport(pui8Report + iLen,
+                                    SECURE_MAX_PAYLOAD - iLen, &bMore);
+    }
+
+    //
+    // Without a slot the master cannot tell when this node polls, and
+    // stages its ACK payloads for others.  A free-running poll straight to
+    // the master asks for a follow-up, for which the master holds this
+    // node's payload, as does a poll that left report data behind.
+    //
+    g_bFollowDue = ((bFree && !bFollowUp &&
+                     (ui8Parent == RELAY_PARENT_MASTER)) ||
+                    (bMore && (g_ui8Follows < NODE_FOLLOW_MAX)));
+    if(g_bFollowDue)
+    {
+        pui8Report[iStatus + 4] |= TDMA_STATUS_FOLLOW;
+    }
+    if(g_bEpochDue)
+    {
+        g_bEpochDue = false;
+        SecureLinkEpochNext(&g_sLink);
+    }
+    iLen = SecureSeal(&g_sLink, SECURE_DIR_UP, pui8Report, iLen, pui8Frame);
+    g_ui32SealCycles = CycleCountGet() - ui32Start;
+    nRFFlushTX();
+    nRFDataPut(pui8Frame, iLen);
+
+    //
+    // Pulse the radio's chip enable, noting the time for the round trip
+    // measurement.
+    //
+    TimeSyncPollSent(&g_sSync, g_sLink.ui32TXCounter & 0xFFFF, TimeNow());
+    BoardPinWrite(BOARD_RADIO0_CE_PORT, BOARD_RADIO0_CE_PIN,
+                  BOARD_RADIO0_CE_PIN);
+    SysCtlDelay(500);
+    BoardPinWrite(BOARD_RADIO0_CE_PORT, BOARD_RADIO0_CE_PIN, 0x00);
+    MAP_IntMasterEnable();
+
+    //
+    // Wait for the ACK before going back to listening.  Back off before
+    // the next poll if none came.
+    //
+    RadioWait();
+    MAP_IntMasterDisable();
+    if(RadioResult(ui8Parent, &g_ui8Retries))
+    {
+        BackoffReset(&g_sBackoff);
+        g_ui32BackoffUs = 0;
+
+        //
+        // The echo got through, unless a newer command came with the ACK.
+        //
+        if(bEcho && (g_ui8CmdSeq == ui8Echo))
+        {
+            g_bEchoDue = false;
+        }
+
+        //
+        // The first acknowledged poll ends the node's start-up, and the
+        // next one reports how long it took.
+        //
+        if(bBoot)
+        {
+            g_bBootDue = false;
+        }
+        else if(g_ui32BootPollUs == 0)
+        {
+            g_ui32BootPollUs = TimeNow();
+            g_bBootDue = true;
+        }
+    }
+    else
+    {
+        g_ui32BackoffUs = BackoffFail(&g_sBackoff);
+        g_bFollowDue = false;
+    }
+    if(g_psNode->bListen)
+    {
+        RadioListen();
+    }
+    MAP_IntMasterEnable();
+}
+
+//
+// Loop forever, requesting instructions at regular intervals and, if the
+// node listens, taking pushed ones and children's polls in between.  The
+// first poll goes out at once, so a node that was power cycled rejoins as
+// soon as its radio is up.
+//
+void
+NodeRun(void)
+{
+    g_ui32LastPoll = TimeNow() - POLL_INTERVAL_US;
+    if(g_psNode->bListen)
+    {
+        RadioListen();
+    }
+    while(1)
+    {
+        if(!SlotWait())
+        {
+            RelayForward();
+            continue;
+        }
+        NodePoll();
+    }
+}
@@ -0,0 +1,66 @@
+//*****************************************************************************
+//
+// node.h - Radio runtime shared by the slave nodes.
+//
+// A node polls the master, directly or through a relay, in the slot the
+// master assigns it and at the pace its traffic sets, and keeps network
+// time from the master's replies.  Between polls it can listen for pushed
+// commands, broadcasts, and children's polls to pass on.  The code here
+// does all of that; each node's own file sets up its peripherals and
+// supplies CommandExecute(), which carries out a command from the master.
+//
+// NodeInit() expects the system clock and cycle counter to be running.  It
+// claims GPIO ports B and E for the radio, Timer2 as the local clock and
+// Timer3A for scheduled commands.
+//
+//*****************************************************************************
+
+#ifndef __NODE_H__
+#define __NODE_H__
+
+//
+// tNodeConfig.ui8Pace for a node whose pace follows its traffic and the
+// master's hints.
+//
+#define NODE_PACE_ADAPT         0xFF
+
+//
+// Follow-up polls a node sends in a row to empty its report data.
+//
+#define NODE_FOLLOW_MAX         3
+
+//
+// How a node uses the runtime.
+//
+typedef struct
+{
+    //
+    // Listen between polls.  A node that does not is only reachable through
+    // the ACKs to its polls, and relays for no one.
+    //
+    bool bListen;
+
+    //
+    // Pace to poll at, whatever the master hints, or NODE_PACE_ADAPT.
+    //
+    uint8_t ui8Pace;
+
+    //
+    // Adds up to iSpace bytes of the node's own messages to the end of a
+    // poll at pui8Buf, returning the length added, and sets *pbMore if it
+    // has more waiting.  A follow-up poll then goes out in
+    // TDMA_JOIN_FOLLOW_US.  May be 0 if the node has nothing to add.
+    //
+    int (*pfnReport)(uint8_t *pui8Buf, int iSpace, bool *pbMore);
+}
+tNodeConfig;
+
+void NodeInit(uint32_t ui32Reset, const tNodeConfig *psConfig);
+void NodeRun(void);
+
+//
+// Supplied by each node.
+//
+void CommandExecute(uint8_t *pui8Cmd, int iLen);
+
+#endif
@@ -0,0 +1,27 @@
+//*****************************************************************************
+//
+// push.h - Radio addresses for commands pushed straight to a node.
+//
+// Between polls, nodes that accept pushed commands listen as a receiver on
+// pipe 1 at an address of their own.  The master briefly becomes the
+// transmitter to reach one.
+//
+//*****************************************************************************
+
+#ifndef __PUSH_H__
+#define __PUSH_H__
+
+#define PUSH_ADDR_LEN           5
+
+//
+// Nodes poll the master at the radio's reset address for pipe 0.
+//
+#define PUSH_POLL_ADDR          {0xE7, 0xE7, 0xE7, 0xE7, 0xE7}
+
+//
+// A node's push address, least significant byte first.  Byte 0 is replaced
+// with the node's ID.
+//
+#define PUSH_NODE_ADDR          {0x00, 0xC2, 0xC2, 0xC2, 0xC2}
+
+#endif
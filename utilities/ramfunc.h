@@ -0,0 +1,40 @@
+//*****************************************************************************
+//
+// ramfunc.h - Running hot code from SRAM.
+//
+// Flash needs wait states above 40 MHz, and the prefetch buffer only hides
+// them on straight-line code; a loop or a call that misses it stalls.
+// Functions on the radio interrupt and SPI path are tagged RAMFUNC, which
+// puts them in the .ramfunc section.  Each target's scatter file places
+// that section in the RW_IRAM_HOT region at the bottom of SRAM, which the
+// C library start-up copies from flash along with the initialised data, so
+// they run with no wait states.  Calls between SRAM and flash go through
+// veneers the linker adds.
+//
+// Data needs no tag: variables are in SRAM already, and nothing on the hot
+// path reads a constant table from flash.  A const table that one of these
+// functions comes to depend on can be tagged RAMFUNC as well.
+//
+// Build with NO_RAMFUNC defined to leave everything in flash, for a
+// before and after comparison.  On the master, "load clear" followed by
+// "load" once traffic has run gives the radio IRQ handler's cycles and
+// those of RadioService() and PollHandle() around it, labelled with where
+// the hot path ran.  host/memory.py reports what the hot region holds and
+// how full each region is.
+//
+// Copyright (c) 2014 Sam Friedman. All Rights Reserved.
+//
+//*****************************************************************************
+
+#ifndef __RAMFUNC_H__
+#define __RAMFUNC_H__
+
+#ifdef NO_RAMFUNC
+#define RAMFUNC
+#define RAMFUNC_WHERE           "flash"
+#else
+#define RAMFUNC                 __attribute__((section(".ramfunc")))
+#define RAMFUNC_WHERE           "SRAM"
+#endif
+
+#endif
@@ -0,0 +1,167 @@
+//*****************************************************************************
+//
+// relay.c - Forwarding polls through mains-powered nodes.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "channel.h"
+#include "push.h"
+#include "relay.h"
+
+//
+// Start with the master as the only parent, assumed to be in range.
+//
+void
+RelayTableInit(tRelayTable *psTable, uint8_t ui8Self)
+{
+    memset(psTable, 0, sizeof(tRelayTable));
+    psTable->psRoutes[0].ui8Parent = RELAY_PARENT_MASTER;
+    psTable->psRoutes[0].ui8Cost = RELAY_COST_SCALE;
+    psTable->ui8Count = 1;
+    psTable->ui8Self = ui8Self;
+}
+
+static int
+RelayCost(const tRelayRoute *psRoute)
+{
+    return(psRoute->ui8Cost +
+           ((psRoute->ui8Parent == RELAY_PARENT_MASTER) ? 0 : RELAY_HOP_COST));
+}
+
+static int
+RelayBest(const tRelayTable *psTable)
+{
+    int i, iBest = 0;
+
+    for(i = 1; i < psTable->ui8Count; i++)
+    {
+        if(RelayCost(&psTable->psRoutes[i]) <
+           RelayCost(&psTable->psRoutes[iBest]))
+        {
+            iBest = i;
+        }
+    }
+    return(iBest);
+}
+
+//
+// Return the parent with the cheapest route, for forwarded polls.
+//
+uint8_t
+RelayParentBest(const tRelayTable *psTable)
+{
+    return(psTable->psRoutes[RelayBest(psTable)].ui8Parent);
+}
+
+//
+// Pick the parent for the next poll.  While the best known route is poor,
+// some polls go to other candidates, in turn, to measure them.  Only nodes
+// on this node's channel are candidates.
+//
+uint8_t
+RelayParentGet(tRelayTable *psTable)
+{
+    int iBest = RelayBest(psTable);
+    int iCost = RelayCost(&psTable->psRoutes[iBest]);
+    uint8_t ui8Probe;
+
+    psTable->ui8Polls++;
+    if((iCost <= RELAY_COST_FAIR) ||
+       ((iCost <= RELAY_COST_POOR) &&
+        (psTable->ui8Polls % RELAY_PROBE_POLLS != 0)))
+    {
+        return(psTable->psRoutes[iBest].ui8Parent);
+    }
+
+    do
+    {
+        ui8Probe = psTable->ui8Probe;
+        psTable->ui8Probe = (ui8Probe + 1) % (RELAY_MAX_ID + 2);
+    }
+    while((ui8Probe == psTable->ui8Self) ||
+          ((ui8Probe <= RELAY_MAX_ID) &&
+           (CHANNEL_RADIO(ui8Probe) != CHANNEL_RADIO(psTable->ui8Self))));
+
+    return((ui8Probe > RELAY_MAX_ID) ? RELAY_PARENT_MASTER : ui8Probe);
+}
+
+//
+// Update the link cost to a parent with the outcome of a poll sent to it.
+// A candidate that answered joins the table, replacing the worst entry if
+// that is costlier.
+//
+void
+RelayResult(tRelayTable *psTable, uint8_t ui8Parent, bool bAcked,
+            uint8_t ui8Retries)
+{
+    tRelayRoute *psRoute;
+    int i, iCost, iWorst;
+
+    iCost = (bAcked ? (ui8Retries + 1) : RELAY_FAIL_TX) * RELAY_COST_SCALE;
+
+    for(i = 0; i < psTable->ui8Count; i++)
+    {
+        psRoute = &psTable->psRoutes[i];
+        if(psRoute->ui8Parent == ui8Parent)
+        {
+            psRoute->ui8Cost += (iCost - psRoute->ui8Cost) / 4;
+            return;
+        }
+    }
+
+    if(!bAcked)
+    {
+        return;
+    }
+
+    if(psTable->ui8Count < RELAY_MAX_ROUTES)
+    {
+        psRoute = &psTable->psRoutes[psTable->ui8Count++];
+    }
+    else
+    {
+        //
+        // The master keeps its entry, so it is always measured again when
+        // probed.
+        //
+        iWorst = 1;
+        for(i = 2; i < RELAY_MAX_ROUTES; i++)
+        {
+            if(psTable->psRoutes[i].ui8Cost > psTable->psRoutes[iWorst].ui8Cost)
+            {
+                iWorst = i;
+            }
+        }
+        psRoute = &psTable->psRoutes[iWorst];
+        if(psRoute->ui8Cost <= iCost)
+        {
+            return;
+        }
+    }
+    psRoute->ui8Parent = ui8Parent;
+    psRoute->ui8Cost = iCost;
+}
+
+//
+// Return the address polls to a parent are sent to.
+//
+void
+RelayAddrGet(uint8_t ui8Parent, uint8_t *pui8Addr)
+{
+    static const uint8_t pui8Poll[PUSH_ADDR_LEN] = PUSH_POLL_ADDR;
+    static const uint8_t pui8Node[PUSH_ADDR_LEN] = PUSH_NODE_ADDR;
+
+    if(ui8Parent == RELAY_PARENT_MASTER)
+    {
+        memcpy(pui8Addr, pui8Poll, PUSH_ADDR_LEN);
+    }
+    else
+    {
+        memcpy(pui8Addr, pui8Node, PUSH_ADDR_LEN);
+        pui8Addr[0] = ui8Parent | RELAY_ADDR_FLAG;
+    }
+}
@@ -0,0 +1,103 @@
+//*****************************************************************************
+//
+// relay.h - Forwarding polls through mains-powered nodes.
+//
+// A node out of range of the master polls a relay instead.  Relays listen
+// for polls on pipe 2, at their push address with RELAY_ADDR_FLAG set in
+// byte 0, and pass each one on to their own parent with a one byte route
+// header in front of the sealed frame.  The master's ACK payload for the
+// forwarded poll comes back to the relay, which holds it as the ACK payload
+// for its child's next poll.  Frames stay sealed end to end, so relays need
+// no keys but their own.
+//
+//*****************************************************************************
+
+#ifndef __RELAY_H__
+#define __RELAY_H__
+
+#define RELAY_ADDR_FLAG         0x80
+
+//
+// Route header: [flag | hops << 4 | first relay ID].  Node IDs are below
+// 0x80, so the flag tells a forwarded frame from a direct one.
+//
+#define RELAY_FRAME_FLAG        0x80
+#define RELAY_HDR(hops, id)     (RELAY_FRAME_FLAG | ((hops) << 4) | (id))
+#define RELAY_HDR_HOPS(hdr)     (((hdr) >> 4) & 0x07)
+#define RELAY_HDR_ID(hdr)       ((hdr) & 0x0F)
+#define RELAY_MAX_HOPS          7
+
+//
+// Relays report what they forwarded since their last poll:
+// [D2][forwarded][dropped][longest hold, us, 2 bytes], relay to master.
+//
+#define RELAY_MSG_STATUS        0xD2
+#define RELAY_STATUS_LEN        5
+
+//
+// A poll a relay cannot pass on within this long is dropped; the child
+// polls again in its next slot.
+//
+#define RELAY_MAX_HOLD_US       10000
+
+//
+// Parents a node keeps link quality for, and the highest node ID probed as
+// a relay.
+//
+#define RELAY_MAX_ROUTES        4
+#define RELAY_MAX_ID            15
+#define RELAY_PARENT_MASTER     0xFF
+
+//
+// Link cost is the mean number of transmissions a poll took, in eighths,
+// with a poll that was never acknowledged counting as RELAY_FAIL_TX.  Each
+// relay hop adds RELAY_HOP_COST so the direct route wins a close call.
+//
+#define RELAY_COST_SCALE        8
+#define RELAY_FAIL_TX           16
+#define RELAY_HOP_COST          (2 * RELAY_COST_SCALE)
+
+//
+// Above RELAY_COST_POOR a node tries a new parent every poll; above
+// RELAY_COST_FAIR, every RELAY_PROBE_POLLS polls.
+//
+#define RELAY_COST_POOR         (6 * RELAY_COST_SCALE)
+#define RELAY_COST_FAIR         (2 * RELAY_COST_SCALE)
+#define RELAY_PROBE_POLLS       8
+
+typedef struct
+{
+    uint8_t ui8Parent;
+
+    uint8_t ui8Cost;
+}
+tRelayRoute;
+
+//
+// A node's routing table: its known parents with their link costs.
+//
+typedef struct
+{
+    tRelayRoute psRoutes[RELAY_MAX_ROUTES];
+
+    uint8_t ui8Count;
+
+    uint8_t ui8Self;
+
+    //
+    // Next candidate to probe; RELAY_MAX_ID + 1 stands for the master.
+    //
+    uint8_t ui8Probe;
+
+    uint8_t ui8Polls;
+}
+tRelayTable;
+
+void RelayTableInit(tRelayTable *psTable, uint8_t ui8Self);
+uint8_t RelayParentGet(tRelayTable *psTable);
+uint8_t RelayParentBest(const tRelayTable *psTable);
+void RelayResult(tRelayTable *psTable, uint8_t ui8Parent, bool bAcked,
+                 uint8_t ui8Retries);
+void RelayAddrGet(uint8_t ui8Parent, uint8_t *pui8Addr);
+
+#endif
@@ -0,0 +1,280 @@
+//*****************************************************************************
+//
+// secure.c - Authenticated, encrypted framing for radio payloads.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "secure.h"
+
+#ifdef rvmdk
+#include "inc/hw_memmap.h"
+#include "driverlib/eeprom.h"
+#include "driverlib/sysctl.h"
+#endif
+
+//
+// Build the 13 byte CCM nonce for a frame.
+//
+static void
+SecureNonce(uint8_t *pui8Nonce, uint8_t ui8ID, uint8_t ui8Dir,
+            uint32_t ui32Counter)
+{
+    memset(pui8Nonce, 0, CCM_NONCE_LEN);
+    pui8Nonce[0] = ui8ID;
+    pui8Nonce[1] = ui8Dir;
+    memcpy(pui8Nonce + 2, &ui32Counter, 4);
+}
+
+//
+// Bring up the crypto engine and, on target builds, the EEPROM that holds
+// keys and counter epochs.
+//
+void
+SecureInit(void)
+{
+#ifdef rvmdk
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_EEPROM0);
+    while(!SysCtlPeripheralReady(SYSCTL_PERIPH_EEPROM0))
+    {
+    }
+    EEPROMInit();
+#endif
+    CCMInit();
+}
+
+//
+// Derive the key for node ui8ID from the network key: K = AES(NetKey, ID).
+//
+void
+SecureKeyDerive(const uint8_t *pui8NetKey, uint8_t ui8ID, uint8_t *pui8Key)
+{
+    tCCMKey sNetKey;
+    uint8_t pui8Block[CCM_BLOCK_LEN];
+
+    memset(pui8Block, 0, sizeof(pui8Block));
+    pui8Block[0] = ui8ID;
+    CCMKeySet(&sNetKey, pui8NetKey);
+    CCMEncryptBlock(&sNetKey, pui8Block, pui8Key);
+}
+
+//
+// Set up a link that sends in epoch ui32Epoch and refuses frames from
+// ui32RXEpoch and earlier, the last epoch accepted before a reset.  An
+// ui32RXEpoch of 0, as SecureRXEpochGet() returns for erased EEPROM,
+// refuses none.
+//
+void
+SecureLinkInit(tSecureLink *psLink, uint8_t ui8ID, const uint8_t *pui8Key,
+               uint32_t ui32Epoch, uint32_t ui32RXEpoch)
+{
+    memset(psLink, 0, sizeof(tSecureLink));
+    CCMKeySet(&psLink->sKey, pui8Key);
+    psLink->ui8ID = ui8ID;
+    psLink->ui32TXCounter = ui32Epoch << SECURE_EPOCH_SHIFT;
+    if(ui32RXEpoch != 0)
+    {
+        psLink->ui32RXCounter = ((ui32RXEpoch + 1) << SECURE_EPOCH_SHIFT) - 1;
+    }
+}
+
+//
+// Have the link persist the epoch of the frames it accepts at EEPROM
+// address ui32Addr, where SecureRXEpochGet() finds it after a reset.
+//
+void
+SecureLinkPersistRX(tSecureLink *psLink, uint32_t ui32Addr)
+{
+    psLink->bPersistRX = true;
+    psLink->ui32RXEpochAddr = ui32Addr;
+}
+
+//
+// Move the link's TX counter on to a fresh epoch, for a peer that has reset
+// and refuses the one in use.  Host builds have no EEPROM, and take the
+// link's next epoch.
+//
+void
+SecureLinkEpochNext(tSecureLink *psLink)
+{
+#ifdef rvmdk
+    psLink->ui32TXCounter = SecureEpochAdvance() << SECURE_EPOCH_SHIFT;
+#else
+    psLink->ui32TXCounter = ((psLink->ui32TXCounter >> SECURE_EPOCH_SHIFT) +
+                             1) << SECURE_EPOCH_SHIFT;
+#endif
+}
+
+//
+// Encrypt and authenticate iLen bytes from pui8Plain into a frame at
+// pui8Frame, which must have room for iLen + SECURE_HDR_LEN + CCM_MIC_LEN
+// bytes.  Returns the frame length, or -1 if the payload is too long.
+//
+int
+SecureSeal(tSecureLink *psLink, uint8_t ui8Dir, const uint8_t *pui8Plain,
+           int iLen, uint8_t *pui8Frame)
+{
+    uint8_t pui8Nonce[CCM_NONCE_LEN];
+
+    if(iLen > SECURE_MAX_PAYLOAD)
+    {
+        return(-1);
+    }
+
+#ifdef rvmdk
+    //
+    // Move to a fresh epoch rather than wrap the sequence number into one
+    // that may already have been used.  This costs an EEPROM write once
+    // every 65535 frames.
+    //
+    if((psLink->ui32TXCounter & SECURE_SEQ_MASK) == SECURE_SEQ_MASK)
+    {
+        psLink->ui32TXCounter = SecureEpochAdvance() << SECURE_EPOCH_SHIFT;
+    }
+#endif
+    psLink->ui32TXCounter++;
+
+    pui8Frame[0] = psLink->ui8ID;
+    memcpy(pui8Frame + 1, &psLink->ui32TXCounter, 4);
+    memcpy(pui8Frame + SECURE_HDR_LEN, pui8Plain, iLen);
+
+    SecureNonce(pui8Nonce, psLink->ui8ID, ui8Dir, psLink->ui32TXCounter);
+    CCMSeal(&psLink->sKey, pui8Nonce, pui8Frame + SECURE_HDR_LEN, iLen,
+            pui8Frame + SECURE_HDR_LEN + iLen);
+
+    return(iLen + SECURE_HDR_LEN + CCM_MIC_LEN);
+}
+
+//
+// Check and decrypt a frame of iLen bytes into pui8Plain.  Returns the
+// plaintext length, or -1 if the frame is malformed, fails authentication or
+// is a replay.  The link's counters only advance on success.
+//
+int
+SecureOpen(tSecureLink *psLink, uint8_t ui8Dir, const uint8_t *pui8Frame,
+           int iLen, uint8_t *pui8Plain)
+{
+    uint8_t pui8Nonce[CCM_NONCE_LEN];
+    uint32_t ui32Counter;
+    int iPlainLen;
+
+    iPlainLen = iLen - SECURE_HDR_LEN - CCM_MIC_LEN;
+    if((iPlainLen < 0) || (iPlainLen > SECURE_MAX_PAYLOAD) ||
+       (pui8Frame[0] != psLink->ui8ID))
+    {
+        psLink->ui32AuthFail++;
+        return(-1);
+    }
+
+    memcpy(&ui32Counter, pui8Frame + 1, 4);
+    if(ui32Counter <= psLink->ui32RXCounter)
+    {
+        psLink->ui32Replay++;
+        return(-1);
+    }
+
+    memcpy(pui8Plain, pui8Frame + SECURE_HDR_LEN, iPlainLen);
+    SecureNonce(pui8Nonce, psLink->ui8ID, ui8Dir, ui32Counter);
+    if(!CCMOpen(&psLink->sKey, pui8Nonce, pui8Plain, iPlainLen,
+                pui8Frame + SECURE_HDR_LEN + iPlainLen))
+    {
+        memset(pui8Plain, 0, iPlainLen);
+        psLink->ui32AuthFail++;
+        return(-1);
+    }
+
+#ifdef rvmdk
+    if(psLink->bPersistRX &&
+       ((ui32Counter >> SECURE_EPOCH_SHIFT) !=
+        (psLink->ui32RXCounter >> SECURE_EPOCH_SHIFT)))
+    {
+        uint32_t ui32Epoch = ui32Counter >> SECURE_EPOCH_SHIFT;
+
+        EEPROMProgram(&ui32Epoch, psLink->ui32RXEpochAddr, 4);
+    }
+#endif
+    psLink->ui32RXCounter = ui32Counter;
+
+    return(iPlainLen);
+}
+
+#ifdef rvmdk
+//
+// Hand out the next TX epoch, persisting it first so it is never reused.
+//
+uint32_t
+SecureEpochAdvance(void)
+{
+    uint32_t ui32Epoch;
+
+    EEPROMRead(&ui32Epoch, SECURE_EE_EPOCH, 4);
+    if(ui32Epoch == 0xFFFFFFFF)
+    {
+        //
+        // Erased EEPROM.
+        //
+        ui32Epoch = 0;
+    }
+    ui32Epoch++;
+    EEPROMProgram(&ui32Epoch, SECURE_EE_EPOCH, 4);
+
+    return(ui32Epoch & SECURE_SEQ_MASK);
+}
+
+//
+// Return the highest RX epoch persisted at ui32Addr before the last reset.
+//
+uint32_t
+SecureRXEpochGet(uint32_t ui32Addr)
+{
+    uint32_t ui32Epoch;
+
+    EEPROMRead(&ui32Epoch, ui32Addr, 4);
+    return((ui32Epoch == 0xFFFFFFFF) ? 0 : (ui32Epoch & SECURE_SEQ_MASK));
+}
+
+//
+// Load a key from EEPROM at ui32Addr.  Returns false if the EEPROM there is
+// erased, as on a node never provisioned.
+//
+static bool
+SecureKeyLoad(uint32_t ui32Addr, uint8_t *pui8Key)
+{
+    uint32_t pui32Key[4];
+
+    EEPROMRead(pui32Key, ui32Addr, 16);
+    if((pui32Key[0] & pui32Key[1] & pui32Key[2] & pui32Key[3]) == 0xFFFFFFFF)
+    {
+        return(false);
+    }
+    memcpy(pui8Key, pui32Key, 16);
+    return(true);
+}
+
+//
+// Load this node's key.  Nodes do not hold the network key, so the key is
+// written to EEPROM beforehand by host/provision.  Returns false if there
+// is none, or it was derived for another ID.
+//
+bool
+SecureNodeKeyGet(uint8_t ui8ID, uint8_t *pui8Key)
+{
+    uint32_t ui32ID;
+
+    EEPROMRead(&ui32ID, SECURE_EE_KEY_ID, 4);
+    return((ui32ID == ui8ID) && SecureKeyLoad(SECURE_EE_KEY, pui8Key));
+}
+
+//
+// Load the key broadcasts are sealed with (see broadcast.h), also written by
+// host/provision.  Returns false if there is none.
+//
+bool
+SecureBroadcastKeyGet(uint8_t *pui8Key)
+{
+    return(SecureKeyLoad(SECURE_EE_BCAST_KEY, pui8Key));
+}
+#endif
@@ -0,0 +1,114 @@
+//*****************************************************************************
+//
+// secure.h - Authenticated, encrypted framing for radio payloads.
+//
+// Every poll and every ACK payload is sent as
+//
+//     [ID][CTR0 CTR1 CTR2 CTR3][ciphertext ...][MIC0 MIC1 MIC2 MIC3]
+//
+// The node ID stays in the clear so the master can pick the key.  CTR is a
+// little-endian per-link, per-direction counter that must strictly increase,
+// which rejects replays.  The CCM nonce is built from ID, direction and CTR,
+// so tampering with the header also fails the MIC.
+//
+//*****************************************************************************
+
+#ifndef __SECURE_H__
+#define __SECURE_H__
+
+#include "ccm.h"
+
+//
+// Frame sizes.  SECURE_OVERHEAD is what the framing adds over the plain
+// protocol, which already carried the node ID.
+//
+#define SECURE_HDR_LEN          5   // Node ID and 32-bit counter
+#define SECURE_OVERHEAD         (SECURE_HDR_LEN + CCM_MIC_LEN - 1)
+#define SECURE_MAX_FRAME        32  // nRF24L01 maximum payload
+#define SECURE_MAX_PAYLOAD      (SECURE_MAX_FRAME - SECURE_HDR_LEN - \
+                                 CCM_MIC_LEN)
+
+//
+// Direction of a frame, part of the nonce.
+//
+#define SECURE_DIR_UP           0x00 // Node to master (poll)
+#define SECURE_DIR_DOWN         0x01 // Master to node (ACK payload)
+
+//
+// The counter is split into a boot epoch, persisted in EEPROM and advanced
+// on every boot, and a sequence number within the epoch.  This keeps nonces
+// unique across resets without writing EEPROM per message.  The receiving
+// end persists only the epoch too, so after a reset it cannot tell how far
+// into that epoch it had got, and refuses all of it.  The sending end moves
+// on to a fresh epoch once it learns of the reset.
+//
+#define SECURE_EPOCH_SHIFT      16
+#define SECURE_SEQ_MASK         0x0000FFFF
+
+//
+// EEPROM layout (byte addresses) used by target builds.
+//
+#define SECURE_EE_KEY           0x00 // 16 byte node key
+#define SECURE_EE_EPOCH         0x10 // Last TX epoch handed out
+#define SECURE_EE_RX_EPOCH      0x14 // Node: highest RX epoch accepted
+#define SECURE_EE_BCAST_KEY     0x18 // 16 byte broadcast key
+#define SECURE_EE_KEY_ID        0x28 // Node ID the keys were derived for
+#define SECURE_EE_BCAST_RX      0x2C // Node: highest broadcast epoch accepted
+
+//
+// The master keeps the highest RX epoch accepted on each node's link.
+//
+#define SECURE_EE_LINK_RX_EPOCH(id) (0x40 + 4 * (id))
+
+typedef struct
+{
+    tCCMKey sKey;
+
+    //
+    // Node ID carried in the clear in byte 0 of every frame.
+    //
+    uint8_t ui8ID;
+
+    //
+    // Persist the epoch of accepted frames, at EEPROM address
+    // ui32RXEpochAddr, so a reset does not reopen the replay window to
+    // frames from earlier epochs.
+    //
+    bool bPersistRX;
+
+    uint32_t ui32RXEpochAddr;
+
+    uint32_t ui32TXCounter;
+
+    uint32_t ui32RXCounter;
+
+    //
+    // Frames dropped for a bad MIC and for a stale counter.
+    //
+    uint32_t ui32AuthFail;
+
+    uint32_t ui32Replay;
+}
+tSecureLink;
+
+void SecureInit(void);
+void SecureKeyDerive(const uint8_t *pui8NetKey, uint8_t ui8ID,
+                     uint8_t *pui8Key);
+void SecureLinkInit(tSecureLink *psLink, uint8_t ui8ID, const uint8_t *pui8Key,
+                    uint32_t ui32Epoch, uint32_t ui32RXEpoch);
+void SecureLinkPersistRX(tSecureLink *psLink, uint32_t ui32Addr);
+void SecureLinkEpochNext(tSecureLink *psLink);
+int SecureSeal(tSecureLink *psLink, uint8_t ui8Dir, const uint8_t *pui8Plain,
+               int iLen, uint8_t *pui8Frame);
+int SecureOpen(tSecureLink *psLink, uint8_t ui8Dir, const uint8_t *pui8Frame,
+               int iLen, uint8_t *pui8Plain);
+
+//
+// EEPROM backed helpers, target builds only.
+//
+uint32_t SecureEpochAdvance(void);
+uint32_t SecureRXEpochGet(uint32_t ui32Addr);
+bool SecureNodeKeyGet(uint8_t ui8ID, uint8_t *pui8Key);
+bool SecureBroadcastKeyGet(uint8_t *pui8Key);
+
+#endif
@@ -0,0 +1,181 @@
+//*****************************************************************************
+//
+// sensorpack.c - Delta encoded sample batches sent by sensor nodes.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sensorpack.h"
+
+//
+// Add a scaled delta to a reconstructed value, clamped to the ADC range.
+//
+static uint16_t
+SensorApply(uint16_t ui16Value, int iDelta, int iShift)
+{
+    int iValue = (int)ui16Value + (iDelta * (1 << iShift));
+
+    if(iValue < 0)
+    {
+        iValue = 0;
+    }
+    else if(iValue > SENSOR_SAMPLE_MAX)
+    {
+        iValue = SENSOR_SAMPLE_MAX;
+    }
+    return((uint16_t)iValue);
+}
+
+//
+// Encode up to SENSOR_BATCH_MAX samples into pui8Buf.  Returns the number of
+// bytes written; the caller checks how many samples fitted with
+// SensorBatchDecode() or by clipping iCount itself.
+//
+int
+SensorBatchEncode(const tSensorSample *psSamples, int iCount,
+                  uint16_t ui16Index, uint8_t ui8Period, uint8_t *pui8Buf)
+{
+    uint16_t pui16Recon[SENSOR_CHANNELS];
+    int piShift[SENSOR_CHANNELS];
+    int i, iChan, iDiff, iMaxDiff, iQ, iHalf;
+    uint8_t ui8Byte;
+
+    if(iCount > SENSOR_BATCH_MAX)
+    {
+        iCount = SENSOR_BATCH_MAX;
+    }
+    if(iCount < 1)
+    {
+        return(0);
+    }
+
+    //
+    // Pick the smallest shift per channel that covers the largest step in
+    // this batch.
+    //
+    for(iChan = 0; iChan < SENSOR_CHANNELS; iChan++)
+    {
+        iMaxDiff = 0;
+        for(i = 1; i < iCount; i++)
+        {
+            iDiff = (int)psSamples[i].pui16Value[iChan] -
+                    (int)psSamples[i - 1].pui16Value[iChan];
+            if(iDiff < 0)
+            {
+                iDiff = -iDiff;
+            }
+            if(iDiff > iMaxDiff)
+            {
+                iMaxDiff = iDiff;
+            }
+        }
+        piShift[iChan] = 0;
+        while((7 << piShift[iChan]) < iMaxDiff)
+        {
+            piShift[iChan]++;
+        }
+        pui16Recon[iChan] = psSamples[0].pui16Value[iChan] & SENSOR_SAMPLE_MAX;
+    }
+
+    pui8Buf[0] = SENSOR_MSG_BATCH;
+    pui8Buf[1] = (uint8_t)iCount;
+    pui8Buf[2] = (uint8_t)ui16Index;
+    pui8Buf[3] = (uint8_t)(ui16Index >> 8);
+    pui8Buf[4] = ui8Period;
+    pui8Buf[5] = (uint8_t)((piShift[SENSOR_CHAN_TEMP] << 4) |
+                           piShift[SENSOR_CHAN_LIGHT]);
+    pui8Buf[6] = (uint8_t)pui16Recon[SENSOR_CHAN_TEMP];
+    pui8Buf[7] = (uint8_t)((pui16Recon[SENSOR_CHAN_TEMP] >> 8) |
+                           (pui16Recon[SENSOR_CHAN_LIGHT] << 4));
+    pui8Buf[8] = (uint8_t)(pui16Recon[SENSOR_CHAN_LIGHT] >> 4);
+
+    for(i = 1; i < iCount; i++)
+    {
+        ui8Byte = 0;
+        for(iChan = 0; iChan < SENSOR_CHANNELS; iChan++)
+        {
+            //
+            // Round the step from the reconstruction to the channel's scale
+            // and clamp it to a signed nibble.
+            //
+            iDiff = (int)psSamples[i].pui16Value[iChan] -
+                    (int)pui16Recon[iChan];
+            iHalf = piShift[iChan] ? (1 << (piShift[iChan] - 1)) : 0;
+            if(iDiff >= 0)
+            {
+                iQ = (iDiff + iHalf) >> piShift[iChan];
+            }
+            else
+            {
+                iQ = -((-iDiff + iHalf) >> piShift[iChan]);
+            }
+            if(iQ > 7)
+            {
+                iQ = 7;
+            }
+            else if(iQ < -8)
+            {
+                iQ = -8;
+            }
+            pui16Recon[iChan] = SensorApply(pui16Recon[iChan], iQ,
+                                            piShift[iChan]);
+            ui8Byte = (uint8_t)((ui8Byte << 4) | (iQ & 0x0F));
+        }
+        pui8Buf[SENSOR_BATCH_HDR_LEN + i - 1] = ui8Byte;
+    }
+
+    return(SENSOR_BATCH_HDR_LEN + iCount - 1);
+}
+
+//
+// Decode a batch into psSamples, which must hold SENSOR_BATCH_MAX samples.
+// Returns the sample count, or -1 if the buffer is not a valid batch.
+//
+int
+SensorBatchDecode(const uint8_t *pui8Buf, int iLen, uint16_t *pui16Index,
+                  uint8_t *pui8Period, tSensorSample *psSamples)
+{
+    int iCount, i, iChan, iDelta;
+    int piShift[SENSOR_CHANNELS];
+    uint8_t ui8Byte;
+
+    if((iLen < SENSOR_BATCH_HDR_LEN) || (pui8Buf[0] != SENSOR_MSG_BATCH))
+    {
+        return(-1);
+    }
+    iCount = pui8Buf[1];
+    if((iCount < 1) || (iCount > SENSOR_BATCH_MAX) ||
+       (iLen < SENSOR_BATCH_HDR_LEN + iCount - 1))
+    {
+        return(-1);
+    }
+
+    *pui16Index = pui8Buf[2] | (pui8Buf[3] << 8);
+    *pui8Period = pui8Buf[4];
+    piShift[SENSOR_CHAN_TEMP] = pui8Buf[5] >> 4;
+    piShift[SENSOR_CHAN_LIGHT] = pui8Buf[5] & 0x0F;
+    psSamples[0].pui16Value[SENSOR_CHAN_TEMP] =
+        pui8Buf[6] | ((pui8Buf[7] & 0x0F) << 8);
+    psSamples[0].pui16Value[SENSOR_CHAN_LIGHT] =
+        (pui8Buf[7] >> 4) | (pui8Buf[8] << 4);
+
+    for(i = 1; i < iCount; i++)
+    {
+        ui8Byte = pui8Buf[SENSOR_BATCH_HDR_LEN + i - 1];
+        for(iChan = 0; iChan < SENSOR_CHANNELS; iChan++)
+        {
+            //
+            // Channel 0 is in the high nibble.  Sign extend the nibble.
+            //
+            iDelta = (ui8Byte >> (4 * (SENSOR_CHANNELS - 1 - iChan))) & 0x0F;
+            iDelta = (iDelta ^ 0x08) - 0x08;
+            psSamples[i].pui16Value[iChan] =
+                SensorApply(psSamples[i - 1].pui16Value[iChan], iDelta,
+                            piShift[iChan]);
+        }
+    }
+
+    return(iCount);
+}
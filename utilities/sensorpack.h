@@ -0,0 +1,51 @@
+//*****************************************************************************
+//
+// sensorpack.h - Delta encoded sample batches sent by sensor nodes.
+//
+// A batch fits in one secure poll payload:
+//
+//     [0]     SENSOR_MSG_BATCH
+//     [1]     Sample count, n
+//     [2..3]  Index of the first sample (low 16 bits, little-endian)
+//     [4]     Sample period in units of 10 ms
+//     [5]     Delta shift per channel: temperature (high nibble), light
+//     [6..8]  First sample, two packed 12-bit values (temperature first)
+//     [9..]   n - 1 bytes, one signed 4-bit delta per channel, temperature
+//             in the high nibble, scaled by 2^shift
+//
+// Samples are timestamped implicitly: sample i of a batch was taken at
+// (index + i) * period.  Deltas are taken from the decoder's reconstruction,
+// so quantisation never accumulates; a batch is lossless whenever
+// consecutive samples differ by no more than 7 counts.
+//
+//*****************************************************************************
+
+#ifndef __SENSORPACK_H__
+#define __SENSORPACK_H__
+
+#include "secure.h"
+
+#define SENSOR_MSG_BATCH        0xB1
+
+#define SENSOR_CHAN_TEMP        0 // Internal temperature sensor
+#define SENSOR_CHAN_LIGHT       1 // Photoresistor divider on AIN0
+#define SENSOR_CHANNELS         2
+
+#define SENSOR_BATCH_HDR_LEN    9
+#define SENSOR_BATCH_MAX        (SECURE_MAX_PAYLOAD - SENSOR_BATCH_HDR_LEN + 1)
+
+#define SENSOR_SAMPLE_MAX       0x0FFF // 12-bit ADC
+
+typedef struct
+{
+    uint16_t pui16Value[SENSOR_CHANNELS];
+}
+tSensorSample;
+
+int SensorBatchEncode(const tSensorSample *psSamples, int iCount,
+                      uint16_t ui16Index, uint8_t ui8Period,
+                      uint8_t *pui8Buf);
+int SensorBatchDecode(const uint8_t *pui8Buf, int iLen, uint16_t *pui16Index,
+                      uint8_t *pui8Period, tSensorSample *psSamples);
+
+#endif
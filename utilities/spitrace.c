@@ -0,0 +1,88 @@
+//*****************************************************************************
+//
+// spitrace.c - Ring buffer trace of SPI transactions with the radio.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "ramfunc.h"
+#include "spitrace.h"
+
+#ifdef SPI_TRACE
+static tSPITraceEntry g_psSPITrace[SPI_TRACE_ENTRIES];
+
+//
+// Transactions recorded since the last clear.  The newest
+// SPI_TRACE_ENTRIES of them are kept.
+//
+static uint32_t g_ui32SPITraceCount;
+
+static bool g_bSPITraceEnabled = true;
+
+//
+// Record a transaction.  Called with chip select already released.  Not
+// reentrant, so all SPI traffic must come from one context.
+//
+RAMFUNC void
+SPITraceRecord(uint32_t ui32Start, uint32_t ui32End, uint8_t ui8Cmd,
+               int iLen, uint8_t ui8Status, uint8_t ui8Flags)
+{
+    tSPITraceEntry *psEntry;
+    uint32_t ui32Cycles;
+
+    if(!g_bSPITraceEnabled)
+    {
+        return;
+    }
+
+    psEntry = &g_psSPITrace[g_ui32SPITraceCount & (SPI_TRACE_ENTRIES - 1)];
+    ui32Cycles = ui32End - ui32Start;
+    psEntry->ui32Start = ui32Start;
+    psEntry->ui16Cycles = (ui32Cycles > 0xFFFF) ? 0xFFFF : ui32Cycles;
+    psEntry->ui8Cmd = ui8Cmd;
+    psEntry->ui8Len = iLen;
+    psEntry->ui8Status = ui8Status;
+    psEntry->ui8Flags = ui8Flags;
+    g_ui32SPITraceCount++;
+}
+
+//
+// Pause or resume recording, so the ring can be read out unchanged.
+//
+void
+SPITraceEnable(bool bEnable)
+{
+    g_bSPITraceEnabled = bEnable;
+}
+
+void
+SPITraceClear(void)
+{
+    memset(g_psSPITrace, 0, sizeof(g_psSPITrace));
+    g_ui32SPITraceCount = 0;
+}
+
+uint32_t
+SPITraceCount(void)
+{
+    return(g_ui32SPITraceCount);
+}
+
+//
+// Return the entry for transaction number ui32Seq, counting from the last
+// clear, or 0 if it has been overwritten or not yet made.
+//
+const tSPITraceEntry *
+SPITraceGet(uint32_t ui32Seq)
+{
+    if((ui32Seq >= g_ui32SPITraceCount) ||
+       (g_ui32SPITraceCount - ui32Seq > SPI_TRACE_ENTRIES))
+    {
+        return(0);
+    }
+    return(&g_psSPITrace[ui32Seq & (SPI_TRACE_ENTRIES - 1)]);
+}
+#endif
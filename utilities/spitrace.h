@@ -0,0 +1,70 @@
+//*****************************************************************************
+//
+// spitrace.h - Ring buffer trace of SPI transactions with the radio.
+//
+// Build with SPI_TRACE defined to record every transaction made through
+// SPISend() and SPIReceive().  Without it the hooks compile to nothing and
+// the ring takes no RAM.  The shipped master project leaves it out; add it
+// to the target's defines to trace.
+//
+//*****************************************************************************
+
+#ifndef __SPITRACE_H__
+#define __SPITRACE_H__
+
+//
+// Entries kept; must be a power of two.
+//
+#define SPI_TRACE_ENTRIES       256
+
+//
+// Entry flags.
+//
+#define SPI_TRACE_READ          0x01 // Made with SPIReceive()
+#define SPI_TRACE_STATUS        0x02 // ui8Status holds the radio's STATUS
+
+//
+// One transaction.  Dumped as raw little-endian bytes, so the layout is
+// part of the dump format read by host/spitrace.py.
+//
+typedef struct
+{
+    //
+    // Cycle count when chip select was asserted, and the cycles until it
+    // was released, saturating at 0xFFFF.
+    //
+    uint32_t ui32Start;
+
+    uint16_t ui16Cycles;
+
+    //
+    // First byte sent: the opcode, with the register for register accesses.
+    //
+    uint8_t ui8Cmd;
+
+    uint8_t ui8Len;
+
+    uint8_t ui8Status;
+
+    uint8_t ui8Flags;
+
+    uint16_t ui16Reserved;
+}
+tSPITraceEntry;
+
+#ifdef SPI_TRACE
+void SPITraceRecord(uint32_t ui32Start, uint32_t ui32End, uint8_t ui8Cmd,
+                    int iLen, uint8_t ui8Status, uint8_t ui8Flags);
+void SPITraceEnable(bool bEnable);
+void SPITraceClear(void);
+uint32_t SPITraceCount(void);
+const tSPITraceEntry *SPITraceGet(uint32_t ui32Seq);
+#else
+#define SPITraceRecord(ui32Start, ui32End, ui8Cmd, iLen, ui8Status, ui8Flags)
+#define SPITraceEnable(bEnable)
+#define SPITraceClear()
+#define SPITraceCount()         0
+#define SPITraceGet(ui32Seq)    ((const tSPITraceEntry *)0)
+#endif
+
+#endif
@@ -0,0 +1,74 @@
+//*****************************************************************************
+//
+// tdma.h - Polling schedule messages between the master and its nodes.
+//
+// Network time is divided into periods of 2^TDMA_PERIOD_LOG2 us.  A node
+// holding slot s of n sends its poll when network time modulo the period
+// reaches s * period / n.  A power of two period keeps the slots aligned
+// across the 32-bit wrap of network time.
+//
+// A node need not poll every period.  At pace p it polls in its slot every
+// 2^p periods, counting from its last poll, so nodes at different paces
+// still never share a slot.  A node goes to TDMA_PACE_ACTIVE when it is
+// sent a command, as more tend to follow, and slows down by one step after
+// every TDMA_PACE_IDLE_POLLS polls that bring none.  The master can set a
+// node's pace with a hint in front of any ACK payload, and learns the pace
+// from the status in each poll.
+//
+// The master has room for one ACK payload at a time, staged for the slotted
+// node it expects to poll next, so a free-running node cannot count on
+// finding its own payload waiting.  Instead a free-running node that polls
+// the master directly sets TDMA_STATUS_FOLLOW and polls again
+// TDMA_JOIN_FOLLOW_US later, and the master stages that node's payload for
+// the follow-up.  A node with more to send than fits in one poll, such as
+// a sensor node with samples waiting, does the same from its slot, so its
+// extra polls neither take nor displace another node's payload.
+//
+//*****************************************************************************
+
+#ifndef __TDMA_H__
+#define __TDMA_H__
+
+#define TDMA_MSG_ASSIGN         0xC3 // [C3][slot][slots][period log2], master to node
+#define TDMA_MSG_STATUS         0xC4 // [C4][slot][slots][retries][pace], node to master
+#define TDMA_MSG_PACE           0xC5 // [C5][pace], master to node
+
+#define TDMA_ASSIGN_LEN         4
+#define TDMA_STATUS_LEN         5
+#define TDMA_PACE_LEN           2
+
+//
+// Flags above the pace in the status pace byte.
+//
+#define TDMA_STATUS_FREE        0x80 // Polling free-running, not in a slot
+#define TDMA_STATUS_FOLLOW      0x40 // A follow-up poll comes shortly
+#define TDMA_STATUS_PACE_M      0x0F
+
+//
+// About 524 ms, the quickest a node with a slot polls.
+//
+#define TDMA_PERIOD_LOG2        19
+
+//
+// Paces run from TDMA_PACE_ACTIVE, every period, to TDMA_PACE_MAX, every
+// 64 periods or about 33.6 s.  Nodes start at TDMA_PACE_START, about 4.2 s,
+// close to the free-running poll interval they use until given a slot.
+//
+#define TDMA_PACE_ACTIVE        0
+#define TDMA_PACE_START         3
+#define TDMA_PACE_MAX           6
+#define TDMA_PACE_IDLE_POLLS    4
+
+//
+// A slot closer than this is skipped for the next period's, so a node that
+// has just polled does not poll again within the same slot.
+//
+#define TDMA_GUARD_US           10000
+
+//
+// How long after a poll flagged TDMA_STATUS_FOLLOW its follow-up is sent,
+// long enough for the master to finish the first poll and stage the reply.
+//
+#define TDMA_JOIN_FOLLOW_US     5000
+
+#endif
@@ -0,0 +1,236 @@
+//*****************************************************************************
+//
+// timesync.c - Network time base shared by the master and its nodes.
+//
+//*****************************************************************************
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "ramfunc.h"
+#include "timesync.h"
+
+void
+TimeClockInit(tTimeClock *psClock, uint32_t ui32ClockHz, uint32_t ui32Raw)
+{
+    psClock->ui32Last = ui32Raw;
+    psClock->ui32Frac = 0;
+    psClock->ui32Micros = 0;
+    psClock->ui32TicksPerUs = ui32ClockHz / 1000000;
+}
+
+//
+// Advance the clock to a new timer reading and return the time in
+// microseconds.  Not reentrant; callers in more than one context must mask
+// interrupts around it.
+//
+RAMFUNC uint32_t
+TimeClockUpdate(tTimeClock *psClock, uint32_t ui32Raw)
+{
+    uint32_t ui32Delta = ui32Raw - psClock->ui32Last;
+
+    psClock->ui32Last = ui32Raw;
+    psClock->ui32Micros += ui32Delta / psClock->ui32TicksPerUs;
+    psClock->ui32Frac += ui32Delta % psClock->ui32TicksPerUs;
+    if(psClock->ui32Frac >= psClock->ui32TicksPerUs)
+    {
+        psClock->ui32Frac -= psClock->ui32TicksPerUs;
+        psClock->ui32Micros++;
+    }
+
+    return(psClock->ui32Micros);
+}
+
+void
+TimeSyncInit(tTimeSync *psSync)
+{
+    memset(psSync, 0, sizeof(tTimeSync));
+}
+
+//
+// Record the local time a poll with sequence number ui16Seq was sent.
+//
+void
+TimeSyncPollSent(tTimeSync *psSync, uint16_t ui16Seq, uint32_t ui32Local)
+{
+    tTimePoll *psPoll = &psSync->psPolls[ui16Seq & 1];
+
+    psPoll->ui16Seq = ui16Seq;
+    psPoll->ui32Sent = ui32Local;
+    psPoll->bAcked = false;
+    psSync->ui8Latest = ui16Seq & 1;
+}
+
+//
+// Record the local time the ACK to the latest poll arrived, with or without
+// a payload.
+//
+void
+TimeSyncAckReceived(tTimeSync *psSync, uint32_t ui32Local)
+{
+    tTimePoll *psPoll = &psSync->psPolls[psSync->ui8Latest];
+
+    if(!psPoll->bAcked)
+    {
+        psPoll->ui32Acked = ui32Local;
+        psPoll->bAcked = true;
+    }
+}
+
+//
+// Convert local time to network time.  Before the first sync the two are
+// taken to be equal.
+//
+uint32_t
+TimeSyncToNetwork(const tTimeSync *psSync, uint32_t ui32Local)
+{
+    int32_t i32Delta;
+
+    if(!psSync->bSynced)
+    {
+        return(ui32Local);
+    }
+
+    i32Delta = (int32_t)(ui32Local - psSync->ui32RefLocal);
+    return(psSync->ui32RefNet + i32Delta +
+           (int32_t)(((int64_t)i32Delta * psSync->i32RatePPB) / 1000000000));
+}
+
+uint32_t
+TimeSyncToLocal(const tTimeSync *psSync, uint32_t ui32Net)
+{
+    int32_t i32Delta;
+
+    if(!psSync->bSynced)
+    {
+        return(ui32Net);
+    }
+
+    i32Delta = (int32_t)(ui32Net - psSync->ui32RefNet);
+    return(psSync->ui32RefLocal + i32Delta -
+           (int32_t)(((int64_t)i32Delta * psSync->i32RatePPB) / 1000000000));
+}
+
+//
+// Take a TIMESYNC_MSG_TIME message from the master.  Returns true if the
+// local clock was corrected.
+//
+bool
+TimeSyncUpdate(tTimeSync *psSync, const uint8_t *pui8Msg, int iLen)
+{
+    tTimePoll *psPoll;
+    uint16_t ui16Seq;
+    uint32_t ui32Arrival, ui32Mid, ui32Interval;
+    int32_t i32Residual;
+    int64_t i64Rate;
+
+    if((iLen < TIMESYNC_TIME_LEN) || (pui8Msg[0] != TIMESYNC_MSG_TIME))
+    {
+        return(false);
+    }
+    ui16Seq = pui8Msg[1] | (pui8Msg[2] << 8);
+    memcpy(&ui32Arrival, pui8Msg + 3, 4);
+
+    psPoll = &psSync->psPolls[ui16Seq & 1];
+    if((psPoll->ui16Seq != ui16Seq) || !psPoll->bAcked ||
+       (psPoll->ui32Acked - psPoll->ui32Sent > TIMESYNC_MAX_RTT_US))
+    {
+        psSync->ui32Rejected++;
+        return(false);
+    }
+    psPoll->bAcked = false;
+
+    //
+    // The master's timestamp is taken to fall halfway through the round
+    // trip.
+    //
+    psSync->ui32RTT = psPoll->ui32Acked - psPoll->ui32Sent;
+    ui32Mid = psPoll->ui32Sent + (psSync->ui32RTT / 2);
+    i32Residual = (int32_t)(ui32Arrival - TimeSyncToNetwork(psSync, ui32Mid));
+
+    if(psSync->bSynced && ((i32Residual > TIMESYNC_STEP_US) ||
+                           (i32Residual < -TIMESYNC_STEP_US)))
+    {
+        if(++psSync->ui32Outliers < TIMESYNC_MAX_OUTLIERS)
+        {
+            psSync->ui32Rejected++;
+            return(false);
+        }
+
+        //
+        // Consistently far off; the master has probably restarted.
+        //
+        psSync->bSynced = false;
+    }
+
+    if(psSync->bSynced)
+    {
+        //
+        // The residual built up over the interval since the last sync, so it
+        // measures the remaining frequency error.  Correct half of it per
+        // update to keep measurement noise from steering the rate.
+        //
+        ui32Interval = ui32Mid - psSync->ui32RefLocal;
+        if(ui32Interval > 0)
+        {
+            i64Rate = psSync->i32RatePPB +
+                      ((int64_t)i32Residual * 500000000) / ui32Interval;
+            if(i64Rate > TIMESYNC_MAX_RATE_PPB)
+            {
+                i64Rate = TIMESYNC_MAX_RATE_PPB;
+            }
+            else if(i64Rate < -TIMESYNC_MAX_RATE_PPB)
+            {
+                i64Rate = -TIMESYNC_MAX_RATE_PPB;
+            }
+            psSync->i32RatePPB = (int32_t)i64Rate;
+        }
+        psSync->i32Residual = i32Residual;
+    }
+    else
+    {
+        //
+        // Step to the master's time.  The jump is not a skew, so is not
+        // reported as one.
+        //
+        psSync->i32RatePPB = 0;
+        psSync->i32Residual = 0;
+        psSync->bSynced = true;
+    }
+
+    psSync->ui32RefLocal = ui32Mid;
+    psSync->ui32RefNet = ui32Arrival;
+    psSync->ui32Outliers = 0;
+    psSync->ui32Syncs++;
+
+    return(true);
+}
+
+//
+// Build the TIMESYNC_MSG_SKEW report a node sends in its polls.
+//
+int
+TimeSyncSkewEncode(const tTimeSync *psSync, uint8_t *pui8Buf)
+{
+    pui8Buf[0] = TIMESYNC_MSG_SKEW;
+    memcpy(pui8Buf + 1, &psSync->i32Residual, 4);
+    pui8Buf[5] = psSync->ui32RTT & 0xFF;
+    pui8Buf[6] = (psSync->ui32RTT >> 8) & 0xFF;
+
+    return(TIMESYNC_SKEW_LEN);
+}
+
+//
+// Build the TIMESYNC_MSG_TIME message the master returns for a poll.
+//
+int
+TimeSyncTimeEncode(uint16_t ui16Seq, uint32_t ui32Arrival, uint8_t *pui8Buf)
+{
+    pui8Buf[0] = TIMESYNC_MSG_TIME;
+    pui8Buf[1] = ui16Seq & 0xFF;
+    pui8Buf[2] = ui16Seq >> 8;
+    memcpy(pui8Buf + 3, &ui32Arrival, 4);
+
+    return(TIMESYNC_TIME_LEN);
+}
@@ -0,0 +1,126 @@
+//*****************************************************************************
+//
+// timesync.h - Network time base shared by the master and its nodes.
+//
+// Network time is the master's microsecond clock.  It reaches a node in two
+// steps: the master timestamps each poll as it arrives and returns that time
+// in the ACK payload of the node's next poll.  The node, which recorded when
+// it sent the poll and when the ACK came back, takes the midpoint of that
+// round trip as the local time matching the master's timestamp.
+//
+//*****************************************************************************
+
+#ifndef __TIMESYNC_H__
+#define __TIMESYNC_H__
+
+//
+// Message types.  All multi-byte fields are little-endian.
+//
+#define TIMESYNC_MSG_TIME       0xC1 // [C1][seq 2][arrival 4], master to node
+#define TIMESYNC_MSG_SKEW       0xC2 // [C2][residual 4][rtt 2], node to master
+#define TIMESYNC_MSG_AT         0xA4 // [A4][time 4][command], master to node
+
+#define TIMESYNC_TIME_LEN       7
+#define TIMESYNC_SKEW_LEN       7
+#define TIMESYNC_AT_HDR_LEN     5
+
+//
+// Round trips longer than this include retransmissions, which make the two
+// directions unequal, so they are not used.
+//
+#define TIMESYNC_MAX_RTT_US     1000
+
+//
+// An offset error larger than this is treated as a bad measurement until it
+// has been seen TIMESYNC_MAX_OUTLIERS times in a row, after which the clock
+// is stepped.
+//
+#define TIMESYNC_STEP_US        5000
+#define TIMESYNC_MAX_OUTLIERS   3
+
+//
+// Largest frequency correction applied, in parts per billion.
+//
+#define TIMESYNC_MAX_RATE_PPB   200000
+
+//
+// Microsecond clock extended in software from a free-running 32-bit timer
+// that counts up at the system clock.  Must be updated at least once per
+// timer wrap.
+//
+typedef struct
+{
+    uint32_t ui32Last;
+
+    uint32_t ui32Frac;
+
+    uint32_t ui32Micros;
+
+    uint32_t ui32TicksPerUs;
+}
+tTimeClock;
+
+//
+// A poll sent by the node, kept until the master returns its arrival time.
+//
+typedef struct
+{
+    uint16_t ui16Seq;
+
+    bool bAcked;
+
+    uint32_t ui32Sent;
+
+    uint32_t ui32Acked;
+}
+tTimePoll;
+
+//
+// Node side clock discipline.  Network time is extrapolated from the last
+// sync point using the estimated frequency error.
+//
+typedef struct
+{
+    tTimePoll psPolls[2];
+
+    uint8_t ui8Latest;
+
+    bool bSynced;
+
+    uint32_t ui32RefLocal;
+
+    uint32_t ui32RefNet;
+
+    int32_t i32RatePPB;
+
+    //
+    // Offset error found by the last measurement, in microseconds, and the
+    // round trip it was taken over.
+    //
+    int32_t i32Residual;
+
+    uint32_t ui32RTT;
+
+    uint32_t ui32Syncs;
+
+    uint32_t ui32Rejected;
+
+    uint32_t ui32Outliers;
+}
+tTimeSync;
+
+void TimeClockInit(tTimeClock *psClock, uint32_t ui32ClockHz,
+                   uint32_t ui32Raw);
+uint32_t TimeClockUpdate(tTimeClock *psClock, uint32_t ui32Raw);
+
+void TimeSyncInit(tTimeSync *psSync);
+void TimeSyncPollSent(tTimeSync *psSync, uint16_t ui16Seq, uint32_t ui32Local);
+void TimeSyncAckReceived(tTimeSync *psSync, uint32_t ui32Local);
+bool TimeSyncUpdate(tTimeSync *psSync, const uint8_t *pui8Msg, int iLen);
+uint32_t TimeSyncToNetwork(const tTimeSync *psSync, uint32_t ui32Local);
+uint32_t TimeSyncToLocal(const tTimeSync *psSync, uint32_t ui32Net);
+int TimeSyncSkewEncode(const tTimeSync *psSync, uint8_t *pui8Buf);
+int TimeSyncTimeEncode(uint16_t ui16Seq, uint32_t ui32Arrival,
+                       uint8_t *pui8Buf);
+
+#endif